@@ -6,6 +6,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -71,6 +72,9 @@ public:
   size_t size() const;
   size_t cur_size() const;
   bool is_empty() const;
+  // 按存储顺序返回所有键值对和事务 id, 同一个 key 的多个版本都会返回
+  std::vector<std::tuple<std::string, std::string, uint64_t>>
+  get_entries() const;
   std::optional<size_t> get_idx_binary(const std::string &key,
                                        uint64_t tranc_id);
 
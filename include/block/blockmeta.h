@@ -27,6 +27,12 @@
  * --------------------------------------------------------------------------------------------------------------
  * 其中, num_entries 表示 metadata 数组的长度, Hash 是 metadata
  数组的哈希值(只包括数组部分, 不包括 num_entries ), 用于校验 metadata 的完整性
+
+ * Hash 之后是每个 block 的事务 id 范围, 旧版本的 sst 没有这一部分:
+ * --------------------------------------------------------------------------
+ * | min_tranc_id (64) | max_tranc_id (64) | ... | Tranc Hash (32) |
+ * --------------------------------------------------------------------------
+ * 按 MetaEntry 的顺序排列, Tranc Hash 只包括事务 id 范围的数组部分
  */
 
 namespace tiny_lsm {
@@ -37,12 +43,16 @@ public:
   size_t offset;         // 块在文件中的偏移量
   std::string first_key; // 块的第一个key
   std::string last_key;  // 块的最后一个key
+  // 块中事务 id 的范围, 未知时为 [0, UINT64_MAX], 不会跳过任何块
+  uint64_t min_tranc_id;
+  uint64_t max_tranc_id;
   static void encode_meta_to_slice(std::vector<BlockMeta> &meta_entries,
                                    std::vector<uint8_t> &metadata);
   static std::vector<BlockMeta>
   decode_meta_from_slice(const std::vector<uint8_t> &metadata);
   BlockMeta();
   BlockMeta(size_t offset, const std::string &first_key,
-            const std::string &last_key);
+            const std::string &last_key, uint64_t min_tranc_id = 0,
+            uint64_t max_tranc_id = UINT64_MAX);
 };
 } // namespace tiny_lsm
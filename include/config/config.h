@@ -17,10 +17,30 @@ private:
   long long lsm_per_mem_size_limit_;
   int lsm_block_size_;
   int lsm_sst_level_ratio_;
+  std::string memtable_rep_;
+  int memtable_hash_bucket_count_;
+  int write_group_max_size_;
+  bool write_parallel_apply_;
+  std::string sst_sync_mode_;
+  int tranc_commit_stripes_;
+  int tranc_commit_history_;
+  int tranc_lock_stripes_;
+  int tranc_lock_timeout_ms_;
+
+  // --- WAL ---
+  int wal_buffer_size_;
+  long long wal_file_size_limit_;
+  std::string wal_sync_mode_;
+  long long wal_sync_interval_ms_;
+  long long wal_sync_bytes_;
+  bool wal_preallocate_;
+  int wal_recycle_file_num_;
+  int wal_recovery_threads_;
 
   // --- LSM Cache ---
   int lsm_block_cache_capacity_;
   int lsm_block_cache_k_;
+  long long lsm_row_cache_capacity_bytes_;
 
   // --- Redis Headers/Separators ---
   std::string redis_expire_header_;
@@ -28,6 +48,8 @@ private:
   std::string redis_field_prefix_;
   char redis_field_separator_;
   char redis_list_separator_;
+  std::string redis_list_value_preffix_;
+  std::string redis_list_prefix_;
   std::string redis_sorted_set_prefix_;
   int redis_sorted_set_score_len_;
   std::string redis_set_prefix_;
@@ -35,6 +57,13 @@ private:
   // --- Bloom Filter ---
   int bloom_filter_expected_size_;
   double bloom_filter_expected_error_rate_;
+  double bloom_filter_bits_per_key_;
+  std::vector<double> bloom_filter_level_bits_per_key_;
+  std::string sst_filter_type_;
+  std::string prefix_extractor_;
+  int prefix_extractor_fixed_len_;
+  double memtable_prefix_bloom_size_ratio_;
+  bool sst_range_filter_;
 
   // Private method to set default values
   void setDefaultValues();
@@ -58,21 +87,74 @@ public:
   long long getLsmPerMemSizeLimit() const;
   int getLsmBlockSize() const;
   int getLsmSstLevelRatio() const;
+  // memtable 的存储结构: "skiplist", "hash_skiplist" 或 "vector"
+  const std::string &getMemtableRep() const;
+  // hash_skiplist 的桶数量
+  int getMemtableHashBucketCount() const;
+  // 组提交时一组最多包含的写入者数量
+  int getWriteGroupMaxSize() const;
+  // 组内的写入者是否并行写入 memtable
+  bool getWriteParallelApply() const;
+  // 新建 SST 的同步方式: "none", "os", "fdatasync", "fsync" 或 "dsync"
+  const std::string &getSstSyncMode() const;
+  // 事务提交校验使用的最近写入表的条带数量
+  int getTrancCommitStripes() const;
+  // 最近写入表每个条带最多保留的 key 数量
+  int getTrancCommitHistory() const;
+  // 悲观事务行锁管理器的条带数量
+  int getTrancLockStripes() const;
+  // 悲观事务等待行锁的超时时间(毫秒)
+  int getTrancLockTimeoutMs() const;
+
+  // wal 缓冲区中最多积累的记录数, 超过后写入文件
+  int getWalBufferSize() const;
+  // 单个 wal 文件的大小上限(字节), 超过后切换到新文件
+  long long getWalFileSizeLimit() const;
+  // 需要同步的 wal 写入的同步方式, 取值与 SST_SYNC_MODE 相同
+  const std::string &getWalSyncMode() const;
+  // 大于 0 时由后台线程每隔这么多毫秒同步一次 wal, 写入只写到操作系统
+  long long getWalSyncIntervalMs() const;
+  // 大于 0 时未同步的 wal 数据达到这么多字节就由后台线程同步
+  long long getWalSyncBytes() const;
+  // 新建 wal 文件时是否预先分配 WAL_FILE_SIZE_LIMIT 字节的磁盘空间
+  bool getWalPreallocate() const;
+  // 最多保留多少个已完成检查点的 wal 文件用于复用, 0 表示直接删除
+  int getWalRecycleFileNum() const;
+  // 恢复时最多同时读取和解码的 wal 文件数
+  int getWalRecoveryThreads() const;
 
   int getLsmBlockCacheCapacity() const;
   int getLsmBlockCacheK() const;
+  // 行缓存容量(字节), 0 表示不启用行缓存
+  long long getLsmRowCacheCapacityBytes() const;
 
   const std::string &getRedisExpireHeader() const;
   const std::string &getRedisHashValuePreffix() const;
   const std::string &getRedisFieldPrefix() const;
   char getRedisFieldSeparator() const;
   char getRedisListSeparator() const;
+  // 链表元数据 value 的前缀和元素 key 的前缀
+  const std::string &getRedisListValuePreffix() const;
+  const std::string &getRedisListPrefix() const;
   const std::string &getRedisSortedSetPrefix() const;
   int getRedisSortedSetScoreLen() const;
   const std::string &getRedisSetPrefix() const;
 
   int getBloomFilterExpectedSize() const;
   double getBloomFilterExpectedErrorRate() const;
+  double getBloomFilterBitsPerKey() const;
+  // 返回 level 层 SST 的布隆过滤器每个 key 分配的位数
+  // 未单独配置的 level 使用 BLOOM_FILTER_BITS_PER_KEY
+  double getBloomFilterBitsPerKey(size_t level) const;
+  // SST 使用的过滤器类型: "bloom" 或 "xor"
+  const std::string &getSstFilterType() const;
+  // 前缀提取器类型: "none", "fixed" 或 "redis"
+  const std::string &getPrefixExtractor() const;
+  int getPrefixExtractorFixedLen() const;
+  // memtable 前缀布隆过滤器占 memtable 大小限制的比例, 0 表示不使用
+  double getMemtablePrefixBloomSizeRatio() const;
+  // 是否为 SST 构建范围过滤器
+  bool getSstRangeFilter() const;
 
   static const TomlConfig &
   getInstance(const std::string &config_path = "config.toml");
@@ -81,5 +163,8 @@ public:
   void modify_lsm_tol_mem_size_limit(long long one);
   void modify_lsm_per_mem_size_limit(long long one);
   void modify_lsm_block_size(int one);
+  void modify_lsm_row_cache_capacity_bytes(long long one);
+  void modify_memtable_rep(const std::string &one);
+  void modify_write_parallel_apply(bool one);
 };
 } // namespace tiny_lsm
\ No newline at end of file
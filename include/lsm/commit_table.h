@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 最近提交的写入: key -> 最后一次提交写入该 key 的 tranc_id
+// 用于乐观事务提交时的冲突检测, 代替对 memtable 和 sst 的查询
+// 按 key 的哈希值分为多个条带, 提交时只锁住写集合涉及的条带,
+// 写集合不相交的提交可以并行进行, 读操作不经过这里
+// 每个条带最多保留 capacity 个 key, 淘汰的 key 中最大的 tranc_id 作为条带的下限,
+// 事务 id 不小于下限时表中的历史是完整的, 否则无法判断
+class CommitTable {
+public:
+  CommitTable(size_t stripe_count, size_t stripe_capacity);
+
+  using LockSet = std::vector<std::unique_lock<std::mutex>>;
+
+  // 锁住 keys 涉及的所有条带, 按条带下标升序加锁避免死锁
+  LockSet lock(const std::vector<std::string> &keys);
+
+  // 以下两个函数需要调用方通过 lock 持有 key 所在条带的锁
+
+  // key 是否被 tranc_id 之后的写入者提交过
+  // 表中的历史不足以判断时返回 std::nullopt, 需要回退到引擎中查询
+  std::optional<bool> has_newer_commit(const std::string &key,
+                                       uint64_t tranc_id);
+  // 需要在写入 memtable 之前加锁, 写入之后记录, 期间不释放条带锁
+  // 否则提交校验可能看不到已经生效的写入
+  void record_(const std::string &key, uint64_t tranc_id);
+
+private:
+  struct Stripe {
+    std::mutex mtx;
+    std::unordered_map<std::string, uint64_t> last_commit;
+    // 按写入顺序排列, 用于淘汰最早的记录
+    std::deque<std::pair<std::string, uint64_t>> history;
+    // 被淘汰的 key 最后一次提交的 tranc_id 都不大于 floor
+    uint64_t floor = 0;
+  };
+
+  size_t stripe_index(const std::string &key) const;
+
+  size_t stripe_capacity_;
+  std::vector<std::unique_ptr<Stripe>> stripes_;
+};
+} // namespace tiny_lsm
@@ -1,7 +1,65 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <tuple>
+#include <vector>
+
 namespace tiny_lsm {
 enum class CompactType {
   FullCompact,
 };
-}
+
+class SST;
+
+// 合并多个 sst 中所有版本的键值对, 按 key 升序输出, 同一个 key 按 tranc_id
+// 降序输出, 并保留原本的 tranc_id
+// 版本清理规则: 比 oldest_tranc_id 更新的版本可能被快照或者活跃事务读取,
+// 全部保留; 不大于 oldest_tranc_id 的版本中只有最新的一个仍然可见, 更早的丢弃
+// 合并到最底层时, 可见的最新版本如果是删除标记, 这个 key 的所有版本都可以丢弃
+class CompactionMerger {
+public:
+  // ssts 按新旧顺序排列, 越靠前越新, 相同的 key 和 tranc_id 只保留较新的
+  CompactionMerger(std::vector<std::shared_ptr<SST>> ssts,
+                   uint64_t oldest_tranc_id, bool bottom_level);
+
+  // 获取下一个需要保留的版本, 没有更多数据时返回 false
+  bool next(std::string &key, std::string &value, uint64_t &tranc_id);
+
+private:
+  // 逐个 block 读取一个 sst 中的所有版本
+  struct Cursor {
+    std::shared_ptr<SST> sst;
+    size_t block_idx = 0;
+    std::vector<std::tuple<std::string, std::string, uint64_t>> entries;
+    size_t pos = 0;
+
+    bool load_next_block();
+    const std::tuple<std::string, std::string, uint64_t> &current() const {
+      return entries[pos];
+    }
+  };
+
+  struct CursorGreater {
+    const std::vector<Cursor> *cursors;
+    bool operator()(size_t a, size_t b) const;
+  };
+
+  // 按合并顺序弹出下一个版本, 没有更多数据时返回 false
+  bool pop(std::string &key, std::string &value, uint64_t &tranc_id);
+
+  std::vector<Cursor> cursors_;
+  std::priority_queue<size_t, std::vector<size_t>, CursorGreater> heap_;
+  uint64_t oldest_tranc_id_;
+  bool bottom_level_;
+
+  // 当前处理的 key, 以及其是否已经输出了不大于 oldest_tranc_id 的版本
+  std::string cur_key_;
+  bool has_cur_key_ = false;
+  bool cur_key_settled_ = false;
+  uint64_t last_tranc_id_ = 0;
+};
+} // namespace tiny_lsm
@@ -3,8 +3,10 @@
 #include "../memtable/memtable.h"
 #include "../sst/sst.h"
 #include "compact.h"
+#include "row_cache.h"
 #include "transaction.h"
 #include "two_merge_iterator.h"
+#include "write_batch.h"
 #include <cstddef>
 #include <deque>
 #include <map>
@@ -25,6 +27,7 @@ public:
   std::unordered_map<size_t, std::shared_ptr<SST>> ssts;
   std::shared_mutex ssts_mtx;
   std::shared_ptr<BlockCache> block_cache;
+  std::shared_ptr<RowCache> row_cache;
   std::weak_ptr<TranManager> tran_manager;
   size_t next_sst_id = 0;
   size_t cur_max_level = 0;
@@ -39,9 +42,18 @@ public:
       std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
   get_batch(const std::vector<std::string> &keys, uint64_t tranc_id);
 
+  // 与 get 相同, 但被删除的 key 会返回空 value 和删除标记的 tranc_id
+  std::optional<std::pair<std::string, uint64_t>>
+  get_(const std::string &key, uint64_t tranc_id);
+
   std::optional<std::pair<std::string, uint64_t>>
   sst_get_(const std::string &key, uint64_t tranc_id);
 
+  // 数据库中是否存在 key 的 tranc_id 大于给定值的版本, 用于提交时的冲突检测
+  // 与 get_(key, 0) 不同, 会检查所有可能包含 key 的 sst,
+  // 通过 sst 和 block 的事务 id 范围跳过较早的数据
+  bool has_newer_version(const std::string &key, uint64_t tranc_id);
+
   // 如果触发了刷盘, 返回当前刷入sst的最大事务id
   uint64_t put(const std::string &key, const std::string &value,
                uint64_t tranc_id);
@@ -58,9 +70,25 @@ public:
 
   std::string get_sst_path(size_t sst_id, size_t target_level);
 
+  // preffix 非空时表示 predicate 是对该前缀的匹配,
+  // 前缀过滤器判定不含该前缀的 memtable 和 sst 会被跳过
+  // range 非空时表示 predicate 是对闭区间 [lo, hi] 的匹配,
+  // 范围过滤器判定区间内没有 key 的 sst 会被跳过
   std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
   lsm_iters_monotony_predicate(
-      uint64_t tranc_id, std::function<int(const std::string &)> predicate);
+      uint64_t tranc_id, std::function<int(const std::string &)> predicate,
+      const std::string &preffix = "",
+      const std::optional<std::pair<std::string, std::string>> &range =
+          std::nullopt);
+
+  // 查询所有以 preffix 开头的 key
+  std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+  lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix);
+
+  // 查询闭区间 [lo, hi] 内的所有 key
+  std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+  lsm_iters_range(uint64_t tranc_id, const std::string &lo,
+                  const std::string &hi);
 
   Level_Iterator begin(uint64_t tranc_id);
   Level_Iterator end();
@@ -78,9 +106,22 @@ private:
   full_common_compact(std::vector<size_t> &lx_ids, std::vector<size_t> &ly_ids,
                       size_t level_y);
 
-  std::vector<std::shared_ptr<SST>> gen_sst_from_iter(BaseIterator &iter,
+  std::vector<std::shared_ptr<SST>> gen_sst_from_iter(CompactionMerger &merger,
                                                       size_t target_sst_size,
                                                       size_t target_level);
+
+  // 所有读者都能看到的最小 tranc_id, 更早的历史版本可以清理
+  uint64_t oldest_visible_tranc_id();
+  // level 之下是否还有 sst
+  bool is_bottom_level(size_t level);
+};
+
+// 非事务写入的选项
+struct WriteOptions {
+  // 返回前将 wal 同步到磁盘, 否则 wal 记录可能仍在缓冲区中
+  bool sync = false;
+  // 不写 wal, 崩溃时尚未刷盘的数据会丢失
+  bool disable_wal = false;
 };
 
 class LSM {
@@ -88,19 +129,35 @@ private:
   std::shared_ptr<LSMEngine> engine;
   std::shared_ptr<TranManager> tran_manager_;
 
+  // 非事务写入, value 为空表示删除
+  // 所有 key 使用同一个 tranc_id, 通过写入队列与其他写入者组提交 wal
+  // 写入前获取所有 key 的排他行锁, 等待超时或死锁时抛出异常, 写入不生效
+  void write_(std::vector<std::pair<std::string, std::string>> kvs,
+              const WriteOptions &options);
+
 public:
   LSM(std::string path);
   ~LSM();
 
   std::optional<std::string> get(const std::string &key);
+  // 读取快照中的版本
+  std::optional<std::string> get(const std::string &key,
+                                 const Snapshot &snapshot);
   std::vector<std::pair<std::string, std::optional<std::string>>>
   get_batch(const std::vector<std::string> &keys);
 
-  void put(const std::string &key, const std::string &value);
-  void put_batch(const std::vector<std::pair<std::string, std::string>> &kvs);
+  void put(const std::string &key, const std::string &value,
+           const WriteOptions &options = WriteOptions{});
+  void put_batch(const std::vector<std::pair<std::string, std::string>> &kvs,
+                 const WriteOptions &options = WriteOptions{});
 
-  void remove(const std::string &key);
-  void remove_batch(const std::vector<std::string> &keys);
+  void remove(const std::string &key,
+              const WriteOptions &options = WriteOptions{});
+  void remove_batch(const std::vector<std::string> &keys,
+                    const WriteOptions &options = WriteOptions{});
+  // 原子地应用 batch 中的 put 和 remove
+  void write(const WriteBatch &batch,
+             const WriteOptions &options = WriteOptions{});
 
   using LSMIterator = Level_Iterator;
   LSMIterator begin(uint64_t tranc_id);
@@ -108,13 +165,24 @@ public:
   std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
   lsm_iters_monotony_predicate(
       uint64_t tranc_id, std::function<int(const std::string &)> predicate);
+  std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+  lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix);
+  // 查询闭区间 [lo, hi] 内的所有 key, 范围过滤器可以跳过不相关的 sst
+  std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+  lsm_iters_range(uint64_t tranc_id, const std::string &lo,
+                  const std::string &hi);
   void clear();
   void flush();
   void flush_all();
 
-  // 开启一个事务
+  // 开启一个事务, 默认为乐观事务
   std::shared_ptr<TranContext>
-  begin_tran(const IsolationLevel &isolation_level);
+  begin_tran(const IsolationLevel &isolation_level,
+             TrancMode tranc_mode = TrancMode::OPTIMISTIC);
+
+  // 获取快照, 使用快照的 tranc_id 进行 get, begin 等读取, 用完后需要释放
+  std::shared_ptr<Snapshot> get_snapshot();
+  void release_snapshot(const std::shared_ptr<Snapshot> &snapshot);
 
   // 重设日志级别
   void set_log_level(const std::string &level);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tiny_lsm {
+
+enum class LockStatus { OK, TIMEOUT, DEADLOCK };
+
+// 悲观事务的行锁管理器, 支持共享锁和排他锁
+// 按 key 的哈希值分为多个条带, 每个条带有自己的互斥锁和条件变量
+// 同一个 key 上的等待者按到达顺序排队, 只持有共享锁的事务升级时排在队首
+// 阻塞前在等待图中登记等待的事务, 形成环时当前请求者作为牺牲者返回 DEADLOCK
+class LockManager {
+public:
+  explicit LockManager(size_t stripe_count);
+
+  // 为 tranc_id 加锁, 已经持有的锁可以重入
+  LockStatus lock(uint64_t tranc_id, const std::string &key, bool exclusive,
+                  std::chrono::milliseconds timeout);
+
+  // 释放 tranc_id 在 keys 上持有的锁
+  void unlock(uint64_t tranc_id, const std::vector<std::string> &keys);
+
+  // 被持有或等待中的 key 的数量
+  size_t lock_count();
+
+private:
+  struct Waiter {
+    uint64_t tranc_id;
+    bool exclusive;
+    bool upgrade;
+  };
+
+  struct LockEntry {
+    std::set<uint64_t> shared; // 持有共享锁的事务
+    uint64_t exclusive = 0;    // 持有排他锁的事务, 0 表示没有
+    std::deque<Waiter> waiters;
+  };
+
+  struct Stripe {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::unordered_map<std::string, LockEntry> locks;
+  };
+
+  size_t stripe_index(const std::string &key) const;
+
+  // 以下函数需要持有 key 所在条带的锁
+  static bool compatible(const LockEntry &entry, uint64_t tranc_id,
+                         bool exclusive);
+  static bool grantable(const LockEntry &entry, size_t pos);
+  static void grant(LockEntry &entry, uint64_t tranc_id, bool exclusive);
+  // 请求需要等待的事务: 不兼容的持有者和排在前面的不兼容的等待者
+  static std::vector<uint64_t> blockers(const LockEntry &entry, size_t pos);
+
+  // 登记 tranc_id 的等待关系, 形成环时撤销登记并返回 true
+  bool add_wait(uint64_t tranc_id, const std::vector<uint64_t> &holders);
+  void remove_wait(uint64_t tranc_id);
+
+  std::vector<std::unique_ptr<Stripe>> stripes_;
+
+  // 等待图: 事务 -> 它正在等待的事务
+  std::mutex graph_mtx_;
+  std::unordered_map<uint64_t, std::vector<uint64_t>> wait_for_;
+};
+} // namespace tiny_lsm
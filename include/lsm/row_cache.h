@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 行缓存: 以 user key 为键, 缓存该 key 最新版本的 value 和 tranc_id
+// value 为空串表示最新版本是删除标记, tranc_id 为 0 表示 key 不存在
+// 容量按字节计算, 分片加锁以减少并发读的锁竞争
+class RowCache {
+public:
+  // capacity_bytes 为 0 时不启用行缓存, 所有操作均为空操作
+  RowCache(size_t capacity_bytes, size_t num_shards = 16);
+  ~RowCache();
+
+  bool enabled() const;
+
+  // 查询对事务 tranc_id 可见的缓存结果, tranc_id 为 0 表示查询最新版本
+  // 缓存的版本比 tranc_id 更新时视为未命中, 由调用方走正常的查询路径
+  std::optional<std::pair<std::string, uint64_t>> get(const std::string &key,
+                                                      uint64_t tranc_id);
+
+  // 返回 key 所在分片的版本号, 需要在查询 LSM 之前获取
+  uint64_t version(const std::string &key) const;
+
+  // 写入 key 最新版本的查询结果
+  // 若 key 所在分片在 version 之后发生过失效操作, 说明查询结果可能已过期,
+  // 放弃写入
+  void put(const std::string &key, const std::string &value, uint64_t tranc_id,
+           uint64_t version);
+
+  // key 被写入或删除后调用, 移除缓存项并递增分片版本号
+  void invalidate(const std::string &key);
+  void clear();
+
+  // 获取缓存命中率
+  double hit_rate() const;
+  // 当前占用的字节数
+  size_t size_bytes() const;
+
+private:
+  struct RowCacheItem {
+    std::string key;
+    std::string value;
+    uint64_t tranc_id;
+    size_t charge; // 占用的字节数
+  };
+
+  struct Shard {
+    mutable std::mutex mutex_;
+    size_t capacity_ = 0;
+    size_t usage_ = 0;
+    uint64_t version_ = 0;
+    std::list<RowCacheItem> lru_list_; // 头部为最近访问的缓存项
+    std::unordered_map<std::string, std::list<RowCacheItem>::iterator>
+        cache_map_;
+
+    void erase(std::unordered_map<
+               std::string, std::list<RowCacheItem>::iterator>::iterator it);
+  };
+
+  Shard &get_shard(const std::string &key) const;
+
+  size_t capacity_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  // 记录请求数和命中数
+  std::atomic<size_t> total_requests_{0};
+  std::atomic<size_t> hit_requests_{0};
+};
+} // namespace tiny_lsm
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace tiny_lsm {
+
+// SERIALIZABLE 事务的读写依赖跟踪 (Serializable Snapshot Isolation)
+//
+// 1. 快照: 每个提交的事务在校验通过时分配递增的提交序号, 写入 memtable
+//    后标记为已应用. SERIALIZABLE 事务开始时记录已应用的最大连续序号
+//    start_seq, 之后提交的事务 (提交序号大于 start_seq) 的写入对它不可见,
+//    读取时跳过这些版本, 从而读到开始时的一致快照
+// 2. 读写反依赖: T 读过的 key (或前缀范围) 被并发的 U 写入时, 存在 T -rw-> U
+//    同时有入边和出边的事务 (pivot) 可能构成不可串行化的环,
+//    提交时只终止会形成 T1 -rw-> T2 -rw-> T3 结构且仍未提交的事务
+// 只有 SERIALIZABLE 事务之间保证可串行化, 其他隔离级别的事务提交时只登记
+// 提交序号和写集合, 用于快照的可见性判断和写写冲突检测
+class SerializableTracker {
+public:
+  struct Txn {
+    uint64_t tranc_id = 0;
+    uint64_t start_seq = 0;
+    // 0 表示尚未提交
+    uint64_t commit_seq = 0;
+    bool serializable = false;
+    // 存在并发事务 R -rw-> 当前事务
+    bool in_conflict = false;
+    // 存在当前事务 -rw-> 并发事务 U
+    bool out_conflict = false;
+    std::vector<std::string> writes;
+
+    // 保护读集合, 事务读取时与其他事务的提交校验并发访问
+    std::mutex mtx;
+    std::unordered_set<std::string> reads;
+    std::vector<std::string> read_preffixes;
+  };
+
+  // 开启一个 SERIALIZABLE 事务
+  std::shared_ptr<Txn> begin(uint64_t tranc_id);
+
+  // 读取前登记, 保证之后提交的并发写入者能发现这次读取
+  void record_read(Txn &txn, const std::string &key);
+  void record_range_read(Txn &txn, const std::string &preffix);
+
+  // writer_tranc_id 写入的版本是否属于 txn 的快照
+  bool visible(const Txn &txn, uint64_t writer_tranc_id);
+
+  // 对 txn 不可见的并发事务写入的, 以 preffix 开头的 key
+  std::vector<std::string> invisible_writes(const Txn &txn,
+                                            const std::string &preffix);
+
+  // SERIALIZABLE 事务提交前的校验, 通过时分配提交序号并返回 true
+  // 失败时事务不再被跟踪, 调用方需要终止事务
+  // 调用方需要持有写集合在 CommitTable 中的条带锁
+  bool validate_and_commit(const std::shared_ptr<Txn> &txn,
+                           std::vector<std::string> write_keys);
+
+  // 其他隔离级别的事务提交时登记提交序号和写集合
+  void commit(uint64_t tranc_id, std::vector<std::string> write_keys);
+
+  // 事务的写入已经应用到 memtable (或者提交失败), 推进快照的序号
+  void applied(uint64_t tranc_id);
+
+  // 终止尚未提交的 SERIALIZABLE 事务
+  void abort(const std::shared_ptr<Txn> &txn);
+
+  // 仍在跟踪的事务数量, 包括活跃的事务和需要保留的已提交事务
+  size_t tracked_count();
+
+private:
+  // 以下函数需要持有 mutex_
+  uint64_t applied_seq() const;
+  void prune();
+  static bool read_overlaps(Txn &reader, const std::vector<std::string> &keys);
+
+  std::mutex mutex_;
+  uint64_t next_commit_seq_ = 1;
+  // 活跃的 SERIALIZABLE 事务: tranc_id -> 事务
+  std::unordered_map<uint64_t, std::shared_ptr<Txn>> active_;
+  std::multiset<uint64_t> active_start_seqs_;
+  // 已提交且仍可能与活跃事务并发的事务: 提交序号 -> 事务
+  std::map<uint64_t, std::shared_ptr<Txn>> committed_;
+  // tranc_id -> 提交序号, 与 committed_ 对应
+  std::unordered_map<uint64_t, uint64_t> committed_seqs_;
+  // 已分配提交序号但尚未应用的事务
+  std::set<uint64_t> pending_seqs_;
+  std::unordered_map<uint64_t, uint64_t> pending_tranc_ids_;
+};
+} // namespace tiny_lsm
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 已刷盘的 tranc_id 集合
+// 用低水位 low_watermark 表示不大于它的 tranc_id 都在集合中,
+// 大于低水位的零散 tranc_id 记录在从低水位附近开始的位图中
+// 插入时推进低水位并丢弃已经覆盖的位图字, 每个 tranc_id 的均摊开销为 O(1)
+class TrancIdSet {
+public:
+  explicit TrancIdSet(uint64_t low_watermark = 0);
+
+  // 插入 tranc_id, 之前不在集合中时返回 true
+  bool insert(uint64_t tranc_id);
+  bool contains(uint64_t tranc_id) const;
+  // 清空集合, 只保留不大于 low_watermark 的部分
+  void reset(uint64_t low_watermark);
+
+  uint64_t low_watermark() const;
+  // 集合中最大的 tranc_id
+  uint64_t max() const;
+  // 大于低水位的 tranc_id, 按从小到大的顺序
+  std::vector<uint64_t> exceptions() const;
+  size_t exception_count() const;
+
+  // 编码格式: | low_watermark (64) | max (64) | count (64) | tranc_id (64) ...|
+  void encode(std::vector<uint8_t> &buf) const;
+  // 返回读取的字节数, 数据不完整时返回 0
+  size_t decode(const uint8_t *data, size_t len);
+
+private:
+  uint64_t low_watermark_;
+  uint64_t max_;
+  size_t exception_count_ = 0;
+  // words_[0] 的最低位对应 base_, base_ 按 64 对齐
+  uint64_t base_ = 0;
+  std::deque<uint64_t> words_;
+
+  bool test_bit_(uint64_t tranc_id) const;
+};
+} // namespace tiny_lsm
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../iterator/iterator.h"
+#include "tranc_write_batch.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 事务的迭代器: 将事务的写入缓存合并到数据库的迭代器之上
+// overlays 按优先级从高到低排列, 相同的 key 只输出优先级最高的来源中的 value,
+// 空 value 表示删除, 不会输出
+// 只输出以 preffix 开头的 key, base 需要已经限定在该前缀内
+// 遍历期间事务可以继续写入, 但新写入的 key 不保证能被遍历到
+class TrancIterator : public BaseIterator {
+public:
+  TrancIterator() = default;
+  TrancIterator(std::shared_ptr<BaseIterator> base,
+                std::vector<std::shared_ptr<const TrancWriteBatch>> overlays,
+                const std::string &preffix, uint64_t tranc_id);
+
+  virtual BaseIterator &operator++() override;
+  virtual bool operator==(const BaseIterator &other) const override;
+  virtual bool operator!=(const BaseIterator &other) const override;
+  virtual value_type operator*() const override;
+  virtual IteratorType get_type() const override;
+  virtual uint64_t get_tranc_id() const override;
+  virtual bool is_end() const override;
+  virtual bool is_valid() const override;
+
+  pointer operator->() const;
+
+private:
+  struct Overlay {
+    std::shared_ptr<const TrancWriteBatch> batch;
+    TrancWriteBatch::const_iterator it;
+  };
+
+  bool base_valid() const;
+  bool overlay_valid(const Overlay &overlay) const;
+  // 移动到下一个未被删除的 key
+  void advance();
+
+  std::shared_ptr<BaseIterator> base_;
+  std::vector<Overlay> overlays_;
+  std::string preffix_;
+  uint64_t tranc_id_ = 0;
+  mutable std::optional<value_type> current_;
+};
+} // namespace tiny_lsm
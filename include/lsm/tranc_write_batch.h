@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../utils/arena.h"
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 事务的写入缓存
+// key 和 value 分配在 Arena 中, 通过按 key 排序的索引查找, 支持有序遍历
+// 同一个 key 多次写入时索引指向最后一次写入的 value, 旧的 value 留在 Arena 中
+// value 为空表示删除
+class TrancWriteBatch {
+public:
+  using Index = std::map<std::string_view, std::string_view>;
+  using const_iterator = Index::const_iterator;
+
+  TrancWriteBatch() = default;
+  TrancWriteBatch(const TrancWriteBatch &) = delete;
+  TrancWriteBatch &operator=(const TrancWriteBatch &) = delete;
+
+  void put(const std::string &key, const std::string &value);
+  void remove(const std::string &key);
+
+  // key 不在缓存中时返回 std::nullopt, 被删除时返回空字符串
+  std::optional<std::string> get(const std::string &key) const;
+
+  size_t size() const;
+  bool empty() const;
+
+  // 按 key 升序遍历, 迭代器在之后的写入中保持有效
+  const_iterator begin() const;
+  const_iterator end() const;
+  const_iterator lower_bound(const std::string &key) const;
+
+  // 按 key 升序返回所有的 key 和键值对
+  std::vector<std::string> keys() const;
+  std::vector<std::pair<std::string, std::string>> kvs() const;
+
+private:
+  std::string_view store(const std::string &data);
+
+  Arena arena_;
+  Index index_;
+};
+} // namespace tiny_lsm
@@ -2,7 +2,15 @@
 
 #include "../utils/files.h"
 #include "../wal/wal.h"
+#include "commit_table.h"
+#include "lock_manager.h"
+#include "serializable_tracker.h"
+#include "tranc_id_set.h"
+#include "tranc_iterator.h"
+#include "tranc_write_batch.h"
+#include "write_queue.h"
 #include <atomic>
+#include <functional>
 #include <map>
 #include <set>
 #include <memory>
@@ -21,6 +29,11 @@ enum class IsolationLevel {
   SERIALIZABLE
 };
 
+// OPTIMISTIC 在提交时获取写集合的行锁并校验冲突, 失败则终止
+// PESSIMISTIC 在读写时获取行锁, 持有到提交或终止, 提交时不会因冲突失败
+// 两种事务可以写入相同的 key, 乐观事务提交时会等待悲观事务释放行锁
+enum class TrancMode { OPTIMISTIC, PESSIMISTIC };
+
 enum class TransactionState {
   COMMITTED,
   ABORTED
@@ -28,6 +41,17 @@ enum class TransactionState {
 
 inline std::string isolation_level_to_string(const IsolationLevel &level);
 
+// 快照句柄, 读取时使用其 tranc_id, 只能看到获取快照时已经分配的 tranc_id 的写入
+// 释放之前, 快照可见的历史版本不会被 flush 和 compact 清理
+class Snapshot {
+public:
+  explicit Snapshot(uint64_t tranc_id) : tranc_id_(tranc_id) {}
+  uint64_t get_tranc_id() const { return tranc_id_; }
+
+private:
+  uint64_t tranc_id_;
+};
+
 class LSMEngine;
 class TranManager;
 
@@ -37,33 +61,71 @@ class TranContext {
 public:
   TranContext(uint64_t tranc_id, std::shared_ptr<LSMEngine> engine,
               std::shared_ptr<TranManager> tranManager,
-              const enum IsolationLevel &isolation_level);
+              const enum IsolationLevel &isolation_level,
+              TrancMode tranc_mode = TrancMode::OPTIMISTIC);
   void put(const std::string &key, const std::string &value);
   void remove(const std::string &key);
   std::optional<std::string> get(const std::string &key);
+  // 读取 key 的最新版本并获取排他锁, 之后对它的写入不会与其他事务冲突
+  // 乐观事务等同于 get
+  std::optional<std::string> get_for_update(const std::string &key);
+  // 查询所有以 preffix 开头的 key, 结果按 key 排序, 包含事务自身的写入
+  // SERIALIZABLE 会登记整个前缀范围, 之后并发插入该范围的事务也会被检测到
+  std::vector<std::pair<std::string, std::string>>
+  scan_preffix(const std::string &preffix);
+
+  // 遍历事务可见的所有 key, 事务自身的写入覆盖数据库中的版本
+  // 除 SERIALIZABLE 外迭代器持有 engine 的 sst 读锁, 需要在提交之前释放
+  TrancIterator begin();
+  TrancIterator end();
+  // 遍历以 preffix 开头的 key, 数据库部分在创建时一次性读取, 不持有锁
+  TrancIterator begin_preffix(const std::string &preffix);
 
   // ! test_fail = true 是测试中手动触发的崩溃
   bool commit(bool test_fail = false);
   bool abort();
   enum IsolationLevel get_isolation_level();
+  TrancMode get_tranc_mode();
 
 public:
   std::shared_ptr<LSMEngine> engine_;
   std::shared_ptr<TranManager> tranManager_;
   uint64_t tranc_id_;
   std::vector<Record> operations;
-  std::unordered_map<std::string, std::string> temp_map_;
+  // 暂存的写入, 提交时按 key 的顺序应用到数据库
+  std::shared_ptr<TrancWriteBatch> write_batch_ =
+      std::make_shared<TrancWriteBatch>();
   bool isCommited = false;
   bool isAborted = false;
   enum IsolationLevel isolation_level_;
+  TrancMode tranc_mode_;
 
 private:
   std::unordered_map<std::string,
                      std::optional<std::pair<std::string, uint64_t>>>
       read_map_;
-  std::unordered_map<std::string,
-                     std::optional<std::pair<std::string, uint64_t>>>
-      rollback_map_;
+  // READ_UNCOMMITTED 直接写入数据库的 key, 终止时回滚
+  // 回滚前的版本在终止时才从版本链中读取
+  std::set<std::string> rollback_keys_;
+  // 事务读取需要的最早的 tranc_id, 在 TranManager 的快照列表中登记
+  uint64_t snapshot_tranc_id_ = 0;
+  // SERIALIZABLE 事务在 SerializableTracker 中的状态
+  std::shared_ptr<SerializableTracker::Txn> ssi_txn_;
+  // 持有锁的 key, 锁以 tranc_id_ 登记
+  // 悲观事务在读写时加锁, 乐观事务在提交时加锁
+  std::set<std::string> locked_keys_;
+
+  // 获取行锁, 超时或死锁时终止事务并抛出异常
+  void lock_key_(const std::string &key, bool exclusive);
+  void release_locks_();
+
+  // 读取 SERIALIZABLE 事务开始时的快照, 跳过之后提交的并发事务写入的版本
+  std::optional<std::pair<std::string, uint64_t>>
+  snapshot_get(const std::string &key);
+  // 将事务自身的写入和 SERIALIZABLE 的快照修正合并到 base 之上
+  // SERIALIZABLE 的快照修正需要点查询, 调用时不能持有 sst 读锁
+  TrancIterator make_iterator_(std::shared_ptr<BaseIterator> base,
+                               const std::string &preffix);
 };
 
 class TranManager : public std::enable_shared_from_this<TranManager> {
@@ -72,22 +134,56 @@ public:
   ~TranManager();
   void init_new_wal();
   void set_engine(std::shared_ptr<LSMEngine> engine);
-  std::shared_ptr<TranContext> new_tranc(const IsolationLevel &isolation_level);
+  // 悲观事务只支持 READ_COMMITTED 和 REPEATABLE_READ
+  std::shared_ptr<TranContext>
+  new_tranc(const IsolationLevel &isolation_level,
+            TrancMode tranc_mode = TrancMode::OPTIMISTIC);
 
   uint64_t getNextTransactionId();
   uint64_t get_max_flushed_tranc_id();
   uint64_t get_checkpoint_tranc_id();
-  std::set<uint64_t>& get_flushed_tranc_ids();
+  const TrancIdSet &get_flushed_tranc_ids();
 
+  // 事务结束(提交或终止)时调用, 同时将其移出活跃事务和快照列表
   void add_ready_to_flush_tranc_id(uint64_t tranc_id, TransactionState state);
-  void add_flushed_tranc_id(uint64_t tranc_id);
-  // void remove_active_tranc_id(uint64_t tranc_id);
+  // 一次 memtable 刷盘后更新 flushed 集合
+  // committed_ids 为表中完成标记的 tranc_id, 对应的事务已经完整刷盘
+  // table_tranc_ids 为表中出现过的所有 tranc_id, 其中不属于事务的是非事务写入,
+  // 非事务写入的整批数据总在同一张表中, 也已经完整刷盘
+  void add_flushed_tranc_ids(const std::vector<uint64_t> &committed_ids,
+                             const std::vector<uint64_t> &table_tranc_ids);
+
+  // 获取和释放快照, 快照按 tranc_id 有序登记
+  std::shared_ptr<Snapshot> get_snapshot();
+  void release_snapshot(const std::shared_ptr<Snapshot> &snapshot);
+  // 所有快照和活跃事务都能看到的最小 tranc_id
+  // 同一个 key 不大于该值的版本中只有最新的一个仍然可见, 更早的可以清理
+  uint64_t oldest_visible_tranc_id();
 
   bool write_to_wal(const std::vector<Record> &records);
 
-  std::map<uint64_t, std::vector<Record>> check_recover();
+  // 事务提交时冲突检测使用的最近写入表
+  CommitTable &get_commit_table();
+  // SERIALIZABLE 事务的快照和读写依赖跟踪
+  SerializableTracker &get_serializable_tracker();
+  // 悲观事务的行锁
+  LockManager &get_lock_manager();
+  // 为悲观事务分配提交使用的新 tranc_id, 原来的 tranc_id 按终止处理
+  uint64_t assign_commit_tranc_id(uint64_t tranc_id);
+  // 非事务写入获取行锁时使用的持有者 id, 与 tranc_id 不重叠
+  // 这样可以在获取行锁之后再分配 tranc_id, 不会在 flushed 集合中留下空洞
+  uint64_t get_lock_owner_id();
+
+  // 通过写入队列组提交, 多个并发写入者的 wal 记录合并写入并只同步一次
+  // wal 初始化之前(恢复阶段)直接执行 writer.apply
+  bool write(WriteQueue::Writer &writer);
+
+  // 按写入顺序将 wal 中尚未刷盘的记录交给 replay, 返回重放的记录数
+  // 恢复出的 tranc_id 不小于 nextTransactionId_ 时同步推进
+  size_t check_recover(const std::function<void(const Record &)> &replay);
 
   std::string get_tranc_id_file_path();
+  // 重写整个 tranc_id 文件, 之前追加的 delta 合并到快照中
   void write_tranc_id_file();
   void read_tranc_id_file();
   // void flusher();
@@ -96,13 +192,32 @@ private:
   mutable std::mutex mutex_;
   std::shared_ptr<LSMEngine> engine_;
   std::shared_ptr<WAL> wal;
+  std::shared_ptr<WriteQueue> write_queue;
+  std::unique_ptr<CommitTable> commit_table_;
+  std::unique_ptr<SerializableTracker> serializable_tracker_;
+  std::unique_ptr<LockManager> lock_manager_;
   std::string data_dir_;
   // std::atomic<bool> flush_thread_running_ = true;
   std::atomic<uint64_t> nextTransactionId_ = 1;
+  std::atomic<uint64_t> nextLockOwnerId_ = uint64_t(1) << 63;
   std::map<uint64_t, std::shared_ptr<TranContext>> activeTrans_;
+  // 快照和活跃事务登记的 tranc_id, 由 mutex_ 保护
+  std::multiset<uint64_t> snapshots_;
+  // snapshots_ 中的最小值, 为空时是 UINT64_MAX, 读取时不需要加锁
+  std::atomic<uint64_t> oldest_snapshot_ = UINT64_MAX;
   std::map<uint64_t, TransactionState> readyToFlushTrancIds_;
-  std::set<uint64_t> flushedTrancIds_;
+  TrancIdSet flushedTrancIds_;
   FileObj tranc_id_file_;
+  // tranc_id 文件中快照部分和之后追加的 delta 的大小
+  size_t tranc_id_snapshot_size_ = 0;
+  size_t tranc_id_delta_size_ = 0;
+
+  // 以下函数需要持有 mutex_
+  void add_snapshot_(uint64_t tranc_id);
+  void remove_snapshot_(uint64_t tranc_id);
+  void write_tranc_id_file_();
+  // 追加一次刷盘新增的 tranc_id, delta 过多时重写整个文件
+  void append_tranc_id_delta_(const std::vector<uint64_t> &ids);
 };
 
 } // namespace tiny_lsm
\ No newline at end of file
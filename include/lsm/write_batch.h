@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 非事务的批量写入, 可以混合 put 和 remove, 通过 LSM::write 原子地生效:
+// 整批使用同一个 tranc_id, 只追加一次 wal, 只获取一次 memtable 的锁
+// 操作按加入的顺序序列化在一块连续的缓冲区中, clear 后保留容量可以复用
+// 序列化格式:
+// | count (32) | type (8) | key_len (32) | key | value_len (32) | value | ... |
+// 其中 remove 没有 value_len 和 value
+class WriteBatch {
+public:
+  enum class OpType : uint8_t { PUT = 0, REMOVE = 1 };
+
+  WriteBatch();
+  // 从 data() 序列化的结果恢复, 格式错误时抛出异常
+  explicit WriteBatch(const std::string &data);
+
+  void put(const std::string &key, const std::string &value);
+  void remove(const std::string &key);
+  void clear();
+
+  // 操作的数量, 同一个 key 的多次操作分别计数
+  size_t count() const;
+  bool empty() const;
+  const std::string &data() const;
+
+  // 按 key 升序返回所有的键值对, value 为空表示删除
+  // 同一个 key 只保留最后一次操作
+  std::vector<std::pair<std::string, std::string>> kvs() const;
+
+private:
+  void append_u32(uint32_t value);
+
+  std::string rep_;
+};
+} // namespace tiny_lsm
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../wal/record.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 写入队列, 实现组提交
+// 排在队首的写入者成为 leader, 收集队列中等待的写入者组成一组,
+// 将整组的 wal 记录一次性写入并只同步一次, 然后应用到 memtable 并唤醒 follower
+// leader 写完 wal 后立即让出队首, 下一组的 wal 写入和本组的 memtable
+// 写入可以同时进行
+class WriteQueue {
+public:
+  struct Writer {
+    std::vector<Record> records; // 需要写入 wal 的记录, 为空时不写 wal
+    bool sync = false;           // 是否需要同步 wal 文件
+    // 写入 memtable, 为空时由调用方在 write 返回后自行写入
+    // (例如提交事务时已经持有了 memtable 的锁, 不能由其他线程代为写入)
+    // 关闭并行写入时 apply 可能在 leader 的线程中执行, 其中不能获取
+    // 写入者排队时可能持有的锁 (例如最近写入表的条带锁)
+    std::function<void()> apply;
+
+  private:
+    friend class WriteQueue;
+    bool done = false;
+    bool apply_self = false; // 由 follower 自己写入 memtable
+    bool ok = true;
+    std::exception_ptr error;
+    std::condition_variable cv;
+  };
+
+  // wal_writer 负责将一组记录写入 wal, 第二个参数表示是否需要同步
+  // parallel_apply 为 true 时, 组内每个写入者并行地写入自己的 memtable 记录,
+  // 否则由 leader 依次写入
+  WriteQueue(std::function<void(const std::vector<Record> &, bool)> wal_writer,
+             size_t max_group_size, bool parallel_apply);
+
+  // 阻塞直到 writer 的 wal 记录写入完成且 apply 执行完成
+  // 没有 wal 记录的 writer 不参与组提交, 直接执行 apply
+  // wal 写入失败时返回 false, 此时不会执行 apply
+  // apply 抛出的异常会在调用 write 的线程中重新抛出
+  bool write(Writer &writer);
+
+private:
+  // 执行 apply 并记录异常, 返回前不持有锁
+  static void run_apply(Writer &writer);
+
+  std::function<void(const std::vector<Record> &, bool)> wal_writer_;
+  size_t max_group_size_;
+  bool parallel_apply_;
+
+  std::mutex mutex_;
+  std::deque<Writer *> writers_;
+};
+} // namespace tiny_lsm
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+namespace tiny_lsm {
+
+// memtable 中多个 key 的批次对读者的可见性
+// 批次写入前登记, 全部写入后发布并分配递增的发布序号,
+// 与 SerializableTracker 的提交序号和 applied_seq 的作用相同:
+// 读取多个 key 的读者开始时取当前的发布序号作为快照, 只能看到不晚于快照发布的批次;
+// 读取单个 key 时只跳过尚未发布的批次
+// 批次和读者都只需要 cur_mtx 的读锁, 写入批次期间不阻塞读取
+class BatchVisibility {
+public:
+  // 一次读取操作的可见性判断, 对同一个 tranc_id 的判断结果不会改变
+  class Reader {
+  public:
+    // snapshot 为 false 时只用于读取单个 key, 不登记快照
+    Reader(BatchVisibility &visibility, bool snapshot);
+    ~Reader();
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    bool visible(uint64_t tranc_id);
+
+  private:
+    BatchVisibility &visibility_;
+    bool snapshot_;
+    uint64_t seq_;
+    std::unordered_map<uint64_t, bool> cache_;
+  };
+
+  // 批次写入 memtable 之前登记, 同一时刻一个 tranc_id 只能有一个批次
+  void begin(uint64_t tranc_id);
+  // 批次已经全部写入, 之后开始的读者可以看到
+  void publish(uint64_t tranc_id);
+
+private:
+  // 以下函数需要持有 mtx_
+  bool visible_(uint64_t tranc_id, uint64_t seq) const;
+  // 清理所有快照都能看到的已发布批次
+  void prune_();
+
+  std::mutex mtx_;
+  uint64_t published_seq_ = 0;
+  // tranc_id -> 发布序号, 0 表示尚未发布
+  std::unordered_map<uint64_t, uint64_t> batch_seqs_;
+  // 发布序号 -> tranc_id, 按发布顺序清理
+  std::map<uint64_t, uint64_t> published_;
+  // 进行中的读者的快照
+  std::multiset<uint64_t> reader_seqs_;
+  // 没有登记的批次时读者不需要加锁
+  std::atomic<size_t> batch_count_{0};
+};
+} // namespace tiny_lsm
@@ -2,6 +2,8 @@
 
 #include "../iterator/iterator.h"
 #include "../skiplist/skiplist.h"
+#include "batch_visibility.h"
+#include "memtable_rep.h"
 #include <cstddef>
 #include <functional>
 #include <iostream>
@@ -31,12 +33,26 @@ private:
 
   SkipListIterator get_(const std::string &key, uint64_t tranc_id);
 
-  SkipListIterator cur_get_(const std::string &key, uint64_t tranc_id);
+  // 以下查询跳过对 reader 不可见的批次写入的版本
+  SkipListIterator cur_get_(const std::string &key, uint64_t tranc_id,
+                            BatchVisibility::Reader &reader);
 
-  SkipListIterator frozen_get_(const std::string &key, uint64_t tranc_id);
+  SkipListIterator frozen_get_(const std::string &key, uint64_t tranc_id,
+                               BatchVisibility::Reader &reader);
 
   void remove_(const std::string &key, uint64_t tranc_id);
   void frozen_cur_table_(); // _ 表示不需要锁的版本
+  // 活跃表超出大小限制时冻结活跃表, 调用方不能持有 cur_mtx
+  void frozen_cur_table_if_full();
+
+  // 按配置的 MEMTABLE_REP 创建新的表, 并开启前缀布隆过滤器
+  std::shared_ptr<MemTableRep> create_table();
+  // 将 table 的记录转化为 SearchItem, 同一个 key 只保留对事务可见的最新版本
+  static void collect_items(MemTableRep &table, int table_idx,
+                            uint64_t tranc_id,
+                            const std::function<int(const std::string &)> &predicate,
+                            BatchVisibility::Reader &reader,
+                            std::vector<SearchItem> &item_vec);
 
 public:
   MemTable();
@@ -54,10 +70,15 @@ public:
   void remove_batch(const std::vector<std::string> &keys, uint64_t tranc_id);
 
   void clear();
+  // flushed_tranc_ids 返回表中完成标记的 tranc_id
+  // table_tranc_ids 返回表中出现过的所有 tranc_id (升序, 去重)
+  // 同一个 key 不大于 oldest_tranc_id 的版本中只有最新的一个会写入 sst
   std::shared_ptr<SST> flush_last(SSTBuilder &builder, std::string &sst_path,
                                   size_t sst_id,
                                   std::vector<uint64_t> &flushed_tranc_ids,
-                                  std::shared_ptr<BlockCache> block_cache);
+                                  std::vector<uint64_t> &table_tranc_ids,
+                                  std::shared_ptr<BlockCache> block_cache,
+                                  uint64_t oldest_tranc_id);
   void frozen_cur_table();
   size_t get_cur_size();
   size_t get_frozen_size();
@@ -65,17 +86,24 @@ public:
   HeapIterator begin(uint64_t tranc_id);
   HeapIterator iters_preffix(const std::string &preffix, uint64_t tranc_id);
 
+  // preffix 非空时表示 predicate 是对该前缀的匹配,
+  // 前缀布隆过滤器判定不含该前缀的表会被跳过
   std::optional<std::pair<HeapIterator, HeapIterator>>
   iters_monotony_predicate(uint64_t tranc_id,
-                           std::function<int(const std::string &)> predicate);
+                           std::function<int(const std::string &)> predicate,
+                           const std::string &preffix = "");
 
   HeapIterator end();
 
 private:
-  std::shared_ptr<SkipList> current_table;
-  std::list<std::shared_ptr<SkipList>> frozen_tables;
+  std::shared_ptr<MemTableRep> current_table;
+  std::list<std::shared_ptr<MemTableRep>> frozen_tables;
   size_t frozen_bytes;
   std::shared_mutex frozen_mtx; // 冻结表的锁
-  std::shared_mutex cur_mtx;    // 活跃表的锁
+  // 活跃表的锁, 跳表支持并发插入, 写入活跃表只需要读锁,
+  // 只有替换活跃表时才需要写锁
+  std::shared_mutex cur_mtx;
+  // 多个 key 的批次在全部写入后才对读者可见
+  BatchVisibility batch_visibility;
 };
 } // namespace tiny_lsm
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "../skiplist/skiplist.h"
+#include "../utils/arena.h"
+#include "../utils/bloom_filter.h"
+#include "../utils/prefix_extractor.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace tiny_lsm {
+
+// memtable 中单张表的存储结构
+// 所有实现都把记录以 SkipListNode 的格式分配在 Arena 中,
+// 因此点查统一返回 SkipListIterator
+// put / get / scan 可以被多个线程并发调用, clear 需要上层保证没有并发访问
+class MemTableRep {
+public:
+  virtual ~MemTableRep() = default;
+
+  virtual void put(const std::string &key, const std::string &value,
+                   uint64_t tranc_id) = 0;
+
+  // 返回对事务 tranc_id 可见的最新版本, tranc_id 为 0 表示查询最新版本
+  // 返回的迭代器只用于读取这一条记录, 不能用于遍历
+  virtual SkipListIterator get(const std::string &key, uint64_t tranc_id) = 0;
+
+  // 依次访问满足谓词的记录, 谓词的约定与 SkipList::iters_monotony_predicate
+  // 相同, 为空时访问所有记录
+  // 同一个 key 的所有版本按 tranc_id 降序连续访问, 不同 key 之间不保证顺序
+  virtual void
+  scan(const std::function<int(const std::string &)> &predicate,
+       const std::function<void(const SkipListIterator &)> &visitor) = 0;
+
+  // 返回按 key 升序, tranc_id 降序排列的全部记录
+  virtual std::vector<std::tuple<std::string, std::string, uint64_t>>
+  flush() = 0;
+
+  // 记录占用的字节数
+  virtual size_t get_size() = 0;
+
+  virtual void clear() = 0;
+
+  // 表被冻结时调用, 之后不会再有写入
+  virtual void freeze() {}
+
+  // 开启前缀布隆过滤器, 之后写入的 key 的前缀会被加入过滤器
+  void enable_prefix_bloom(std::shared_ptr<const PrefixExtractor> extractor,
+                           size_t num_bits);
+
+  // 表中是否可能存在以 preffix 开头的 key
+  bool may_contain_preffix(const std::string &preffix) const;
+
+  // 根据配置 MEMTABLE_REP 创建新的表
+  static std::shared_ptr<MemTableRep> from_config();
+
+protected:
+  // 写入时由子类调用, 记录 key 的前缀
+  void add_prefix(const std::string &key);
+  void clear_prefix_bloom();
+
+private:
+  // 布隆过滤器本身不是线程安全的, 需要单独加锁
+  std::shared_ptr<const PrefixExtractor> prefix_extractor;
+  std::shared_ptr<BloomFilter> prefix_bloom;
+  mutable std::mutex prefix_bloom_mtx;
+};
+
+// 默认的跳表实现, 兼顾点查和范围查询
+class SkipListRep : public MemTableRep {
+public:
+  SkipListRep();
+
+  void put(const std::string &key, const std::string &value,
+           uint64_t tranc_id) override;
+  SkipListIterator get(const std::string &key, uint64_t tranc_id) override;
+  void scan(const std::function<int(const std::string &)> &predicate,
+            const std::function<void(const SkipListIterator &)> &visitor)
+      override;
+  std::vector<std::tuple<std::string, std::string, uint64_t>> flush() override;
+  size_t get_size() override;
+  void clear() override;
+
+private:
+  SkipList table;
+};
+
+// 按 key 的哈希值分桶, 每个桶是一个较小的跳表
+// 点查只需要在一个较矮的跳表中查找, 范围查询需要访问所有的桶
+// 所有桶共享一个 arena, 桶在第一次写入时创建
+class HashSkipListRep : public MemTableRep {
+public:
+  explicit HashSkipListRep(size_t bucket_count);
+  ~HashSkipListRep() override;
+
+  void put(const std::string &key, const std::string &value,
+           uint64_t tranc_id) override;
+  SkipListIterator get(const std::string &key, uint64_t tranc_id) override;
+  void scan(const std::function<int(const std::string &)> &predicate,
+            const std::function<void(const SkipListIterator &)> &visitor)
+      override;
+  std::vector<std::tuple<std::string, std::string, uint64_t>> flush() override;
+  size_t get_size() override;
+  void clear() override;
+
+private:
+  SkipList *get_bucket(const std::string &key, bool create);
+  void reset();
+
+  size_t bucket_count_;
+  std::shared_ptr<Arena> arena_;
+  std::unique_ptr<std::atomic<SkipList *>[]> buckets_;
+  std::mutex create_mtx_; // 创建桶时加锁
+};
+
+// 只追加的数组, 写入只需要在 arena 中分配节点并追加指针
+// 数组在冻结时排序一次, 适合批量导入后直接刷盘的场景
+// 活跃表由有序的前缀和无序的尾部组成, 按序写入只会延长前缀,
+// 查询在前缀上二分, 在尾部上线性扫描, 不会修改数组
+class VectorRep : public MemTableRep {
+public:
+  VectorRep();
+
+  void put(const std::string &key, const std::string &value,
+           uint64_t tranc_id) override;
+  SkipListIterator get(const std::string &key, uint64_t tranc_id) override;
+  void scan(const std::function<int(const std::string &)> &predicate,
+            const std::function<void(const SkipListIterator &)> &visitor)
+      override;
+  std::vector<std::tuple<std::string, std::string, uint64_t>> flush() override;
+  size_t get_size() override;
+  void clear() override;
+  void freeze() override;
+
+private:
+  // 按 key 升序, tranc_id 降序排序, 相同的 (key, tranc_id) 只保留最后写入的
+  // 调用方需要持有 mtx_ 的写锁
+  void sort_();
+
+  std::shared_ptr<Arena> arena_;
+  // [0, sorted_count_) 有序且没有重复, 之后为无序的尾部
+  std::vector<const SkipListNode *> entries_;
+  size_t sorted_count_ = 0;
+  std::shared_mutex mtx_;
+};
+} // namespace tiny_lsm
@@ -32,6 +32,14 @@ private:
   bool expire_set_clean(const std::string &key,
                         std::shared_lock<std::shared_mutex> &rlock);
 
+  // 读取链表元素的序号范围 [head, tail), 需要持有写锁
+  // 旧版本用分隔符拼接的链表会先转换为按元素存储
+  std::optional<std::pair<uint64_t, uint64_t>> load_list_(const std::string &key);
+  // 读取链表中下标为 [start, stop] 的元素, value 为链表 key 的值
+  std::vector<std::string> list_range_(const std::string &key,
+                                       const std::string &value, size_t start,
+                                       size_t stop);
+
 public:
   RedisWrapper(const std::string &db_path);
   void clear();
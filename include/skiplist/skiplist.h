@@ -1,14 +1,17 @@
 #pragma once
 #include "../iterator/iterator.h"
+#include "../utils/arena.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
-#include <random>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <tuple>
 #include <utility>
@@ -17,61 +20,59 @@
 namespace tiny_lsm {
 
 // ************************ SkipListNode ************************
+// 节点整体分配在 Arena 中, 内存布局为:
+// | SkipListNode 头部 | next_[0..height_) | key | value_len(32) | value |
+// 更新 value 时在 Arena 中重新分配 | value_len(32) | value | 并修改 value_
+// next_ 和 value_ 都是原子变量, 写线程通过 CAS 链接节点, 读线程不需要加锁
 struct SkipListNode {
-  std::string key_;   // 节点存储的键
-  std::string value_; // 节点存储的值
   uint64_t tranc_id_; // 事务 id
-  std::vector<std::shared_ptr<SkipListNode>>
-      forward_; // 指向不同层级的下一个节点的指针数组
-  std::vector<std::weak_ptr<SkipListNode>>
-      backward_; // 指向不同层级的下一个节点的指针数组
-  SkipListNode(const std::string &k, const std::string &v, int level,
-               uint64_t tranc_id)
-      : key_(k), value_(v), forward_(level, nullptr),
-        backward_(level, std::weak_ptr<SkipListNode>()), tranc_id_(tranc_id) {}
-
-  void set_backward(int level, std::shared_ptr<SkipListNode> node) {
-    backward_[level] = std::weak_ptr<SkipListNode>(node);
-  }
+  std::atomic<const char *> value_; // 指向 Arena 中以 32 位长度开头的 value
+  uint32_t key_size_;
+  uint32_t height_;
+  std::atomic<SkipListNode *> next_[1]; // 不同层级的下一个节点, 长度为 height_
 
-  bool operator==(const SkipListNode &other) const {
-    return key_ == other.key_ && value_ == other.value_ &&
-           tranc_id_ == other.tranc_id_;
+  std::string_view key() const {
+    return {reinterpret_cast<const char *>(next_ + height_), key_size_};
   }
 
-  bool operator!=(const SkipListNode &other) const { return !(*this == other); }
+  std::string_view value() const {
+    const char *value_ptr = value_.load(std::memory_order_acquire);
+    uint32_t value_size;
+    std::memcpy(&value_size, value_ptr, sizeof(uint32_t));
+    return {value_ptr + sizeof(uint32_t), value_size};
+  }
 
-  bool operator<(const SkipListNode &other) const {
-    if (key_ == other.key_) {
-      // key 相等时，trans_id 更大的优先级更高
-      return tranc_id_ > other.tranc_id_;
-    }
-    return key_ < other.key_;
+  // acquire 保证读到的节点已经完成初始化
+  SkipListNode *next(int level) const {
+    return next_[level].load(std::memory_order_acquire);
+  }
+  // release 保证节点初始化完成后才对其他线程可见
+  void set_next(int level, SkipListNode *node) {
+    next_[level].store(node, std::memory_order_release);
   }
-  bool operator>(const SkipListNode &other) const {
-    if (key_ == other.key_) {
-      // key 相等时，trans_id 更大的优先级更高
-      return tranc_id_ < other.tranc_id_;
-    }
-    return key_ > other.key_;
+  bool cas_next(int level, SkipListNode *expected, SkipListNode *node) {
+    return next_[level].compare_exchange_strong(expected, node,
+                                                std::memory_order_acq_rel);
   }
+
+  // 在 arena 中分配并初始化一个高度为 height 的节点, next_ 均为空
+  static SkipListNode *create(Arena &arena, const std::string &key,
+                              const std::string &value, int height,
+                              uint64_t tranc_id);
+  // 在 arena 中分配 | value_len(32) | value |
+  static const char *create_value(Arena &arena, const std::string &value);
 };
 
 // ************************ SkipListIterator ************************
 
 class SkipListIterator : public BaseIterator {
 public:
-  // ! deprecated: 构造函数，接收锁
-  // SkipListIterator(std::shared_ptr<SkipListNode> node, std::shared_mutex
-  // &mutex)
-  //     : current(node),
-  //       lock(std::make_shared<std::shared_lock<std::shared_mutex>>(mutex)) {}
-
-  // 构造函数
-  SkipListIterator(std::shared_ptr<SkipListNode> node) : current(node) {}
+  // 构造函数, 迭代器持有 Arena 的引用, 保证跳表被释放后节点仍然有效
+  SkipListIterator(const SkipListNode *node, std::shared_ptr<Arena> arena)
+      : current(node), arena(std::move(arena)) {}
 
   // 空迭代器构造函数
-  SkipListIterator() : current(nullptr), lock(nullptr) {}
+  SkipListIterator() : current(nullptr), arena(nullptr) {}
 
   virtual BaseIterator &operator++() override;
   virtual bool operator==(const BaseIterator &other) const override;
@@ -85,53 +86,45 @@ public:
   uint64_t get_tranc_id() const override;
 
 private:
-  std::shared_ptr<SkipListNode> current;
-  std::shared_ptr<std::shared_lock<std::shared_mutex>>
-      lock; // 持有读锁, 整个迭代器有效期间都持有读锁
+  const SkipListNode *current;
+  std::shared_ptr<Arena> arena;
 };
 
 // ************************ SkipList ************************
 
 class SkipList {
 private:
-  std::shared_ptr<SkipListNode>
-      head; // 跳表的头节点，不存储实际数据，用于遍历跳表
-  int max_level;     // 跳表的最大层级数，限制跳表的高度
-  int current_level; // 跳表当前的实际层级数，动态变化
-  size_t size_bytes = 0; // 跳表当前占用的内存大小（字节数），用于跟踪内存使用
-  // std::shared_mutex rw_mutex; // ! 目前看起来这个锁是冗余的, 在上层控制即可,
-  // 后续考虑是否需要细粒度的锁
-
-  std::uniform_int_distribution<> dis_01;
-  std::uniform_int_distribution<> dis_level;
-  std::mt19937 gen;
+  std::shared_ptr<Arena> arena; // 所有节点都分配在 arena 中, 随跳表整体释放
+  SkipListNode *head; // 跳表的头节点，不存储实际数据，用于遍历跳表
+  size_t head_bytes;  // 头节点占用的内存, 不计入跳表大小
+  int max_level;      // 跳表的最大层级数，限制跳表的高度
+  std::atomic<int> current_level; // 跳表当前的实际层级数，动态变化
 
 private:
   int random_level(); // 生成新节点的随机层级数
 
+  // 返回第一个不小于 (key, tranc_id) 的节点, 排序规则为 key 升序,
+  // key 相同时 tranc_id 降序, prev 不为空时记录每一层的前驱节点
+  SkipListNode *find_greater_or_equal(const std::string &key,
+                                      uint64_t tranc_id,
+                                      SkipListNode **prev) const;
+
+  // 从 before 开始在 level 层查找 (key, tranc_id) 的插入位置
+  // 结果满足 prev < (key, tranc_id) <= next
+  void find_splice_for_level(const std::string &key, uint64_t tranc_id,
+                             SkipListNode *before, int level,
+                             SkipListNode **prev, SkipListNode **next) const;
+
 public:
   SkipList(int max_lvl = 16); // 构造函数，初始化跳表
-
-  ~SkipList() {
-    // std::unique_lock<std::shared_mutex> lock(rw_mutex);
-    // Disconnect all nodes before cleanup to avoid stack overflow in case of
-    // deep recursion during shared_ptr destruction
-    auto current = head;
-    while (current && current->forward_[0]) {
-      auto next = current->forward_[0];
-      // Clear all forward_ pointers of the current node
-      for (size_t i = 0; i < current->forward_.size(); ++i) {
-        current->forward_[i].reset();
-      }
-      current = next;
-    }
-
-    // Finally clear the head
-    head.reset();
-  }
+  // 节点分配在外部传入的 arena 中, 多个跳表可以共享同一个 arena,
+  // 此时 get_size 和 clear 没有意义, 由 arena 的持有者统计和释放内存
+  SkipList(std::shared_ptr<Arena> arena, int max_lvl = 16);
 
   // 插入或更新键值对
   // 这里不对 tranc_id 进行检查，由上层保证 tranc_id 的合法性
+  // put 和 get / 迭代器可以被多个线程并发调用, 不需要外部加锁
+  // 其余修改跳表结构的操作(remove, clear)需要上层保证没有并发访问
   void put(const std::string &key, const std::string &value, uint64_t tranc_id);
 
   // 查找键对应的值
@@ -147,6 +140,8 @@ public:
   // value 为 真实 value 和 tranc_id 的二元组
   std::vector<std::tuple<std::string, std::string, uint64_t>> flush();
 
+  // 节点在 arena 中实际占用的字节数, 被 remove 的节点和被覆盖的 value
+  // 仍然占用内存, 直到跳表被清空或释放
   size_t get_size();
 
   void clear(); // 清空跳表，释放内存
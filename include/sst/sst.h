@@ -3,11 +3,14 @@
 #include "../block/block.h"
 #include "../block/block_cache.h"
 #include "../block/blockmeta.h"
-#include "../utils/bloom_filter.h"
+#include "../utils/filter.h"
+#include "../utils/prefix_extractor.h"
+#include "../utils/range_filter.h"
 #include "../utils/files.h"
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -16,13 +19,34 @@ namespace tiny_lsm {
 
 class SstIterator;
 
+// Filter Section 的魔数和版本号
+// 旧版本的 Filter Section 以布隆过滤器的 expected_elements (64) 开头,
+// 不会等于该魔数
+constexpr uint64_t SST_FILTER_MAGIC = 0x544C49464D534C54ULL; // 文件中为 "TLSMFILT"
+constexpr uint8_t SST_FILTER_VERSION = 1;
+
 /**
  * SST文件的结构, 参考自 https://skyzh.github.io/mini-lsm/week1-04-sst.html
- * ------------------------------------------------------------------------
- * |         Block Section         |  Meta Section | Extra                |
- * ------------------------------------------------------------------------
- * | data block | ... | data block |    metadata   | metadata offset (32) |
- * ------------------------------------------------------------------------
+ * ---------------------------------------------------------------------------
+ * |   Block Section   | Meta Section | Filter Section | Extra                |
+ * ---------------------------------------------------------------------------
+ * | data block | ... |   metadata   |     filter     | metadata offset (32) |
+ * |                   |              |                | filter offset (32)   |
+ * |                   |              |                | min tranc_id (64)    |
+ * |                   |              |                | max tranc_id (64)    |
+ * ---------------------------------------------------------------------------
+
+ * Filter Section 可以为空, 否则结构如下:
+ * -----------------------------------------------------------------------
+ * | magic(64) | version(8) | key_filter_len(32) | key_filter
+ * | prefix_filter_len(32) | prefix_filter | extractor_name_len(16)
+ * | extractor_name | range_filter_len(32) | range_filter |
+ * -----------------------------------------------------------------------
+ * 其中 key_filter, prefix_filter 和 range_filter
+ 的第一个字节为过滤器类型(FilterType), 之后是对应过滤器的编码数据,
+ 长度为0表示不存在; extractor_name 是构建前缀过滤器时使用的前缀提取器名称
+ * 没有 magic 的 Filter Section 是旧版本的格式, 只有一个布隆过滤器的编码数据
+ * 无法解析的 Filter Section 视为没有过滤器
 
  * 其中, metadata 是一个数组加上一些描述信息, 数组每个元素由一个 BlockMeta
  编码形成 MetaEntry, MetaEntry 结构如下:
@@ -37,6 +61,7 @@ class SstIterator;
  * ---------------------------------------------------------------
  * 其中, num_entries 表示 metadata 数组的长度, Hash 是 metadata
  数组的哈希值(只包括数组部分, 不包括 num_entries ), 用于校验 metadata 的完整性
+ * Hash 之后是每个 block 的事务 id 范围, 结构见 blockmeta.h
  */
 
 class SST : public std::enable_shared_from_this<SST> {
@@ -49,16 +74,23 @@ class SST : public std::enable_shared_from_this<SST> {
 private:
   FileObj file;
   std::vector<BlockMeta> meta_entries;
-  uint32_t bloom_offset;
+  uint32_t filter_offset;
   uint32_t meta_block_offset;
   size_t sst_id;
   std::string first_key;
   std::string last_key;
-  std::shared_ptr<BloomFilter> bloom_filter;
+  std::shared_ptr<Filter> filter;
+  // 前缀过滤器, 以及与构建时一致的前缀提取器(不一致时为空)
+  std::shared_ptr<Filter> prefix_filter;
+  std::shared_ptr<const PrefixExtractor> prefix_extractor;
+  std::shared_ptr<RangeFilter> range_filter;
   std::shared_ptr<BlockCache> block_cache;
   uint64_t min_tranc_id_ = UINT64_MAX;
   uint64_t max_tranc_id_ = 0;
 
+  // 解码 Filter Section, 格式错误时抛出异常
+  void decode_filters(const std::vector<uint8_t> &data);
+
 public:
   // 从文件中打开sst
   static std::shared_ptr<SST> open(size_t sst_id, FileObj file,
@@ -74,6 +106,12 @@ public:
   // 根据key返回迭代器
   SstIterator get(const std::string &key, uint64_t tranc_id);
 
+  // sst 中是否可能存在以 preffix 开头的 key
+  bool may_contain_preffix(const std::string &preffix) const;
+
+  // sst 中是否可能存在位于闭区间 [lo, hi] 的 key
+  bool may_contain_range(const std::string &lo, const std::string &hi) const;
+
   // 返回sst中block的数量
   size_t num_blocks() const;
 
@@ -96,6 +134,13 @@ public:
   SstIterator end();
 
   std::pair<uint64_t, uint64_t> get_tranc_id_range() const;
+
+  // block 中是否可能存在 tranc_id 可见的版本, tranc_id 为 0 表示全部可见
+  bool block_visible(size_t block_idx, uint64_t tranc_id) const;
+
+  // sst 中是否存在 key 的 tranc_id 大于给定值的版本
+  // 根据 sst 和 block 的事务 id 范围跳过不可能存在的部分
+  bool has_newer_version(const std::string &key, uint64_t tranc_id);
 };
 
 class SSTBuilder {
@@ -106,13 +151,33 @@ private:
   std::vector<BlockMeta> meta_entries;
   std::vector<uint8_t> data;
   size_t block_size;
-  std::shared_ptr<BloomFilter> bloom_filter;
+  std::shared_ptr<Filter> filter;
+  std::shared_ptr<Filter> prefix_filter;
+  bool has_bloom;
+  // sst 所在的层级, 用于选择布隆过滤器每个 key 的位数
+  size_t level;
+  // 每个不同 key 的基础哈希值, build 时按实际数量创建过滤器
+  std::vector<std::pair<size_t, size_t>> key_hashes;
+  // 每个不同前缀的基础哈希值
+  std::shared_ptr<const PrefixExtractor> prefix_extractor;
+  std::string last_prefix;
+  std::vector<std::pair<size_t, size_t>> prefix_hashes;
+  std::optional<RangeFilter::Builder> range_builder;
+  std::shared_ptr<RangeFilter> range_filter;
   uint64_t min_tranc_id_ = UINT64_MAX;
   uint64_t max_tranc_id_ = 0;
+  // 当前 block 的事务 id 范围
+  uint64_t block_min_tranc_id_ = UINT64_MAX;
+  uint64_t block_max_tranc_id_ = 0;
+
+  std::shared_ptr<Filter>
+  build_filter(std::vector<std::pair<size_t, size_t>> &hashes);
+  std::vector<uint8_t> encode_filters();
 
 public:
   // 创建一个sst构建器, 指定目标block的大小
-  SSTBuilder(size_t block_size, bool has_bloom); // 添加一个key-value对
+  SSTBuilder(size_t block_size, bool has_bloom, size_t level = 0);
+  // 添加一个key-value对
   void add(const std::string &key, const std::string &value, uint64_t tranc_id);
   // 估计sst的大小
   size_t estimated_size() const;
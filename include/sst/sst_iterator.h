@@ -34,6 +34,8 @@ private:
   void update_current() const;
   void set_block_idx(size_t idx);
   void set_block_it(std::shared_ptr<BlockIterator> it);
+  // 从 m_block_idx 开始加载第一个存在可见版本的 block
+  void load_visible_block();
 
 public:
   // 创建迭代器, 并移动到第一个key
@@ -58,6 +60,8 @@ public:
   virtual value_type operator*() const override;
   virtual IteratorType get_type() const override;
   virtual uint64_t get_tranc_id() const override;
+  // 当前键值对的事务 id, get_tranc_id 返回的是迭代器的最大可见事务 id
+  uint64_t get_entry_tranc_id() const;
   virtual bool is_end() const override;
   virtual bool is_valid() const override;
 
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 内存池: 从大块内存中顺序分配, 不支持单独释放, 析构时统一释放所有内存
+// 用于存放 memtable 的节点, 避免每个节点都单独向系统申请内存
+// 分配操作是线程安全的, 多个写线程可以同时向跳表插入节点
+class Arena {
+public:
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
+
+  Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // 分配 bytes 字节的内存, 起始地址按指针大小对齐
+  char *allocate(size_t bytes);
+
+  // 已经分配给调用方的字节数(包含对齐填充)
+  size_t allocated_bytes() const;
+
+  // 向系统申请的全部内存字节数
+  size_t memory_usage() const;
+
+private:
+  char *allocate_fallback(size_t bytes);
+  char *allocate_new_block(size_t block_bytes);
+
+  size_t block_size_;
+  std::mutex mutex_;
+  char *alloc_ptr_;               // 当前块中未分配部分的起始地址
+  size_t alloc_bytes_remaining_;  // 当前块中剩余的字节数
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::atomic<size_t> allocated_bytes_;
+  std::atomic<size_t> memory_usage_;
+};
+} // namespace tiny_lsm
@@ -2,15 +2,17 @@
 
 #pragma once
 
+#include "filter.h"
 #include <cmath>
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace tiny_lsm {
 
-class BloomFilter {
+class BloomFilter : public Filter {
 public:
   // 构造函数，初始化布隆过滤器
   // expected_elements: 预期插入的元素数量
@@ -18,20 +20,35 @@ public:
   BloomFilter();
   BloomFilter(size_t expected_elements, double false_positive_rate);
 
+  // 直接指定位数组大小, 哈希函数数量由每个元素分摊的位数决定
   BloomFilter(size_t expected_elements, double false_positive_rate,
               size_t num_bits);
 
+  // 按照实际元素数量和每个元素的位数创建布隆过滤器
+  static BloomFilter with_bits_per_key(size_t num_elements, double bits_per_key);
+
   void add(const std::string &key);
 
+  // 计算 key 的两个基础哈希值, 用于在元素数量确定前暂存 key
+  static std::pair<size_t, size_t> base_hashes(const std::string &key);
+
+  // 使用 base_hashes 的结果添加元素, 与 add(key) 等价
+  void add_hashes(size_t h1, size_t h2);
+
+  FilterType type() const override;
+
   // 如果key可能存在于布隆过滤器中，返回true；否则返回false
-  bool possibly_contains(const std::string &key) const;
+  bool possibly_contains(const std::string &key) const override;
 
   // 清空布隆过滤器
   void clear();
 
-  std::vector<uint8_t> encode();
+  std::vector<uint8_t> encode() override;
   static BloomFilter decode(const std::vector<uint8_t> &data);
 
+  // 位数组的大小
+  size_t num_bits() const;
+
 private:
   // 布隆过滤器的位数组大小
   size_t expected_elements_;
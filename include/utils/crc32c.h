@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tiny_lsm {
+
+// CRC32C (Castagnoli), 支持 SSE4.2 / ARMv8 CRC 指令时使用硬件计算,
+// 否则使用查表实现
+
+// 在 crc 的基础上继续计算 data 的校验和, crc 为之前的计算结果
+uint32_t crc32c_extend(uint32_t crc, const uint8_t *data, size_t n);
+
+inline uint32_t crc32c_value(const uint8_t *data, size_t n) {
+  return crc32c_extend(0, data, n);
+}
+
+// 当前 CPU 是否支持硬件计算
+bool crc32c_hardware_accelerated();
+} // namespace tiny_lsm
@@ -38,8 +38,10 @@ public:
   bool truncate(size_t offset);
 
   // 创建文件对象, 并写入到磁盘
+  // mode 会落盘时同时同步文件所在的目录
   static FileObj create_and_write(const std::string &path,
-                                  std::vector<uint8_t> buf);
+                                  std::vector<uint8_t> buf,
+                                  SyncMode mode = SyncMode::OS);
 
   // 打开文件对象
   static FileObj open(const std::string &path, bool create);
@@ -77,8 +79,23 @@ public:
   bool append_uint32(uint32_t value);
   bool append_uint64(uint64_t value);
 
+  // 设置 sync 使用的同步方式, 默认只写入操作系统
+  bool set_sync_mode(SyncMode mode);
+
+  // 写入操作系统, 不保证落盘
+  bool flush();
+
   bool sync();
 
+  // 只同步文件描述符, 可以在其他线程写入时调用
+  bool sync_data();
+
+  // 同步 path 所在的目录
+  static bool sync_dir(const std::string &path);
+
+  // 预先分配磁盘空间, 不改变文件大小, 不支持时返回 false
+  bool preallocate(size_t size);
+
   Cursor get_cursor(FileObj &file_obj);
 };
 } // namespace tiny_lsm
\ No newline at end of file
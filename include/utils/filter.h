@@ -0,0 +1,38 @@
+// include/utils/filter.h
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tiny_lsm {
+
+// sst 中过滤器的类型, 编码时作为过滤器段的第一个字节
+enum class FilterType : uint8_t {
+  BLOOM = 0,
+  XOR = 1,
+  RANGE = 2,
+};
+
+// 过滤器的公共接口, SST 通过该接口判断 key 是否可能存在
+class Filter {
+public:
+  virtual ~Filter() = default;
+
+  virtual FilterType type() const = 0;
+
+  // 如果key可能存在于过滤器中，返回true；否则返回false
+  virtual bool possibly_contains(const std::string &key) const = 0;
+
+  // 编码过滤器本身的数据, 不包含类型
+  virtual std::vector<uint8_t> encode() = 0;
+
+  // 编码为 | type(8) | filter data |
+  static std::vector<uint8_t> encode_with_type(Filter &filter);
+  // 根据类型解码过滤器
+  static std::shared_ptr<Filter>
+  decode_with_type(const std::vector<uint8_t> &data);
+};
+} // namespace tiny_lsm
@@ -0,0 +1,67 @@
+// include/utils/prefix_extractor.h
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 前缀提取器, 用于构建前缀布隆过滤器
+// 要求: 若 key 以 preffix 开头且 preffix 在定义域内,
+// 则 key 也在定义域内且 transform(key) == transform(preffix)
+class PrefixExtractor {
+public:
+  virtual ~PrefixExtractor() = default;
+
+  // 名称会写入 sst, 提取器变化后旧 sst 的前缀过滤器不再使用
+  virtual std::string name() const = 0;
+
+  // key 是否可以提取前缀
+  virtual bool in_domain(const std::string &key) const = 0;
+
+  // 提取前缀, 调用前需保证 in_domain(key) 为 true
+  virtual std::string transform(const std::string &key) const = 0;
+
+  // 前缀查询 preffix 能使用的过滤前缀, 无法使用前缀过滤器时返回空
+  std::optional<std::string> query_prefix(const std::string &preffix) const;
+
+  // 根据配置创建前缀提取器, 未配置时返回 nullptr
+  static std::shared_ptr<const PrefixExtractor> from_config();
+};
+
+// 取 key 的前 len 个字节
+class FixedPrefixExtractor : public PrefixExtractor {
+public:
+  explicit FixedPrefixExtractor(size_t len);
+
+  std::string name() const override;
+  bool in_domain(const std::string &key) const override;
+  std::string transform(const std::string &key) const override;
+
+private:
+  size_t len_;
+};
+
+// 以某个 header 开头的 key, 取到 header 之后第一个分隔符为止(包含分隔符)
+// 如 redis 的集合成员 REDIS_SET_{key}_{member} 提取为 REDIS_SET_{key}_
+class HeaderPrefixExtractor : public PrefixExtractor {
+public:
+  // headers 之间不能互为前缀
+  HeaderPrefixExtractor(std::vector<std::string> headers, char delimiter);
+
+  std::string name() const override;
+  bool in_domain(const std::string &key) const override;
+  std::string transform(const std::string &key) const override;
+
+private:
+  std::vector<std::string> headers_;
+  char delimiter_;
+
+  // 返回分隔符的位置, 不在定义域内时返回 std::string::npos
+  size_t delimiter_pos(const std::string &key) const;
+};
+} // namespace tiny_lsm
@@ -0,0 +1,57 @@
+// include/utils/range_filter.h
+
+#pragma once
+
+#include "filter.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 范围过滤器 (参考 SuRF-Base 的截断方式)
+// 每个 key 只保存能与相邻 key 区分开的最短前缀, 所有截断后的前缀有序存放
+// 可以判断某个范围或前缀内是否可能存在 key, 不会出现假阴性
+class RangeFilter : public Filter {
+public:
+  // 按照升序依次添加 key 来构建范围过滤器
+  class Builder {
+  public:
+    // 相同的 key 连续添加只记录一次
+    void add(const std::string &key);
+    RangeFilter finish();
+
+  private:
+    std::vector<std::string> entries_;
+    std::optional<std::string> last_key_;
+    // last_key_ 与前一个 key 的公共前缀长度
+    size_t last_lcp_ = 0;
+  };
+
+  RangeFilter() = default;
+
+  FilterType type() const override;
+
+  bool possibly_contains(const std::string &key) const override;
+
+  // 闭区间 [lo, hi] 中是否可能存在 key
+  bool may_contain_range(const std::string &lo, const std::string &hi) const;
+
+  // 是否可能存在以 preffix 开头的 key
+  bool may_contain_preffix(const std::string &preffix) const;
+
+  std::vector<uint8_t> encode() override;
+  static RangeFilter decode(const std::vector<uint8_t> &data);
+
+  // 截断后的前缀数量
+  size_t num_entries() const;
+
+private:
+  std::vector<std::string> entries_;
+
+  // 返回第一个不小于 lo 的前缀的位置, prefix_of_lo 表示其之前的前缀是否为 lo
+  // 的前缀
+  size_t seek(const std::string &lo, bool &prefix_of_lo) const;
+};
+} // namespace tiny_lsm
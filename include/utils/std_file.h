@@ -7,11 +7,36 @@
 #include <vector>
 
 namespace tiny_lsm {
+
+// 文件同步到磁盘的方式
+enum class SyncMode {
+  NONE,      // 不主动同步, 数据留在用户态缓冲区中, 缓冲区满或关闭时写出
+  OS,        // 写入操作系统的页缓存, 进程崩溃不会丢失, 掉电可能丢失
+  FDATASYNC, // 同步时调用 fdatasync
+  FSYNC,     // 同步时调用 fsync, 同时持久化文件的元数据
+  DSYNC,     // 以 O_DSYNC 写入, 每次写入返回时已经落盘
+};
+
+// 配置中的 "none", "os", "fdatasync", "fsync", "dsync"
+// 无法识别时使用 fdatasync
+SyncMode sync_mode_from_string(const std::string &mode);
+
+// 是否会把数据真正写到磁盘上
+inline bool is_durable(SyncMode mode) {
+  return mode == SyncMode::FDATASYNC || mode == SyncMode::FSYNC ||
+         mode == SyncMode::DSYNC;
+}
+
 class StdFile {
 
 private:
   std::fstream file_;
   std::filesystem::path filename_;
+  SyncMode sync_mode_ = SyncMode::OS;
+  // 用于 fdatasync / fsync / O_DSYNC 写入的文件描述符
+  int sync_fd_ = -1;
+
+  void close_sync_fd();
 
 public:
   StdFile() {}
@@ -19,13 +44,18 @@ public:
     if (file_.is_open()) {
       close();
     }
+    close_sync_fd();
   }
 
   // 打开文件并映射到内存
   bool open(const std::string &filename, bool create);
 
-  // 创建文件
-  bool create(const std::string &filename, std::vector<uint8_t> &buf);
+  // 创建文件, 在写入内容之前设置同步方式
+  bool create(const std::string &filename, std::vector<uint8_t> &buf,
+              SyncMode mode = SyncMode::OS);
+
+  // 设置同步方式, DSYNC 模式下之后的写入都直接写到磁盘
+  bool set_sync_mode(SyncMode mode);
 
   // 关闭文件
   void close();
@@ -39,9 +69,23 @@ public:
   // 读取数据
   std::vector<uint8_t> read(size_t offset, size_t length);
 
-  // 同步到磁盘
+  // 将用户态缓冲区写入操作系统, NONE 模式下不做任何事
+  bool flush();
+
+  // 按照同步方式同步到磁盘
   bool sync();
 
+  // 只对文件描述符执行 fdatasync / fsync, 不访问用户态缓冲区
+  // 可以与写入并发调用, 调用前需要先 flush
+  bool sync_data();
+
+  // 同步 path 所在的目录, 使新建的文件在掉电后仍然存在
+  static bool sync_dir(const std::string &path);
+
+  // 为文件预先分配 size 字节的磁盘空间, 不改变文件大小
+  // 之后的写入不需要再分配磁盘块, 减少同步时的元数据更新
+  bool preallocate(size_t size);
+
   // 删除文件
   bool remove();
 
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tiny_lsm {
+
+// wal 文件按 LOG_BLOCK_SIZE 大小的块组织, 每次写入的数据作为一条逻辑记录,
+// 切分为若干分片写入块中, 分片不会跨越块的边界
+// 分片格式: crc32c(32) + 长度(16) + 类型(8) + 日志编号(32) + 数据
+// 校验和覆盖类型, 日志编号和数据
+// 块的剩余空间放不下分片头时用 0 填充, 读取时跳到下一个块
+enum class LogFragmentType : uint8_t {
+  ZERO = 0, // 保留给填充和预分配的空间
+  FULL = 1, // 逻辑记录完整地放在一个分片中
+  FIRST = 2,
+  MIDDLE = 3,
+  LAST = 4,
+};
+
+class LogFormat {
+public:
+  static constexpr size_t BLOCK_SIZE = 32768;
+  static constexpr size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(uint16_t) +
+                                        sizeof(uint8_t) + sizeof(uint32_t);
+
+  // 将一条逻辑记录编码为分片, 追加到 dst 的末尾
+  // offset 为 dst 的数据在文件中的起始位置, 用于确定块的边界
+  // log_number 为所在 wal 文件的编号
+  static void encode(std::vector<uint8_t> &dst, size_t offset,
+                     const uint8_t *data, size_t size, uint32_t log_number);
+
+  // 从文件开头解码所有完整的逻辑记录
+  // 遇到校验和错误, 不完整的分片 (崩溃时写了一半) 或者日志编号不是 log_number
+  // 的分片 (复用的文件中残留的旧记录) 时停止, 之前未拼接完整的逻辑记录被丢弃
+  static std::vector<std::vector<uint8_t>>
+  decode(const std::vector<uint8_t> &data, uint32_t log_number);
+};
+} // namespace tiny_lsm
@@ -31,10 +31,19 @@ public:
                           const std::string &value);
   static Record deleteRecord(uint64_t tranc_id, const std::string &key);
 
-  // 编码记录
+  // 记录头: 记录长度(32) + 事务id(64) + 操作类型(8)
+  // key 和 value 的长度同样使用 32 位编码
+  static constexpr size_t HEADER_SIZE =
+      sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint8_t);
+
   std::vector<uint8_t> encode() const;
+  // 编码后追加到 buf 的末尾, 一批记录可以编码到同一块连续的内存中
+  void encode_to(std::vector<uint8_t> &buf) const;
+  // 编码后的长度
+  size_t encoded_size() const { return record_len_; }
 
-  // 解码记录
+  // 解码记录, 遇到不完整的记录时停止
+  // 数据的完整性由 wal 文件分片的校验和保证
   static std::vector<Record> decode(const std::vector<uint8_t> &data);
 
   // 获取记录的各个部分
@@ -54,6 +63,6 @@ private:
   OperationType operation_type_;
   std::string key_;
   std::string value_;
-  uint16_t record_len_;
+  uint32_t record_len_;
 };
 } // namespace tiny_lsm
\ No newline at end of file
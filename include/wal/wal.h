@@ -3,12 +3,16 @@
 #pragma once
 
 #include "../utils/files.h"
+#include "log_format.h"
 #include "record.h"
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
@@ -17,15 +21,31 @@ namespace tiny_lsm {
 
 class WAL {
 public:
+  // sync_mode 为需要同步的写入使用的同步方式
+  // sync_interval_ms 或 sync_bytes 大于 0 时开启后台同步:
+  // 写入只写到操作系统, 由后台线程定时或在未同步的数据足够多时同步
+  // preallocate 为 true 时新建的文件预先分配 file_size_limit 字节的空间
+  // 已经完成检查点的旧文件最多保留 recycle_file_num 个, 切换文件时重命名复用
   WAL(const std::string &log_dir, size_t buffer_size,
       uint64_t checkpoint_tranc_id, uint64_t clean_interval,
-      uint64_t file_size_limit);
+      uint64_t file_size_limit, SyncMode sync_mode = SyncMode::OS,
+      uint64_t sync_interval_ms = 0, uint64_t sync_bytes = 0,
+      bool preallocate = false, size_t recycle_file_num = 0);
   ~WAL();
 
   static std::map<uint64_t, std::vector<Record>>
   recover(const std::string &log_dir, uint64_t checkpoint_tranc_id);
 
+  // 按文件编号的顺序, 每个文件回调一次 visitor, 传入其中需要恢复的记录
+  // 最多 parallelism 个文件同时在后台线程中读取和解码,
+  // 内存中只保留这些文件的记录
+  static void
+  recover(const std::string &log_dir, uint64_t checkpoint_tranc_id,
+          const std::function<void(std::vector<Record> &)> &visitor,
+          size_t parallelism);
+
   // 将记录添加到缓冲区
+  // force_flush 为 true 时写入文件并按照同步方式同步
   void log(const std::vector<Record> &records, bool force_flush = false);
 
   // 强制将缓冲区中的数据写入 WAL 文件
@@ -35,19 +55,64 @@ public:
 
 private:
   void cleaner();
-  void cleanWALFile();
   void reset_file();
+  void syncer();
+  bool background_sync() const;
+  // 读取 wal 文件中的所有记录, log_number 为文件的编号
+  static std::vector<Record> read_records(const std::string &path,
+                                          uint32_t log_number);
+  // 读取文件末尾的摘要, 返回 (最小 tranc_id, 最大 tranc_id)
+  // 文件没有正常切换 (如崩溃时的当前文件) 或者摘要属于复用前的旧文件时返回空
+  static std::optional<std::pair<uint64_t, uint64_t>>
+  read_footer(const std::string &path, uint32_t log_number);
+  // 在当前文件末尾写入摘要, 并记录到 segment_ranges_ 中
+  void seal_file();
 
 protected:
+  // 删除或回收已经完成检查点的文件
+  void cleanWALFile();
+
   std::string active_log_path_;
   FileObj log_file_;
+  // 当前文件的编号, 写入每个分片的头部, 用于识别复用文件中残留的旧记录
+  uint32_t log_number_ = 0;
+  // 当前文件中记录的 tranc_id 范围, 没有记录时 min 大于 max
+  uint64_t min_tranc_id_;
+  uint64_t max_tranc_id_;
+  // 已经切换出去的文件的编号 -> 其中记录的 tranc_id 范围
+  // 清理时只需要检查这里, 不需要读取文件
+  std::map<uint64_t, std::pair<uint64_t, uint64_t>> segment_ranges_;
+  // 下一条记录在当前文件中的写入位置
+  // 复用的文件大小不代表已写入的数据量, 不能直接追加
+  size_t write_offset_ = 0;
+  bool preallocate_;
+  size_t recycle_file_num_;
+  // 等待复用的文件
+  std::deque<std::string> recycle_paths_;
   size_t file_size_limit_;
   std::mutex mutex_;
-  std::vector<Record> log_buffer_;
+  // 缓冲区中的记录已经编码, 写入文件时整体作为一条逻辑记录
+  std::vector<uint8_t> log_buffer_;
+  size_t log_buffer_records_ = 0;
+  // 分片后的数据, 复用内存避免每次写入都重新分配
+  std::vector<uint8_t> write_buffer_;
   size_t buffer_size_;
   std::thread cleaner_thread_;
   uint64_t checkpoint_tranc_id_;
   std::atomic<bool> stop_cleaner_;
+  // 关闭时唤醒清理线程, 不必等待 clean_interval_ 结束
+  std::condition_variable cleaner_cv_;
   uint64_t clean_interval_;
+
+  SyncMode sync_mode_;
+  uint64_t sync_interval_ms_;
+  uint64_t sync_bytes_;
+  // 后台同步线程
+  std::thread syncer_thread_;
+  std::condition_variable sync_cv_;
+  bool stop_syncer_ = false;
+  size_t unsynced_bytes_ = 0;
+  // 后台线程同步文件时持有, 切换文件时需要等待同步完成
+  std::mutex sync_mutex_;
 };
 } // namespace tiny_lsm
\ No newline at end of file
@@ -31,6 +31,18 @@ void bind_Level_Iterator(py::module &m) {
       });
 }
 
+void bind_TrancIterator(py::module &m) {
+  py::class_<tiny_lsm::TrancIterator>(m, "TrancIterator")
+      .def("__iter__", [](tiny_lsm::TrancIterator &it) { return &it; })
+      .def("__next__", [](tiny_lsm::TrancIterator &it) {
+        if (!it.is_valid())
+          throw py::stop_iteration();
+        auto kv = *it;
+        ++it;
+        return py::make_tuple(kv.first, kv.second);
+      });
+}
+
 // 绑定 TranContext 事务上下文
 
 // 提前声明 TranContext（如果头文件未包含）
@@ -43,10 +55,22 @@ void bind_TranContext(py::module &m) {
            py::arg("test_fail") = false) // 处理默认参数
       .def("abort", &tiny_lsm::TranContext::abort)
       .def("get", &tiny_lsm::TranContext::get)
+      .def("get_for_update", &tiny_lsm::TranContext::get_for_update)
+      .def("scan_preffix", &tiny_lsm::TranContext::scan_preffix,
+           py::arg("preffix"))
+      .def("begin", &tiny_lsm::TranContext::begin)
+      .def("begin_preffix", &tiny_lsm::TranContext::begin_preffix,
+           py::arg("preffix"))
       .def("remove", &tiny_lsm::TranContext::remove)
       .def("put", &tiny_lsm::TranContext::put);
 }
 
+void bind_Snapshot(py::module &m) {
+  py::class_<tiny_lsm::Snapshot, std::shared_ptr<tiny_lsm::Snapshot>>(
+      m, "Snapshot")
+      .def_property_readonly("tranc_id", &tiny_lsm::Snapshot::get_tranc_id);
+}
+
 void bind_IsolationLevel(py::module &m) {
   py::enum_<tiny_lsm::IsolationLevel>(m, "IsolationLevel")
       .value("READ_UNCOMMITTED", tiny_lsm::IsolationLevel::READ_UNCOMMITTED)
@@ -56,34 +80,87 @@ void bind_IsolationLevel(py::module &m) {
       .export_values();
 }
 
+void bind_TrancMode(py::module &m) {
+  py::enum_<tiny_lsm::TrancMode>(m, "TrancMode")
+      .value("OPTIMISTIC", tiny_lsm::TrancMode::OPTIMISTIC)
+      .value("PESSIMISTIC", tiny_lsm::TrancMode::PESSIMISTIC)
+      .export_values();
+}
+
+void bind_WriteOptions(py::module &m) {
+  py::class_<tiny_lsm::WriteOptions>(m, "WriteOptions")
+      .def(py::init<>())
+      .def_readwrite("sync", &tiny_lsm::WriteOptions::sync)
+      .def_readwrite("disable_wal", &tiny_lsm::WriteOptions::disable_wal);
+}
+
+void bind_WriteBatch(py::module &m) {
+  py::class_<tiny_lsm::WriteBatch>(m, "WriteBatch")
+      .def(py::init<>())
+      .def(py::init<const std::string &>(), py::arg("data"),
+           "Restore a batch from its serialized data")
+      .def("put", &tiny_lsm::WriteBatch::put, py::arg("key"), py::arg("value"))
+      .def("remove", &tiny_lsm::WriteBatch::remove, py::arg("key"))
+      .def("clear", &tiny_lsm::WriteBatch::clear)
+      .def("count", &tiny_lsm::WriteBatch::count)
+      .def("data",
+           [](const tiny_lsm::WriteBatch &batch) {
+             return py::bytes(batch.data());
+           },
+           "Serialized batch");
+}
+
 PYBIND11_MODULE(lsm_pybind, m) {
   // 绑定辅助类
   bind_TwoMergeIterator(m);
   bind_Level_Iterator(m);
+  bind_TrancIterator(m);
   bind_TranContext(m);
+  bind_Snapshot(m);
   bind_IsolationLevel(m);
+  bind_TrancMode(m);
+  bind_WriteOptions(m);
+  bind_WriteBatch(m);
 
   // 主类 LSM
   py::class_<tiny_lsm::LSM>(m, "LSM")
       .def(py::init<const std::string &>())
       // 基础操作
       .def("put", &tiny_lsm::LSM::put, py::arg("key"), py::arg("value"),
+           py::arg("options") = tiny_lsm::WriteOptions(),
            "Insert a key-value pair (bytes type)")
-      .def("get", &tiny_lsm::LSM::get, py::arg("key"),
-           "Get value by key, returns None if not found")
-      .def("remove", &tiny_lsm::LSM::remove, py::arg("key"), "Delete a key")
+      .def("get",
+           py::overload_cast<const std::string &>(&tiny_lsm::LSM::get),
+           py::arg("key"), "Get value by key, returns None if not found")
+      .def("get",
+           py::overload_cast<const std::string &, const tiny_lsm::Snapshot &>(
+               &tiny_lsm::LSM::get),
+           py::arg("key"), py::arg("snapshot"),
+           "Get value by key as of a snapshot")
+      .def("remove", &tiny_lsm::LSM::remove, py::arg("key"),
+           py::arg("options") = tiny_lsm::WriteOptions(), "Delete a key")
       // 批量操作
       .def("put_batch", &tiny_lsm::LSM::put_batch, py::arg("kvs"),
+           py::arg("options") = tiny_lsm::WriteOptions(),
            "Batch insert key-value pairs")
       .def("remove_batch", &tiny_lsm::LSM::remove_batch, py::arg("keys"),
-           "Batch delete keys")
+           py::arg("options") = tiny_lsm::WriteOptions(), "Batch delete keys")
+      .def("write", &tiny_lsm::LSM::write, py::arg("batch"),
+           py::arg("options") = tiny_lsm::WriteOptions(),
+           "Apply puts and deletes in a batch atomically")
       // 迭代器
       .def("begin", &tiny_lsm::LSM::begin, py::arg("tranc_id"),
            "Start an iterator with transaction ID")
       .def("end", &tiny_lsm::LSM::end, "Get end iterator")
       // 事务
       .def("begin_tran", &tiny_lsm::LSM::begin_tran, py::arg("isolation_level"),
+           py::arg("tranc_mode") = tiny_lsm::TrancMode::OPTIMISTIC,
            "Start a transaction")
+      // 快照
+      .def("get_snapshot", &tiny_lsm::LSM::get_snapshot,
+           "Take a snapshot, release it with release_snapshot")
+      .def("release_snapshot", &tiny_lsm::LSM::release_snapshot,
+           py::arg("snapshot"), "Release a snapshot")
       // 其他方法
       .def("clear", &tiny_lsm::LSM::clear, "Clear all data") // ! Fix bugs
       .def("flush", &tiny_lsm::LSM::flush, "Flush memory table to disk")
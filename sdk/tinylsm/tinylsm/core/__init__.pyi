@@ -9,6 +9,11 @@ class IsolationLevel(Enum):
     SERIALIZABLE = 3
 
 
+class TrancMode(Enum):
+    OPTIMISTIC = 0
+    PESSIMISTIC = 1
+
+
 class TwoMergeIterator:
 
     def __iter__(self) -> Iterator[Tuple[bytes, bytes]]:
@@ -26,6 +31,15 @@ class Level_Iterator:
         ...
 
 
+class TrancIterator:
+
+    def __iter__(self) -> Iterator[Tuple[bytes, bytes]]:
+        ...
+
+    def __next__(self) -> Tuple[bytes, bytes]:
+        ...
+
+
 class TranContext:
     # 事务操作
     def commit(self, test_fail: bool = False) -> bool:
@@ -44,6 +58,48 @@ class TranContext:
     def get(self, key: bytes) -> Optional[bytes]:
         ...
 
+    # 悲观事务读取时获取排他锁
+    def get_for_update(self, key: bytes) -> Optional[bytes]:
+        ...
+
+    def scan_preffix(self, preffix: bytes) -> List[Tuple[bytes, bytes]]:
+        ...
+
+    # 遍历时合并事务自身的写入
+    def begin(self) -> TrancIterator:
+        ...
+
+    def begin_preffix(self, preffix: bytes) -> TrancIterator:
+        ...
+
+
+class Snapshot:
+    @property
+    def tranc_id(self) -> int:
+        ...
+
+
+class WriteBatch:
+
+    def __init__(self, data: bytes = ...) -> None:
+        ...
+
+    def put(self, key: bytes, value: bytes) -> None:
+        ...
+
+    def remove(self, key: bytes) -> None:
+        ...
+
+    def clear(self) -> None:
+        ...
+
+    def count(self) -> int:
+        ...
+
+    # 序列化后的数据, 可以用于重新构造 WriteBatch
+    def data(self) -> bytes:
+        ...
+
 
 class LSM:
 
@@ -54,7 +110,7 @@ class LSM:
     def put(self, key: bytes, value: bytes) -> None:
         ...
 
-    def get(self, key: bytes) -> Optional[bytes]:
+    def get(self, key: bytes, snapshot: Snapshot = ...) -> Optional[bytes]:
         ...
 
     def remove(self, key: bytes) -> None:
@@ -67,6 +123,10 @@ class LSM:
     def remove_batch(self, keys: List[bytes]) -> None:
         ...
 
+    # 原子地应用 put 和 remove 混合的批量写入
+    def write(self, batch: WriteBatch) -> None:
+        ...
+
     # 迭代器
     def begin(self, tranc_id: int) -> Level_Iterator:
         ...
@@ -75,7 +135,15 @@ class LSM:
         ...
 
     # 事务管理
-    def begin_tran(self, isolation_level: IsolationLevel) -> TranContext:
+    def begin_tran(self, isolation_level: IsolationLevel,
+                   tranc_mode: TrancMode = TrancMode.OPTIMISTIC) -> TranContext:
+        ...
+
+    # 快照
+    def get_snapshot(self) -> Snapshot:
+        ...
+
+    def release_snapshot(self, snapshot: Snapshot) -> None:
         ...
 
     # 维护操作
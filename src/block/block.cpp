@@ -387,6 +387,17 @@ size_t Block::cur_size() const {
 
 bool Block::is_empty() const { return offsets.empty(); }
 
+std::vector<std::tuple<std::string, std::string, uint64_t>>
+Block::get_entries() const {
+  std::vector<std::tuple<std::string, std::string, uint64_t>> entries;
+  entries.reserve(offsets.size());
+  for (auto offset : offsets) {
+    entries.emplace_back(get_key_at(offset), get_value_at(offset),
+                         get_tranc_id_at(offset));
+  }
+  return entries;
+}
+
 BlockIterator Block::begin(uint64_t tranc_id) {
   return BlockIterator(shared_from_this(), 0, tranc_id);
 }
@@ -4,11 +4,15 @@
 #include <stdexcept>
 
 namespace tiny_lsm {
-BlockMeta::BlockMeta() : offset(0), first_key(""), last_key("") {}
+BlockMeta::BlockMeta()
+    : offset(0), first_key(""), last_key(""), min_tranc_id(0),
+      max_tranc_id(UINT64_MAX) {}
 
 BlockMeta::BlockMeta(size_t offset, const std::string &first_key,
-                     const std::string &last_key)
-    : offset(offset), first_key(first_key), last_key(last_key) {}
+                     const std::string &last_key, uint64_t min_tranc_id,
+                     uint64_t max_tranc_id)
+    : offset(offset), first_key(first_key), last_key(last_key),
+      min_tranc_id(min_tranc_id), max_tranc_id(max_tranc_id) {}
 
 void BlockMeta::encode_meta_to_slice(std::vector<BlockMeta> &meta_entries,
                                      std::vector<uint8_t> &metadata) {
@@ -25,6 +29,8 @@ void BlockMeta::encode_meta_to_slice(std::vector<BlockMeta> &meta_entries,
                   meta.last_key.size();   // last_key
   }
   total_size += sizeof(uint32_t); // hash
+  // 事务 id 范围和对应的 hash
+  total_size += num_entries * sizeof(uint64_t) * 2 + sizeof(uint32_t);
 
   // 2. 分配空间
   metadata.resize(total_size);
@@ -66,6 +72,20 @@ void BlockMeta::encode_meta_to_slice(std::vector<BlockMeta> &meta_entries,
       std::string_view(reinterpret_cast<const char *>(data_start), data_len));
 
   memcpy(ptr, &hash, sizeof(uint32_t));
+  ptr += sizeof(uint32_t);
+
+  // 6. 写入每个 block 的事务 id 范围及其 hash
+  const uint8_t *tranc_start = ptr;
+  for (const auto &meta : meta_entries) {
+    memcpy(ptr, &meta.min_tranc_id, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+    memcpy(ptr, &meta.max_tranc_id, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+  }
+  uint32_t tranc_hash = std::hash<std::string_view>{}(
+      std::string_view(reinterpret_cast<const char *>(tranc_start),
+                       ptr - tranc_start));
+  memcpy(ptr, &tranc_hash, sizeof(uint32_t));
 }
 
 std::vector<BlockMeta>
@@ -125,6 +145,30 @@ BlockMeta::decode_meta_from_slice(const std::vector<uint8_t> &metadata) {
   if (stored_hash != computed_hash) {
     throw std::runtime_error("Metadata hash mismatch");
   }
+  ptr += sizeof(uint32_t);
+
+  // 5. 读取事务 id 范围, 旧版本的 sst 没有这一部分, 保持默认值
+  size_t remain = metadata.data() + metadata.size() - ptr;
+  if (remain == 0) {
+    return meta_entries;
+  }
+  size_t tranc_len = num_entries * sizeof(uint64_t) * 2;
+  if (remain < tranc_len + sizeof(uint32_t)) {
+    throw std::runtime_error("Invalid metadata size");
+  }
+  uint32_t stored_tranc_hash;
+  memcpy(&stored_tranc_hash, ptr + tranc_len, sizeof(uint32_t));
+  uint32_t computed_tranc_hash = std::hash<std::string_view>{}(
+      std::string_view(reinterpret_cast<const char *>(ptr), tranc_len));
+  if (stored_tranc_hash != computed_tranc_hash) {
+    throw std::runtime_error("Metadata hash mismatch");
+  }
+  for (auto &meta : meta_entries) {
+    memcpy(&meta.min_tranc_id, ptr, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+    memcpy(&meta.max_tranc_id, ptr, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+  }
 
   return meta_entries;
 }
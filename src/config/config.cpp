@@ -5,6 +5,14 @@
 
 namespace tiny_lsm {
 
+// toml 中的数字既可能写成整数也可能写成浮点数
+static double as_number(const toml::value &value) {
+  if (value.is_integer()) {
+    return static_cast<double>(value.as_integer());
+  }
+  return value.as_floating();
+}
+
 // Private helper to set all default values
 void TomlConfig::setDefaultValues() {
   // --- LSM Core ---
@@ -12,10 +20,30 @@ void TomlConfig::setDefaultValues() {
   lsm_per_mem_size_limit_ = 4194304;  // Default: 4 * 1024 * 1024
   lsm_block_size_ = 32768;            // Default: 32 * 1024
   lsm_sst_level_ratio_ = 4;           // Default: 4
+  memtable_rep_ = "skiplist";
+  memtable_hash_bucket_count_ = 1024;
+  write_group_max_size_ = 64;
+  write_parallel_apply_ = true;
+  sst_sync_mode_ = "fdatasync";
+  tranc_commit_stripes_ = 64;
+  tranc_commit_history_ = 4096;
+  tranc_lock_stripes_ = 64;
+  tranc_lock_timeout_ms_ = 1000;
+
+  // --- WAL ---
+  wal_buffer_size_ = 128;
+  wal_file_size_limit_ = 4194304; // Default: 4 * 1024 * 1024
+  wal_sync_mode_ = "fdatasync";
+  wal_sync_interval_ms_ = 0;
+  wal_sync_bytes_ = 0;
+  wal_preallocate_ = true;
+  wal_recycle_file_num_ = 4;
+  wal_recovery_threads_ = 4;
 
   // --- LSM Cache ---
   lsm_block_cache_capacity_ = 1024; // Default: 1024
   lsm_block_cache_k_ = 8;           // Default: 8
+  lsm_row_cache_capacity_bytes_ = 0; // Default: disabled
 
   // --- Redis Headers/Separators ---
   redis_expire_header_ = "REDIS_EXPIRE_";
@@ -23,6 +51,8 @@ void TomlConfig::setDefaultValues() {
   redis_field_prefix_ = "REDIS_FIELD_";
   redis_field_separator_ = '$';
   redis_list_separator_ = '#';
+  redis_list_value_preffix_ = "REDIS_LIST_VALUE_";
+  redis_list_prefix_ = "REDIS_LIST_";
   redis_sorted_set_prefix_ = "REDIS_SORTED_SET_";
   redis_sorted_set_score_len_ = 32;
   redis_set_prefix_ = "REDIS_SET_";
@@ -30,6 +60,13 @@ void TomlConfig::setDefaultValues() {
   // --- Bloom Filter ---
   bloom_filter_expected_size_ = 65536;
   bloom_filter_expected_error_rate_ = 0.1;
+  bloom_filter_bits_per_key_ = 10;
+  bloom_filter_level_bits_per_key_.clear();
+  sst_filter_type_ = "bloom";
+  prefix_extractor_ = "redis";
+  prefix_extractor_fixed_len_ = 8;
+  memtable_prefix_bloom_size_ratio_ = 0.02;
+  sst_range_filter_ = true;
 }
 
 //////////////////////////////////////////////////////////////////
@@ -43,6 +80,18 @@ void TomlConfig::modify_lsm_block_size(int one) { lsm_block_size_ = one; }
 void TomlConfig::modify_lsm_per_mem_size_limit(long long one) {
   lsm_per_mem_size_limit_ = one;
 }
+
+void TomlConfig::modify_lsm_row_cache_capacity_bytes(long long one) {
+  lsm_row_cache_capacity_bytes_ = one;
+}
+
+void TomlConfig::modify_memtable_rep(const std::string &one) {
+  memtable_rep_ = one;
+}
+
+void TomlConfig::modify_write_parallel_apply(bool one) {
+  write_parallel_apply_ = one;
+}
 //////////////////////////////////////////////////////////////////
 
 // Constructor implementation
@@ -82,6 +131,74 @@ bool TomlConfig::loadFromFile(const std::string &filePath) {
         core_config.at("LSM_PER_MEM_SIZE_LIMIT").as_integer();
     lsm_block_size_ = core_config.at("LSM_BLOCK_SIZE").as_integer();
     lsm_sst_level_ratio_ = core_config.at("LSM_SST_LEVEL_RATIO").as_integer();
+    // 可选配置, 缺省时使用跳表
+    if (core_config.contains("MEMTABLE_REP")) {
+      memtable_rep_ = core_config.at("MEMTABLE_REP").as_string();
+    }
+    if (core_config.contains("MEMTABLE_HASH_BUCKET_COUNT")) {
+      memtable_hash_bucket_count_ =
+          core_config.at("MEMTABLE_HASH_BUCKET_COUNT").as_integer();
+    }
+    if (core_config.contains("WRITE_GROUP_MAX_SIZE")) {
+      write_group_max_size_ =
+          core_config.at("WRITE_GROUP_MAX_SIZE").as_integer();
+    }
+    if (core_config.contains("WRITE_PARALLEL_APPLY")) {
+      write_parallel_apply_ =
+          core_config.at("WRITE_PARALLEL_APPLY").as_boolean();
+    }
+    if (core_config.contains("SST_SYNC_MODE")) {
+      sst_sync_mode_ = core_config.at("SST_SYNC_MODE").as_string();
+    }
+    if (core_config.contains("TRANC_COMMIT_STRIPES")) {
+      tranc_commit_stripes_ =
+          core_config.at("TRANC_COMMIT_STRIPES").as_integer();
+    }
+    if (core_config.contains("TRANC_COMMIT_HISTORY")) {
+      tranc_commit_history_ =
+          core_config.at("TRANC_COMMIT_HISTORY").as_integer();
+    }
+    if (core_config.contains("TRANC_LOCK_STRIPES")) {
+      tranc_lock_stripes_ = core_config.at("TRANC_LOCK_STRIPES").as_integer();
+    }
+    if (core_config.contains("TRANC_LOCK_TIMEOUT_MS")) {
+      tranc_lock_timeout_ms_ =
+          core_config.at("TRANC_LOCK_TIMEOUT_MS").as_integer();
+    }
+
+    // --- Load WAL ---
+    // 整个 [wal] 表都是可选的, 缺省时使用默认值
+    if (config.contains("wal")) {
+      auto wal_config = config["wal"];
+      if (wal_config.contains("WAL_BUFFER_SIZE")) {
+        wal_buffer_size_ = wal_config.at("WAL_BUFFER_SIZE").as_integer();
+      }
+      if (wal_config.contains("WAL_FILE_SIZE_LIMIT")) {
+        wal_file_size_limit_ =
+            wal_config.at("WAL_FILE_SIZE_LIMIT").as_integer();
+      }
+      if (wal_config.contains("WAL_SYNC_MODE")) {
+        wal_sync_mode_ = wal_config.at("WAL_SYNC_MODE").as_string();
+      }
+      if (wal_config.contains("WAL_SYNC_INTERVAL_MS")) {
+        wal_sync_interval_ms_ =
+            wal_config.at("WAL_SYNC_INTERVAL_MS").as_integer();
+      }
+      if (wal_config.contains("WAL_SYNC_BYTES")) {
+        wal_sync_bytes_ = wal_config.at("WAL_SYNC_BYTES").as_integer();
+      }
+      if (wal_config.contains("WAL_PREALLOCATE")) {
+        wal_preallocate_ = wal_config.at("WAL_PREALLOCATE").as_boolean();
+      }
+      if (wal_config.contains("WAL_RECYCLE_FILE_NUM")) {
+        wal_recycle_file_num_ =
+            wal_config.at("WAL_RECYCLE_FILE_NUM").as_integer();
+      }
+      if (wal_config.contains("WAL_RECOVERY_THREADS")) {
+        wal_recovery_threads_ =
+            wal_config.at("WAL_RECOVERY_THREADS").as_integer();
+      }
+    }
 
     // --- Load LSM Cache ---
     auto cache_config = config["lsm"]["cache"];
@@ -89,6 +206,11 @@ bool TomlConfig::loadFromFile(const std::string &filePath) {
     lsm_block_cache_capacity_ =
         cache_config.at("LSM_BLOCK_CACHE_CAPACITY").as_integer();
     lsm_block_cache_k_ = cache_config.at("LSM_BLOCK_CACHE_K").as_integer();
+    // 可选配置, 缺省时不启用行缓存
+    if (cache_config.contains("LSM_ROW_CACHE_CAPACITY_BYTES")) {
+      lsm_row_cache_capacity_bytes_ =
+          cache_config.at("LSM_ROW_CACHE_CAPACITY_BYTES").as_integer();
+    }
 
     // --- Load Redis Headers/Separators ---
     auto redis_config = config["redis"];
@@ -103,6 +225,14 @@ bool TomlConfig::loadFromFile(const std::string &filePath) {
 
     redis_list_separator_ =
         redis_config.at("REDIS_LIST_SEPARATOR").as_string()[0];
+    // 可选配置, 链表按元素存储时使用
+    if (redis_config.contains("REDIS_LIST_VALUE_PREFFIX")) {
+      redis_list_value_preffix_ =
+          redis_config.at("REDIS_LIST_VALUE_PREFFIX").as_string();
+    }
+    if (redis_config.contains("REDIS_LIST_PREFIX")) {
+      redis_list_prefix_ = redis_config.at("REDIS_LIST_PREFIX").as_string();
+    }
 
     redis_sorted_set_prefix_ =
         redis_config.at("REDIS_SORTED_SET_PREFIX").as_string();
@@ -121,6 +251,35 @@ bool TomlConfig::loadFromFile(const std::string &filePath) {
     bloom_filter_expected_error_rate_ =
         bloom_config.at("BLOOM_FILTER_EXPECTED_ERROR_RATE").as_floating();
 
+    // 以下为可选配置, 缺省时保留默认值以兼容旧的配置文件
+    if (bloom_config.contains("BLOOM_FILTER_BITS_PER_KEY")) {
+      bloom_filter_bits_per_key_ =
+          as_number(bloom_config.at("BLOOM_FILTER_BITS_PER_KEY"));
+    }
+    if (bloom_config.contains("BLOOM_FILTER_LEVEL_BITS_PER_KEY")) {
+      for (const auto &bits :
+           bloom_config.at("BLOOM_FILTER_LEVEL_BITS_PER_KEY").as_array()) {
+        bloom_filter_level_bits_per_key_.push_back(as_number(bits));
+      }
+    }
+    if (bloom_config.contains("SST_FILTER_TYPE")) {
+      sst_filter_type_ = bloom_config.at("SST_FILTER_TYPE").as_string();
+    }
+    if (bloom_config.contains("PREFIX_EXTRACTOR")) {
+      prefix_extractor_ = bloom_config.at("PREFIX_EXTRACTOR").as_string();
+    }
+    if (bloom_config.contains("PREFIX_EXTRACTOR_FIXED_LEN")) {
+      prefix_extractor_fixed_len_ =
+          bloom_config.at("PREFIX_EXTRACTOR_FIXED_LEN").as_integer();
+    }
+    if (bloom_config.contains("MEMTABLE_PREFIX_BLOOM_SIZE_RATIO")) {
+      memtable_prefix_bloom_size_ratio_ =
+          as_number(bloom_config.at("MEMTABLE_PREFIX_BLOOM_SIZE_RATIO"));
+    }
+    if (bloom_config.contains("SST_RANGE_FILTER")) {
+      sst_range_filter_ = bloom_config.at("SST_RANGE_FILTER").as_boolean();
+    }
+
     spdlog::info("Configuration loaded successfully from {}", filePath);
     return true;
 
@@ -144,11 +303,43 @@ long long TomlConfig::getLsmPerMemSizeLimit() const {
 }
 int TomlConfig::getLsmBlockSize() const { return lsm_block_size_; }
 int TomlConfig::getLsmSstLevelRatio() const { return lsm_sst_level_ratio_; }
+const std::string &TomlConfig::getMemtableRep() const { return memtable_rep_; }
+int TomlConfig::getMemtableHashBucketCount() const {
+  return memtable_hash_bucket_count_;
+}
+int TomlConfig::getWriteGroupMaxSize() const { return write_group_max_size_; }
+bool TomlConfig::getWriteParallelApply() const { return write_parallel_apply_; }
+
+const std::string &TomlConfig::getSstSyncMode() const {
+  return sst_sync_mode_;
+}
+int TomlConfig::getTrancCommitStripes() const { return tranc_commit_stripes_; }
+int TomlConfig::getTrancCommitHistory() const { return tranc_commit_history_; }
+int TomlConfig::getTrancLockStripes() const { return tranc_lock_stripes_; }
+int TomlConfig::getTrancLockTimeoutMs() const { return tranc_lock_timeout_ms_; }
+
+int TomlConfig::getWalBufferSize() const { return wal_buffer_size_; }
+long long TomlConfig::getWalFileSizeLimit() const {
+  return wal_file_size_limit_;
+}
+const std::string &TomlConfig::getWalSyncMode() const {
+  return wal_sync_mode_;
+}
+long long TomlConfig::getWalSyncIntervalMs() const {
+  return wal_sync_interval_ms_;
+}
+long long TomlConfig::getWalSyncBytes() const { return wal_sync_bytes_; }
+bool TomlConfig::getWalPreallocate() const { return wal_preallocate_; }
+int TomlConfig::getWalRecycleFileNum() const { return wal_recycle_file_num_; }
+int TomlConfig::getWalRecoveryThreads() const { return wal_recovery_threads_; }
 
 int TomlConfig::getLsmBlockCacheCapacity() const {
   return lsm_block_cache_capacity_;
 }
 int TomlConfig::getLsmBlockCacheK() const { return lsm_block_cache_k_; }
+long long TomlConfig::getLsmRowCacheCapacityBytes() const {
+  return lsm_row_cache_capacity_bytes_;
+}
 
 const std::string &TomlConfig::getRedisExpireHeader() const {
   return redis_expire_header_;
@@ -163,6 +354,12 @@ char TomlConfig::getRedisFieldSeparator() const {
   return redis_field_separator_;
 }
 char TomlConfig::getRedisListSeparator() const { return redis_list_separator_; }
+const std::string &TomlConfig::getRedisListValuePreffix() const {
+  return redis_list_value_preffix_;
+}
+const std::string &TomlConfig::getRedisListPrefix() const {
+  return redis_list_prefix_;
+}
 const std::string &TomlConfig::getRedisSortedSetPrefix() const {
   return redis_sorted_set_prefix_;
 }
@@ -179,6 +376,28 @@ int TomlConfig::getBloomFilterExpectedSize() const {
 double TomlConfig::getBloomFilterExpectedErrorRate() const {
   return bloom_filter_expected_error_rate_;
 }
+double TomlConfig::getBloomFilterBitsPerKey() const {
+  return bloom_filter_bits_per_key_;
+}
+double TomlConfig::getBloomFilterBitsPerKey(size_t level) const {
+  if (level < bloom_filter_level_bits_per_key_.size()) {
+    return bloom_filter_level_bits_per_key_[level];
+  }
+  return bloom_filter_bits_per_key_;
+}
+const std::string &TomlConfig::getSstFilterType() const {
+  return sst_filter_type_;
+}
+const std::string &TomlConfig::getPrefixExtractor() const {
+  return prefix_extractor_;
+}
+int TomlConfig::getPrefixExtractorFixedLen() const {
+  return prefix_extractor_fixed_len_;
+}
+double TomlConfig::getMemtablePrefixBloomSizeRatio() const {
+  return memtable_prefix_bloom_size_ratio_;
+}
+bool TomlConfig::getSstRangeFilter() const { return sst_range_filter_; }
 
 const TomlConfig &TomlConfig::getInstance(const std::string &config_path) {
   // 静态实例确保只创建一次
@@ -217,11 +436,33 @@ bool TomlConfig::saveToFile(const std::string &filePath) {
     config["lsm"]["core"]["LSM_PER_MEM_SIZE_LIMIT"] = lsm_per_mem_size_limit_;
     config["lsm"]["core"]["LSM_BLOCK_SIZE"] = lsm_block_size_;
     config["lsm"]["core"]["LSM_SST_LEVEL_RATIO"] = lsm_sst_level_ratio_;
+    config["lsm"]["core"]["MEMTABLE_REP"] = memtable_rep_;
+    config["lsm"]["core"]["MEMTABLE_HASH_BUCKET_COUNT"] =
+        memtable_hash_bucket_count_;
+    config["lsm"]["core"]["WRITE_GROUP_MAX_SIZE"] = write_group_max_size_;
+    config["lsm"]["core"]["WRITE_PARALLEL_APPLY"] = write_parallel_apply_;
+    config["lsm"]["core"]["SST_SYNC_MODE"] = sst_sync_mode_;
+    config["lsm"]["core"]["TRANC_COMMIT_STRIPES"] = tranc_commit_stripes_;
+    config["lsm"]["core"]["TRANC_COMMIT_HISTORY"] = tranc_commit_history_;
+    config["lsm"]["core"]["TRANC_LOCK_STRIPES"] = tranc_lock_stripes_;
+    config["lsm"]["core"]["TRANC_LOCK_TIMEOUT_MS"] = tranc_lock_timeout_ms_;
+
+    // --- WAL ---
+    config["wal"]["WAL_BUFFER_SIZE"] = wal_buffer_size_;
+    config["wal"]["WAL_FILE_SIZE_LIMIT"] = wal_file_size_limit_;
+    config["wal"]["WAL_SYNC_MODE"] = wal_sync_mode_;
+    config["wal"]["WAL_SYNC_INTERVAL_MS"] = wal_sync_interval_ms_;
+    config["wal"]["WAL_SYNC_BYTES"] = wal_sync_bytes_;
+    config["wal"]["WAL_PREALLOCATE"] = wal_preallocate_;
+    config["wal"]["WAL_RECYCLE_FILE_NUM"] = wal_recycle_file_num_;
+    config["wal"]["WAL_RECOVERY_THREADS"] = wal_recovery_threads_;
 
     // --- LSM Cache ---
     config["lsm"]["cache"]["LSM_BLOCK_CACHE_CAPACITY"] =
         lsm_block_cache_capacity_;
     config["lsm"]["cache"]["LSM_BLOCK_CACHE_K"] = lsm_block_cache_k_;
+    config["lsm"]["cache"]["LSM_ROW_CACHE_CAPACITY_BYTES"] =
+        lsm_row_cache_capacity_bytes_;
 
     // --- Redis Headers/Separators ---
     config["redis"]["REDIS_EXPIRE_HEADER"] = redis_expire_header_;
@@ -231,6 +472,8 @@ bool TomlConfig::saveToFile(const std::string &filePath) {
         std::string(1, redis_field_separator_);
     config["redis"]["REDIS_LIST_SEPARATOR"] =
         std::string(1, redis_list_separator_);
+    config["redis"]["REDIS_LIST_VALUE_PREFFIX"] = redis_list_value_preffix_;
+    config["redis"]["REDIS_LIST_PREFIX"] = redis_list_prefix_;
     config["redis"]["REDIS_SORTED_SET_PREFIX"] = redis_sorted_set_prefix_;
     config["redis"]["REDIS_SORTED_SET_SCORE_LEN"] = redis_sorted_set_score_len_;
     config["redis"]["REDIS_SET_PREFIX"] = redis_set_prefix_;
@@ -240,6 +483,17 @@ bool TomlConfig::saveToFile(const std::string &filePath) {
         bloom_filter_expected_size_;
     config["bloom_filter"]["BLOOM_FILTER_EXPECTED_ERROR_RATE"] =
         bloom_filter_expected_error_rate_;
+    config["bloom_filter"]["BLOOM_FILTER_BITS_PER_KEY"] =
+        bloom_filter_bits_per_key_;
+    config["bloom_filter"]["BLOOM_FILTER_LEVEL_BITS_PER_KEY"] =
+        bloom_filter_level_bits_per_key_;
+    config["bloom_filter"]["SST_FILTER_TYPE"] = sst_filter_type_;
+    config["bloom_filter"]["PREFIX_EXTRACTOR"] = prefix_extractor_;
+    config["bloom_filter"]["PREFIX_EXTRACTOR_FIXED_LEN"] =
+        prefix_extractor_fixed_len_;
+    config["bloom_filter"]["MEMTABLE_PREFIX_BLOOM_SIZE_RATIO"] =
+        memtable_prefix_bloom_size_ratio_;
+    config["bloom_filter"]["SST_RANGE_FILTER"] = sst_range_filter_;
 
     // 写入到文件
     std::ofstream outFile(filePath);
@@ -0,0 +1,68 @@
+#include "../../include/lsm/commit_table.h"
+#include <algorithm>
+#include <functional>
+
+namespace tiny_lsm {
+
+CommitTable::CommitTable(size_t stripe_count, size_t stripe_capacity)
+    : stripe_capacity_(std::max<size_t>(stripe_capacity, 1)) {
+  stripe_count = std::max<size_t>(stripe_count, 1);
+  stripes_.reserve(stripe_count);
+  for (size_t i = 0; i < stripe_count; i++) {
+    stripes_.push_back(std::make_unique<Stripe>());
+  }
+}
+
+size_t CommitTable::stripe_index(const std::string &key) const {
+  return std::hash<std::string>{}(key) % stripes_.size();
+}
+
+CommitTable::LockSet CommitTable::lock(const std::vector<std::string> &keys) {
+  std::vector<size_t> indexes;
+  indexes.reserve(keys.size());
+  for (auto &key : keys) {
+    indexes.push_back(stripe_index(key));
+  }
+  std::sort(indexes.begin(), indexes.end());
+  indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+
+  LockSet locks;
+  locks.reserve(indexes.size());
+  for (auto index : indexes) {
+    locks.emplace_back(stripes_[index]->mtx);
+  }
+  return locks;
+}
+
+std::optional<bool> CommitTable::has_newer_commit(const std::string &key,
+                                                  uint64_t tranc_id) {
+  auto &stripe = *stripes_[stripe_index(key)];
+  auto it = stripe.last_commit.find(key);
+  if (it != stripe.last_commit.end()) {
+    return it->second > tranc_id;
+  }
+  if (tranc_id < stripe.floor) {
+    // 被淘汰的记录可能比 tranc_id 更新
+    return std::nullopt;
+  }
+  return false;
+}
+
+void CommitTable::record_(const std::string &key, uint64_t tranc_id) {
+  auto &stripe = *stripes_[stripe_index(key)];
+  auto &last = stripe.last_commit[key];
+  last = std::max(last, tranc_id);
+  stripe.history.emplace_back(key, tranc_id);
+
+  while (stripe.history.size() > stripe_capacity_) {
+    auto &[old_key, old_tranc_id] = stripe.history.front();
+    auto it = stripe.last_commit.find(old_key);
+    // 之后又被提交过的 key 仍然保留
+    if (it != stripe.last_commit.end() && it->second == old_tranc_id) {
+      stripe.floor = std::max(stripe.floor, old_tranc_id);
+      stripe.last_commit.erase(it);
+    }
+    stripe.history.pop_front();
+  }
+}
+} // namespace tiny_lsm
@@ -0,0 +1,87 @@
+#include "../../include/lsm/compact.h"
+#include "../../include/block/block.h"
+#include "../../include/sst/sst.h"
+
+namespace tiny_lsm {
+
+bool CompactionMerger::Cursor::load_next_block() {
+  entries.clear();
+  pos = 0;
+  while (entries.empty() && block_idx < sst->num_blocks()) {
+    entries = sst->read_block(block_idx++)->get_entries();
+  }
+  return !entries.empty();
+}
+
+bool CompactionMerger::CursorGreater::operator()(size_t a, size_t b) const {
+  auto &[key_a, value_a, tranc_a] = (*cursors)[a].current();
+  auto &[key_b, value_b, tranc_b] = (*cursors)[b].current();
+  if (key_a != key_b) {
+    return key_a > key_b;
+  }
+  if (tranc_a != tranc_b) {
+    return tranc_a < tranc_b;
+  }
+  // 相同的版本优先输出较新的 sst 中的
+  return a > b;
+}
+
+CompactionMerger::CompactionMerger(std::vector<std::shared_ptr<SST>> ssts,
+                                   uint64_t oldest_tranc_id, bool bottom_level)
+    : heap_(CursorGreater{&cursors_}), oldest_tranc_id_(oldest_tranc_id),
+      bottom_level_(bottom_level) {
+  cursors_.resize(ssts.size());
+  for (size_t i = 0; i < ssts.size(); i++) {
+    cursors_[i].sst = std::move(ssts[i]);
+    if (cursors_[i].load_next_block()) {
+      heap_.push(i);
+    }
+  }
+}
+
+bool CompactionMerger::pop(std::string &key, std::string &value,
+                           uint64_t &tranc_id) {
+  if (heap_.empty()) {
+    return false;
+  }
+  size_t idx = heap_.top();
+  heap_.pop();
+
+  auto &cursor = cursors_[idx];
+  std::tie(key, value, tranc_id) = cursor.current();
+  if (++cursor.pos < cursor.entries.size() || cursor.load_next_block()) {
+    heap_.push(idx);
+  }
+  return true;
+}
+
+bool CompactionMerger::next(std::string &key, std::string &value,
+                            uint64_t &tranc_id) {
+  while (pop(key, value, tranc_id)) {
+    if (!has_cur_key_ || key != cur_key_) {
+      cur_key_ = key;
+      has_cur_key_ = true;
+      cur_key_settled_ = false;
+    } else if (tranc_id == last_tranc_id_) {
+      // 不同 sst 中的同一个版本
+      continue;
+    }
+    last_tranc_id_ = tranc_id;
+
+    if (cur_key_settled_) {
+      // 已经输出了所有读者都可见的版本, 更早的版本不会再被读取
+      continue;
+    }
+    if (tranc_id > oldest_tranc_id_) {
+      return true;
+    }
+    cur_key_settled_ = true;
+    if (bottom_level_ && value.empty()) {
+      // 最底层不再有更早的数据需要删除标记遮盖
+      continue;
+    }
+    return true;
+  }
+  return false;
+}
+} // namespace tiny_lsm
@@ -3,12 +3,14 @@
 #include "../../include/consts.h"
 #include "../../include/logger/logger.h"
 #include "../../include/lsm/level_iterator.h"
+#include "../../include/lsm/lock_manager.h"
 #include "../../include/sst/concact_iterator.h"
 #include "../../include/sst/sst.h"
 #include "../../include/sst/sst_iterator.h"
 #include "spdlog/spdlog.h"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <filesystem>
 #include <memory>
@@ -30,6 +32,10 @@ LSMEngine::LSMEngine(std::string path) : data_dir(path) {
       TomlConfig::getInstance().getLsmBlockCacheCapacity(),
       TomlConfig::getInstance().getLsmBlockCacheK());
 
+  // 初始化 row_cache
+  row_cache = std::make_shared<RowCache>(
+      TomlConfig::getInstance().getLsmRowCacheCapacityBytes());
+
   // 创建数据目录
   if (!std::filesystem::exists(path)) {
     spdlog::info("LSMEngine--"
@@ -105,6 +111,48 @@ LSMEngine::~LSMEngine() = default;
 
 std::optional<std::pair<std::string, uint64_t>>
 LSMEngine::get(const std::string &key, uint64_t tranc_id) {
+  // value 为空表示被删除或不存在
+  auto visible = [](std::optional<std::pair<std::string, uint64_t>> res)
+      -> std::optional<std::pair<std::string, uint64_t>> {
+    if (res.has_value() && res->first.empty()) {
+      return std::nullopt;
+    }
+    return res;
+  };
+
+  if (!row_cache->enabled()) {
+    return visible(get_(key, tranc_id));
+  }
+
+  // 1. 先查询行缓存
+  auto cache_res = row_cache->get(key, tranc_id);
+  if (cache_res.has_value()) {
+    spdlog::trace("LSMEngine--"
+                  "get({},{}): returning from row cache, tranc_id = {}",
+                  key, tranc_id, cache_res->second);
+    return visible(cache_res);
+  }
+
+  // 2. 未命中时查询 key 的最新版本并写入行缓存
+  // 版本号需要在查询前获取, 避免查询期间的写入被过期的结果覆盖
+  auto version = row_cache->version(key);
+  auto latest = get_(key, 0);
+  if (latest.has_value()) {
+    row_cache->put(key, latest->first, latest->second, version);
+  } else {
+    row_cache->put(key, "", 0, version);
+  }
+
+  if (tranc_id == 0 || !latest.has_value() || latest->second <= tranc_id) {
+    return visible(latest);
+  }
+
+  // 3. 最新版本对当前事务不可见, 按事务可见性重新查询
+  return visible(get_(key, tranc_id));
+}
+
+std::optional<std::pair<std::string, uint64_t>>
+LSMEngine::get_(const std::string &key, uint64_t tranc_id) {
   // 1. 先查找 memtable
   auto mem_res = memtable.get(key, tranc_id);
   if (mem_res.is_valid()) {
@@ -122,7 +170,7 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
                     "get({},{}): key is deleted, returning "
                     "from memtable",
                     key, tranc_id);
-      return std::nullopt;
+      return std::pair<std::string, uint64_t>{"", mem_res.get_tranc_id()};
     }
   }
 
@@ -141,9 +189,9 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
                       "get({},{}): value = {}, tranc_id = {} "
                       "returning from l0 sst{}",
                       key, tranc_id, sst_iterator->second,
-                      sst_iterator.get_tranc_id(), sst_id);
-        return std::pair<std::string, uint64_t>{sst_iterator->second,
-                                                sst_iterator.get_tranc_id()};
+                      sst_iterator.get_entry_tranc_id(), sst_id);
+        return std::pair<std::string, uint64_t>{
+            sst_iterator->second, sst_iterator.get_entry_tranc_id()};
       } else {
         // 空值表示被删除了
         spdlog::trace("LSMEngine--"
@@ -151,7 +199,8 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
                       "exist , returning "
                       "from l0 sst{}",
                       key, tranc_id, sst_id);
-        return std::nullopt;
+        return std::pair<std::string, uint64_t>{
+            "", sst_iterator.get_entry_tranc_id()};
       }
     }
   }
@@ -175,10 +224,11 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
                           "get({},{}): value = {}, tranc_id = {} "
                           "returning from l{} sst{}",
                           key, tranc_id, sst_iterator->second,
-                          sst_iterator.get_tranc_id(), level, l_sst_ids[mid]);
+                          sst_iterator.get_entry_tranc_id(), level,
+                          l_sst_ids[mid]);
 
             return std::pair<std::string, uint64_t>{
-                sst_iterator->second, sst_iterator.get_tranc_id()};
+                sst_iterator->second, sst_iterator.get_entry_tranc_id()};
           } else {
             // 空值表示被删除了
             spdlog::trace("LSMEngine--"
@@ -186,7 +236,8 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
                           "returning from l{} sst{}",
                           key, tranc_id, level, l_sst_ids[mid]);
 
-            return std::nullopt;
+            return std::pair<std::string, uint64_t>{
+                "", sst_iterator.get_entry_tranc_id()};
           }
         } else {
           break;
@@ -290,6 +341,35 @@ LSMEngine::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
   return results;
 }
 
+bool LSMEngine::has_newer_version(const std::string &key, uint64_t tranc_id) {
+  // 1. memtable 中的最新版本
+  auto mem_res = memtable.get(key, 0);
+  if (mem_res.is_valid() && mem_res.get_tranc_id() > tranc_id) {
+    return true;
+  }
+
+  // 2. tranc_id 与写入顺序无关, 较早刷盘的 sst 中也可能有更新的版本
+  std::shared_lock<std::shared_mutex> rlock(ssts_mtx);
+  for (auto &sst_id : level_sst_ids[0]) {
+    if (ssts[sst_id]->has_newer_version(key, tranc_id)) {
+      return true;
+    }
+  }
+
+  // 3. 其他 level 中 key 最多位于一个 sst
+  for (size_t level = 1; level <= cur_max_level; level++) {
+    auto &l_sst_ids = level_sst_ids[level];
+    auto it = std::lower_bound(l_sst_ids.begin(), l_sst_ids.end(), key,
+                               [&](size_t sst_id, const std::string &k) {
+                                 return ssts[sst_id]->get_last_key() < k;
+                               });
+    if (it != l_sst_ids.end() && ssts[*it]->has_newer_version(key, tranc_id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 std::optional<std::pair<std::string, uint64_t>>
 LSMEngine::sst_get_(const std::string &key, uint64_t tranc_id) {
 
@@ -364,6 +444,7 @@ LSMEngine::sst_get_(const std::string &key, uint64_t tranc_id) {
 uint64_t LSMEngine::put(const std::string &key, const std::string &value,
                         uint64_t tranc_id) {
   memtable.put(key, value, tranc_id);
+  row_cache->invalidate(key);
   spdlog::trace("LSMEngine--"
                 "put({}, {}, {})"
                 "inserted into memtable",
@@ -382,6 +463,9 @@ uint64_t LSMEngine::put_batch(
     const std::vector<std::pair<std::string, std::string>> &kvs,
     uint64_t tranc_id) {
   memtable.put_batch(kvs, tranc_id);
+  for (auto &[key, value] : kvs) {
+    row_cache->invalidate(key);
+  }
 
   spdlog::trace("LSMEngine--"
                 "put_batch with {} keys inserted into memtable",
@@ -397,6 +481,7 @@ uint64_t LSMEngine::put_batch(
 uint64_t LSMEngine::remove(const std::string &key, uint64_t tranc_id) {
   // 在 LSM 中，删除实际上是插入一个空值
   memtable.remove(key, tranc_id);
+  row_cache->invalidate(key);
 
   spdlog::trace("LSMEngine--"
                 "remove({}, {}) marked as "
@@ -414,6 +499,9 @@ uint64_t LSMEngine::remove(const std::string &key, uint64_t tranc_id) {
 uint64_t LSMEngine::remove_batch(const std::vector<std::string> &keys,
                                  uint64_t tranc_id) {
   memtable.remove_batch(keys, tranc_id);
+  for (auto &key : keys) {
+    row_cache->invalidate(key);
+  }
 
   spdlog::trace("LSMEngine--"
                 "remove_batch with {} keys tagged into memtable",
@@ -429,6 +517,7 @@ uint64_t LSMEngine::remove_batch(const std::vector<std::string> &keys,
 
 void LSMEngine::clear() {
   memtable.clear();
+  row_cache->clear();
   level_sst_ids.clear();
   ssts.clear();
   // 清空当前文件夹的所有内容
@@ -472,9 +561,11 @@ uint64_t LSMEngine::flush() {
 
   // 4. 将 memtable 中最旧的表写入 SST
   std::vector<uint64_t> flushed_tranc_ids;
+  std::vector<uint64_t> table_tranc_ids;
   auto sst_path = get_sst_path(new_sst_id, 0);
   auto new_sst = memtable.flush_last(builder, sst_path, new_sst_id,
-                                     flushed_tranc_ids, block_cache);
+                                     flushed_tranc_ids, table_tranc_ids,
+                                     block_cache, oldest_visible_tranc_id());
 
   // 5. 更新内存索引
   ssts[new_sst_id] = new_sst;
@@ -483,8 +574,10 @@ uint64_t LSMEngine::flush() {
   level_sst_ids[0].push_front(new_sst_id);
 
   // 7. 添加到 flushed 集合
-  for (auto &id : flushed_tranc_ids) {
-    tran_manager.lock()->add_flushed_tranc_id(id);
+  // 单独使用 LSMEngine 时没有事务管理器
+  if (auto tran_manager_ptr = tran_manager.lock()) {
+    tran_manager_ptr->add_flushed_tranc_ids(flushed_tranc_ids,
+                                            table_tranc_ids);
   }
 
   // 返回新刷入的 sst 的最大的 tranc_id
@@ -505,16 +598,27 @@ std::string LSMEngine::get_sst_path(size_t sst_id, size_t target_level) {
 
 std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
 LSMEngine::lsm_iters_monotony_predicate(
-    uint64_t tranc_id, std::function<int(const std::string &)> predicate) {
-
+    uint64_t tranc_id, std::function<int(const std::string &)> predicate,
+    const std::string &preffix,
+    const std::optional<std::pair<std::string, std::string>> &range) {
   //  先从 memtable 中查询
-  auto mem_result = memtable.iters_monotony_predicate(tranc_id, predicate);
+  auto mem_result =
+      memtable.iters_monotony_predicate(tranc_id, predicate, preffix);
 
   // 再从 sst 中查询
   std::vector<SearchItem> item_vec;
   for (auto &[sst_level, sst_ids] : level_sst_ids) {
     for (auto &sst_id : sst_ids) {
       auto sst = ssts[sst_id];
+      if (!preffix.empty() && !sst->may_contain_preffix(preffix)) {
+        // 前缀过滤器判定 sst 中不存在该前缀
+        continue;
+      }
+      if (range.has_value() &&
+          !sst->may_contain_range(range->first, range->second)) {
+        // 范围过滤器判定 sst 中不存在该区间内的 key
+        continue;
+      }
       auto result = sst_iters_monotony_predicate(sst, tranc_id, predicate);
       if (!result.has_value()) {
         continue;
@@ -568,6 +672,36 @@ LSMEngine::lsm_iters_monotony_predicate(
   }
 }
 
+std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+LSMEngine::lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix) {
+  return lsm_iters_monotony_predicate(
+      tranc_id,
+      [&preffix](const std::string &key) {
+        return -key.compare(0, preffix.size(), preffix);
+      },
+      preffix);
+}
+
+std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+LSMEngine::lsm_iters_range(uint64_t tranc_id, const std::string &lo,
+                           const std::string &hi) {
+  if (lo > hi) {
+    return std::nullopt;
+  }
+  return lsm_iters_monotony_predicate(
+      tranc_id,
+      [&lo, &hi](const std::string &key) {
+        if (key < lo) {
+          return 1;
+        }
+        if (key > hi) {
+          return -1;
+        }
+        return 0;
+      },
+      "", std::make_pair(lo, hi));
+}
+
 Level_Iterator LSMEngine::begin(uint64_t tranc_id) {
   return Level_Iterator(shared_from_this(), tranc_id);
 }
@@ -630,29 +764,19 @@ void LSMEngine::full_compact(size_t src_level) {
 std::vector<std::shared_ptr<SST>>
 LSMEngine::full_l0_l1_compact(std::vector<size_t> &l0_ids,
                               std::vector<size_t> &l1_ids) {
-  // TODO: 这里需要补全的是对已经完成事务的删除
-  std::vector<SstIterator> l0_iters;
-  std::vector<std::shared_ptr<SST>> l1_ssts;
-
+  // l0 的sst之间的key有重叠, 越新的 sst 越靠前, 合并时优先
+  std::vector<std::shared_ptr<SST>> input_ssts;
   for (auto id : l0_ids) {
-    auto sst_it = ssts[id]->begin(0);
-    l0_iters.push_back(sst_it);
+    input_ssts.push_back(ssts[id]);
   }
   for (auto id : l1_ids) {
-    l1_ssts.push_back(ssts[id]);
+    input_ssts.push_back(ssts[id]);
   }
-  // l0 的sst之间的key有重叠, 需要合并
-  auto [l0_begin, l0_end] = SstIterator::merge_sst_iterator(l0_iters, 0);
-
-  std::shared_ptr<HeapIterator> l0_begin_ptr = std::make_shared<HeapIterator>();
-  *l0_begin_ptr = l0_begin;
-
-  std::shared_ptr<ConcactIterator> old_l1_begin_ptr =
-      std::make_shared<ConcactIterator>(l1_ssts, 0);
 
-  TwoMergeIterator l0_l1_begin(l0_begin_ptr, old_l1_begin_ptr, 0);
+  CompactionMerger merger(std::move(input_ssts), oldest_visible_tranc_id(),
+                          is_bottom_level(1));
 
-  return gen_sst_from_iter(l0_l1_begin,
+  return gen_sst_from_iter(merger,
                            TomlConfig::getInstance().getLsmPerMemSizeLimit() *
                                TomlConfig::getInstance().getLsmSstLevelRatio(),
                            1);
@@ -661,46 +785,34 @@ LSMEngine::full_l0_l1_compact(std::vector<size_t> &l0_ids,
 std::vector<std::shared_ptr<SST>>
 LSMEngine::full_common_compact(std::vector<size_t> &lx_ids,
                                std::vector<size_t> &ly_ids, size_t level_y) {
-  // TODO 需要补全已完成事务的滤除
-  std::vector<std::shared_ptr<SST>> lx_iters;
-  std::vector<std::shared_ptr<SST>> ly_iters;
-
+  // lx 中的数据比 ly 中的更新
+  std::vector<std::shared_ptr<SST>> input_ssts;
   for (auto id : lx_ids) {
-    lx_iters.push_back(ssts[id]);
+    input_ssts.push_back(ssts[id]);
   }
   for (auto id : ly_ids) {
-    ly_iters.push_back(ssts[id]);
+    input_ssts.push_back(ssts[id]);
   }
 
-  std::shared_ptr<ConcactIterator> old_lx_begin_ptr =
-      std::make_shared<ConcactIterator>(lx_iters, 0);
-
-  std::shared_ptr<ConcactIterator> old_ly_begin_ptr =
-      std::make_shared<ConcactIterator>(ly_iters, 0);
-
-  TwoMergeIterator lx_ly_begin(old_lx_begin_ptr, old_ly_begin_ptr, 0);
-
-  // TODO:如果目标 level 的下一级 level+1 不存在, 则为底层的level,
-  // 可以清理掉删除标记
+  // 如果目标 level 的下一级 level 不存在, 则为底层的 level, 可以清理掉删除标记
+  CompactionMerger merger(std::move(input_ssts), oldest_visible_tranc_id(),
+                          is_bottom_level(level_y));
 
-  return gen_sst_from_iter(lx_ly_begin, LSMEngine::get_sst_size(level_y),
-                           level_y);
+  return gen_sst_from_iter(merger, LSMEngine::get_sst_size(level_y), level_y);
 }
 
 std::vector<std::shared_ptr<SST>>
-LSMEngine::gen_sst_from_iter(BaseIterator &iter, size_t target_sst_size,
+LSMEngine::gen_sst_from_iter(CompactionMerger &merger, size_t target_sst_size,
                              size_t target_level) {
-  // TODO: 这里需要补全的是对已经完成事务的删除
-  // std::cout << "process into gen\n";
   std::vector<std::shared_ptr<SST>> new_ssts;
-  auto new_sst_builder =
-      SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(), true);
-  while (iter.is_valid() && !iter.is_end()) {
-
-    new_sst_builder.add((*iter).first, (*iter).second, 0);
-    ++iter;
-
-    if (new_sst_builder.estimated_size() >= target_sst_size) {
+  auto new_sst_builder = SSTBuilder(
+      TomlConfig::getInstance().getLsmBlockSize(), true, target_level);
+  std::string key, value, last_key;
+  uint64_t tranc_id;
+  while (merger.next(key, value, tranc_id)) {
+    // 同一个 key 的多个版本必须位于同一个 sst 中
+    if (key != last_key &&
+        new_sst_builder.estimated_size() >= target_sst_size) {
       size_t sst_id = next_sst_id++; // TODO: 后续优化并发性
       std::string sst_path = get_sst_path(sst_id, target_level);
       auto new_sst = new_sst_builder.build(sst_id, sst_path, this->block_cache);
@@ -711,9 +823,13 @@ LSMEngine::gen_sst_from_iter(BaseIterator &iter, size_t target_sst_size,
                     "at level{}",
                     sst_id, target_level);
 
-      new_sst_builder = SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(),
-                                   true); // 重置builder
+      new_sst_builder =
+          SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(), true,
+                     target_level); // 重置builder
     }
+
+    new_sst_builder.add(key, value, tranc_id);
+    last_key = key;
   }
 
   //只要builder里面存在没有落盘的数据，就要把它放到sst里面去。
@@ -732,6 +848,25 @@ LSMEngine::gen_sst_from_iter(BaseIterator &iter, size_t target_sst_size,
   return new_ssts;
 }
 
+uint64_t LSMEngine::oldest_visible_tranc_id() {
+  // 单独使用 LSMEngine 时没有事务管理器, 不知道读者使用的 tranc_id,
+  // 保留所有版本
+  if (auto tran_manager_ptr = tran_manager.lock()) {
+    return tran_manager_ptr->oldest_visible_tranc_id();
+  }
+  return 0;
+}
+
+bool LSMEngine::is_bottom_level(size_t level) {
+  for (auto it = level_sst_ids.upper_bound(level); it != level_sst_ids.end();
+       ++it) {
+    if (!it->second.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 size_t LSMEngine::get_sst_size(size_t level) {
   if (level == 0) {
     return TomlConfig::getInstance().getLsmPerMemSizeLimit();
@@ -752,22 +887,18 @@ LSM::LSM(std::string path)
       tran_manager_(std::make_shared<TranManager>(path)) {
   tran_manager_->set_engine(engine);
   engine->set_tran_manager(tran_manager_);
-  auto check_recover_res = tran_manager_->check_recover();
-  for (auto &[tranc_id, records] : check_recover_res) {
-    if (tran_manager_->get_flushed_tranc_ids().count(tranc_id)) {
-      continue;
+  // 重放的记录直接写入 memtable, 写满的表只冻结不刷盘
+  // 启动时行缓存为空, 也不需要失效
+  tran_manager_->check_recover([this](const Record &record) {
+    if (record.getOperationType() == OperationType::PUT) {
+      engine->memtable.put(record.getKey(), record.getValue(),
+                           record.getTrancId());
+    } else if (record.getOperationType() == OperationType::DELETE) {
+      engine->memtable.remove(record.getKey(), record.getTrancId());
     }
-    for (auto &record : records) {
-      if (record.getOperationType() == OperationType::PUT) {
-        engine->put(record.getKey(), record.getValue(), tranc_id);
-      } else if (record.getOperationType() == OperationType::DELETE) {
-        engine->remove(record.getKey(), tranc_id);
-      }
-    }
-    spdlog::debug("LSMEngine--"
-                  "Recover: Recovered transaction with tranc_id={}",
-                  tranc_id);
-  }
+  });
+  // 重放结束后统一刷盘, 之后旧的 wal 文件才可以删除
+  flush_all();
   tran_manager_->init_new_wal();
 }
 
@@ -777,8 +908,19 @@ LSM::~LSM() {
 }
 
 std::optional<std::string> LSM::get(const std::string &key) {
-  auto tranc_id = tran_manager_->getNextTransactionId();
-  auto res = engine->get(key, tranc_id);
+  // 非事务读取最新版本, 不分配 tranc_id
+  // 否则这些 id 不会出现在任何表中, 在 flushed 集合里留下无法合并的空洞
+  auto res = engine->get(key, 0);
+
+  if (res.has_value()) {
+    return res.value().first;
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> LSM::get(const std::string &key,
+                                   const Snapshot &snapshot) {
+  auto res = engine->get(key, snapshot.get_tranc_id());
 
   if (res.has_value()) {
     return res.value().first;
@@ -788,11 +930,9 @@ std::optional<std::string> LSM::get(const std::string &key) {
 
 std::vector<std::pair<std::string, std::optional<std::string>>>
 LSM::get_batch(const std::vector<std::string> &keys) {
-  // 1. 获取事务ID
-  auto tranc_id = tran_manager_->getNextTransactionId();
-
+  // 1. 与 get 相同, 读取最新版本
   // 2. 调用 engine 的批量查询接口
-  auto batch_results = engine->get_batch(keys, tranc_id);
+  auto batch_results = engine->get_batch(keys, 0);
 
   // 3. 构造最终结果
   std::vector<std::pair<std::string, std::optional<std::string>>> results;
@@ -807,24 +947,108 @@ LSM::get_batch(const std::vector<std::string> &keys) {
   return results;
 }
 
-void LSM::put(const std::string &key, const std::string &value) {
+void LSM::write_(std::vector<std::pair<std::string, std::string>> kvs,
+                 const WriteOptions &options) {
+  std::vector<std::string> keys;
+  keys.reserve(kvs.size());
+  for (auto &[k, v] : kvs) {
+    keys.push_back(k);
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // 非事务写入也要获取排他的行锁, 不能覆盖悲观事务已经锁住的 key
+  // 按 key 升序在条带锁之前获取, 与事务提交的顺序一致
+  auto &lock_manager = tran_manager_->get_lock_manager();
+  auto owner_id = tran_manager_->get_lock_owner_id();
+  auto timeout = std::chrono::milliseconds(
+      TomlConfig::getInstance().getTrancLockTimeoutMs());
+  std::vector<std::string> locked_keys;
+  locked_keys.reserve(keys.size());
+  for (auto &key : keys) {
+    auto status = lock_manager.lock(owner_id, key, true, timeout);
+    if (status != LockStatus::OK) {
+      lock_manager.unlock(owner_id, locked_keys);
+      spdlog::warn("LSM--write_(): {} on key={}",
+                   status == LockStatus::DEADLOCK ? "Deadlock detected"
+                                                  : "Lock wait timeout",
+                   key);
+      throw std::runtime_error(status == LockStatus::DEADLOCK
+                                   ? "deadlock detected on key " + key
+                                   : "lock wait timeout on key " + key);
+    }
+    locked_keys.push_back(key);
+  }
+
+  // 获取行锁之后再分配 tranc_id, 比之前持有锁的事务提交的版本更新
   auto tranc_id = tran_manager_->getNextTransactionId();
-  engine->put(key, value, tranc_id);
+
+  WriteQueue::Writer writer;
+  if (!options.disable_wal) {
+    writer.records.reserve(kvs.size() + 1);
+    for (auto &[k, v] : kvs) {
+      writer.records.push_back(v.empty() ? Record::deleteRecord(tranc_id, k)
+                                         : Record::putRecord(tranc_id, k, v));
+    }
+    writer.records.push_back(Record::commitRecord(tranc_id));
+    writer.sync = options.sync;
+  }
+
+  // 与事务提交相同, 条带锁从写入 memtable 之前一直持有到记录到最近写入表,
+  // 提交校验不会看到已经生效但还没有记录的写入
+  // apply 可能由 leader 代为执行, 其中不能再获取条带锁
+  CommitTable &commit_table = tran_manager_->get_commit_table();
+  auto locks = commit_table.lock(keys);
+
+  // 不写完成标记, 整批数据在同一张表中, 这张表刷盘后即可视为刷盘完成
+  writer.apply = [&]() { engine->put_batch(kvs, tranc_id); };
+
+  if (!tran_manager_->write(writer)) {
+    spdlog::error("LSM--write_(): Failed to write WAL for tranc_id={}",
+                  tranc_id);
+    lock_manager.unlock(owner_id, locked_keys);
+
+    throw std::runtime_error("write to wal failed");
+  }
+
+  // 写入后记录到最近写入表, 与之冲突的事务提交时不需要再查询数据库
+  for (auto &key : keys) {
+    commit_table.record_(key, tranc_id);
+  }
+  lock_manager.unlock(owner_id, locked_keys);
+}
+
+void LSM::put(const std::string &key, const std::string &value,
+              const WriteOptions &options) {
+  write_({{key, value}}, options);
 }
 
 void LSM::put_batch(
-    const std::vector<std::pair<std::string, std::string>> &kvs) {
-  auto tranc_id = tran_manager_->getNextTransactionId();
-  engine->put_batch(kvs, tranc_id);
+    const std::vector<std::pair<std::string, std::string>> &kvs,
+    const WriteOptions &options) {
+  write_(kvs, options);
 }
-void LSM::remove(const std::string &key) {
-  auto tranc_id = tran_manager_->getNextTransactionId();
-  engine->remove(key, tranc_id);
+
+void LSM::remove(const std::string &key, const WriteOptions &options) {
+  // 在 LSM 中，删除实际上是插入一个空值
+  write_({{key, ""}}, options);
 }
 
-void LSM::remove_batch(const std::vector<std::string> &keys) {
-  auto tranc_id = tran_manager_->getNextTransactionId();
-  engine->remove_batch(keys, tranc_id);
+void LSM::remove_batch(const std::vector<std::string> &keys,
+                       const WriteOptions &options) {
+  std::vector<std::pair<std::string, std::string>> kvs;
+  kvs.reserve(keys.size());
+  for (auto &key : keys) {
+    kvs.emplace_back(key, "");
+  }
+  write_(std::move(kvs), options);
+}
+
+void LSM::write(const WriteBatch &batch, const WriteOptions &options) {
+  if (batch.empty()) {
+    return;
+  }
+  write_(batch.kvs(), options);
 }
 
 void LSM::clear() { engine->clear(); }
@@ -850,10 +1074,21 @@ LSM::lsm_iters_monotony_predicate(
   return engine->lsm_iters_monotony_predicate(tranc_id, predicate);
 }
 
+std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+LSM::lsm_iters_preffix(uint64_t tranc_id, const std::string &preffix) {
+  return engine->lsm_iters_preffix(tranc_id, preffix);
+}
+
+std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
+LSM::lsm_iters_range(uint64_t tranc_id, const std::string &lo,
+                     const std::string &hi) {
+  return engine->lsm_iters_range(tranc_id, lo, hi);
+}
+
 // 开启一个事务
 std::shared_ptr<TranContext>
-LSM::begin_tran(const IsolationLevel &isolation_level) {
-  auto tranc_context = tran_manager_->new_tranc(isolation_level);
+LSM::begin_tran(const IsolationLevel &isolation_level, TrancMode tranc_mode) {
+  auto tranc_context = tran_manager_->new_tranc(isolation_level, tranc_mode);
 
   spdlog::info("LSM--"
                "lsm_iters_monotony_predicate: Starting query for tranc_id={}",
@@ -862,5 +1097,13 @@ LSM::begin_tran(const IsolationLevel &isolation_level) {
   return tranc_context;
 }
 
+std::shared_ptr<Snapshot> LSM::get_snapshot() {
+  return tran_manager_->get_snapshot();
+}
+
+void LSM::release_snapshot(const std::shared_ptr<Snapshot> &snapshot) {
+  tran_manager_->release_snapshot(snapshot);
+}
+
 void LSM::set_log_level(const std::string &level) { reset_log_level(level); }
 } // namespace tiny_lsm
\ No newline at end of file
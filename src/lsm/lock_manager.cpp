@@ -0,0 +1,209 @@
+#include "../../include/lsm/lock_manager.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+namespace tiny_lsm {
+
+LockManager::LockManager(size_t stripe_count) {
+  stripe_count = std::max<size_t>(stripe_count, 1);
+  stripes_.reserve(stripe_count);
+  for (size_t i = 0; i < stripe_count; i++) {
+    stripes_.push_back(std::make_unique<Stripe>());
+  }
+}
+
+size_t LockManager::stripe_index(const std::string &key) const {
+  return std::hash<std::string>{}(key) % stripes_.size();
+}
+
+bool LockManager::compatible(const LockEntry &entry, uint64_t tranc_id,
+                             bool exclusive) {
+  if (entry.exclusive != 0 && entry.exclusive != tranc_id) {
+    return false;
+  }
+  if (!exclusive) {
+    return true;
+  }
+  // 排他锁只允许自己持有的共享锁存在
+  return entry.shared.empty() ||
+         (entry.shared.size() == 1 && *entry.shared.begin() == tranc_id);
+}
+
+bool LockManager::grantable(const LockEntry &entry, size_t pos) {
+  auto &waiter = entry.waiters[pos];
+  if (!compatible(entry, waiter.tranc_id, waiter.exclusive)) {
+    return false;
+  }
+  // 按到达顺序授予, 只有连续的共享锁请求可以一起获得
+  for (size_t i = 0; i < pos; i++) {
+    if (waiter.exclusive || entry.waiters[i].exclusive) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void LockManager::grant(LockEntry &entry, uint64_t tranc_id, bool exclusive) {
+  if (exclusive) {
+    entry.exclusive = tranc_id;
+    entry.shared.erase(tranc_id);
+  } else {
+    entry.shared.insert(tranc_id);
+  }
+}
+
+std::vector<uint64_t> LockManager::blockers(const LockEntry &entry,
+                                            size_t pos) {
+  auto &waiter = entry.waiters[pos];
+  std::vector<uint64_t> res;
+  if (entry.exclusive != 0 && entry.exclusive != waiter.tranc_id) {
+    res.push_back(entry.exclusive);
+  }
+  if (waiter.exclusive) {
+    for (auto holder : entry.shared) {
+      if (holder != waiter.tranc_id) {
+        res.push_back(holder);
+      }
+    }
+  }
+  for (size_t i = 0; i < pos; i++) {
+    if (waiter.exclusive || entry.waiters[i].exclusive) {
+      res.push_back(entry.waiters[i].tranc_id);
+    }
+  }
+  return res;
+}
+
+bool LockManager::add_wait(uint64_t tranc_id,
+                           const std::vector<uint64_t> &holders) {
+  std::lock_guard<std::mutex> lock(graph_mtx_);
+  wait_for_[tranc_id] = holders;
+
+  // 从等待的事务出发, 能回到自己说明形成了环
+  std::vector<uint64_t> stack(holders.begin(), holders.end());
+  std::unordered_set<uint64_t> visited;
+  while (!stack.empty()) {
+    auto cur = stack.back();
+    stack.pop_back();
+    if (cur == tranc_id) {
+      wait_for_.erase(tranc_id);
+      return true;
+    }
+    if (!visited.insert(cur).second) {
+      continue;
+    }
+    auto it = wait_for_.find(cur);
+    if (it != wait_for_.end()) {
+      stack.insert(stack.end(), it->second.begin(), it->second.end());
+    }
+  }
+  return false;
+}
+
+void LockManager::remove_wait(uint64_t tranc_id) {
+  std::lock_guard<std::mutex> lock(graph_mtx_);
+  wait_for_.erase(tranc_id);
+}
+
+LockStatus LockManager::lock(uint64_t tranc_id, const std::string &key,
+                             bool exclusive,
+                             std::chrono::milliseconds timeout) {
+  auto &stripe = *stripes_[stripe_index(key)];
+  std::unique_lock<std::mutex> lk(stripe.mtx);
+  // unordered_map 的元素在 rehash 时地址不变, 等待期间 entry 不会被删除
+  auto &entry = stripe.locks[key];
+
+  // 1 已经持有足够的锁
+  if (entry.exclusive == tranc_id ||
+      (!exclusive && entry.shared.count(tranc_id))) {
+    return LockStatus::OK;
+  }
+
+  // 2 没有等待者且兼容时直接获得
+  if (entry.waiters.empty() && compatible(entry, tranc_id, exclusive)) {
+    grant(entry, tranc_id, exclusive);
+    return LockStatus::OK;
+  }
+
+  // 3 排队等待, 升级请求排在其他升级请求之后, 普通请求之前
+  bool upgrade = entry.shared.count(tranc_id) > 0;
+  auto it = entry.waiters.end();
+  if (upgrade) {
+    it = std::find_if(entry.waiters.begin(), entry.waiters.end(),
+                      [](const Waiter &w) { return !w.upgrade; });
+  }
+  entry.waiters.insert(it, Waiter{tranc_id, exclusive, upgrade});
+
+  auto find_pos = [&]() {
+    for (size_t i = 0; i < entry.waiters.size(); i++) {
+      if (entry.waiters[i].tranc_id == tranc_id) {
+        return i;
+      }
+    }
+    return entry.waiters.size();
+  };
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto status = LockStatus::OK;
+  while (true) {
+    if (grantable(entry, find_pos())) {
+      break;
+    }
+    // 等待的事务可能已经变化, 每次阻塞前重新登记
+    if (add_wait(tranc_id, blockers(entry, find_pos()))) {
+      status = LockStatus::DEADLOCK;
+      break;
+    }
+    if (stripe.cv.wait_until(lk, deadline) == std::cv_status::timeout) {
+      if (!grantable(entry, find_pos())) {
+        status = LockStatus::TIMEOUT;
+      }
+      break;
+    }
+  }
+  remove_wait(tranc_id);
+
+  entry.waiters.erase(entry.waiters.begin() + find_pos());
+  if (status == LockStatus::OK) {
+    grant(entry, tranc_id, exclusive);
+  } else if (entry.exclusive == 0 && entry.shared.empty() &&
+             entry.waiters.empty()) {
+    stripe.locks.erase(key);
+  }
+  // 队列发生了变化, 后面的等待者可能可以获得锁
+  stripe.cv.notify_all();
+  return status;
+}
+
+void LockManager::unlock(uint64_t tranc_id,
+                         const std::vector<std::string> &keys) {
+  for (auto &key : keys) {
+    auto &stripe = *stripes_[stripe_index(key)];
+    std::lock_guard<std::mutex> lk(stripe.mtx);
+    auto it = stripe.locks.find(key);
+    if (it == stripe.locks.end()) {
+      continue;
+    }
+    auto &entry = it->second;
+    entry.shared.erase(tranc_id);
+    if (entry.exclusive == tranc_id) {
+      entry.exclusive = 0;
+    }
+    if (entry.exclusive == 0 && entry.shared.empty() &&
+        entry.waiters.empty()) {
+      stripe.locks.erase(it);
+    }
+    stripe.cv.notify_all();
+  }
+}
+
+size_t LockManager::lock_count() {
+  size_t count = 0;
+  for (auto &stripe : stripes_) {
+    std::lock_guard<std::mutex> lk(stripe->mtx);
+    count += stripe->locks.size();
+  }
+  return count;
+}
+} // namespace tiny_lsm
@@ -0,0 +1,145 @@
+#include "../../include/lsm/row_cache.h"
+#include <functional>
+#include <mutex>
+
+namespace tiny_lsm {
+
+// 每个缓存项除 key 和 value 外的额外开销(链表节点, 哈希表节点等)的估计值
+static constexpr size_t ROW_CACHE_ITEM_OVERHEAD = 64;
+
+RowCache::RowCache(size_t capacity_bytes, size_t num_shards)
+    : capacity_(capacity_bytes) {
+  if (capacity_ == 0) {
+    return;
+  }
+  if (num_shards == 0) {
+    num_shards = 1;
+  }
+  for (size_t i = 0; i < num_shards; i++) {
+    auto shard = std::make_unique<Shard>();
+    // 容量平均分配到各个分片
+    shard->capacity_ = (capacity_ + num_shards - 1) / num_shards;
+    shards_.push_back(std::move(shard));
+  }
+}
+
+RowCache::~RowCache() = default;
+
+bool RowCache::enabled() const { return capacity_ > 0; }
+
+RowCache::Shard &RowCache::get_shard(const std::string &key) const {
+  return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+void RowCache::Shard::erase(
+    std::unordered_map<std::string,
+                       std::list<RowCacheItem>::iterator>::iterator it) {
+  usage_ -= it->second->charge;
+  lru_list_.erase(it->second);
+  cache_map_.erase(it);
+}
+
+std::optional<std::pair<std::string, uint64_t>>
+RowCache::get(const std::string &key, uint64_t tranc_id) {
+  if (!enabled()) {
+    return std::nullopt;
+  }
+  ++total_requests_;
+
+  auto &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  auto it = shard.cache_map_.find(key);
+  if (it == shard.cache_map_.end()) {
+    return std::nullopt; // 缓存未命中
+  }
+
+  auto &item = *it->second;
+  if (tranc_id != 0 && item.tranc_id > tranc_id) {
+    // 最新版本对当前事务不可见, 需要查询更早的版本
+    return std::nullopt;
+  }
+
+  ++hit_requests_;
+  // 移动到链表头部
+  shard.lru_list_.splice(shard.lru_list_.begin(), shard.lru_list_, it->second);
+  return std::make_pair(item.value, item.tranc_id);
+}
+
+uint64_t RowCache::version(const std::string &key) const {
+  if (!enabled()) {
+    return 0;
+  }
+  auto &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  return shard.version_;
+}
+
+void RowCache::put(const std::string &key, const std::string &value,
+                   uint64_t tranc_id, uint64_t version) {
+  if (!enabled()) {
+    return;
+  }
+  auto &shard = get_shard(key);
+  size_t charge = key.size() + value.size() + ROW_CACHE_ITEM_OVERHEAD;
+  if (charge > shard.capacity_) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  if (shard.version_ != version) {
+    // 查询期间发生了写入, 查询结果可能已经过期
+    return;
+  }
+
+  auto it = shard.cache_map_.find(key);
+  if (it != shard.cache_map_.end()) {
+    shard.erase(it);
+  }
+
+  // 淘汰最久未使用的缓存项直到容量足够
+  while (shard.usage_ + charge > shard.capacity_ && !shard.lru_list_.empty()) {
+    shard.erase(shard.cache_map_.find(shard.lru_list_.back().key));
+  }
+
+  shard.lru_list_.push_front({key, value, tranc_id, charge});
+  shard.cache_map_[key] = shard.lru_list_.begin();
+  shard.usage_ += charge;
+}
+
+void RowCache::invalidate(const std::string &key) {
+  if (!enabled()) {
+    return;
+  }
+  auto &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  ++shard.version_;
+  auto it = shard.cache_map_.find(key);
+  if (it != shard.cache_map_.end()) {
+    shard.erase(it);
+  }
+}
+
+void RowCache::clear() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex_);
+    ++shard->version_;
+    shard->lru_list_.clear();
+    shard->cache_map_.clear();
+    shard->usage_ = 0;
+  }
+}
+
+double RowCache::hit_rate() const {
+  size_t total = total_requests_.load();
+  return total == 0 ? 0.0 : static_cast<double>(hit_requests_.load()) / total;
+}
+
+size_t RowCache::size_bytes() const {
+  size_t total = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex_);
+    total += shard->usage_;
+  }
+  return total;
+}
+} // namespace tiny_lsm
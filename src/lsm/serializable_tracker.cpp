@@ -0,0 +1,214 @@
+#include "../../include/lsm/serializable_tracker.h"
+#include <algorithm>
+
+namespace tiny_lsm {
+
+std::shared_ptr<SerializableTracker::Txn>
+SerializableTracker::begin(uint64_t tranc_id) {
+  auto txn = std::make_shared<Txn>();
+  txn->tranc_id = tranc_id;
+  txn->serializable = true;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  txn->start_seq = applied_seq();
+  active_[tranc_id] = txn;
+  active_start_seqs_.insert(txn->start_seq);
+  return txn;
+}
+
+void SerializableTracker::record_read(Txn &txn, const std::string &key) {
+  std::lock_guard<std::mutex> lock(txn.mtx);
+  txn.reads.insert(key);
+}
+
+void SerializableTracker::record_range_read(Txn &txn,
+                                            const std::string &preffix) {
+  std::lock_guard<std::mutex> lock(txn.mtx);
+  txn.read_preffixes.push_back(preffix);
+}
+
+bool SerializableTracker::visible(const Txn &txn, uint64_t writer_tranc_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = committed_seqs_.find(writer_tranc_id);
+  // 不在表中的写入者在 txn 开始前就已经应用
+  return it == committed_seqs_.end() || it->second <= txn.start_seq;
+}
+
+std::vector<std::string>
+SerializableTracker::invisible_writes(const Txn &txn,
+                                      const std::string &preffix) {
+  std::vector<std::string> keys;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = committed_.upper_bound(txn.start_seq); it != committed_.end();
+       ++it) {
+    for (auto &key : it->second->writes) {
+      if (key.compare(0, preffix.size(), preffix) == 0) {
+        keys.push_back(key);
+      }
+    }
+  }
+  return keys;
+}
+
+bool SerializableTracker::read_overlaps(Txn &reader,
+                                        const std::vector<std::string> &keys) {
+  std::lock_guard<std::mutex> lock(reader.mtx);
+  for (auto &key : keys) {
+    if (reader.reads.count(key)) {
+      return true;
+    }
+    for (auto &preffix : reader.read_preffixes) {
+      if (key.compare(0, preffix.size(), preffix) == 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool SerializableTracker::validate_and_commit(
+    const std::shared_ptr<Txn> &txn, std::vector<std::string> write_keys) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto abort_txn = [&]() {
+    active_.erase(txn->tranc_id);
+    active_start_seqs_.erase(active_start_seqs_.find(txn->start_seq));
+    prune();
+    return false;
+  };
+
+  std::unordered_set<std::string> write_set(write_keys.begin(),
+                                            write_keys.end());
+  std::vector<Txn *> out_txns;
+  std::vector<Txn *> in_txns;
+
+  // 1 txn 开始后提交的事务
+  for (auto it = committed_.upper_bound(txn->start_seq); it != committed_.end();
+       ++it) {
+    auto &other = *it->second;
+    // 1.1 写写冲突, 先提交者胜出
+    for (auto &key : other.writes) {
+      if (write_set.count(key)) {
+        return abort_txn();
+      }
+    }
+    // 1.2 txn 读取的数据被其修改: txn -rw-> other
+    if (other.serializable && read_overlaps(*txn, other.writes)) {
+      if (other.out_conflict) {
+        // other 已经提交, 且成为 txn -rw-> other -rw-> ... 的中间节点
+        return abort_txn();
+      }
+      out_txns.push_back(&other);
+    }
+  }
+
+  // 2 与 txn 并发的事务读取过 txn 要写入的数据: other -rw-> txn
+  auto check_reader = [&](Txn &other) {
+    if (&other == txn.get() || !read_overlaps(other, write_keys)) {
+      return true;
+    }
+    if (other.commit_seq != 0 && other.in_conflict) {
+      // 已经提交的 other 会成为中间节点, 只能终止 txn
+      return false;
+    }
+    in_txns.push_back(&other);
+    return true;
+  };
+  for (auto &[tranc_id, other] : active_) {
+    if (!check_reader(*other)) {
+      return abort_txn();
+    }
+  }
+  for (auto it = committed_.upper_bound(txn->start_seq); it != committed_.end();
+       ++it) {
+    if (it->second->serializable && !check_reader(*it->second)) {
+      return abort_txn();
+    }
+  }
+
+  // 3 txn 自身同时有入边和出边
+  bool in_conflict = txn->in_conflict || !in_txns.empty();
+  bool out_conflict = txn->out_conflict || !out_txns.empty();
+  if (in_conflict && out_conflict) {
+    return abort_txn();
+  }
+
+  // 校验通过, 记录依赖关系
+  // 活跃的读者因此成为中间节点时, 由它自己的提交校验终止
+  txn->in_conflict = in_conflict;
+  txn->out_conflict = out_conflict;
+  for (auto other : out_txns) {
+    other->in_conflict = true;
+  }
+  for (auto other : in_txns) {
+    other->out_conflict = true;
+  }
+
+  active_.erase(txn->tranc_id);
+  active_start_seqs_.erase(active_start_seqs_.find(txn->start_seq));
+  txn->writes = std::move(write_keys);
+  txn->commit_seq = next_commit_seq_++;
+  committed_[txn->commit_seq] = txn;
+  committed_seqs_[txn->tranc_id] = txn->commit_seq;
+  pending_seqs_.insert(txn->commit_seq);
+  pending_tranc_ids_[txn->tranc_id] = txn->commit_seq;
+  return true;
+}
+
+void SerializableTracker::commit(uint64_t tranc_id,
+                                 std::vector<std::string> write_keys) {
+  auto txn = std::make_shared<Txn>();
+  txn->tranc_id = tranc_id;
+  txn->writes = std::move(write_keys);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  txn->commit_seq = next_commit_seq_++;
+  committed_[txn->commit_seq] = txn;
+  committed_seqs_[tranc_id] = txn->commit_seq;
+  pending_seqs_.insert(txn->commit_seq);
+  pending_tranc_ids_[tranc_id] = txn->commit_seq;
+}
+
+void SerializableTracker::applied(uint64_t tranc_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = pending_tranc_ids_.find(tranc_id);
+  if (it == pending_tranc_ids_.end()) {
+    return;
+  }
+  pending_seqs_.erase(it->second);
+  pending_tranc_ids_.erase(it);
+  prune();
+}
+
+void SerializableTracker::abort(const std::shared_ptr<Txn> &txn) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (active_.erase(txn->tranc_id)) {
+    active_start_seqs_.erase(active_start_seqs_.find(txn->start_seq));
+    prune();
+  }
+}
+
+size_t SerializableTracker::tracked_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_.size() + committed_.size();
+}
+
+uint64_t SerializableTracker::applied_seq() const {
+  // 提交序号连续应用到的位置, 之后可能有已应用的序号, 但中间存在空洞
+  if (pending_seqs_.empty()) {
+    return next_commit_seq_ - 1;
+  }
+  return *pending_seqs_.begin() - 1;
+}
+
+void SerializableTracker::prune() {
+  // 在所有活跃事务开始前就已经应用的事务不再与任何事务并发
+  uint64_t min_start_seq = active_start_seqs_.empty()
+                               ? applied_seq()
+                               : *active_start_seqs_.begin();
+  while (!committed_.empty() && committed_.begin()->first <= min_start_seq) {
+    committed_seqs_.erase(committed_.begin()->second->tranc_id);
+    committed_.erase(committed_.begin());
+  }
+}
+} // namespace tiny_lsm
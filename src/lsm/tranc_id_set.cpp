@@ -0,0 +1,120 @@
+#include "../../include/lsm/tranc_id_set.h"
+#include <algorithm>
+#include <cstring>
+
+namespace tiny_lsm {
+
+TrancIdSet::TrancIdSet(uint64_t low_watermark)
+    : low_watermark_(low_watermark), max_(low_watermark) {}
+
+bool TrancIdSet::test_bit_(uint64_t tranc_id) const {
+  if (tranc_id < base_) {
+    return false;
+  }
+  uint64_t idx = (tranc_id - base_) / 64;
+  if (idx >= words_.size()) {
+    return false;
+  }
+  return (words_[idx] >> ((tranc_id - base_) % 64)) & 1;
+}
+
+bool TrancIdSet::contains(uint64_t tranc_id) const {
+  return tranc_id <= low_watermark_ || test_bit_(tranc_id);
+}
+
+bool TrancIdSet::insert(uint64_t tranc_id) {
+  if (contains(tranc_id)) {
+    return false;
+  }
+  if (words_.empty()) {
+    base_ = (low_watermark_ + 1) / 64 * 64;
+  }
+  uint64_t idx = (tranc_id - base_) / 64;
+  if (idx >= words_.size()) {
+    words_.resize(idx + 1, 0);
+  }
+  words_[idx] |= uint64_t(1) << ((tranc_id - base_) % 64);
+  exception_count_++;
+  max_ = std::max(max_, tranc_id);
+
+  // 推进低水位, 每个 tranc_id 只会被越过一次
+  while (test_bit_(low_watermark_ + 1)) {
+    low_watermark_++;
+    exception_count_--;
+  }
+  // 完全不大于低水位的字不再需要
+  while (!words_.empty() && base_ + 64 <= low_watermark_ + 1) {
+    words_.pop_front();
+    base_ += 64;
+  }
+  return true;
+}
+
+void TrancIdSet::reset(uint64_t low_watermark) {
+  low_watermark_ = low_watermark;
+  max_ = low_watermark;
+  exception_count_ = 0;
+  words_.clear();
+}
+
+uint64_t TrancIdSet::low_watermark() const { return low_watermark_; }
+
+uint64_t TrancIdSet::max() const { return max_; }
+
+size_t TrancIdSet::exception_count() const { return exception_count_; }
+
+std::vector<uint64_t> TrancIdSet::exceptions() const {
+  std::vector<uint64_t> res;
+  res.reserve(exception_count_);
+  for (size_t i = 0; i < words_.size(); i++) {
+    auto word = words_[i];
+    while (word != 0) {
+      uint64_t tranc_id = base_ + i * 64 + __builtin_ctzll(word);
+      word &= word - 1;
+      if (tranc_id > low_watermark_) {
+        res.push_back(tranc_id);
+      }
+    }
+  }
+  return res;
+}
+
+void TrancIdSet::encode(std::vector<uint8_t> &buf) const {
+  auto ids = exceptions();
+  size_t offset = buf.size();
+  buf.resize(offset + sizeof(uint64_t) * (3 + ids.size()));
+  uint8_t *ptr = buf.data() + offset;
+  uint64_t count = ids.size();
+  memcpy(ptr, &low_watermark_, sizeof(uint64_t));
+  memcpy(ptr + sizeof(uint64_t), &max_, sizeof(uint64_t));
+  memcpy(ptr + sizeof(uint64_t) * 2, &count, sizeof(uint64_t));
+  if (!ids.empty()) {
+    memcpy(ptr + sizeof(uint64_t) * 3, ids.data(),
+           sizeof(uint64_t) * ids.size());
+  }
+}
+
+size_t TrancIdSet::decode(const uint8_t *data, size_t len) {
+  if (len < sizeof(uint64_t) * 3) {
+    return 0;
+  }
+  uint64_t low_watermark, max, count;
+  memcpy(&low_watermark, data, sizeof(uint64_t));
+  memcpy(&max, data + sizeof(uint64_t), sizeof(uint64_t));
+  memcpy(&count, data + sizeof(uint64_t) * 2, sizeof(uint64_t));
+  size_t total = sizeof(uint64_t) * 3;
+  if (count > (len - total) / sizeof(uint64_t)) {
+    return 0;
+  }
+
+  reset(low_watermark);
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t tranc_id;
+    memcpy(&tranc_id, data + total, sizeof(uint64_t));
+    total += sizeof(uint64_t);
+    insert(tranc_id);
+  }
+  max_ = std::max(max_, max);
+  return total;
+}
+} // namespace tiny_lsm
@@ -0,0 +1,113 @@
+#include "../../include/lsm/tranc_iterator.h"
+#include <stdexcept>
+
+namespace tiny_lsm {
+
+TrancIterator::TrancIterator(
+    std::shared_ptr<BaseIterator> base,
+    std::vector<std::shared_ptr<const TrancWriteBatch>> overlays,
+    const std::string &preffix, uint64_t tranc_id)
+    : base_(std::move(base)), preffix_(preffix), tranc_id_(tranc_id) {
+  for (auto &batch : overlays) {
+    auto it = batch->lower_bound(preffix_);
+    overlays_.push_back({std::move(batch), it});
+  }
+  advance();
+}
+
+bool TrancIterator::base_valid() const {
+  return base_ != nullptr && !base_->is_end() && base_->is_valid();
+}
+
+bool TrancIterator::overlay_valid(const Overlay &overlay) const {
+  return overlay.it != overlay.batch->end() &&
+         overlay.it->first.compare(0, preffix_.size(), preffix_) == 0;
+}
+
+void TrancIterator::advance() {
+  while (true) {
+    // 1 找到所有来源中最小的 key
+    std::optional<std::string> min_key;
+    if (base_valid()) {
+      min_key = (**base_).first;
+    }
+    for (auto &overlay : overlays_) {
+      if (overlay_valid(overlay) &&
+          (!min_key.has_value() || overlay.it->first < *min_key)) {
+        min_key = std::string(overlay.it->first);
+      }
+    }
+    if (!min_key.has_value()) {
+      current_ = std::nullopt;
+      return;
+    }
+
+    // 2 优先级最高的来源决定 value, 所有来源都跳过这个 key
+    std::optional<std::string> value;
+    for (auto &overlay : overlays_) {
+      if (overlay_valid(overlay) && overlay.it->first == *min_key) {
+        if (!value.has_value()) {
+          value = std::string(overlay.it->second);
+        }
+        ++overlay.it;
+      }
+    }
+    if (base_valid() && (**base_).first == *min_key) {
+      if (!value.has_value()) {
+        value = (**base_).second;
+      }
+      ++(*base_);
+    }
+
+    if (!value->empty()) {
+      current_ = std::make_pair(std::move(*min_key), std::move(*value));
+      return;
+    }
+    // 被事务删除的 key, 继续查找下一个
+  }
+}
+
+BaseIterator &TrancIterator::operator++() {
+  advance();
+  return *this;
+}
+
+bool TrancIterator::operator==(const BaseIterator &other) const {
+  if (other.get_type() != IteratorType::TrancIterator) {
+    return false;
+  }
+  auto &other2 = dynamic_cast<const TrancIterator &>(other);
+  if (is_end() || other2.is_end()) {
+    return is_end() && other2.is_end();
+  }
+  return current_ == other2.current_;
+}
+
+bool TrancIterator::operator!=(const BaseIterator &other) const {
+  return !(*this == other);
+}
+
+BaseIterator::value_type TrancIterator::operator*() const {
+  if (!current_.has_value()) {
+    throw std::runtime_error("Iterator is invalid");
+  }
+  return *current_;
+}
+
+IteratorType TrancIterator::get_type() const {
+  return IteratorType::TrancIterator;
+}
+
+uint64_t TrancIterator::get_tranc_id() const { return tranc_id_; }
+
+bool TrancIterator::is_end() const { return !current_.has_value(); }
+
+bool TrancIterator::is_valid() const { return current_.has_value(); }
+
+TrancIterator::pointer TrancIterator::operator->() const {
+  if (!current_.has_value()) {
+    throw std::runtime_error("Iterator is invalid");
+  }
+  return &(*current_);
+}
+} // namespace tiny_lsm
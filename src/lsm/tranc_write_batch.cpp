@@ -0,0 +1,69 @@
+#include "../../include/lsm/tranc_write_batch.h"
+#include <cstring>
+
+namespace tiny_lsm {
+
+std::string_view TrancWriteBatch::store(const std::string &data) {
+  if (data.empty()) {
+    return {};
+  }
+  char *buf = arena_.allocate(data.size());
+  std::memcpy(buf, data.data(), data.size());
+  return {buf, data.size()};
+}
+
+void TrancWriteBatch::put(const std::string &key, const std::string &value) {
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    // key 已经在 Arena 中, 只需要重新分配 value
+    it->second = store(value);
+    return;
+  }
+  index_.emplace(store(key), store(value));
+}
+
+void TrancWriteBatch::remove(const std::string &key) { put(key, ""); }
+
+std::optional<std::string> TrancWriteBatch::get(const std::string &key) const {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return std::nullopt;
+  }
+  return std::string(it->second);
+}
+
+size_t TrancWriteBatch::size() const { return index_.size(); }
+
+bool TrancWriteBatch::empty() const { return index_.empty(); }
+
+TrancWriteBatch::const_iterator TrancWriteBatch::begin() const {
+  return index_.begin();
+}
+
+TrancWriteBatch::const_iterator TrancWriteBatch::end() const {
+  return index_.end();
+}
+
+TrancWriteBatch::const_iterator
+TrancWriteBatch::lower_bound(const std::string &key) const {
+  return index_.lower_bound(key);
+}
+
+std::vector<std::string> TrancWriteBatch::keys() const {
+  std::vector<std::string> keys;
+  keys.reserve(index_.size());
+  for (auto &[key, value] : index_) {
+    keys.emplace_back(key);
+  }
+  return keys;
+}
+
+std::vector<std::pair<std::string, std::string>> TrancWriteBatch::kvs() const {
+  std::vector<std::pair<std::string, std::string>> kvs;
+  kvs.reserve(index_.size());
+  for (auto &[key, value] : index_) {
+    kvs.emplace_back(key, value);
+  }
+  return kvs;
+}
+} // namespace tiny_lsm
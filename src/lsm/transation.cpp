@@ -1,7 +1,8 @@
+#include "../../include/config/config.h"
 #include "../../include/lsm/engine.h"
+#include "../../include/lsm/level_iterator.h"
 #include "../../include/lsm/transaction.h"
 #include "../../include/utils/files.h"
-#include "../../include/utils/set_operation.h"
 #include "spdlog/spdlog.h"
 #include <algorithm>
 #include <cerrno>
@@ -9,7 +10,9 @@
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <thread>
 #include <vector>
 
@@ -33,9 +36,11 @@ inline std::string isolation_level_to_string(const IsolationLevel &level) {
 // *********************** TranContext ***********************
 TranContext::TranContext(uint64_t tranc_id, std::shared_ptr<LSMEngine> engine,
                          std::shared_ptr<TranManager> tranManager,
-                         const enum IsolationLevel &isolation_level)
+                         const enum IsolationLevel &isolation_level,
+                         TrancMode tranc_mode)
     : tranc_id_(tranc_id), engine_(std::move(engine)),
-      tranManager_(std::move(tranManager)), isolation_level_(isolation_level) {
+      tranManager_(std::move(tranManager)), isolation_level_(isolation_level),
+      tranc_mode_(tranc_mode) {
   operations.emplace_back(Record::createRecord(tranc_id_));
 }
 
@@ -51,9 +56,8 @@ void TranContext::put(const std::string &key, const std::string &value) {
 
   if (isolation_level == IsolationLevel::READ_UNCOMMITTED) {
     // 1 如果隔离级别是 READ_UNCOMMITTED, 直接写入 memtable
-    // 先查询以前的记录, 因为回滚时可能需要
-    auto prev_record = engine_->get(key, 0);
-    rollback_map_[key] = prev_record;
+    // 之前的版本仍保留在版本链中, 只需要记录 key, 回滚时再读取
+    rollback_keys_.insert(key);
     engine_->put(key, value, tranc_id_);
 
     spdlog::trace(
@@ -63,10 +67,14 @@ void TranContext::put(const std::string &key, const std::string &value) {
     return;
   }
 
-  // 2 其他隔离级别需要 暂存到 temp_map_ 中, 统一提交后才在数据库中生效
-  temp_map_[key] = value;
+  // 2 其他隔离级别需要 暂存到 write_batch_ 中, 统一提交后才在数据库中生效
+  // 悲观事务先获取排他锁, 提交或终止时才释放
+  if (tranc_mode_ == TrancMode::PESSIMISTIC) {
+    lock_key_(key, true);
+  }
+  write_batch_->put(key, value);
 
-  spdlog::trace("TranContext--{}: put({}, {}) stored in temp map",
+  spdlog::trace("TranContext--{}: put({}, {}) stored in write batch",
                 isolation_level_to_string(isolation_level_), key, value);
 }
 
@@ -80,9 +88,8 @@ void TranContext::remove(const std::string &key) {
 
   if (isolation_level == IsolationLevel::READ_UNCOMMITTED) {
     // 1 如果隔离级别是 READ_UNCOMMITTED, 直接写入 memtable
-    // 先查询以前的记录, 因为回滚时可能需要
-    auto prev_record = engine_->get(key, 0);
-    rollback_map_[key] = prev_record;
+    // 之前的版本仍保留在版本链中, 只需要记录 key, 回滚时再读取
+    rollback_keys_.insert(key);
     engine_->remove(key, tranc_id_);
 
     spdlog::trace(
@@ -91,9 +98,12 @@ void TranContext::remove(const std::string &key) {
     return;
   }
 
-  // 2 其他隔离级别需要 暂存到 temp_map_ 中, 统一提交后才在数据库中生效
-  temp_map_[key] = "";
-  spdlog::trace("TranContext--{}: remove({}) stored in temp map",
+  // 2 其他隔离级别需要 暂存到 write_batch_ 中, 统一提交后才在数据库中生效
+  if (tranc_mode_ == TrancMode::PESSIMISTIC) {
+    lock_key_(key, true);
+  }
+  write_batch_->remove(key);
+  spdlog::trace("TranContext--{}: remove({}) stored in write batch",
                 isolation_level_to_string(isolation_level_), key);
 }
 
@@ -103,13 +113,14 @@ std::optional<std::string> TranContext::get(const std::string &key) {
   auto isolation_level = get_isolation_level();
 
   // 1 所有隔离级别先就近在当前操作的临时缓存中查找
-  if (temp_map_.find(key) != temp_map_.end()) {
+  auto buffered = write_batch_->get(key);
+  if (buffered.has_value()) {
     // READ_UNCOMMITTED 随单次操作更新数据库, 不需要最后的统一更新
     // 这一步骤肯定会自然跳过的
-    spdlog::trace("TranContext--{}: get({}) found in temp map",
+    spdlog::trace("TranContext--{}: get({}) found in write batch",
                   isolation_level_to_string(isolation_level), key);
 
-    return temp_map_[key];
+    return buffered;
   }
 
   // 2 否则使用 engine 查询
@@ -122,11 +133,21 @@ std::optional<std::string> TranContext::get(const std::string &key) {
     // 2.2 如果隔离级别是 READ_COMMITTED, 使用 engine
     // 查询时判断 tranc_id
     query = engine_->get(key, this->tranc_id_);
+  } else if (tranc_mode_ == TrancMode::PESSIMISTIC) {
+    // 2.3 悲观事务的 REPEATABLE_READ 先获取共享锁
+    // 持有锁期间其他悲观事务无法修改该 key, 读取最新的版本即可重复读
+    lock_key_(key, false);
+    query = engine_->get(key, 0);
   } else {
-    // 2.2 如果隔离级别是 SERIALIZABLE 或 REPEATABLE_READ, 第一次使用 engine
+    // 2.4 如果隔离级别是 SERIALIZABLE 或 REPEATABLE_READ, 第一次使用 engine
     // 查询后还需要暂存
     if (read_map_.find(key) != read_map_.end()) {
       query = read_map_[key];
+    } else if (isolation_level == IsolationLevel::SERIALIZABLE) {
+      // SERIALIZABLE 先登记读集合再读取快照
+      tranManager_->get_serializable_tracker().record_read(*ssi_txn_, key);
+      query = snapshot_get(key);
+      read_map_[key] = query;
     } else {
       query = engine_->get(key, this->tranc_id_);
       read_map_[key] = query;
@@ -144,6 +165,142 @@ std::optional<std::string> TranContext::get(const std::string &key) {
   return query.has_value() ? std::make_optional(query->first) : std::nullopt;
 }
 
+std::optional<std::string>
+TranContext::get_for_update(const std::string &key) {
+  if (tranc_mode_ != TrancMode::PESSIMISTIC) {
+    // 乐观事务在提交时校验冲突
+    return get(key);
+  }
+  spdlog::trace("TranContext--get_for_update({}) called, tranc_id={}", key,
+                tranc_id_);
+
+  // 获取排他锁后读取最新的版本, 之后的写入不会与其他悲观事务冲突
+  lock_key_(key, true);
+  auto buffered = write_batch_->get(key);
+  if (buffered.has_value()) {
+    return buffered;
+  }
+  auto query = engine_->get(key, 0);
+  return query.has_value() ? std::make_optional(query->first) : std::nullopt;
+}
+
+void TranContext::lock_key_(const std::string &key, bool exclusive) {
+  auto timeout = std::chrono::milliseconds(
+      TomlConfig::getInstance().getTrancLockTimeoutMs());
+  auto status = tranManager_->get_lock_manager().lock(tranc_id_, key,
+                                                      exclusive, timeout);
+  if (status == LockStatus::OK) {
+    locked_keys_.insert(key);
+    return;
+  }
+
+  // 加锁失败时终止事务, 释放已经持有的锁, 让等待的事务继续执行
+  spdlog::warn("TranContext--lock_key_(): {} on key={}, aborting "
+               "transaction ID={}",
+               status == LockStatus::DEADLOCK ? "Deadlock detected"
+                                              : "Lock wait timeout",
+               key, tranc_id_);
+  abort();
+  throw std::runtime_error(status == LockStatus::DEADLOCK
+                               ? "deadlock detected on key " + key
+                               : "lock wait timeout on key " + key);
+}
+
+void TranContext::release_locks_() {
+  if (locked_keys_.empty()) {
+    return;
+  }
+  std::vector<std::string> keys(locked_keys_.begin(), locked_keys_.end());
+  tranManager_->get_lock_manager().unlock(tranc_id_, keys);
+  locked_keys_.clear();
+}
+
+std::optional<std::pair<std::string, uint64_t>>
+TranContext::snapshot_get(const std::string &key) {
+  auto &tracker = tranManager_->get_serializable_tracker();
+  // 使用 get_ 查询, 并发事务的删除标记也需要跳过
+  auto res = engine_->get_(key, tranc_id_);
+  while (res.has_value() && !tracker.visible(*ssi_txn_, res->second)) {
+    // 该版本由本事务开始后提交的事务写入, 继续查询更早的版本
+    res = res->second > 1 ? engine_->get_(key, res->second - 1) : std::nullopt;
+  }
+  if (res.has_value() && res->first.empty()) {
+    return std::nullopt;
+  }
+  return res;
+}
+
+std::vector<std::pair<std::string, std::string>>
+TranContext::scan_preffix(const std::string &preffix) {
+  spdlog::trace("TranContext--scan_preffix({}) called, tranc_id={}", preffix,
+                tranc_id_);
+
+  std::vector<std::pair<std::string, std::string>> result;
+  for (auto it = begin_preffix(preffix); !it.is_end(); ++it) {
+    result.push_back(*it);
+  }
+  return result;
+}
+
+TrancIterator TranContext::begin() {
+  auto isolation_level = get_isolation_level();
+  if (isolation_level == IsolationLevel::SERIALIZABLE) {
+    // 快照修正需要在不持有 sst 读锁时查询
+    return begin_preffix("");
+  }
+  uint64_t query_tranc_id =
+      isolation_level == IsolationLevel::READ_UNCOMMITTED ? 0 : tranc_id_;
+  auto base = std::make_shared<Level_Iterator>(engine_, query_tranc_id);
+  return make_iterator_(base, "");
+}
+
+TrancIterator TranContext::end() { return TrancIterator{}; }
+
+TrancIterator TranContext::begin_preffix(const std::string &preffix) {
+  auto isolation_level = get_isolation_level();
+  if (isolation_level == IsolationLevel::SERIALIZABLE) {
+    // 先登记范围再读取, 之后并发插入该范围的事务也会被检测到
+    tranManager_->get_serializable_tracker().record_range_read(*ssi_txn_,
+                                                               preffix);
+  }
+
+  // READ_UNCOMMITTED 读取最新值, 其余隔离级别判断 tranc_id
+  // ! 范围查询的结果不暂存到 read_map_ 中
+  uint64_t query_tranc_id =
+      isolation_level == IsolationLevel::READ_UNCOMMITTED ? 0 : tranc_id_;
+  std::shared_ptr<BaseIterator> base;
+  {
+    std::shared_lock<std::shared_mutex> rlock(engine_->ssts_mtx);
+    auto iters = engine_->lsm_iters_preffix(query_tranc_id, preffix);
+    if (iters.has_value()) {
+      base = std::make_shared<TwoMergeIterator>(iters->first);
+    }
+  }
+  return make_iterator_(base, preffix);
+}
+
+TrancIterator TranContext::make_iterator_(std::shared_ptr<BaseIterator> base,
+                                          const std::string &preffix) {
+  // 事务自身的写入优先级最高
+  std::vector<std::shared_ptr<const TrancWriteBatch>> overlays{write_batch_};
+
+  if (get_isolation_level() == IsolationLevel::SERIALIZABLE) {
+    // SERIALIZABLE 需要将并发事务写入的 key 替换为快照中的版本
+    // base 已经读取完毕, 之后提交的写入一定能在这里找到
+    auto keys = tranManager_->get_serializable_tracker().invisible_writes(
+        *ssi_txn_, preffix);
+    auto corrections = std::make_shared<TrancWriteBatch>();
+    for (auto &key : keys) {
+      auto query = snapshot_get(key);
+      corrections->put(key, query.has_value() ? query->first : "");
+    }
+    overlays.push_back(corrections);
+  }
+
+  return TrancIterator(std::move(base), std::move(overlays), preffix,
+                       tranc_id_);
+}
+
 bool TranContext::commit(bool test_fail) {
   spdlog::info("TranContext--commit(): Starting commit for transaction ID={}",
                tranc_id_);
@@ -155,8 +312,18 @@ bool TranContext::commit(bool test_fail) {
     // 因此也不需要使用到后面的锁保证正确性
     operations.emplace_back(Record::commitRecord(this->tranc_id_));
 
-    // 先刷入wal
-    auto wal_success = tranManager_->write_to_wal(operations);
+    // 条带锁一直持有到记录到最近写入表, 与其他提交的顺序和 LSM::write_ 相同
+    std::vector<std::string> keys(rollback_keys_.begin(),
+                                  rollback_keys_.end());
+    CommitTable &commit_table = tranManager_->get_commit_table();
+    auto locks = commit_table.lock(keys);
+
+    // 先刷入wal, 再写入事务完成的标记, 与其他并发写入者组提交
+    WriteQueue::Writer writer;
+    writer.records = operations;
+    writer.sync = true;
+    writer.apply = [this]() { engine_->memtable.put("", "", tranc_id_); };
+    auto wal_success = tranManager_->write(writer);
 
     if (!wal_success) {
       spdlog::error(
@@ -165,7 +332,10 @@ bool TranContext::commit(bool test_fail) {
 
       throw std::runtime_error("write to wal failed");
     }
-    engine_->memtable.put_("", "", tranc_id_);
+    for (auto &k : keys) {
+      commit_table.record_(k, tranc_id_);
+    }
+
     isCommited = true;
     tranManager_->add_ready_to_flush_tranc_id(tranc_id_, TransactionState::COMMITTED);
 
@@ -177,97 +347,143 @@ bool TranContext::commit(bool test_fail) {
   }
 
   // commit 需要检查所有的操作是否合法
+  // 只锁住写集合所在的条带, 写集合不相交的事务可以并行提交, 读操作不受影响
+  // 条带锁一直持有到写入 memtable, 同一个 key 上的提交依次进行
+  auto keys = write_batch_->keys();
+
+  if (tranc_mode_ == TrancMode::OPTIMISTIC) {
+    // 乐观事务提交时也要获取写集合的排他锁, 持有锁的悲观事务读到的版本
+    // 在它提交前不会被覆盖; 行锁在条带锁之前获取, 与悲观事务的顺序一致
+    auto &lock_manager = tranManager_->get_lock_manager();
+    auto timeout = std::chrono::milliseconds(
+        TomlConfig::getInstance().getTrancLockTimeoutMs());
+    for (auto &k : keys) {
+      auto status = lock_manager.lock(tranc_id_, k, true, timeout);
+      if (status != LockStatus::OK) {
+        spdlog::warn("TranContext--commit(): Failed to lock key={}, aborting "
+                     "transaction ID={}",
+                     k, tranc_id_);
+        abort();
+        return false;
+      }
+      locked_keys_.insert(k);
+    }
+  }
 
-  // 遍历所有的记录, 判断是否合法
-
-  // TODO: 目前为检查冲突, 全局获取了读锁, 后续考虑性能优化方案
-
-  MemTable &memtable = engine_->memtable;
-  std::unique_lock<std::shared_mutex> wlock1(memtable.frozen_mtx);
-  std::unique_lock<std::shared_mutex> wlock2(memtable.cur_mtx);
-
-  if (isolation_level == IsolationLevel::REPEATABLE_READ ||
-      isolation_level == IsolationLevel::SERIALIZABLE) {
-    // REPEATABLE_READ 需要校验冲突
-    // TODO: 目前 SERIALIZABLE 还没有实现, 逻辑和 REPEATABLE_READ 相同
-
-    // 只要需要校验的 隔离级别 需要加sst的锁
-    std::shared_lock<std::shared_mutex> rlock3(engine_->ssts_mtx);
-
-    for (auto &[k, v] : temp_map_) {
-      // 步骤1: 先在内存表中判断该 key 是否冲突
-
-      // ! 注意第二个参数设置为0, 表示忽略事务可见性的查询
-      auto res = memtable.get_(k, 0);
-      if (res.is_valid() && res.get_tranc_id() > tranc_id_) {
+  CommitTable &commit_table = tranManager_->get_commit_table();
+  auto locks = commit_table.lock(keys);
+
+  auto &tracker = tranManager_->get_serializable_tracker();
+
+  if (tranc_mode_ == TrancMode::OPTIMISTIC &&
+      (isolation_level == IsolationLevel::REPEATABLE_READ ||
+       isolation_level == IsolationLevel::SERIALIZABLE)) {
+    // 乐观事务的 REPEATABLE_READ 和 SERIALIZABLE 需要校验冲突
+    // 悲观事务的写集合都持有排他锁, 乐观事务提交时也需要获取这些锁,
+    // 悲观事务读取之后不会有其他提交写入相同的 key, 不需要校验
+    for (auto &k : keys) {
+      // 步骤1: 在最近写入表中判断该 key 是否冲突
+      auto conflict = commit_table.has_newer_commit(k, tranc_id_);
+      if (!conflict.has_value()) {
+        // 步骤2: 表中的历史已经被淘汰, 查询数据库中是否有该 key 更新的版本
+        // 事务 id 范围早于当前事务的 sst 和 block 会被跳过
+        conflict = engine_->has_newer_version(k, tranc_id_);
+      }
+      if (conflict.value()) {
         // 数据库中存在相同的 key , 且其 tranc_id 大于当前 tranc_id
         // 表示更晚创建的事务修改了相同的key, 并先提交, 发生了冲突
         // 需要终止事务
+        if (ssi_txn_ != nullptr) {
+          tracker.abort(ssi_txn_);
+        }
         isAborted = true;
-        tranManager_->add_ready_to_flush_tranc_id(tranc_id_, TransactionState::ABORTED);
+        tranManager_->add_ready_to_flush_tranc_id(tranc_id_,
+                                                  TransactionState::ABORTED);
+        release_locks_();
 
         spdlog::warn("TranContext--commit(): Conflict detected on key={}, "
                      "aborting transaction ID={}",
                      k, tranc_id_);
 
         return false;
-      } else {
-        // 步骤2: 判断sst中是否是否存在冲突
-        if (tranManager_->get_max_flushed_tranc_id() <= tranc_id_) {
-          // sst 中最大的 tranc_id 小于当前 tranc_id, 没有冲突
-          continue;
-        }
-
-        // 否则要查询具体的key是否冲突
-        // ! 注意第二个参数设置为0, 表示忽略事务可见性的查询
-        auto res = engine_->sst_get_(k, 0);
-        if (res.has_value()) {
-          auto [v, tranc_id] = res.value();
-          if (tranc_id > tranc_id_) {
-            // 数据库中存在相同的 key , 且其 tranc_id 大于当前 tranc_id
-            // 表示更晚创建的事务修改了相同的key, 并先提交, 发生了冲突
-            // 需要终止事务
-            isAborted = true;
-            tranManager_->add_ready_to_flush_tranc_id(tranc_id_, TransactionState::ABORTED);
-
-            spdlog::warn("TranContext--commit(): SST conflict on key={}, "
-                         "aborting transaction ID={}",
-                         k, tranc_id_);
-
-            return false;
-          }
-        }
       }
     }
   }
 
+  if (isolation_level == IsolationLevel::SERIALIZABLE) {
+    // SERIALIZABLE 还需要校验与并发事务之间的读写依赖
+    if (!tracker.validate_and_commit(ssi_txn_, keys)) {
+      isAborted = true;
+      tranManager_->add_ready_to_flush_tranc_id(tranc_id_,
+                                                TransactionState::ABORTED);
+      release_locks_();
+
+      spdlog::warn("TranContext--commit(): Serialization conflict detected, "
+                   "aborting transaction ID={}",
+                   tranc_id_);
+
+      return false;
+    }
+  }
+
   // 其他隔离级别不检查, 直接运行到这里
 
+  // 暂存数据和完成标记在同一次批量写入中, 保证位于同一张表
+  // 暂存数据按 key 的顺序写入, 完成标记在最后
+  auto kvs = write_batch_->kvs();
+
+  uint64_t commit_tranc_id = tranc_id_;
+  if (tranc_mode_ == TrancMode::PESSIMISTIC) {
+    // 等待锁期间其他事务可能以更大的 tranc_id 提交了相同的 key,
+    // 使用新分配的 tranc_id 写入, 保证本事务的版本比它们更新
+    commit_tranc_id = tranManager_->assign_commit_tranc_id(tranc_id_);
+    operations.clear();
+    operations.emplace_back(Record::createRecord(commit_tranc_id));
+    for (auto &[k, v] : kvs) {
+      operations.emplace_back(
+          v.empty() ? Record::deleteRecord(commit_tranc_id, k)
+                    : Record::putRecord(commit_tranc_id, k, v));
+    }
+  }
+
+  if (isolation_level != IsolationLevel::SERIALIZABLE) {
+    // 登记提交序号, 应用期间的写入对之后开始的 SERIALIZABLE 事务不可见
+    tracker.commit(commit_tranc_id, keys);
+  }
+
   // 校验全部通过, 可以刷入
-  operations.emplace_back(Record::commitRecord(this->tranc_id_));
+  operations.emplace_back(Record::commitRecord(commit_tranc_id));
+  kvs.emplace_back("", "");
 
-  // 先刷入wal
-  auto wal_success = tranManager_->write_to_wal(operations);
+  // 先刷入wal, 再将暂存数据应用到数据库, 与其他并发写入者组提交
+  WriteQueue::Writer writer;
+  writer.records = operations;
+  writer.sync = true;
+  if (!test_fail) {
+    writer.apply = [&]() { engine_->put_batch(kvs, commit_tranc_id); };
+  }
+  auto wal_success = tranManager_->write(writer);
+  // 失败时也需要推进快照序号, 否则之后的 SERIALIZABLE 事务一直看不到新的提交
+  tracker.applied(commit_tranc_id);
 
   if (!wal_success) {
     spdlog::error(
         "TranContext--commit(): Failed to write WAL for transaction ID={}",
         tranc_id_);
 
+    release_locks_();
     throw std::runtime_error("write to wal failed");
   }
 
-  // 将暂存数据应用到数据库
-  if (!test_fail) {
-    // 这里是手动调用 memtable 的无锁版本的 put_, 因为之前手动加了写锁
-    for (auto &[k, v] : temp_map_) {
-      memtable.put_(k, v, tranc_id_);
-    }
-    memtable.put_("", "", tranc_id_);
+  for (auto &k : keys) {
+    commit_table.record_(k, commit_tranc_id);
   }
 
   isCommited = true;
-  tranManager_->add_ready_to_flush_tranc_id(tranc_id_, TransactionState::COMMITTED);
+  tranManager_->add_ready_to_flush_tranc_id(commit_tranc_id,
+                                            TransactionState::COMMITTED);
+  // 数据已经生效, 释放悲观事务持有的行锁
+  release_locks_();
 
   spdlog::info(
       "TranContext--commit(): Transaction ID={} committed successfully",
@@ -282,14 +498,23 @@ bool TranContext::abort() {
 
   if (isolation_level == IsolationLevel::READ_UNCOMMITTED) {
     // 需要手动恢复之前的更改
-    // TODO: 需要使用批量化操作优化性能
-    for (auto &[k, res] : rollback_map_) {
-      if (res.has_value()) {
-        engine_->put(k, res.value().first, res.value().second);
-      } else {
-        // 之前本就不存在, 需要移除当前事务的新增操作
-        engine_->remove(k, tranc_id_);
+    // 以当前 tranc_id 覆盖本事务写入的版本, 整个回滚只批量写入一次 memtable
+    std::vector<std::pair<std::string, std::string>> kvs;
+    kvs.reserve(rollback_keys_.size());
+    for (auto &k : rollback_keys_) {
+      auto latest = engine_->get_(k, 0);
+      if (!latest.has_value() || latest->second != tranc_id_) {
+        // 之后的写入已经覆盖了本事务的修改, 不需要回滚
+        continue;
       }
+      // 本事务之前的版本, 之前本就不存在或已删除时写入删除标记
+      // ! tranc_id 为 0 时表示忽略可见性, 不能用于查询
+      auto prev_record = tranc_id_ > 1 ? engine_->get_(k, tranc_id_ - 1)
+                                       : std::nullopt;
+      kvs.emplace_back(k, prev_record.has_value() ? prev_record->first : "");
+    }
+    if (!kvs.empty()) {
+      engine_->put_batch(kvs, tranc_id_);
     }
     isAborted = true;
     tranManager_->add_ready_to_flush_tranc_id(tranc_id_, TransactionState::ABORTED);
@@ -310,8 +535,12 @@ bool TranContext::abort() {
   //   throw std::runtime_error("write to wal failed");
   // }
 
+  if (ssi_txn_ != nullptr) {
+    tranManager_->get_serializable_tracker().abort(ssi_txn_);
+  }
   isAborted = true;
   tranManager_->add_ready_to_flush_tranc_id(tranc_id_, TransactionState::ABORTED);
+  release_locks_();
   return true;
 }
 
@@ -319,15 +548,23 @@ enum IsolationLevel TranContext::get_isolation_level() {
   return isolation_level_;
 }
 
+TrancMode TranContext::get_tranc_mode() { return tranc_mode_; }
+
 // *********************** TranManager ***********************
-TranManager::TranManager(std::string data_dir) : data_dir_(data_dir) {
+TranManager::TranManager(std::string data_dir)
+    : commit_table_(std::make_unique<CommitTable>(
+          TomlConfig::getInstance().getTrancCommitStripes(),
+          TomlConfig::getInstance().getTrancCommitHistory())),
+      serializable_tracker_(std::make_unique<SerializableTracker>()),
+      lock_manager_(std::make_unique<LockManager>(
+          TomlConfig::getInstance().getTrancLockStripes())),
+      data_dir_(data_dir) {
   auto file_path = get_tranc_id_file_path();
 
   // 判断文件是否存在
 
   if (!std::filesystem::exists(file_path)) {
     tranc_id_file_ = FileObj::open(file_path, true);
-    flushedTrancIds_.insert(0);
   } else {
     tranc_id_file_ = FileObj::open(file_path, false);
     read_tranc_id_file();
@@ -337,16 +574,30 @@ TranManager::TranManager(std::string data_dir) : data_dir_(data_dir) {
 void TranManager::init_new_wal() {
   spdlog::info("TranManager--init_new_wal(): Cleaning up old WAL files");
 
-  // TODO: 1 和 4096 应该统一用宏定义
   // 先清理掉所有 wal. 开头的文件, 因为其已经被重放过了
   for (const auto &entry : std::filesystem::directory_iterator(data_dir_)) {
     if (entry.path().filename().string().find("wal.") == 0) {
       std::filesystem::remove(entry.path());
     }
   }
-  wal = std::make_shared<WAL>(data_dir_, 128, get_max_flushed_tranc_id(), 1, 4096);
-  flushedTrancIds_.clear();
-  flushedTrancIds_.insert(nextTransactionId_.load() - 1);
+  auto &config = TomlConfig::getInstance();
+  wal = std::make_shared<WAL>(
+      data_dir_, config.getWalBufferSize(), get_max_flushed_tranc_id(), 1,
+      config.getWalFileSizeLimit(),
+      sync_mode_from_string(config.getWalSyncMode()),
+      config.getWalSyncIntervalMs(), config.getWalSyncBytes(),
+      config.getWalPreallocate(), config.getWalRecycleFileNum());
+  write_queue = std::make_shared<WriteQueue>(
+      [wal = wal](const std::vector<Record> &records, bool sync) {
+        wal->log(records, sync);
+      },
+      config.getWriteGroupMaxSize(), config.getWriteParallelApply());
+  {
+    // 恢复的数据已经全部刷盘, 之前的 tranc_id 都视为已刷盘
+    std::unique_lock lock(mutex_);
+    flushedTrancIds_.reset(nextTransactionId_.load() - 1);
+    write_tranc_id_file_();
+  }
   spdlog::info("TranManager--init_new_wal(): New WAL initialized");
 }
 
@@ -357,100 +608,299 @@ void TranManager::set_engine(std::shared_ptr<LSMEngine> engine) {
 TranManager::~TranManager() { write_tranc_id_file(); }
 
 void TranManager::write_tranc_id_file() {
-  // 共4个8字节的整型id记录
-  // std::atomic<uint64_t> nextTransactionId_;
-  // std::atomic<uint64_t> max_flushed_tranc_id_;
-  // std::atomic<uint64_t> checkpoint_tranc_id_;
+  std::unique_lock lock(mutex_);
+  write_tranc_id_file_();
+}
 
-  int buffer_size = sizeof(uint64_t) * (flushedTrancIds_.size() + 2);
-  std::vector<uint8_t> buf(buffer_size, 0);
+void TranManager::write_tranc_id_file_() {
+  // 文件格式:
+  // | nextTransactionId (64) | UINT64_MAX (64) | TrancIdSet | delta | delta ...|
+  // 旧版本第二个字段是 flushed 集合的大小, 以 UINT64_MAX 区分
+  // 每个 delta 是一次刷盘新增的 tranc_id:
+  // | count (64) | tranc_id (64) ... | hash (32) |
+  std::vector<uint8_t> buf(sizeof(uint64_t) * 2, 0);
   uint64_t nextTransactionId = nextTransactionId_.load();
-  uint64_t tranc_size = flushedTrancIds_.size();
+  uint64_t version_mark = UINT64_MAX;
   memcpy(buf.data(), &nextTransactionId, sizeof(uint64_t));
-  memcpy(buf.data() + sizeof(uint64_t), &tranc_size, sizeof(uint64_t));
-  int offset = sizeof(uint64_t) * 2;
-  for (auto& tranc_id : flushedTrancIds_) {
-    memcpy(buf.data() + offset, &tranc_id,
-         sizeof(uint64_t));
-    offset += sizeof(uint64_t);
-  }
+  memcpy(buf.data() + sizeof(uint64_t), &version_mark, sizeof(uint64_t));
+  flushedTrancIds_.encode(buf);
 
   tranc_id_file_.write(0, buf);
+  tranc_id_file_.truncate(buf.size());
   tranc_id_file_.sync();
+  tranc_id_snapshot_size_ = buf.size();
+  tranc_id_delta_size_ = 0;
+}
+
+void TranManager::append_tranc_id_delta_(const std::vector<uint64_t> &ids) {
+  if (ids.empty()) {
+    return;
+  }
+  // delta 过多时重写整个文件, 文件大小与未完成的 tranc_id 数量成正比
+  // 新建的文件还没有写入头部
+  if (tranc_id_snapshot_size_ == 0 ||
+      tranc_id_delta_size_ >
+          std::max<size_t>(tranc_id_snapshot_size_, 4096)) {
+    write_tranc_id_file_();
+    return;
+  }
+
+  std::vector<uint8_t> buf(sizeof(uint64_t) * (ids.size() + 1) +
+                           sizeof(uint32_t));
+  uint64_t count = ids.size();
+  memcpy(buf.data(), &count, sizeof(uint64_t));
+  memcpy(buf.data() + sizeof(uint64_t), ids.data(),
+         sizeof(uint64_t) * ids.size());
+  uint32_t hash = std::hash<std::string_view>{}(
+      std::string_view(reinterpret_cast<const char *>(buf.data()),
+                       buf.size() - sizeof(uint32_t)));
+  memcpy(buf.data() + buf.size() - sizeof(uint32_t), &hash, sizeof(uint32_t));
+  // 只写入操作系统, 不需要落盘: 文件落后时恢复只会多重放一些已经刷盘的 wal 记录
+  tranc_id_file_.append(buf);
+  tranc_id_file_.flush();
+  tranc_id_delta_size_ += buf.size();
 }
 
 void TranManager::read_tranc_id_file() {
+  auto file_size = tranc_id_file_.size();
+  if (file_size < sizeof(uint64_t) * 2) {
+    return;
+  }
   nextTransactionId_ = tranc_id_file_.read_uint64(0);
   uint64_t size = tranc_id_file_.read_uint64(sizeof(uint64_t));
-  int offset = sizeof(uint64_t) * 2;
-  for (int i = 0; i < size; i++) {
-    uint64_t flushed_id = tranc_id_file_.read_uint64(offset);
-    flushedTrancIds_.insert(flushed_id);
-    offset += sizeof(uint64_t);
+  if (size != UINT64_MAX) {
+    // 旧版本的格式, 第一个元素之前的 tranc_id 都已刷盘
+    std::vector<uint64_t> ids;
+    size_t offset = sizeof(uint64_t) * 2;
+    for (uint64_t i = 0; i < size; i++) {
+      ids.push_back(tranc_id_file_.read_uint64(offset));
+      offset += sizeof(uint64_t);
+    }
+    flushedTrancIds_.reset(ids.empty() ? 0 : ids.front());
+    for (auto tranc_id : ids) {
+      flushedTrancIds_.insert(tranc_id);
+    }
+    return;
+  }
+
+  auto buf = tranc_id_file_.read_to_slice(0, file_size);
+  size_t offset = sizeof(uint64_t) * 2;
+  size_t len =
+      flushedTrancIds_.decode(buf.data() + offset, buf.size() - offset);
+  if (len == 0) {
+    throw std::runtime_error("Invalid tranc_id file");
+  }
+  offset += len;
+  tranc_id_snapshot_size_ = offset;
+
+  // 依次应用 delta, 崩溃时最后一个可能不完整, 丢弃即可
+  while (offset + sizeof(uint64_t) <= buf.size()) {
+    uint64_t count;
+    memcpy(&count, buf.data() + offset, sizeof(uint64_t));
+    size_t remain = buf.size() - offset;
+    if (count > remain / sizeof(uint64_t) ||
+        sizeof(uint64_t) * (count + 1) + sizeof(uint32_t) > remain) {
+      break;
+    }
+    size_t body_len = sizeof(uint64_t) * (count + 1);
+    uint32_t stored_hash;
+    memcpy(&stored_hash, buf.data() + offset + body_len, sizeof(uint32_t));
+    uint32_t computed_hash = std::hash<std::string_view>{}(std::string_view(
+        reinterpret_cast<const char *>(buf.data() + offset), body_len));
+    if (stored_hash != computed_hash) {
+      break;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t tranc_id;
+      memcpy(&tranc_id,
+             buf.data() + offset + sizeof(uint64_t) * (i + 1),
+             sizeof(uint64_t));
+      flushedTrancIds_.insert(tranc_id);
+    }
+    offset += body_len + sizeof(uint32_t);
+  }
+  if (offset < buf.size()) {
+    tranc_id_file_.truncate(offset);
+  }
+  tranc_id_delta_size_ = offset - tranc_id_snapshot_size_;
+
+  // 崩溃时 nextTransactionId 没有写入, 不能小于已经刷盘的 tranc_id
+  if (nextTransactionId_.load() <= flushedTrancIds_.max()) {
+    nextTransactionId_ = flushedTrancIds_.max() + 1;
   }
 }
 
 void TranManager::add_ready_to_flush_tranc_id(uint64_t tranc_id, TransactionState state) {
   std::unique_lock lock(mutex_);
   readyToFlushTrancIds_[tranc_id] = state;
+
+  // 与加入 readyToFlushTrancIds_ 在同一个临界区中完成,
+  // 刷盘时不会把结束的事务误判为非事务写入
+  auto it = activeTrans_.find(tranc_id);
+  if (it != activeTrans_.end()) {
+    remove_snapshot_(it->second->snapshot_tranc_id_);
+    activeTrans_.erase(it);
+  }
 }
 
-void TranManager::add_flushed_tranc_id(uint64_t tranc_id) {
+uint64_t TranManager::assign_commit_tranc_id(uint64_t tranc_id) {
   std::unique_lock lock(mutex_);
-  std::vector<uint64_t> needRemove;
-  for (auto& [readyId, state] : readyToFlushTrancIds_) {
-    if(readyId < tranc_id && state == TransactionState::ABORTED) {
-      flushedTrancIds_.insert(readyId);
-      needRemove.push_back(readyId);
-    } else if(readyId == tranc_id) {
-      flushedTrancIds_.insert(readyId);
-      needRemove.push_back(readyId);
-      break;
+  auto commit_tranc_id = getNextTransactionId();
+  auto it = activeTrans_.find(tranc_id);
+  if (it != activeTrans_.end()) {
+    activeTrans_[commit_tranc_id] = it->second;
+    activeTrans_.erase(it);
+  }
+  // 原来的 tranc_id 没有写入任何数据, 与终止的事务一样处理
+  readyToFlushTrancIds_[tranc_id] = TransactionState::ABORTED;
+  return commit_tranc_id;
+}
+
+uint64_t TranManager::get_lock_owner_id() { return nextLockOwnerId_++; }
+
+std::shared_ptr<Snapshot> TranManager::get_snapshot() {
+  std::unique_lock lock(mutex_);
+  // 使用已经分配的最大 tranc_id, 之后分配的 tranc_id 对快照不可见
+  // 不分配新的 tranc_id, 否则它不会出现在任何表中, 阻塞已刷盘集合的低水位
+  auto tranc_id = nextTransactionId_.load() - 1;
+  if (tranc_id == 0) {
+    // tranc_id 为 0 表示读取最新版本, 还没有分配过时只能分配一个,
+    // 它不会写入任何数据, 直接视为已刷盘
+    tranc_id = getNextTransactionId();
+    flushedTrancIds_.insert(tranc_id);
+    if (wal != nullptr) {
+      append_tranc_id_delta_({tranc_id});
     }
   }
-  for (auto id : needRemove) {
-    readyToFlushTrancIds_.erase(id);
+  auto snapshot = std::make_shared<Snapshot>(tranc_id);
+  add_snapshot_(snapshot->get_tranc_id());
+  return snapshot;
+}
+
+void TranManager::release_snapshot(const std::shared_ptr<Snapshot> &snapshot) {
+  std::unique_lock lock(mutex_);
+  remove_snapshot_(snapshot->get_tranc_id());
+}
+
+uint64_t TranManager::oldest_visible_tranc_id() {
+  // 没有快照时, 已经分配的 tranc_id 都可见
+  return std::min(oldest_snapshot_.load(), nextTransactionId_.load() - 1);
+}
+
+void TranManager::add_snapshot_(uint64_t tranc_id) {
+  snapshots_.insert(tranc_id);
+  oldest_snapshot_ = *snapshots_.begin();
+}
+
+void TranManager::remove_snapshot_(uint64_t tranc_id) {
+  auto it = snapshots_.find(tranc_id);
+  if (it == snapshots_.end()) {
+    return;
+  }
+  snapshots_.erase(it);
+  oldest_snapshot_ = snapshots_.empty() ? UINT64_MAX : *snapshots_.begin();
+}
+
+void TranManager::add_flushed_tranc_ids(
+    const std::vector<uint64_t> &committed_ids,
+    const std::vector<uint64_t> &table_tranc_ids) {
+  if (committed_ids.empty() && table_tranc_ids.empty()) {
+    return;
+  }
+  std::unique_lock lock(mutex_);
+  // 本次新增的 tranc_id, 追加到 tranc_id 文件中
+  std::vector<uint64_t> delta;
+  auto add = [&](uint64_t tranc_id) {
+    if (flushedTrancIds_.insert(tranc_id)) {
+      delta.push_back(tranc_id);
+    }
+  };
+  uint64_t max_tranc_id = 0;
+  for (auto tranc_id : committed_ids) {
+    add(tranc_id);
+    readyToFlushTrancIds_.erase(tranc_id);
+    max_tranc_id = std::max(max_tranc_id, tranc_id);
+  }
+  for (auto tranc_id : table_tranc_ids) {
+    // 事务的数据可能分布在多张表中, 只能以完成标记为准
+    if (activeTrans_.count(tranc_id) ||
+        readyToFlushTrancIds_.count(tranc_id)) {
+      continue;
+    }
+    add(tranc_id);
+  }
+  // 更早结束的被终止事务没有需要恢复的数据, 一并视为已刷盘
+  for (auto it = readyToFlushTrancIds_.begin();
+       it != readyToFlushTrancIds_.end() && it->first < max_tranc_id;) {
+    if (it->second == TransactionState::ABORTED) {
+      add(it->first);
+      it = readyToFlushTrancIds_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // 恢复阶段结束后会整体重写, 不需要追加
+  if (wal != nullptr) {
+    append_tranc_id_delta_(delta);
+    // 不大于低水位的 tranc_id 都已刷盘, 对应的 wal 文件可以清理
+    wal->set_checkpoint_tranc_id(flushedTrancIds_.low_watermark());
   }
-  
-  flushedTrancIds_ = compressSet<uint64_t>(flushedTrancIds_);
 }
 
 uint64_t TranManager::getNextTransactionId() {
   return nextTransactionId_.fetch_add(1);
 }
 
-std::set<uint64_t>& TranManager::get_flushed_tranc_ids() {
+const TrancIdSet &TranManager::get_flushed_tranc_ids() {
   return flushedTrancIds_;
 }
 
 uint64_t TranManager::get_max_flushed_tranc_id() {
-  // 需保证 size 至少为1
-  return *flushedTrancIds_.rbegin();
+  return flushedTrancIds_.max();
 }
 
 uint64_t TranManager::get_checkpoint_tranc_id() {
-  // 需保证 size 至少为1
-  return *flushedTrancIds_.begin();
+  return flushedTrancIds_.low_watermark();
 }
 
 std::shared_ptr<TranContext>
-TranManager::new_tranc(const IsolationLevel &isolation_level) {
+TranManager::new_tranc(const IsolationLevel &isolation_level,
+                       TrancMode tranc_mode) {
   spdlog::debug("TranManager--new_tranc(): Creating new transaction with "
                 "isolation level={}",
                 static_cast<int>(isolation_level));
 
+  if (tranc_mode == TrancMode::PESSIMISTIC &&
+      isolation_level != IsolationLevel::READ_COMMITTED &&
+      isolation_level != IsolationLevel::REPEATABLE_READ) {
+    throw std::invalid_argument("pessimistic transactions only support "
+                                "READ_COMMITTED and REPEATABLE_READ");
+  }
+
   // 获取锁
   std::unique_lock<std::mutex> lock(mutex_);
 
   auto tranc_id = getNextTransactionId();
-  activeTrans_[tranc_id] = std::make_shared<TranContext>(
-      tranc_id, engine_, shared_from_this(), isolation_level);
+  auto tranc = std::make_shared<TranContext>(
+      tranc_id, engine_, shared_from_this(), isolation_level, tranc_mode);
+  activeTrans_[tranc_id] = tranc;
+  tranc->snapshot_tranc_id_ = tranc_id;
+  if (isolation_level == IsolationLevel::READ_UNCOMMITTED) {
+    // READ_UNCOMMITTED 回滚时需要读取本事务写入之前的版本
+    tranc->snapshot_tranc_id_ = tranc_id - 1;
+  } else if (isolation_level == IsolationLevel::SERIALIZABLE) {
+    tranc->ssi_txn_ = serializable_tracker_->begin(tranc_id);
+    // SERIALIZABLE 会跳过开始时仍未完成的事务的写入, 需要保留它们之前的版本
+    tranc->snapshot_tranc_id_ = activeTrans_.begin()->first - 1;
+  }
+  add_snapshot_(tranc->snapshot_tranc_id_);
 
   spdlog::debug("TranManager--new_tranc(): Created transaction ID={} with "
                 "isolation level={}",
                 tranc_id, static_cast<int>(isolation_level));
 
-  return activeTrans_[tranc_id];
+  return tranc;
 }
 std::string TranManager::get_tranc_id_file_path() {
   if (data_dir_.empty()) {
@@ -459,28 +909,51 @@ std::string TranManager::get_tranc_id_file_path() {
   return data_dir_ + "/tranc_id";
 }
 
-std::map<uint64_t, std::vector<Record>> TranManager::check_recover() {
+size_t
+TranManager::check_recover(const std::function<void(const Record &)> &replay) {
   spdlog::info("TranManager--check_recover(): Starting recovery from WAL");
 
-  std::map<uint64_t, std::vector<Record>> wal_records =
-      WAL::recover(data_dir_, *flushedTrancIds_.begin());
+  size_t record_count = 0;
+  size_t tranc_count = 0;
+  uint64_t max_tranc_id = 0;
+  WAL::recover(
+      data_dir_, flushedTrancIds_.low_watermark(),
+      [&](std::vector<Record> &records) {
+        for (auto &record : records) {
+          auto tranc_id = record.getTrancId();
+          max_tranc_id = std::max(max_tranc_id, tranc_id);
+          if (flushedTrancIds_.contains(tranc_id)) {
+            continue;
+          }
+          if (record.getOperationType() == OperationType::COMMIT) {
+            tranc_count++;
+          }
+          replay(record);
+          record_count++;
+        }
+      },
+      TomlConfig::getInstance().getWalRecoveryThreads());
+
+  // tranc_id 文件只在正常关闭时写入, 崩溃后其中的值可能落后于 wal
+  if (max_tranc_id >= nextTransactionId_.load()) {
+    nextTransactionId_ = max_tranc_id + 1;
+  }
 
-  spdlog::info("TranManager--check_recover(): Recovered {} transactions",
-               wal_records.size());
+  spdlog::info("TranManager--check_recover(): Recovered {} transactions ({} "
+               "records)",
+               tranc_count, record_count);
 
-  return wal_records;
+  return record_count;
 }
 
 bool TranManager::write_to_wal(const std::vector<Record> &records) {
   spdlog::trace("TranManager--write_to_wal(): Writing {} records to WAL",
                 records.size());
 
-  try {
-    wal->log(records, true);
-  } catch (const std::exception &e) {
-    spdlog::error("TranManager--write_to_wal(): Exception occurred: {}",
-                  e.what());
-
+  WriteQueue::Writer writer;
+  writer.records = records;
+  writer.sync = true;
+  if (!write(writer)) {
     return false;
   }
 
@@ -491,6 +964,24 @@ bool TranManager::write_to_wal(const std::vector<Record> &records) {
   return true;
 }
 
+CommitTable &TranManager::get_commit_table() { return *commit_table_; }
+
+LockManager &TranManager::get_lock_manager() { return *lock_manager_; }
+
+SerializableTracker &TranManager::get_serializable_tracker() {
+  return *serializable_tracker_;
+}
+
+bool TranManager::write(WriteQueue::Writer &writer) {
+  if (write_queue == nullptr) {
+    if (writer.apply) {
+      writer.apply();
+    }
+    return true;
+  }
+  return write_queue->write(writer);
+}
+
 // void TranManager::flusher() {
 //   while (flush_thread_running_.load()) {
 //     std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -0,0 +1,110 @@
+#include "../../include/lsm/write_batch.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace tiny_lsm {
+
+WriteBatch::WriteBatch() { clear(); }
+
+WriteBatch::WriteBatch(const std::string &data) : rep_(data) {
+  if (rep_.size() < sizeof(uint32_t)) {
+    throw std::runtime_error("Invalid write batch");
+  }
+  // 解析一遍, 校验格式
+  kvs();
+}
+
+void WriteBatch::append_u32(uint32_t value) {
+  rep_.append(reinterpret_cast<const char *>(&value), sizeof(uint32_t));
+}
+
+void WriteBatch::put(const std::string &key, const std::string &value) {
+  rep_.push_back(static_cast<char>(OpType::PUT));
+  append_u32(key.size());
+  rep_.append(key);
+  append_u32(value.size());
+  rep_.append(value);
+
+  uint32_t n = count() + 1;
+  memcpy(rep_.data(), &n, sizeof(uint32_t));
+}
+
+void WriteBatch::remove(const std::string &key) {
+  rep_.push_back(static_cast<char>(OpType::REMOVE));
+  append_u32(key.size());
+  rep_.append(key);
+
+  uint32_t n = count() + 1;
+  memcpy(rep_.data(), &n, sizeof(uint32_t));
+}
+
+void WriteBatch::clear() {
+  // std::string::clear 不释放容量, 复用时不需要重新申请内存
+  rep_.clear();
+  append_u32(0);
+}
+
+size_t WriteBatch::count() const {
+  uint32_t n;
+  memcpy(&n, rep_.data(), sizeof(uint32_t));
+  return n;
+}
+
+bool WriteBatch::empty() const { return count() == 0; }
+
+const std::string &WriteBatch::data() const { return rep_; }
+
+std::vector<std::pair<std::string, std::string>> WriteBatch::kvs() const {
+  std::vector<std::pair<std::string_view, std::string_view>> ops;
+  size_t n = count();
+  ops.reserve(n);
+
+  size_t offset = sizeof(uint32_t);
+  auto read_slice = [&]() {
+    uint32_t len;
+    if (offset + sizeof(uint32_t) > rep_.size()) {
+      throw std::runtime_error("Invalid write batch");
+    }
+    memcpy(&len, rep_.data() + offset, sizeof(uint32_t));
+    offset += sizeof(uint32_t);
+    if (len > rep_.size() - offset) {
+      throw std::runtime_error("Invalid write batch");
+    }
+    std::string_view slice(rep_.data() + offset, len);
+    offset += len;
+    return slice;
+  };
+  for (size_t i = 0; i < n; i++) {
+    if (offset >= rep_.size()) {
+      throw std::runtime_error("Invalid write batch");
+    }
+    auto type = static_cast<OpType>(rep_[offset++]);
+    auto key = read_slice();
+    if (type == OpType::PUT) {
+      ops.emplace_back(key, read_slice());
+    } else if (type == OpType::REMOVE) {
+      ops.emplace_back(key, std::string_view());
+    } else {
+      throw std::runtime_error("Invalid write batch");
+    }
+  }
+  if (offset != rep_.size()) {
+    throw std::runtime_error("Invalid write batch");
+  }
+
+  // 稳定排序后同一个 key 的最后一次操作排在最后
+  std::stable_sort(ops.begin(), ops.end(), [](const auto &a, const auto &b) {
+    return a.first < b.first;
+  });
+  std::vector<std::pair<std::string, std::string>> res;
+  res.reserve(ops.size());
+  for (size_t i = 0; i < ops.size(); i++) {
+    if (i + 1 < ops.size() && ops[i + 1].first == ops[i].first) {
+      continue;
+    }
+    res.emplace_back(ops[i].first, ops[i].second);
+  }
+  return res;
+}
+} // namespace tiny_lsm
@@ -0,0 +1,131 @@
+#include "../../include/lsm/write_queue.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <utility>
+
+namespace tiny_lsm {
+
+WriteQueue::WriteQueue(
+    std::function<void(const std::vector<Record> &, bool)> wal_writer,
+    size_t max_group_size, bool parallel_apply)
+    : wal_writer_(std::move(wal_writer)),
+      max_group_size_(std::max<size_t>(max_group_size, 1)),
+      parallel_apply_(parallel_apply) {}
+
+void WriteQueue::run_apply(Writer &writer) {
+  if (!writer.apply) {
+    return;
+  }
+  try {
+    writer.apply();
+  } catch (...) {
+    writer.error = std::current_exception();
+  }
+}
+
+bool WriteQueue::write(Writer &writer) {
+  if (writer.records.empty()) {
+    // 不写 wal 的写入者不需要排队, 直接写入 memtable
+    run_apply(writer);
+    if (writer.error) {
+      std::rethrow_exception(writer.error);
+    }
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  writers_.push_back(&writer);
+  writer.cv.wait(lock, [&] {
+    return writer.done || writer.apply_self ||
+           (!writers_.empty() && writers_.front() == &writer);
+  });
+
+  if (writer.done || writer.apply_self) {
+    // 作为 follower, wal 已经由 leader 写入
+    lock.unlock();
+    if (writer.apply_self) {
+      run_apply(writer);
+    }
+    if (writer.error) {
+      std::rethrow_exception(writer.error);
+    }
+    return writer.ok;
+  }
+
+  // 1. 成为 leader, 收集队列中等待的写入者
+  std::vector<Writer *> group;
+  for (auto w : writers_) {
+    if (group.size() >= max_group_size_) {
+      break;
+    }
+    group.push_back(w);
+  }
+  lock.unlock();
+
+  // 2. 整组的记录一次性写入 wal, 只要有一个写入者需要同步就同步
+  std::vector<Record> records;
+  bool sync = false;
+  for (auto w : group) {
+    records.insert(records.end(), w->records.begin(), w->records.end());
+    sync = sync || w->sync;
+  }
+  bool ok = true;
+  try {
+    wal_writer_(records, sync);
+  } catch (const std::exception &e) {
+    spdlog::error("WriteQueue--write(): Failed to write {} records to WAL: {}",
+                  records.size(), e.what());
+    ok = false;
+  }
+
+  // 3. 让出队首, 下一组可以开始写 wal
+  // leader 没有 apply 时可能持有 memtable 的锁, 不能代为写入其他人的记录
+  bool leader_applies = ok && !parallel_apply_ && writer.apply;
+  std::vector<Writer *> to_apply;
+  lock.lock();
+  for (size_t i = 0; i < group.size(); i++) {
+    writers_.pop_front();
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.notify_one();
+  }
+  for (auto w : group) {
+    if (w == &writer) {
+      continue;
+    }
+    w->ok = ok;
+    if (!ok || !w->apply) {
+      w->done = true;
+    } else if (leader_applies) {
+      to_apply.push_back(w);
+      continue;
+    } else {
+      w->apply_self = true;
+    }
+    w->cv.notify_one();
+  }
+  lock.unlock();
+
+  // 4. 写入 memtable
+  writer.ok = ok;
+  if (ok) {
+    run_apply(writer);
+  }
+  if (!to_apply.empty()) {
+    for (auto w : to_apply) {
+      run_apply(*w);
+    }
+    lock.lock();
+    for (auto w : to_apply) {
+      w->done = true;
+      w->cv.notify_one();
+    }
+    lock.unlock();
+  }
+
+  if (writer.error) {
+    std::rethrow_exception(writer.error);
+  }
+  return ok;
+}
+} // namespace tiny_lsm
@@ -0,0 +1,75 @@
+#include "../../include/memtable/batch_visibility.h"
+
+namespace tiny_lsm {
+
+BatchVisibility::Reader::Reader(BatchVisibility &visibility, bool snapshot)
+    : visibility_(visibility), snapshot_(snapshot), seq_(UINT64_MAX) {
+  if (!snapshot_) {
+    return;
+  }
+  // 快照登记后, 之后发布的批次会一直保留到读者结束
+  std::lock_guard<std::mutex> lock(visibility_.mtx_);
+  seq_ = visibility_.published_seq_;
+  visibility_.reader_seqs_.insert(seq_);
+}
+
+BatchVisibility::Reader::~Reader() {
+  if (!snapshot_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(visibility_.mtx_);
+  visibility_.reader_seqs_.erase(visibility_.reader_seqs_.find(seq_));
+  visibility_.prune_();
+}
+
+bool BatchVisibility::Reader::visible(uint64_t tranc_id) {
+  // 批次在写入第一条记录之前登记, 读到记录之后再判断不会漏掉
+  if (visibility_.batch_count_.load(std::memory_order_acquire) == 0) {
+    return true;
+  }
+  auto it = cache_.find(tranc_id);
+  if (it != cache_.end()) {
+    return it->second;
+  }
+  bool res;
+  {
+    std::lock_guard<std::mutex> lock(visibility_.mtx_);
+    res = visibility_.visible_(tranc_id, seq_);
+  }
+  cache_.emplace(tranc_id, res);
+  return res;
+}
+
+void BatchVisibility::begin(uint64_t tranc_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  batch_seqs_[tranc_id] = 0;
+  batch_count_.store(batch_seqs_.size(), std::memory_order_release);
+}
+
+void BatchVisibility::publish(uint64_t tranc_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto seq = ++published_seq_;
+  batch_seqs_[tranc_id] = seq;
+  published_[seq] = tranc_id;
+  prune_();
+}
+
+bool BatchVisibility::visible_(uint64_t tranc_id, uint64_t seq) const {
+  auto it = batch_seqs_.find(tranc_id);
+  if (it == batch_seqs_.end()) {
+    // 不是批次写入, 或者已经对所有快照可见
+    return true;
+  }
+  return it->second != 0 && it->second <= seq;
+}
+
+void BatchVisibility::prune_() {
+  uint64_t oldest =
+      reader_seqs_.empty() ? published_seq_ : *reader_seqs_.begin();
+  while (!published_.empty() && published_.begin()->first <= oldest) {
+    batch_seqs_.erase(published_.begin()->second);
+    published_.erase(published_.begin());
+  }
+  batch_count_.store(batch_seqs_.size(), std::memory_order_release);
+}
+} // namespace tiny_lsm
@@ -4,6 +4,7 @@
 #include "../../include/iterator/iterator.h"
 #include "../../include/skiplist/skiplist.h"
 #include "../../include/sst/sst.h"
+#include "../../include/utils/prefix_extractor.h"
 #include "spdlog/spdlog.h"
 #include <algorithm>
 #include <cstddef>
@@ -20,11 +21,18 @@ namespace tiny_lsm {
 class BlockCache;
 
 // MemTable implementation using PIMPL idiom
-MemTable::MemTable() : frozen_bytes(0) {
-  current_table = std::make_shared<SkipList>();
-}
+MemTable::MemTable() : frozen_bytes(0) { current_table = create_table(); }
 MemTable::~MemTable() = default;
 
+std::shared_ptr<MemTableRep> MemTable::create_table() {
+  auto table = MemTableRep::from_config();
+  auto &config = TomlConfig::getInstance();
+  auto num_bits = static_cast<size_t>(config.getLsmPerMemSizeLimit() * 8 *
+                                      config.getMemtablePrefixBloomSizeRatio());
+  table->enable_prefix_bloom(PrefixExtractor::from_config(), num_bits);
+  return table;
+}
+
 void MemTable::put_(const std::string &key, const std::string &value,
                     uint64_t tranc_id) {
   current_table->put(key, value, tranc_id);
@@ -34,16 +42,12 @@ void MemTable::put(const std::string &key, const std::string &value,
                    uint64_t tranc_id) {
   spdlog::trace("MemTable--put({}, {}, {}) called", key, value, tranc_id);
 
-  std::unique_lock<std::shared_mutex> lock1(cur_mtx);
-  put_(key, value, tranc_id);
-  if (current_table->get_size() >
-      TomlConfig::getInstance().getLsmPerMemSizeLimit()) {
-    // 冻结当前表还需要获取frozen_mtx的写锁
-    std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
-    frozen_cur_table_();
-    spdlog::debug("MemTable--Current table size exceeded limit. Frozen and "
-                  "created new table.");
+  {
+    // 跳表支持并发插入, 只需要读锁保证活跃表在写入期间不会被替换
+    std::shared_lock<std::shared_mutex> slock(cur_mtx);
+    put_(key, value, tranc_id);
   }
+  frozen_cur_table_if_full();
 }
 
 void MemTable::put_batch(
@@ -51,24 +55,47 @@ void MemTable::put_batch(
     uint64_t tranc_id) {
   spdlog::trace("MemTable--put_batch with {} keys", kvs.size());
 
-  std::unique_lock<std::shared_mutex> lock1(cur_mtx);
-  for (auto &[k, v] : kvs) {
-    put_(k, v, tranc_id);
+  // 多个 key 的批次写入前登记, 全部写入后发布, 读者不会看到写了一半的批次
+  // 只涉及一个 key 的批次 (事务的完成标记对读者不可见) 不需要登记
+  size_t visible = std::count_if(kvs.begin(), kvs.end(), [](const auto &kv) {
+    return !kv.first.empty();
+  });
+  bool track = visible > 1 && tranc_id != 0;
+  {
+    std::shared_lock<std::shared_mutex> slock(cur_mtx);
+    if (track) {
+      batch_visibility.begin(tranc_id);
+    }
+    for (auto &[k, v] : kvs) {
+      put_(k, v, tranc_id);
+    }
+    if (track) {
+      batch_visibility.publish(tranc_id);
+    }
   }
-  if (current_table->get_size() >
-      TomlConfig::getInstance().getLsmPerMemSizeLimit()) {
-    // 冻结当前表还需要获取frozen_mtx的写锁
-    std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
-    frozen_cur_table_();
+  frozen_cur_table_if_full();
+}
 
-    spdlog::debug("MemTable--Current table size exceeded limit after batch "
-                  "put. Frozen and created new table.");
+// 查询 table 中对 reader 可见的最新版本
+// 未发布的批次写入的版本不可见, 继续查找 tranc_id 更小的版本
+static SkipListIterator visible_get(MemTableRep &table, const std::string &key,
+                                    uint64_t tranc_id,
+                                    BatchVisibility::Reader &reader) {
+  auto result = table.get(key, tranc_id);
+  while (result.is_valid() && !reader.visible(result.get_tranc_id())) {
+    // 登记的批次 tranc_id 不为 0, 查询 0 表示最新版本, 不能再向前查找
+    if (result.get_tranc_id() <= 1) {
+      return SkipListIterator{};
+    }
+    result = table.get(key, result.get_tranc_id() - 1);
   }
+  return result;
 }
 
-SkipListIterator MemTable::cur_get_(const std::string &key, uint64_t tranc_id) {
+SkipListIterator MemTable::cur_get_(const std::string &key, uint64_t tranc_id,
+                                    BatchVisibility::Reader &reader) {
   // 检查当前活跃的memtable
-  auto result = current_table->get(key, tranc_id);
+  auto result = visible_get(*current_table, key, tranc_id, reader);
   if (result.is_valid()) {
     // 只要找到了 key, 不管 value 是否为空都返回
     return result;
@@ -79,10 +106,11 @@ SkipListIterator MemTable::cur_get_(const std::string &key, uint64_t tranc_id) {
 }
 
 SkipListIterator MemTable::frozen_get_(const std::string &key,
-                                       uint64_t tranc_id) {
+                                       uint64_t tranc_id,
+                                       BatchVisibility::Reader &reader) {
   // 检查frozen memtable
   for (auto &tabe : frozen_tables) {
-    auto result = tabe->get(key, tranc_id);
+    auto result = visible_get(*tabe, key, tranc_id, reader);
     if (result.is_valid()) {
       return result;
     }
@@ -95,16 +123,19 @@ SkipListIterator MemTable::frozen_get_(const std::string &key,
 SkipListIterator MemTable::get(const std::string &key, uint64_t tranc_id) {
   spdlog::trace("MemTable--get({}) called", key);
 
+  // 只读取一个 key, 跳过未发布的批次即可, 不需要登记快照
+  BatchVisibility::Reader reader(batch_visibility, false);
+
   // 先获取当前活跃表的锁
   std::shared_lock<std::shared_mutex> slock1(cur_mtx);
-  auto cur_res = cur_get_(key, tranc_id);
+  auto cur_res = cur_get_(key, tranc_id, reader);
   if (cur_res.is_valid()) {
     return cur_res;
   }
   // 活跃表没有找到，再获取冻结表的锁
   slock1.unlock();
   std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
-  auto frozen_result = frozen_get_(key, tranc_id);
+  auto frozen_result = frozen_get_(key, tranc_id, reader);
   if (frozen_result.is_valid()) {
     return frozen_result;
   }
@@ -117,12 +148,13 @@ SkipListIterator MemTable::get(const std::string &key, uint64_t tranc_id) {
 SkipListIterator MemTable::get_(const std::string &key, uint64_t tranc_id) {
   spdlog::trace("MemTable--get_({}) called", key);
 
-  auto cur_res = cur_get_(key, tranc_id);
+  BatchVisibility::Reader reader(batch_visibility, false);
+  auto cur_res = cur_get_(key, tranc_id, reader);
   if (cur_res.is_valid()) {
     return cur_res;
   }
 
-  auto frozen_result = frozen_get_(key, tranc_id);
+  auto frozen_result = frozen_get_(key, tranc_id, reader);
   if (frozen_result.is_valid()) {
     return frozen_result;
   }
@@ -138,12 +170,14 @@ MemTable::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
       std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
       results;
   results.reserve(keys.size());
+  // 所有 key 使用同一个快照, 不会读到批次的一部分
+  BatchVisibility::Reader reader(batch_visibility, true);
 
   // 1. 先获取活跃表的锁
   std::shared_lock<std::shared_mutex> slock1(cur_mtx);
   for (size_t idx = 0; idx < keys.size(); idx++) {
     auto key = keys[idx];
-    auto cur_res = cur_get_(key, tranc_id);
+    auto cur_res = cur_get_(key, tranc_id, reader);
     if (cur_res.is_valid()) {
       // 值存在且不为空
       results.emplace_back(
@@ -169,7 +203,7 @@ MemTable::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
       continue; // 如果在活跃表中已经找到，则跳过
     }
     auto key = keys[idx];
-    auto frozen_result = frozen_get_(key, tranc_id);
+    auto frozen_result = frozen_get_(key, tranc_id, reader);
     if (frozen_result.is_valid()) {
       // 值存在且不为空
       results[idx] =
@@ -193,31 +227,31 @@ void MemTable::remove_(const std::string &key, uint64_t tranc_id) {
 void MemTable::remove(const std::string &key, uint64_t tranc_id) {
   spdlog::trace("MemTable--remove({}) called", key);
 
-  std::unique_lock<std::shared_mutex> lock(cur_mtx);
-  remove_(key, tranc_id);
-  if (current_table->get_size() >
-      TomlConfig::getInstance().getLsmPerMemSizeLimit()) {
-    // 冻结当前表还需要获取frozen_mtx的写锁
-    std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
-    frozen_cur_table_();
-    spdlog::debug("MemTable--Current table size exceeded limit after remove. "
-                  "Frozen and created new table.");
+  {
+    std::shared_lock<std::shared_mutex> slock(cur_mtx);
+    remove_(key, tranc_id);
   }
+  frozen_cur_table_if_full();
 }
 
 void MemTable::remove_batch(const std::vector<std::string> &keys,
                             uint64_t tranc_id) {
-  std::unique_lock<std::shared_mutex> lock(cur_mtx);
-  // 删除的方式是写入空值
-  for (auto &key : keys) {
-    remove_(key, tranc_id);
-  }
-  if (current_table->get_size() >
-      TomlConfig::getInstance().getLsmPerMemSizeLimit()) {
-    // 冻结当前表还需要获取frozen_mtx的写锁
-    std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
-    frozen_cur_table_();
+  // 与 put_batch 相同, 多个 key 的批次全部写入后才对读者可见
+  bool track = keys.size() > 1 && tranc_id != 0;
+  {
+    std::shared_lock<std::shared_mutex> slock(cur_mtx);
+    if (track) {
+      batch_visibility.begin(tranc_id);
+    }
+    // 删除的方式是写入空值
+    for (auto &key : keys) {
+      remove_(key, tranc_id);
+    }
+    if (track) {
+      batch_visibility.publish(tranc_id);
+    }
   }
+  frozen_cur_table_if_full();
 }
 
 void MemTable::clear() {
@@ -233,11 +267,15 @@ void MemTable::clear() {
 std::shared_ptr<SST>
 MemTable::flush_last(SSTBuilder &builder, std::string &sst_path, size_t sst_id,
                      std::vector<uint64_t> &flushed_tranc_ids,
-                     std::shared_ptr<BlockCache> block_cache) {
+                     std::vector<uint64_t> &table_tranc_ids,
+                     std::shared_ptr<BlockCache> block_cache,
+                     uint64_t oldest_tranc_id) {
   spdlog::debug("MemTable--flush_last(): Starting to flush memtable to SST{}",
                 sst_id);
 
   // 由于 flush 后需要移除最老的 memtable, 因此需要加写锁
+  // 没有冻结表时需要冻结活跃表, 按照 cur_mtx -> frozen_mtx 的顺序加锁
+  std::unique_lock<std::shared_mutex> cur_lock(cur_mtx);
   std::unique_lock<std::shared_mutex> lock(frozen_mtx);
 
   uint64_t max_tranc_id = 0;
@@ -252,27 +290,47 @@ MemTable::flush_last(SSTBuilder &builder, std::string &sst_path, size_t sst_id,
       return nullptr;
     }
     // 将当前表加入到frozen_tables头部
+    current_table->freeze();
     frozen_tables.push_front(current_table);
     frozen_bytes += current_table->get_size();
     // 创建新的空表作为当前表
-    current_table = std::make_shared<SkipList>();
+    current_table = create_table();
   }
+  // 之后只涉及冻结表, 不再阻塞活跃表的写入
+  cur_lock.unlock();
 
   // 将最老的 memtable 写入 SST
-  std::shared_ptr<SkipList> table = frozen_tables.back();
+  std::shared_ptr<MemTableRep> table = frozen_tables.back();
   frozen_tables.pop_back();
   frozen_bytes -= table->get_size();
 
   std::vector<std::tuple<std::string, std::string, uint64_t>> flush_data =
       table->flush();
+  // 数据按 key 升序, 同一个 key 按 tranc_id 降序排列
+  const std::string *settled_key = nullptr;
   for (auto &[k, v, t] : flush_data) {
     if (k == "" && v == "") {
       flushed_tranc_ids.push_back(t);
     }
+    if (table_tranc_ids.empty() || table_tranc_ids.back() != t) {
+      table_tranc_ids.push_back(t);
+    }
     max_tranc_id = std::max(t, max_tranc_id);
     min_tranc_id = std::min(t, min_tranc_id);
+
+    if (settled_key != nullptr && *settled_key == k) {
+      // 已经写入了所有读者都可见的版本, 更早的版本不会再被读取
+      continue;
+    }
+    if (t <= oldest_tranc_id) {
+      settled_key = &k;
+    }
     builder.add(k, v, t);
   }
+  std::sort(table_tranc_ids.begin(), table_tranc_ids.end());
+  table_tranc_ids.erase(
+      std::unique(table_tranc_ids.begin(), table_tranc_ids.end()),
+      table_tranc_ids.end());
   auto sst = builder.build(sst_id, sst_path, block_cache);
 
   spdlog::info("MemTable--flush_last(): SST{} built successfully at '{}'",
@@ -284,9 +342,27 @@ MemTable::flush_last(SSTBuilder &builder, std::string &sst_path, size_t sst_id,
 void MemTable::frozen_cur_table_() {
   spdlog::trace("MemTable--frozen_cur_table_(): Freezing current table");
 
+  current_table->freeze();
   frozen_bytes += current_table->get_size();
   frozen_tables.push_front(std::move(current_table));
-  current_table = std::make_shared<SkipList>();
+  current_table = create_table();
+}
+
+void MemTable::frozen_cur_table_if_full() {
+  auto limit = TomlConfig::getInstance().getLsmPerMemSizeLimit();
+  if (get_cur_size() <= limit) {
+    return;
+  }
+
+  // 替换活跃表需要 cur_mtx 的写锁, 冻结当前表还需要获取frozen_mtx的写锁
+  std::unique_lock<std::shared_mutex> lock1(cur_mtx);
+  // 等待写锁期间活跃表可能已经被其他线程冻结了
+  if (current_table->get_size() > limit) {
+    std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
+    frozen_cur_table_();
+    spdlog::debug("MemTable--Current table size exceeded limit. Frozen and "
+                  "created new table.");
+  }
 }
 
 void MemTable::frozen_cur_table() {
@@ -311,34 +387,47 @@ size_t MemTable::get_frozen_size() {
 size_t MemTable::get_total_size() {
   std::shared_lock<std::shared_mutex> slock1(cur_mtx);
   std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
-  return get_frozen_size() + get_cur_size();
+  // 已经持有两把锁, 不能再调用会重复加锁的 get_frozen_size / get_cur_size
+  return frozen_bytes + current_table->get_size();
+}
+
+void MemTable::collect_items(
+    MemTableRep &table, int table_idx, uint64_t tranc_id,
+    const std::function<int(const std::string &)> &predicate,
+    BatchVisibility::Reader &reader, std::vector<SearchItem> &item_vec) {
+  size_t start = item_vec.size();
+  table.scan(predicate, [&](const SkipListIterator &iter) {
+    if (tranc_id != 0 && iter.get_tranc_id() > tranc_id) {
+      // 如果开启了事务, 比当前事务 id 更大的记录是不可见的
+      return;
+    }
+    if (!reader.visible(iter.get_tranc_id())) {
+      // 快照之后才发布的批次不可见, 继续查找更早的版本
+      return;
+    }
+    if (item_vec.size() > start && item_vec.back().key_ == iter.get_key()) {
+      // 同一个 key 的版本是连续访问的, 只保留最新的事务修改的记录即可
+      // 且这个记录既然已经存在于item_vec中，则其肯定满足了事务的可见性判断
+      return;
+    }
+    item_vec.emplace_back(iter.get_key(), iter.get_value(), table_idx, 0,
+                          iter.get_tranc_id());
+  });
 }
 
 // TODO: 需要进一步判断这里的 HeapIterator 能否跳过删除元素
 HeapIterator MemTable::begin(uint64_t tranc_id) {
+  // 所有表使用同一个快照, 不会读到批次的一部分
+  BatchVisibility::Reader reader(batch_visibility, true);
   std::shared_lock<std::shared_mutex> slock1(cur_mtx);
   std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
   std::vector<SearchItem> item_vec;
 
-  for (auto iter = current_table->begin(); iter != current_table->end();
-       ++iter) {
-    if (tranc_id != 0 && iter.get_tranc_id() > tranc_id) {
-      continue;
-    }
-    item_vec.emplace_back(iter.get_key(), iter.get_value(), 0, 0,
-                          iter.get_tranc_id());
-  }
+  collect_items(*current_table, 0, tranc_id, nullptr, reader, item_vec);
 
   int table_idx = 1;
-  for (auto ft = frozen_tables.begin(); ft != frozen_tables.end(); ft++) {
-    auto table = *ft;
-    for (auto iter = table->begin(); iter != table->end(); ++iter) {
-      if (tranc_id != 0 && iter.get_tranc_id() > tranc_id) {
-        continue;
-      }
-      item_vec.emplace_back(iter.get_key(), iter.get_value(), table_idx, 0,
-                            iter.get_tranc_id());
-    }
+  for (auto &table : frozen_tables) {
+    collect_items(*table, table_idx, tranc_id, nullptr, reader, item_vec);
     table_idx++;
   }
 
@@ -356,46 +445,28 @@ HeapIterator MemTable::iters_preffix(const std::string &preffix,
   spdlog::trace("MemTable--iters_preffix('{}', tranc_id={})", preffix,
                 tranc_id);
 
+  BatchVisibility::Reader reader(batch_visibility, true);
   std::shared_lock<std::shared_mutex> slock1(cur_mtx);
   std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
   std::vector<SearchItem> item_vec;
 
-  for (auto iter = current_table->begin_preffix(preffix);
-       iter != current_table->end_preffix(preffix); ++iter) {
-    if (tranc_id != 0 && iter.get_tranc_id() > tranc_id) {
-      // 如果开启了事务, 比当前事务 id 更大的记录是不可见的
-      continue;
-    }
-    if (!item_vec.empty() && item_vec.back().key_ == iter.get_key()) {
-      // 如果key相同，则只保留最新的事务修改的记录即可
-      // 且这个记录既然已经存在于item_vec中，则其肯定满足了事务的可见性判断
-      continue;
+  // 前缀匹配是单调谓词: 小于前缀的 key 在左侧, 大于前缀且不匹配的 key 在右侧
+  auto predicate = [&preffix](const std::string &key) {
+    if (key.starts_with(preffix)) {
+      return 0;
     }
-    item_vec.emplace_back(iter.get_key(), iter.get_value(), 0, 0,
-                          iter.get_tranc_id());
+    return key < preffix ? 1 : -1;
+  };
 
-    spdlog::trace("MemTable--iters_preffix(): get range from curent table");
+  // 前缀布隆过滤器判定不存在该前缀时跳过该表
+  if (current_table->may_contain_preffix(preffix)) {
+    collect_items(*current_table, 0, tranc_id, predicate, reader, item_vec);
   }
 
   int table_idx = 1;
-  for (auto ft = frozen_tables.begin(); ft != frozen_tables.end(); ft++) {
-    auto table = *ft;
-    for (auto iter = table->begin_preffix(preffix);
-         iter != table->end_preffix(preffix); ++iter) {
-      if (tranc_id != 0 && iter.get_tranc_id() > tranc_id) {
-        // 如果开启了事务, 比当前事务 id 更大的记录是不可见的
-        continue;
-      }
-      if (!item_vec.empty() && item_vec.back().key_ == iter.get_key()) {
-        // 如果key相同，则只保留最新的事务修改的记录即可
-        // 且这个记录既然已经存在于item_vec中，则其肯定满足了事务的可见性判断
-        continue;
-      }
-      item_vec.emplace_back(iter.get_key(), iter.get_value(), table_idx, 0,
-                            iter.get_tranc_id());
-
-      spdlog::trace("MemTable--iters_preffix(): get range from table{}",
-                    table_idx);
+  for (auto &table : frozen_tables) {
+    if (table->may_contain_preffix(preffix)) {
+      collect_items(*table, table_idx, tranc_id, predicate, reader, item_vec);
     }
     table_idx++;
   }
@@ -405,59 +476,25 @@ HeapIterator MemTable::iters_preffix(const std::string &preffix,
 
 std::optional<std::pair<HeapIterator, HeapIterator>>
 MemTable::iters_monotony_predicate(
-    uint64_t tranc_id, std::function<int(const std::string &)> predicate) {
+    uint64_t tranc_id, std::function<int(const std::string &)> predicate,
+    const std::string &preffix) {
   spdlog::trace("MemTable--iters_monotony_predicate(tranc_id={}) called",
                 tranc_id);
 
+  BatchVisibility::Reader reader(batch_visibility, true);
   std::shared_lock<std::shared_mutex> slock1(cur_mtx);
   std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
 
   std::vector<SearchItem> item_vec;
 
-  auto cur_result = current_table->iters_monotony_predicate(predicate);
-  if (cur_result.has_value()) {
-    auto [begin, end] = cur_result.value();
-    for (auto iter = begin; iter != end; ++iter) {
-      if (tranc_id != 0 && iter.get_tranc_id() > tranc_id) {
-        // 如果开启了事务, 比当前事务 id 更大的记录是不可见的
-        continue;
-      }
-      if (!item_vec.empty() && item_vec.back().key_ == iter.get_key()) {
-        // 如果key相同，则只保留最新的事务修改的记录即可
-        // 且这个记录既然已经存在于item_vec中，则其肯定满足了事务的可见性判断
-        continue;
-      }
-      item_vec.emplace_back(iter.get_key(), iter.get_value(), 0, 0,
-                            iter.get_tranc_id());
-
-      spdlog::trace(
-          "MemTable--iters_monotony_predicate(): get range from curent table");
-    }
+  if (preffix.empty() || current_table->may_contain_preffix(preffix)) {
+    collect_items(*current_table, 0, tranc_id, predicate, reader, item_vec);
   }
 
   int table_idx = 1;
-  for (auto ft = frozen_tables.begin(); ft != frozen_tables.end(); ft++) {
-    auto table = *ft;
-    auto result = table->iters_monotony_predicate(predicate);
-    if (result.has_value()) {
-      auto [begin, end] = result.value();
-      for (auto iter = begin; iter != end; ++iter) {
-        if (tranc_id != 0 && iter.get_tranc_id() > tranc_id) {
-          // 如果开启了事务, 比当前事务 id 更大的记录是不可见的
-          continue;
-        }
-        if (!item_vec.empty() && item_vec.back().key_ == iter.get_key()) {
-          // 如果key相同，则只保留最新的事务修改的记录即可
-          // 且这个记录既然已经存在于item_vec中，则其肯定满足了事务的可见性判断
-          continue;
-        }
-        item_vec.emplace_back(iter.get_key(), iter.get_value(), table_idx, 0,
-                              iter.get_tranc_id());
-      }
-
-      spdlog::trace(
-          "MemTable--iters_monotony_predicate(): get range from table{}",
-          table_idx);
+  for (auto &table : frozen_tables) {
+    if (preffix.empty() || table->may_contain_preffix(preffix)) {
+      collect_items(*table, table_idx, tranc_id, predicate, reader, item_vec);
     }
     table_idx++;
   }
@@ -0,0 +1,367 @@
+#include "../../include/memtable/memtable_rep.h"
+#include "../../include/config/config.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <limits>
+
+namespace tiny_lsm {
+
+// 查询 key 的最新版本时使用的事务 id, 排在同一个 key 的所有版本之前
+static constexpr uint64_t LATEST_TRANC_ID = std::numeric_limits<uint64_t>::max();
+
+// 哈希桶中的跳表数据量较小, 使用较低的最大层数
+static constexpr int HASH_BUCKET_MAX_LEVEL = 12;
+
+// 排序规则与跳表相同: key 升序, key 相同时 tranc_id 降序
+static bool entry_less(const SkipListNode *a, const SkipListNode *b) {
+  int cmp = a->key().compare(b->key());
+  if (cmp == 0) {
+    return a->tranc_id_ > b->tranc_id_;
+  }
+  return cmp < 0;
+}
+
+static void scan_skiplist(
+    SkipList &table, const std::function<int(const std::string &)> &predicate,
+    const std::function<void(const SkipListIterator &)> &visitor) {
+  if (!predicate) {
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+      visitor(iter);
+    }
+    return;
+  }
+  auto result = table.iters_monotony_predicate(predicate);
+  if (!result.has_value()) {
+    return;
+  }
+  auto [begin, end] = result.value();
+  for (auto iter = begin; iter != end; ++iter) {
+    visitor(iter);
+  }
+}
+
+// ************************ MemTableRep ************************
+void MemTableRep::enable_prefix_bloom(
+    std::shared_ptr<const PrefixExtractor> extractor, size_t num_bits) {
+  if (extractor == nullptr || num_bits == 0) {
+    return;
+  }
+  prefix_extractor = std::move(extractor);
+  // 按照每个前缀 10 位估算能容纳的前缀数量
+  prefix_bloom = std::make_shared<BloomFilter>(std::max<size_t>(num_bits / 10, 1),
+                                               0.01, num_bits);
+}
+
+bool MemTableRep::may_contain_preffix(const std::string &preffix) const {
+  if (prefix_bloom == nullptr) {
+    return true;
+  }
+  auto query = prefix_extractor->query_prefix(preffix);
+  if (!query.has_value()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(prefix_bloom_mtx);
+  return prefix_bloom->possibly_contains(query.value());
+}
+
+void MemTableRep::add_prefix(const std::string &key) {
+  if (prefix_bloom != nullptr && prefix_extractor->in_domain(key)) {
+    std::lock_guard<std::mutex> lock(prefix_bloom_mtx);
+    prefix_bloom->add(prefix_extractor->transform(key));
+  }
+}
+
+void MemTableRep::clear_prefix_bloom() {
+  if (prefix_bloom != nullptr) {
+    std::lock_guard<std::mutex> lock(prefix_bloom_mtx);
+    prefix_bloom->clear();
+  }
+}
+
+std::shared_ptr<MemTableRep> MemTableRep::from_config() {
+  auto &config = TomlConfig::getInstance();
+  const auto &type = config.getMemtableRep();
+  if (type == "hash_skiplist") {
+    return std::make_shared<HashSkipListRep>(
+        config.getMemtableHashBucketCount());
+  }
+  if (type == "vector") {
+    return std::make_shared<VectorRep>();
+  }
+  if (type != "skiplist") {
+    spdlog::warn("MemTableRep--Unknown memtable rep '{}', using skiplist",
+                 type);
+  }
+  return std::make_shared<SkipListRep>();
+}
+
+// ************************ SkipListRep ************************
+SkipListRep::SkipListRep() = default;
+
+void SkipListRep::put(const std::string &key, const std::string &value,
+                      uint64_t tranc_id) {
+  add_prefix(key);
+  table.put(key, value, tranc_id);
+}
+
+SkipListIterator SkipListRep::get(const std::string &key, uint64_t tranc_id) {
+  return table.get(key, tranc_id);
+}
+
+void SkipListRep::scan(
+    const std::function<int(const std::string &)> &predicate,
+    const std::function<void(const SkipListIterator &)> &visitor) {
+  scan_skiplist(table, predicate, visitor);
+}
+
+std::vector<std::tuple<std::string, std::string, uint64_t>>
+SkipListRep::flush() {
+  return table.flush();
+}
+
+size_t SkipListRep::get_size() { return table.get_size(); }
+
+void SkipListRep::clear() {
+  table.clear();
+  clear_prefix_bloom();
+}
+
+// ************************ HashSkipListRep ************************
+HashSkipListRep::HashSkipListRep(size_t bucket_count)
+    : bucket_count_(std::max<size_t>(bucket_count, 1)) {
+  reset();
+}
+
+HashSkipListRep::~HashSkipListRep() {
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    delete buckets_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void HashSkipListRep::reset() {
+  arena_ = std::make_shared<Arena>();
+  buckets_ = std::make_unique<std::atomic<SkipList *>[]>(bucket_count_);
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    buckets_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+SkipList *HashSkipListRep::get_bucket(const std::string &key, bool create) {
+  auto &bucket = buckets_[std::hash<std::string>{}(key) % bucket_count_];
+  auto table = bucket.load(std::memory_order_acquire);
+  if (table != nullptr || !create) {
+    return table;
+  }
+
+  std::lock_guard<std::mutex> lock(create_mtx_);
+  // 等待锁期间其他线程可能已经创建了这个桶
+  table = bucket.load(std::memory_order_relaxed);
+  if (table == nullptr) {
+    table = new SkipList(arena_, HASH_BUCKET_MAX_LEVEL);
+    bucket.store(table, std::memory_order_release);
+  }
+  return table;
+}
+
+void HashSkipListRep::put(const std::string &key, const std::string &value,
+                          uint64_t tranc_id) {
+  add_prefix(key);
+  get_bucket(key, true)->put(key, value, tranc_id);
+}
+
+SkipListIterator HashSkipListRep::get(const std::string &key,
+                                      uint64_t tranc_id) {
+  auto table = get_bucket(key, false);
+  if (table == nullptr) {
+    return SkipListIterator{};
+  }
+  return table->get(key, tranc_id);
+}
+
+// 同一个 key 只会落在一个桶中, 因此各个桶依次访问即可满足 scan 的约定
+void HashSkipListRep::scan(
+    const std::function<int(const std::string &)> &predicate,
+    const std::function<void(const SkipListIterator &)> &visitor) {
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    auto table = buckets_[i].load(std::memory_order_acquire);
+    if (table != nullptr) {
+      scan_skiplist(*table, predicate, visitor);
+    }
+  }
+}
+
+std::vector<std::tuple<std::string, std::string, uint64_t>>
+HashSkipListRep::flush() {
+  std::vector<std::tuple<std::string, std::string, uint64_t>> data;
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    auto table = buckets_[i].load(std::memory_order_acquire);
+    if (table == nullptr) {
+      continue;
+    }
+    auto bucket_data = table->flush();
+    data.insert(data.end(), std::make_move_iterator(bucket_data.begin()),
+                std::make_move_iterator(bucket_data.end()));
+  }
+
+  // 各个桶内部有序, 合并后需要重新排序
+  std::sort(data.begin(), data.end(), [](const auto &a, const auto &b) {
+    if (std::get<0>(a) != std::get<0>(b)) {
+      return std::get<0>(a) < std::get<0>(b);
+    }
+    return std::get<2>(a) > std::get<2>(b);
+  });
+  return data;
+}
+
+// 桶的头节点也分配在 arena 中, 一并计入大小
+size_t HashSkipListRep::get_size() { return arena_->allocated_bytes(); }
+
+void HashSkipListRep::clear() {
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    delete buckets_[i].load(std::memory_order_relaxed);
+  }
+  reset();
+  clear_prefix_bloom();
+}
+
+// ************************ VectorRep ************************
+VectorRep::VectorRep() : arena_(std::make_shared<Arena>()) {}
+
+void VectorRep::put(const std::string &key, const std::string &value,
+                    uint64_t tranc_id) {
+  add_prefix(key);
+  // 节点不需要链接, 高度为 1 即可
+  auto node = SkipListNode::create(*arena_, key, value, 1, tranc_id);
+
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  // 尾部为空且严格大于前缀的最后一条时, 直接延长有序前缀
+  if (sorted_count_ == entries_.size() &&
+      (entries_.empty() || entry_less(entries_.back(), node))) {
+    sorted_count_++;
+  }
+  entries_.push_back(node);
+}
+
+void VectorRep::sort_() {
+  if (sorted_count_ == entries_.size()) {
+    return;
+  }
+  // 稳定排序保证相同的 (key, tranc_id) 中最后写入的排在最后
+  std::stable_sort(entries_.begin(), entries_.end(), entry_less);
+  size_t n = 0;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (i + 1 < entries_.size() && !entry_less(entries_[i], entries_[i + 1])) {
+      // 被覆盖的记录仍然占用 arena 的内存, 直到表被释放
+      continue;
+    }
+    entries_[n++] = entries_[i];
+  }
+  entries_.resize(n);
+  sorted_count_ = n;
+}
+
+void VectorRep::freeze() {
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  sort_();
+}
+
+SkipListIterator VectorRep::get(const std::string &key, uint64_t tranc_id) {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+
+  // 如果没有开启事务, 直接返回 key 的最新版本
+  // 否则返回第一个事务 id 小于等于 tranc_id 的版本
+  uint64_t target = tranc_id == 0 ? LATEST_TRANC_ID : tranc_id;
+  const SkipListNode *res = nullptr;
+  auto sorted_end = entries_.begin() + sorted_count_;
+  auto it = std::partition_point(
+      entries_.begin(), sorted_end, [&](const SkipListNode *node) {
+        int cmp = node->key().compare(key);
+        return cmp < 0 || (cmp == 0 && node->tranc_id_ > target);
+      });
+  if (it != sorted_end && (*it)->key() == key) {
+    res = *it;
+  }
+  // 尾部的记录比前缀新, tranc_id 相同时取尾部中最后写入的
+  for (auto tail = sorted_end; tail != entries_.end(); ++tail) {
+    auto node = *tail;
+    if (node->tranc_id_ <= target && node->key() == key &&
+        (res == nullptr || node->tranc_id_ >= res->tranc_id_)) {
+      res = node;
+    }
+  }
+  if (res != nullptr) {
+    return SkipListIterator{res, arena_};
+  }
+  return SkipListIterator{};
+}
+
+void VectorRep::scan(
+    const std::function<int(const std::string &)> &predicate,
+    const std::function<void(const SkipListIterator &)> &visitor) {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+
+  auto sorted_end = entries_.begin() + sorted_count_;
+  auto it = entries_.begin();
+  auto end = sorted_end;
+  if (predicate) {
+    it = std::partition_point(
+        entries_.begin(), sorted_end, [&](const SkipListNode *node) {
+          return predicate(std::string(node->key())) > 0;
+        });
+    end = std::partition_point(it, sorted_end, [&](const SkipListNode *node) {
+      return predicate(std::string(node->key())) == 0;
+    });
+  }
+
+  // 尾部中满足谓词的记录单独排序去重, 再与前缀归并
+  std::vector<const SkipListNode *> tail;
+  for (auto t = sorted_end; t != entries_.end(); ++t) {
+    if (!predicate || predicate(std::string((*t)->key())) == 0) {
+      tail.push_back(*t);
+    }
+  }
+  std::stable_sort(tail.begin(), tail.end(), entry_less);
+
+  size_t i = 0;
+  while (it != end || i < tail.size()) {
+    if (i < tail.size() && i + 1 < tail.size() &&
+        !entry_less(tail[i], tail[i + 1])) {
+      // 尾部中被覆盖的记录
+      i++;
+      continue;
+    }
+    if (i == tail.size() || (it != end && entry_less(*it, tail[i]))) {
+      visitor(SkipListIterator{*it++, arena_});
+      continue;
+    }
+    if (it != end && !entry_less(tail[i], *it)) {
+      // 相同的 (key, tranc_id) 以尾部为准
+      ++it;
+    }
+    visitor(SkipListIterator{tail[i++], arena_});
+  }
+}
+
+std::vector<std::tuple<std::string, std::string, uint64_t>> VectorRep::flush() {
+  // 冻结后已经有序, 这里只处理未冻结直接刷盘的情况
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  sort_();
+
+  std::vector<std::tuple<std::string, std::string, uint64_t>> data;
+  data.reserve(entries_.size());
+  for (auto node : entries_) {
+    data.emplace_back(node->key(), node->value(), node->tranc_id_);
+  }
+  return data;
+}
+
+size_t VectorRep::get_size() { return arena_->allocated_bytes(); }
+
+void VectorRep::clear() {
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  arena_ = std::make_shared<Arena>();
+  entries_.clear();
+  sorted_count_ = 0;
+  clear_prefix_bloom();
+}
+} // namespace tiny_lsm
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <iomanip>
 #include <optional>
@@ -125,6 +126,44 @@ inline std::string get_set_member_prefix(const std::string &key) {
   return TomlConfig::getInstance().getRedisSetPrefix() + key + "_";
 }
 
+// 链表的元数据保存在 key 中, value 为 前缀 + head + tail
+// 元素保存在 前缀 + key + "_" + seq 中, [head, tail) 为元素的序号范围
+// 序号使用定长的十六进制, key 的顺序即为链表顺序, 从中间开始分配, 两端都可以插入
+constexpr uint64_t REDIS_LIST_INITIAL_SEQ = uint64_t(1) << 63;
+constexpr size_t REDIS_LIST_SEQ_LEN = 16;
+
+inline std::string get_list_seq_str(uint64_t seq) {
+  char buf[REDIS_LIST_SEQ_LEN + 1];
+  std::snprintf(buf, sizeof(buf), "%016llx",
+                static_cast<unsigned long long>(seq));
+  return std::string(buf, REDIS_LIST_SEQ_LEN);
+}
+
+inline std::string get_list_value(uint64_t head, uint64_t tail) {
+  return TomlConfig::getInstance().getRedisListValuePreffix() +
+         get_list_seq_str(head) + get_list_seq_str(tail);
+}
+
+inline bool is_value_list(const std::string &value) {
+  return value.find(TomlConfig::getInstance().getRedisListValuePreffix()) == 0;
+}
+
+inline std::pair<uint64_t, uint64_t>
+get_list_range_from_value(const std::string &value) {
+  auto offset = TomlConfig::getInstance().getRedisListValuePreffix().size();
+  uint64_t head =
+      std::stoull(value.substr(offset, REDIS_LIST_SEQ_LEN), nullptr, 16);
+  uint64_t tail = std::stoull(
+      value.substr(offset + REDIS_LIST_SEQ_LEN, REDIS_LIST_SEQ_LEN), nullptr,
+      16);
+  return {head, tail};
+}
+
+inline std::string get_list_elem_key(const std::string &key, uint64_t seq) {
+  return TomlConfig::getInstance().getRedisListPrefix() + key + "_" +
+         get_list_seq_str(seq);
+}
+
 bool is_expired(const std::optional<std::string> &expire_str,
                 std::time_t *now_time) {
   if (!expire_str.has_value()) {
@@ -186,12 +225,14 @@ bool RedisWrapper::expire_hash_clean(
     rlock.unlock();                                       // 解锁读锁
     std::unique_lock<std::shared_mutex> wlock(redis_mtx); // 写锁
     auto fileds = get_fileds_from_hash_value(lsm->get(key));
+    WriteBatch batch;
     for (const auto &field : fileds) {
       std::string field_key = get_hash_filed_key(key, field);
-      lsm->remove(field_key);
+      batch.remove(field_key);
     }
-    lsm->remove(key);
-    lsm->remove(expire_key);
+    batch.remove(key);
+    batch.remove(expire_key);
+    lsm->write(batch);
     return true;
   }
   return false;
@@ -206,8 +247,17 @@ bool RedisWrapper::expire_list_clean(
     // 先升级锁
     rlock.unlock();                                       // 解锁读锁
     std::unique_lock<std::shared_mutex> wlock(redis_mtx); // 写锁
-    lsm->remove(key);
-    lsm->remove(expire_key);
+    WriteBatch batch;
+    auto list_opt = lsm->get(key);
+    if (list_opt.has_value() && is_value_list(list_opt.value())) {
+      auto [head, tail] = get_list_range_from_value(list_opt.value());
+      for (uint64_t seq = head; seq < tail; seq++) {
+        batch.remove(get_list_elem_key(key, seq));
+      }
+    }
+    batch.remove(key);
+    batch.remove(expire_key);
+    lsm->write(batch);
     return true;
   }
   return false;
@@ -222,21 +272,18 @@ bool RedisWrapper::expire_zset_clean(
     // 先升级锁
     rlock.unlock();                                       // 解锁读锁
     std::unique_lock<std::shared_mutex> wlock(redis_mtx); // 写锁
-    lsm->remove(key);
-    lsm->remove(expire_key);
+    WriteBatch batch;
+    batch.remove(key);
+    batch.remove(expire_key);
     auto preffix = get_zset_key_preffix(key);
-    auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-        0, [&preffix](const std::string &elem) {
-          return -elem.compare(0, preffix.size(), preffix);
-        });
+    auto result_elem = this->lsm->lsm_iters_preffix(0, preffix);
     if (result_elem.has_value()) {
       auto [elem_begin, elem_end] = result_elem.value();
-      std::vector<std::string> remove_vec;
       for (; elem_begin != elem_end; ++elem_begin) {
-        remove_vec.push_back(elem_begin->first);
+        batch.remove(elem_begin->first);
       }
-      lsm->remove_batch(remove_vec);
     }
+    lsm->write(batch);
     return true;
   }
   return false;
@@ -251,21 +298,18 @@ bool RedisWrapper::expire_set_clean(
     // 先升级锁
     rlock.unlock();                                       // 解锁读锁
     std::unique_lock<std::shared_mutex> wlock(redis_mtx); // 写锁
-    lsm->remove(key);
-    lsm->remove(expire_key);
+    WriteBatch batch;
+    batch.remove(key);
+    batch.remove(expire_key);
     auto preffix = get_set_key_preffix(key);
-    auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-        0, [&preffix](const std::string &elem) {
-          return -elem.compare(0, preffix.size(), preffix);
-        });
+    auto result_elem = this->lsm->lsm_iters_preffix(0, preffix);
     if (result_elem.has_value()) {
       auto [elem_begin, elem_end] = result_elem.value();
-      std::vector<std::string> remove_vec;
       for (; elem_begin != elem_end; ++elem_begin) {
-        remove_vec.push_back(elem_begin->first);
+        batch.remove(elem_begin->first);
       }
-      lsm->remove_batch(remove_vec);
     }
+    lsm->write(batch);
     return true;
   }
   return false;
@@ -422,9 +466,16 @@ std::string RedisWrapper::redis_incr(const std::string &key) {
 
 std::string RedisWrapper::redis_del(std::vector<std::string> &args) {
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
+  // 所有 key 的删除在同一个批量写入中原子地生效
+  WriteBatch batch;
+  // 批量写入生效前 get 仍能读到旧值, 重复的 key 只处理一次
+  std::unordered_set<std::string> seen_keys;
   int del_count = 0;
   for (int idx = 1; idx < args.size(); idx++) {
     std::string cur_key = args[idx];
+    if (!seen_keys.insert(cur_key).second) {
+      continue;
+    }
     auto cur_value = this->lsm->get(cur_key);
 
     if (cur_value.has_value()) {
@@ -434,17 +485,24 @@ std::string RedisWrapper::redis_del(std::vector<std::string> &args) {
         auto field_list = get_fileds_from_hash_value(cur_value);
         for (const auto &field : field_list) {
           std::string field_key = get_hash_filed_key(cur_key, field);
-          this->lsm->remove(field_key);
+          batch.remove(field_key);
+        }
+      } else if (is_value_list(cur_value.value())) {
+        // 链表需要删除所有元素
+        auto [head, tail] = get_list_range_from_value(cur_value.value());
+        for (uint64_t seq = head; seq < tail; seq++) {
+          batch.remove(get_list_elem_key(cur_key, seq));
         }
       }
-      this->lsm->remove(cur_key);
+      batch.remove(cur_key);
       del_count++;
     }
     std::string expire_key = get_explire_key(cur_key);
     if (this->lsm->get(expire_key).has_value()) {
-      this->lsm->remove(expire_key);
+      batch.remove(expire_key);
     }
   }
+  this->lsm->write(batch);
   return ":" + std::to_string(del_count) + "\r\n";
 }
 
@@ -476,12 +534,14 @@ std::string RedisWrapper::redis_expire(const std::string &key,
 
 std::string RedisWrapper::redis_set(std::string &key, std::string &value) {
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
-  this->lsm->put(key, value);
+  WriteBatch batch;
+  batch.put(key, value);
   // 同时如果设置有过期时间, 需要删除过期时间
   std::string expire_key = get_explire_key(key);
   if (this->lsm->get(expire_key).has_value()) {
-    this->lsm->remove(expire_key);
+    batch.remove(expire_key);
   }
+  this->lsm->write(batch);
   return "+OK\r\n";
 }
 
@@ -502,8 +562,10 @@ std::string RedisWrapper::redis_get(std::string &key) {
         // 过期了, 先进行锁升级, 再清理数据
         rlock.unlock();                                       // 解锁读锁
         std::unique_lock<std::shared_mutex> wlock(redis_mtx); // 写锁
-        this->lsm->remove(key);
-        this->lsm->remove(expire_key);
+        WriteBatch batch;
+        batch.remove(key);
+        batch.remove(expire_key);
+        this->lsm->write(batch);
         return "$-1\r\n";
       } else {
         // 没有过期
@@ -583,10 +645,11 @@ std::string RedisWrapper::redis_hset_batch(
   std::unordered_set<std::string> existing_fields(field_list.begin(),
                                                   field_list.end());
 
-  // 批量处理字段
+  // 批量处理字段, 字段值和字段列表一起写入
+  WriteBatch batch;
   for (const auto &[field, value] : field_value_pairs) {
     std::string field_key = get_hash_filed_key(key, field);
-    lsm->put(field_key, value);
+    batch.put(field_key, value);
 
     if (!existing_fields.count(field)) {
       field_list.push_back(field);
@@ -596,7 +659,8 @@ std::string RedisWrapper::redis_hset_batch(
   }
 
   // 更新字段列表
-  lsm->put(key, get_hash_value_from_fields(field_list));
+  batch.put(key, get_hash_value_from_fields(field_list));
+  lsm->write(batch);
   return ":" + std::to_string(added_count) + "\r\n";
 }
 std::string RedisWrapper::redis_hset(const std::string &key,
@@ -613,8 +677,9 @@ std::string RedisWrapper::redis_hset(const std::string &key,
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
 
   // 更新字段值
+  WriteBatch batch;
   std::string field_key = get_hash_filed_key(key, field);
-  lsm->put(field_key, value);
+  batch.put(field_key, value);
 
   // 更新字段列表
   auto field_list_opt = lsm->get(key);
@@ -626,8 +691,9 @@ std::string RedisWrapper::redis_hset(const std::string &key,
     // 不存在则添加
     field_list.push_back(field);
     auto new_value = get_hash_value_from_fields(field_list);
-    lsm->put(key, new_value);
+    batch.put(key, new_value);
   }
+  lsm->write(batch);
 
   return "+OK\r\n";
 }
@@ -668,10 +734,11 @@ std::string RedisWrapper::redis_hdel(const std::string &key,
 
   int del_count = 0;
   // 删除字段值
+  WriteBatch batch;
   std::string field_key = get_hash_filed_key(key, field);
   if (this->lsm->get(field_key).has_value()) {
     del_count++;
-    this->lsm->remove(field_key);
+    batch.remove(field_key);
   }
 
   // 更新字段列表
@@ -683,13 +750,14 @@ std::string RedisWrapper::redis_hdel(const std::string &key,
     field_list.erase(find_res);
     if (field_list.empty()) {
       // 如果字段列表为空, 则删除 key
-      lsm->remove(key);
+      batch.remove(key);
     } else {
       // 否则更新字段列表
       auto new_value = get_hash_value_from_fields(field_list);
-      lsm->put(key, new_value);
+      batch.put(key, new_value);
     }
   }
+  lsm->write(batch);
 
   return ":" + std::to_string(del_count) + "\r\n";
 }
@@ -716,6 +784,61 @@ std::string RedisWrapper::redis_hkeys(const std::string &key) {
 }
 
 // 链表操作
+std::optional<std::pair<uint64_t, uint64_t>>
+RedisWrapper::load_list_(const std::string &key) {
+  auto list_opt = lsm->get(key);
+  if (!list_opt.has_value()) {
+    return std::nullopt;
+  }
+  if (is_value_list(list_opt.value())) {
+    return get_list_range_from_value(list_opt.value());
+  }
+
+  // 旧版本用分隔符拼接的链表, 转换为按元素存储
+  auto elements = split(list_opt.value(),
+                        TomlConfig::getInstance().getRedisListSeparator());
+  uint64_t head = REDIS_LIST_INITIAL_SEQ;
+  uint64_t tail = head;
+  WriteBatch batch;
+  for (const auto &elem : elements) {
+    batch.put(get_list_elem_key(key, tail++), elem);
+  }
+  batch.put(key, get_list_value(head, tail));
+  lsm->write(batch);
+  return std::make_pair(head, tail);
+}
+
+std::vector<std::string>
+RedisWrapper::list_range_(const std::string &key, const std::string &value,
+                          size_t start, size_t stop) {
+  if (!is_value_list(value)) {
+    // 旧版本的链表在写入前不会转换, 读取时直接拆分
+    auto elements =
+        split(value, TomlConfig::getInstance().getRedisListSeparator());
+    return std::vector<std::string>(elements.begin() + start,
+                                    elements.begin() + stop + 1);
+  }
+
+  // 元素的 key 按序号排列, 一次范围查询即可读出
+  auto head = get_list_range_from_value(value).first;
+  auto first_key = get_list_elem_key(key, head + start);
+  auto last_key = get_list_elem_key(key, head + stop);
+  auto result = lsm->lsm_iters_range(0, first_key, last_key);
+
+  std::vector<std::string> elements;
+  elements.reserve(stop - start + 1);
+  if (result.has_value()) {
+    auto [elem_begin, elem_end] = result.value();
+    for (; elem_begin != elem_end; ++elem_begin) {
+      // 名称以 key + "_" 开头的其他链表的元素也可能落在范围内
+      if (elem_begin->first.size() == first_key.size()) {
+        elements.push_back(elem_begin->second);
+      }
+    }
+  }
+  return elements;
+}
+
 std::string RedisWrapper::redis_lpush(const std::string &key,
                                       const std::string &value) {
   std::shared_lock<std::shared_mutex> rlock(redis_mtx); // 读锁
@@ -728,21 +851,16 @@ std::string RedisWrapper::redis_lpush(const std::string &key,
   }
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
 
-  auto list_opt = lsm->get(key);
-  std::string list_value = list_opt.value_or("");
-  if (!list_value.empty()) {
-    list_value =
-        value + TomlConfig::getInstance().getRedisListSeparator() + list_value;
-  } else {
-    list_value = value;
-  }
+  auto [head, tail] = load_list_(key).value_or(
+      std::make_pair(REDIS_LIST_INITIAL_SEQ, REDIS_LIST_INITIAL_SEQ));
+  head--;
 
-  lsm->put(key, list_value);
-  return ":" +
-         std::to_string(split(list_value,
-                              TomlConfig::getInstance().getRedisListSeparator())
-                            .size()) +
-         "\r\n";
+  // 只写入新元素和元数据
+  WriteBatch batch;
+  batch.put(get_list_elem_key(key, head), value);
+  batch.put(key, get_list_value(head, tail));
+  lsm->write(batch);
+  return ":" + std::to_string(tail - head) + "\r\n";
 }
 
 std::string RedisWrapper::redis_rpush(const std::string &key,
@@ -758,21 +876,15 @@ std::string RedisWrapper::redis_rpush(const std::string &key,
 
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
 
-  auto list_opt = lsm->get(key);
-  std::string list_value = list_opt.value_or("");
-  if (!list_value.empty()) {
-    list_value =
-        list_value + TomlConfig::getInstance().getRedisListSeparator() + value;
-  } else {
-    list_value = value;
-  }
+  auto [head, tail] = load_list_(key).value_or(
+      std::make_pair(REDIS_LIST_INITIAL_SEQ, REDIS_LIST_INITIAL_SEQ));
 
-  lsm->put(key, list_value);
-  return ":" +
-         std::to_string(split(list_value,
-                              TomlConfig::getInstance().getRedisListSeparator())
-                            .size()) +
-         "\r\n";
+  WriteBatch batch;
+  batch.put(get_list_elem_key(key, tail), value);
+  tail++;
+  batch.put(key, get_list_value(head, tail));
+  lsm->write(batch);
+  return ":" + std::to_string(tail - head) + "\r\n";
 }
 
 std::string RedisWrapper::redis_lpop(const std::string &key) {
@@ -787,26 +899,24 @@ std::string RedisWrapper::redis_lpop(const std::string &key) {
   rlock.unlock();                                      // 升级锁
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
 
-  auto list_opt = lsm->get(key);
-  if (!list_opt.has_value()) {
-    return "$-1\r\n"; // 表示链表不存在
-  }
-
-  std::vector<std::string> elements = split(
-      list_opt.value(), TomlConfig::getInstance().getRedisListSeparator());
-  if (elements.empty()) {
-    return "$-1\r\n"; // 表示链表为空
+  auto range = load_list_(key);
+  if (!range.has_value() || range->first == range->second) {
+    return "$-1\r\n"; // 表示链表不存在或为空
   }
+  auto [head, tail] = range.value();
 
-  std::string value = elements.front();
-  elements.erase(elements.begin());
+  auto elem_key = get_list_elem_key(key, head);
+  std::string value = lsm->get(elem_key).value_or("");
+  head++;
 
-  if (elements.empty()) {
-    lsm->remove(key);
+  WriteBatch batch;
+  batch.remove(elem_key);
+  if (head == tail) {
+    batch.remove(key);
   } else {
-    lsm->put(key,
-             join(elements, TomlConfig::getInstance().getRedisListSeparator()));
+    batch.put(key, get_list_value(head, tail));
   }
+  lsm->write(batch);
   return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
 }
 
@@ -822,26 +932,24 @@ std::string RedisWrapper::redis_rpop(const std::string &key) {
   rlock.unlock();                                      // 升级锁
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
 
-  auto list_opt = lsm->get(key);
-  if (!list_opt.has_value()) {
-    return "$-1\r\n"; // 表示链表不存在
-  }
-
-  std::vector<std::string> elements = split(
-      list_opt.value(), TomlConfig::getInstance().getRedisListSeparator());
-  if (elements.empty()) {
-    return "$-1\r\n"; // 表示链表为空
+  auto range = load_list_(key);
+  if (!range.has_value() || range->first == range->second) {
+    return "$-1\r\n"; // 表示链表不存在或为空
   }
+  auto [head, tail] = range.value();
 
-  std::string value = elements.back();
-  elements.pop_back();
+  tail--;
+  auto elem_key = get_list_elem_key(key, tail);
+  std::string value = lsm->get(elem_key).value_or("");
 
-  if (elements.empty()) {
-    lsm->remove(key);
+  WriteBatch batch;
+  batch.remove(elem_key);
+  if (head == tail) {
+    batch.remove(key);
   } else {
-    lsm->put(key,
-             join(elements, TomlConfig::getInstance().getRedisListSeparator()));
+    batch.put(key, get_list_value(head, tail));
   }
+  lsm->write(batch);
   return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
 }
 
@@ -858,9 +966,14 @@ std::string RedisWrapper::redis_llen(const std::string &key) {
     return ":0\r\n"; // 表示链表不存在
   }
 
-  std::vector<std::string> elements = split(
-      list_opt.value(), TomlConfig::getInstance().getRedisListSeparator());
-  return ":" + std::to_string(elements.size()) + "\r\n";
+  if (!is_value_list(list_opt.value())) {
+    std::vector<std::string> elements = split(
+        list_opt.value(), TomlConfig::getInstance().getRedisListSeparator());
+    return ":" + std::to_string(elements.size()) + "\r\n";
+  }
+  // 长度直接由元数据得到
+  auto [head, tail] = get_list_range_from_value(list_opt.value());
+  return ":" + std::to_string(tail - head) + "\r\n";
 }
 
 std::string RedisWrapper::redis_lrange(const std::string &key, int start,
@@ -877,27 +990,38 @@ std::string RedisWrapper::redis_lrange(const std::string &key, int start,
     return "*0\r\n"; // 表示链表不存在
   }
 
-  std::vector<std::string> elements = split(
-      list_opt.value(), TomlConfig::getInstance().getRedisListSeparator());
-  if (elements.empty()) {
+  int64_t size;
+  if (is_value_list(list_opt.value())) {
+    auto [head, tail] = get_list_range_from_value(list_opt.value());
+    size = tail - head;
+  } else {
+    size = split(list_opt.value(),
+                 TomlConfig::getInstance().getRedisListSeparator())
+               .size();
+  }
+  if (size == 0) {
     return "*0\r\n"; // 表示链表为空
   }
 
-  if (start < 0)
-    start += elements.size();
-  if (stop < 0)
-    stop += elements.size();
-  if (start < 0)
-    start = 0;
-  if (stop >= elements.size())
-    stop = elements.size() - 1;
-  if (start > stop)
+  int64_t first = start;
+  int64_t last = stop;
+  if (first < 0)
+    first += size;
+  if (last < 0)
+    last += size;
+  if (first < 0)
+    first = 0;
+  if (last >= size)
+    last = size - 1;
+  if (first > last)
     return "*0\r\n";
 
+  auto elements = list_range_(key, list_opt.value(), first, last);
+
   std::ostringstream oss;
-  oss << "*" << (stop - start + 1) << "\r\n";
-  for (int i = start; i <= stop; ++i) {
-    oss << "$" << elements[i].size() << "\r\n" << elements[i] << "\r\n";
+  oss << "*" << elements.size() << "\r\n";
+  for (const auto &elem : elements) {
+    oss << "$" << elem.size() << "\r\n" << elem << "\r\n";
   }
   return oss.str();
 }
@@ -915,16 +1039,15 @@ std::string RedisWrapper::redis_zadd(std::vector<std::string> &args) {
   }
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
 
-  std::vector<std::pair<std::string, std::string>> put_kvs;
-  std::vector<std::string> del_keys;
+  // 旧 score 的删除和新成员的写入在同一个批量写入中
+  WriteBatch batch;
 
   auto value = get_zset_key_preffix(key); // 直接将 前缀 作为 value
   if (!lsm->get(value).has_value()) {
     // 如果不存在, 需要新建
-    put_kvs.emplace_back(key, value);
+    batch.put(key, value);
   }
 
-  std::vector<std::string> remove_keys;
   int added_count = 0;
   for (size_t i = 2; i < args.size(); i += 2) {
     std::string score = args[i];
@@ -943,14 +1066,13 @@ std::string RedisWrapper::redis_zadd(std::vector<std::string> &args) {
       }
       // 需要移除旧 score
       std::string original_key_score = get_zset_key_socre(key, original_score);
-      remove_keys.push_back(original_key_score);
+      batch.remove(original_key_score);
     }
-    put_kvs.emplace_back(key_score, elem);
-    put_kvs.emplace_back(key_elem, score);
+    batch.put(key_score, elem);
+    batch.put(key_elem, score);
     added_count++;
   }
-  lsm->remove_batch(del_keys);
-  lsm->put_batch(put_kvs);
+  lsm->write(batch);
 
   return ":" + std::to_string(added_count) + "\r\n";
 }
@@ -971,20 +1093,27 @@ std::string RedisWrapper::redis_zrem(std::vector<std::string> &args) {
   rlock.unlock();
   std::unique_lock<std::shared_mutex> lock(redis_mtx); // 写锁
 
+  WriteBatch batch;
+  // 重复的元素只删除和计数一次
+  std::unordered_set<std::string> seen_elems;
   int removed_count = 0;
   for (size_t i = 2; i < args.size(); ++i) {
     std::string elem = args[i];
+    if (!seen_elems.insert(elem).second) {
+      continue;
+    }
     std::string key_elem = get_zset_key_elem(key, elem);
 
     auto query_elem = lsm->get(key_elem);
     if (query_elem.has_value()) {
       std::string score = query_elem.value();
       std::string key_score = get_zset_key_socre(key, score);
-      lsm->remove(key_elem);
-      lsm->remove(key_score);
+      batch.remove(key_elem);
+      batch.remove(key_score);
       removed_count++;
     }
   }
+  lsm->write(batch);
 
   return ":" + std::to_string(removed_count) + "\r\n";
 }
@@ -1003,10 +1132,7 @@ std::string RedisWrapper::redis_zrange(std::vector<std::string> &args) {
 
   // 范围查询: 按照 score 查询就能满足 zrange 的顺序
   std::string preffix_score = get_zset_score_preffix(key);
-  auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-      0, [&preffix_score](const std::string &elem) {
-        return -elem.compare(0, preffix_score.size(), preffix_score);
-      });
+  auto result_elem = this->lsm->lsm_iters_preffix(0, preffix_score);
 
   if (!result_elem.has_value()) {
     return "*0\r\n";
@@ -1051,10 +1177,7 @@ std::string RedisWrapper::redis_zcard(const std::string &key) {
 
   // key_score 和 key_elem 是一对, 所以只需要一个即可
   std::string preffix = get_zset_score_preffix(key);
-  auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-      0, [&preffix](const std::string &elem) {
-        return -elem.compare(0, preffix.size(), preffix);
-      });
+  auto result_elem = this->lsm->lsm_iters_preffix(0, preffix);
 
   if (!result_elem.has_value()) {
     return ":0\r\n";
@@ -1104,12 +1227,13 @@ std::string RedisWrapper::redis_zincrby(const std::string &key,
   std::string key_elem = get_zset_key_elem(key, elem);
   auto query_elem = lsm->get(key_elem);
 
+  WriteBatch batch;
   uint64_t new_score;
   if (query_elem.has_value()) {
     std::string original_score = query_elem.value();
     new_score = std::stol(original_score) + std::stod(increment);
     std::string original_key_score = get_zset_key_socre(key, original_score);
-    lsm->remove(original_key_score);
+    batch.remove(original_key_score);
   } else {
     // 如果查询不到, 则相当于新建
     new_score = std::stod(increment);
@@ -1118,8 +1242,9 @@ std::string RedisWrapper::redis_zincrby(const std::string &key,
   std::string new_score_str = std::to_string(new_score);
   std::string key_score = get_zset_key_socre(key, new_score_str);
 
-  lsm->put(key_elem, new_score_str);
-  lsm->put(key_score, elem);
+  batch.put(key_elem, new_score_str);
+  batch.put(key_score, elem);
+  lsm->write(batch);
 
   return ":" + new_score_str + "\r\n";
 }
@@ -1146,10 +1271,7 @@ std::string RedisWrapper::redis_zrank(const std::string &key,
 
   // 获取有序集合的前缀
   std::string preffix_score = get_zset_key_preffix(key);
-  auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-      0, [&preffix_score](const std::string &elem) {
-        return -elem.compare(0, preffix_score.size(), preffix_score);
-      });
+  auto result_elem = this->lsm->lsm_iters_preffix(0, preffix_score);
 
   if (!result_elem.has_value()) {
     return "$-1\r\n";
@@ -1234,8 +1356,12 @@ std::string RedisWrapper::redis_srem(std::vector<std::string> &args) {
     auto prev_size = std::stoi(key_query.value());
     set_size += prev_size;
   }
-  this->lsm->put(key, std::to_string(set_size));
-  this->lsm->remove_batch(del_kvs);
+  WriteBatch batch;
+  batch.put(key, std::to_string(set_size));
+  for (auto &member_key : del_kvs) {
+    batch.remove(member_key);
+  }
+  this->lsm->write(batch);
 
   return ":" + std::to_string(del_kvs.size()) + "\r\n";
 }
@@ -1283,10 +1409,7 @@ std::string RedisWrapper::redis_smembers(const std::string &key) {
   }
 
   std::string prefix = get_set_member_prefix(key);
-  auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-      0, [&prefix](const std::string &elem) {
-        return -elem.compare(0, prefix.size(), prefix);
-      });
+  auto result_elem = this->lsm->lsm_iters_preffix(0, prefix);
 
   if (!result_elem.has_value()) {
     return "*0\r\n"; // 空数组
@@ -1,6 +1,10 @@
 #include "../../include/skiplist/skiplist.h"
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <random>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 #include <tuple>
@@ -8,10 +12,62 @@
 
 namespace tiny_lsm {
 
+// 查询 key 的最新版本时使用的事务 id, 排在同一个 key 的所有版本之前
+static constexpr uint64_t LATEST_TRANC_ID = std::numeric_limits<uint64_t>::max();
+
+// 节点是否排在 (key, tranc_id) 之前
+// 排序规则为 key 升序, key 相同时 tranc_id 更大的优先级更高
+static bool node_less(const SkipListNode *node, const std::string &key,
+                      uint64_t tranc_id) {
+  int cmp = node->key().compare(key);
+  if (cmp == 0) {
+    return node->tranc_id_ > tranc_id;
+  }
+  return cmp < 0;
+}
+
+// ************************ SkipListNode ************************
+SkipListNode *SkipListNode::create(Arena &arena, const std::string &key,
+                                   const std::string &value, int height,
+                                   uint64_t tranc_id) {
+  // 节点头部已经包含了 next_[0]
+  size_t bytes = sizeof(SkipListNode) + sizeof(SkipListNode *) * (height - 1) +
+                 key.size() + sizeof(uint32_t) + value.size();
+  char *mem = arena.allocate(bytes);
+
+  auto node = new (mem) SkipListNode;
+  node->tranc_id_ = tranc_id;
+  node->key_size_ = static_cast<uint32_t>(key.size());
+  node->height_ = static_cast<uint32_t>(height);
+  for (int i = 0; i < height; ++i) {
+    // 头部之外的 next_ 也需要构造原子变量
+    new (&node->next_[i]) std::atomic<SkipListNode *>(nullptr);
+  }
+
+  char *key_mem = reinterpret_cast<char *>(node->next_ + height);
+  std::memcpy(key_mem, key.data(), key.size());
+
+  char *value_mem = key_mem + key.size();
+  uint32_t value_size = static_cast<uint32_t>(value.size());
+  std::memcpy(value_mem, &value_size, sizeof(uint32_t));
+  std::memcpy(value_mem + sizeof(uint32_t), value.data(), value.size());
+  node->value_.store(value_mem, std::memory_order_relaxed);
+  return node;
+}
+
+const char *SkipListNode::create_value(Arena &arena, const std::string &value) {
+  char *mem = arena.allocate(sizeof(uint32_t) + value.size());
+
+  uint32_t value_size = static_cast<uint32_t>(value.size());
+  std::memcpy(mem, &value_size, sizeof(uint32_t));
+  std::memcpy(mem + sizeof(uint32_t), value.data(), value.size());
+  return mem;
+}
+
 // ************************ SkipListIterator ************************
 BaseIterator &SkipListIterator::operator++() {
   if (current) {
-    current = current->forward_[0];
+    current = current->next(0);
   }
   return *this;
 }
@@ -30,7 +86,7 @@ bool SkipListIterator::operator!=(const BaseIterator &other) const {
 SkipListIterator::value_type SkipListIterator::operator*() const {
   if (!current)
     throw std::runtime_error("Dereferencing invalid iterator");
-  return {current->key_, current->value_};
+  return {std::string(current->key()), std::string(current->value())};
 }
 
 IteratorType SkipListIterator::get_type() const {
@@ -38,24 +94,32 @@ IteratorType SkipListIterator::get_type() const {
 }
 
 bool SkipListIterator::is_valid() const {
-  return current && !current->key_.empty();
+  return current && current->key_size_ > 0;
 }
 bool SkipListIterator::is_end() const { return current == nullptr; }
 
-std::string SkipListIterator::get_key() const { return current->key_; }
-std::string SkipListIterator::get_value() const { return current->value_; }
+std::string SkipListIterator::get_key() const {
+  return std::string(current->key());
+}
+std::string SkipListIterator::get_value() const {
+  return std::string(current->value());
+}
 uint64_t SkipListIterator::get_tranc_id() const { return current->tranc_id_; }
 
 // ************************ SkipList ************************
 // 构造函数
-SkipList::SkipList(int max_lvl) : max_level(max_lvl), current_level(1) {
-  head = std::make_shared<SkipListNode>("", "", max_level, 0);
-  dis_01 = std::uniform_int_distribution<>(0, 1);
-  dis_level = std::uniform_int_distribution<>(0, (1 << max_lvl) - 1);
-  gen = std::mt19937(std::random_device()());
+SkipList::SkipList(int max_lvl) : SkipList(std::make_shared<Arena>(), max_lvl) {}
+
+SkipList::SkipList(std::shared_ptr<Arena> arena, int max_lvl)
+    : arena(std::move(arena)), max_level(max_lvl), current_level(1) {
+  head = SkipListNode::create(*this->arena, "", "", max_level, 0);
+  head_bytes = this->arena->allocated_bytes();
 }
 
 int SkipList::random_level() {
+  // 每个线程使用独立的随机数生成器, 避免并发插入时的竞争
+  thread_local std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<> dis_01(0, 1);
   int level = 1;
   // 通过"抛硬币"的方式随机生成层数：
   // - 每次有50%的概率增加一层
@@ -67,89 +131,99 @@ int SkipList::random_level() {
   return level;
 }
 
-// 插入或更新键值对
-void SkipList::put(const std::string &key, const std::string &value,
-                   uint64_t tranc_id) {
-  spdlog::trace("SkipList--put({}, {}, {})", key, value, tranc_id);
-
-  std::vector<std::shared_ptr<SkipListNode>> update(max_level, nullptr);
-
-  // 先创建一个新节点
-  int new_level = std::max(random_level(), current_level);
-  auto new_node =
-      std::make_shared<SkipListNode>(key, value, new_level, tranc_id);
-
-  // std::unique_lock<std::shared_mutex> lock(rw_mutex);
+SkipListNode *SkipList::find_greater_or_equal(const std::string &key,
+                                              uint64_t tranc_id,
+                                              SkipListNode **prev) const {
   auto current = head;
-
-  // 从最高层开始查找插入位置
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] && *current->forward_[i] < *new_node) {
-      current = current->forward_[i];
+  // 从最高层开始查找
+  for (int i = current_level.load(std::memory_order_relaxed) - 1; i >= 0;
+       --i) {
+    auto next = current->next(i);
+    while (next && node_less(next, key, tranc_id)) {
+      current = next;
+      next = current->next(i);
+    }
+    if (prev != nullptr) {
+      prev[i] = current;
     }
-    spdlog::trace("SkipList--put({}, {}, {}), level{} needs updating", key,
-                  value, tranc_id, i);
-
-    update[i] = current;
   }
-
   // 移动到最底层
-  current = current->forward_[0];
-
-  if (current && current->key_ == key && current->tranc_id_ == tranc_id) {
-    // 若 key 存在且 tranc_id 相同，更新 value
-    size_bytes += value.size() - current->value_.size();
-    current->value_ = value;
-    current->tranc_id_ = tranc_id;
-
-    spdlog::trace("SkipList--put({}, {}, {}), key and tranc_id_ is the same, "
-                  "only update value to {}",
-                  key, value, tranc_id, value);
+  return current->next(0);
+}
 
-    return;
+void SkipList::find_splice_for_level(const std::string &key, uint64_t tranc_id,
+                                     SkipListNode *before, int level,
+                                     SkipListNode **prev,
+                                     SkipListNode **next) const {
+  while (true) {
+    auto after = before->next(level);
+    if (after == nullptr || !node_less(after, key, tranc_id)) {
+      *prev = before;
+      *next = after;
+      return;
+    }
+    before = after;
   }
+}
 
-  // 如果key不存在，创建新节点
-  // ! 默认新的 tranc_id 一定比当前的大, 由上层保证
-  if (new_level > current_level) {
-    for (int i = current_level; i < new_level; ++i) {
-      update[i] = head;
+// 插入或更新键值对
+// 节点逐层通过 CAS 链接到跳表中, 第 0 层链接成功后节点即对读线程可见
+// CAS 失败说明前驱节点之后被其他线程插入了新节点, 从前驱节点开始重新查找即可,
+// 因为节点不会被并发删除, 前驱节点始终有效
+void SkipList::put(const std::string &key, const std::string &value,
+                   uint64_t tranc_id) {
+  spdlog::trace("SkipList--put({}, {}, {})", key, value, tranc_id);
 
-      spdlog::trace("SkipList--put({}, {}, {}), update level{} to head", key,
-                    value, tranc_id, i);
+  // 先确定新节点的层数, 必要时提高跳表的层级
+  int new_level = random_level();
+  int max_height = current_level.load(std::memory_order_relaxed);
+  while (new_level > max_height) {
+    if (current_level.compare_exchange_weak(max_height, new_level)) {
+      max_height = new_level;
+      break;
     }
   }
 
-  // 生成一个随机数，用于决定是否在每一层更新节点
-  int random_bits = dis_level(gen);
-
-  size_bytes += key.size() + value.size() + sizeof(uint64_t);
+  // 从最高层开始查找每一层的插入位置
+  std::vector<SkipListNode *> prev(max_height, nullptr);
+  std::vector<SkipListNode *> next(max_height, nullptr);
+  for (int i = max_height - 1; i >= 0; --i) {
+    find_splice_for_level(key, tranc_id, i == max_height - 1 ? head : prev[i + 1],
+                          i, &prev[i], &next[i]);
+  }
 
-  // 更新各层的指针
+  SkipListNode *node = nullptr;
   for (int i = 0; i < new_level; ++i) {
-    bool need_update = false;
-    if (i == 0 || (new_level > current_level) || (random_bits & (1 << i))) {
-      // 按照如下顺序判断是否进行更新
-      // 1. 第0层总是更新
-      // 2. 如果需要创建新的层级, 这个节点需要再之前所有的层级上都更新
-      // 3. 否则, 根据随机数的位数按照50%的概率更新
-      need_update = true;
-    }
+    while (true) {
+      if (i == 0 && next[0] && next[0]->key() == key &&
+          next[0]->tranc_id_ == tranc_id) {
+        // 若 key 存在且 tranc_id 相同，更新 value
+        // 旧的 value 仍然占用 arena 的内存, 直到跳表被释放
+        next[0]->value_.store(SkipListNode::create_value(*arena, value),
+                              std::memory_order_release);
+
+        spdlog::trace(
+            "SkipList--put({}, {}, {}), key and tranc_id_ is the same, "
+            "only update value to {}",
+            key, value, tranc_id, value);
+
+        return;
+      }
 
-    if (need_update) {
-      new_node->forward_[i] = update[i]->forward_[i]; // 可能为nullptr
-      if (new_node->forward_[i]) {
-        new_node->forward_[i]->set_backward(i, new_node);
+      if (node == nullptr) {
+        // 如果key不存在，创建新节点
+        // ! 默认新的 tranc_id 一定比当前的大, 由上层保证
+        node = SkipListNode::create(*arena, key, value, new_level, tranc_id);
       }
-      update[i]->forward_[i] = new_node;
-      new_node->set_backward(i, update[i]);
-    } else {
-      // 如果不更新当前层，之后更高的层级都不更新
-      break;
+
+      node->next_[i].store(next[i], std::memory_order_relaxed);
+      if (prev[i]->cas_next(i, next[i], node)) {
+        break;
+      }
+      // 其他线程在 prev[i] 之后插入了节点, 重新查找插入位置
+      find_splice_for_level(key, tranc_id, prev[i], i, &prev[i], &next[i]);
     }
   }
-
-  current_level = new_level;
 }
 
 // 查找键值对
@@ -157,39 +231,14 @@ SkipListIterator SkipList::get(const std::string &key, uint64_t tranc_id) {
   // std::shared_lock<std::shared_mutex> slock(rw_mutex);
   spdlog::trace("SkipList--get({}) called", key);
 
-  auto current = head;
-  // 从最高层开始查找
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] && current->forward_[i]->key_ < key) {
-      current = current->forward_[i];
-    }
-  }
-  // 移动到最底层
-  current = current->forward_[0];
-  if (tranc_id == 0) {
-    // 如果没有开启事务，直接比较key即可
-    // 如果找到匹配的key，返回value
-    if (current && current->key_ == key) {
-      return SkipListIterator{current};
-    }
-  } else {
-    while (current && current->key_ == key) {
-      // 如果开启了事务，只返回小于等于事务id的值
-      if (tranc_id != 0) {
-        if (current->tranc_id_ <= tranc_id) {
-          // 满足事务可见性
-          return SkipListIterator{current};
-
-        } else {
-          // 否则跳过
-          current = current->forward_[0];
-        }
-      } else {
-        // 没有开启事务
-        return SkipListIterator{current};
-      }
-    }
+  // 如果没有开启事务, 直接返回 key 的最新版本
+  // 否则返回第一个事务 id 小于等于 tranc_id 的版本
+  auto current = find_greater_or_equal(
+      key, tranc_id == 0 ? LATEST_TRANC_ID : tranc_id, nullptr);
+  if (current && current->key() == key) {
+    return SkipListIterator{current, arena};
   }
+
   // 未找到返回空
   spdlog::trace("SkipList--get({}): not found", key);
   return SkipListIterator{};
@@ -198,45 +247,25 @@ SkipListIterator SkipList::get(const std::string &key, uint64_t tranc_id) {
 // 删除键值对
 // ! 这里的 remove 是跳表本身真实的 remove,  lsm 应该使用 put 空值表示删除,
 // ! 这里只是为了实现完整的 SkipList 不会真正被上层调用
+// ! 被删除的节点仍然占用 arena 的内存
 void SkipList::remove(const std::string &key) {
-  std::vector<std::shared_ptr<SkipListNode>> update(max_level, nullptr);
+  std::vector<SkipListNode *> update(max_level, nullptr);
 
   // std::unique_lock<std::shared_mutex> lock(rw_mutex);
-  auto current = head;
-
-  // 从最高层开始查找目标节点
-  for (int i = current->forward_.size() - 1; i >= 0; --i) {
-    while (current->forward_[i] && current->forward_[i]->key_ < key) {
-      current = current->forward_[i];
-    }
-    update[i] = current;
-  }
-
-  // 移动到最底层
-  current = current->forward_[0];
+  auto current = find_greater_or_equal(key, LATEST_TRANC_ID, update.data());
 
   // 如果找到目标节点，执行删除操作
-  if (current && current->key_ == key) {
-    // 更新每一层的 forward 指针，跳过目标节点
+  if (current && current->key() == key) {
+    // 更新每一层的 next 指针，跳过目标节点
     for (int i = 0; i < current_level; ++i) {
-      if (update[i]->forward_[i] != current) {
+      if (update[i]->next(i) != current) {
         break;
       }
-      update[i]->forward_[i] = current->forward_[i];
+      update[i]->set_next(i, current->next(i));
     }
 
-    // 更新 backward 指针
-    for (int i = 0; i < current->backward_.size() && i < current_level; ++i) {
-      if (current->forward_[i]) {
-        current->forward_[i]->set_backward(i, update[i]);
-      }
-    }
-
-    // 更新跳表的内存大小
-    size_bytes -= key.size() + current->value_.size() + sizeof(uint64_t);
-
     // 如果删除的节点是最高层的节点，更新跳表的当前层级
-    while (current_level > 1 && head->forward_[current_level - 1] == nullptr) {
+    while (current_level > 1 && head->next(current_level - 1) == nullptr) {
       current_level--;
     }
   }
@@ -248,10 +277,10 @@ std::vector<std::tuple<std::string, std::string, uint64_t>> SkipList::flush() {
   spdlog::debug("SkipList--flush(): Starting to flush skiplist data");
 
   std::vector<std::tuple<std::string, std::string, uint64_t>> data;
-  auto node = head->forward_[0];
+  auto node = head->next(0);
   while (node) {
-    data.emplace_back(node->key_, node->value_, node->tranc_id_);
-    node = node->forward_[0];
+    data.emplace_back(node->key(), node->value(), node->tranc_id_);
+    node = node->next(0);
   }
 
   spdlog::debug("SkipList--flush(): Flushed {} entries", data.size());
@@ -260,20 +289,22 @@ std::vector<std::tuple<std::string, std::string, uint64_t>> SkipList::flush() {
 }
 
 size_t SkipList::get_size() {
-  // std::shared_lock<std::shared_mutex> slock(rw_mutex);
-  return size_bytes;
+  return arena->allocated_bytes() - head_bytes;
 }
 
 // 清空跳表，释放内存
+// 仍在使用的迭代器持有旧的 arena, 不受影响
 void SkipList::clear() {
   // std::unique_lock<std::shared_mutex> lock(rw_mutex);
-  head = std::make_shared<SkipListNode>("", "", max_level, 0);
-  size_bytes = 0;
+  arena = std::make_shared<Arena>();
+  head = SkipListNode::create(*arena, "", "", max_level, 0);
+  head_bytes = arena->allocated_bytes();
+  current_level = 1;
 }
 
 SkipListIterator SkipList::begin() {
   // return SkipListIterator(head->forward[0], rw_mutex);
-  return SkipListIterator(head->forward_[0]);
+  return SkipListIterator(head->next(0), arena);
 }
 
 SkipListIterator SkipList::end() {
@@ -286,55 +317,37 @@ SkipListIterator SkipList::begin_preffix(const std::string &preffix) {
   // std::shared_lock<std::shared_mutex> slock(rw_mutex);
   spdlog::trace("SkipList--begin_preffix('{}') called", preffix);
 
-  auto current = head;
-  // 从最高层开始查找
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] && current->forward_[i]->key_ < preffix) {
-      current = current->forward_[i];
-    }
-  }
-  // 移动到最底层
-  current = current->forward_[0];
+  auto current = find_greater_or_equal(preffix, LATEST_TRANC_ID, nullptr);
 
-  if (current && current->key_ == preffix) {
+  if (current && current->key() == preffix) {
     spdlog::trace("SkipList--begin_preffix('{}'): first match at '{}'", preffix,
-                  current->key_);
+                  current->key());
   }
 
-  return SkipListIterator(current);
+  return SkipListIterator(current, arena);
 }
 
 // 找到前缀的终结位置
 SkipListIterator SkipList::end_preffix(const std::string &prefix) {
   spdlog::trace("SkipList--end_preffix('{}') called", prefix);
 
-  auto current = head;
-
-  // 从最高层开始查找
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] && current->forward_[i]->key_ < prefix) {
-      current = current->forward_[i];
-    }
-  }
-
-  // 移动到最底层
-  current = current->forward_[0];
+  auto current = find_greater_or_equal(prefix, LATEST_TRANC_ID, nullptr);
 
   // 找到第一个键不以给定前缀开头的节点
-  while (current && current->key_.substr(0, prefix.size()) == prefix) {
-    current = current->forward_[0];
+  while (current && current->key().starts_with(prefix)) {
+    current = current->next(0);
   }
 
   if (current) {
     spdlog::trace("SkipList--begin_preffix('{}'): end at '{}'", prefix,
-                  current->key_);
+                  current->key());
   } else {
     spdlog::trace("SkipList--begin_preffix('{}'): end at the skiplist end",
                   prefix);
   }
 
   // 返回当前节点的迭代器
-  return SkipListIterator(current);
+  return SkipListIterator(current, arena);
 }
 
 // 返回第一个满足谓词的位置和最后一个满足谓词的迭代器
@@ -348,108 +361,37 @@ SkipListIterator SkipList::end_preffix(const std::string &prefix) {
 std::optional<std::pair<SkipListIterator, SkipListIterator>>
 SkipList::iters_monotony_predicate(
     std::function<int(const std::string &)> predicate) {
+  // 从最高层开始查找最后一个位于目标区间左侧的节点
   auto current = head;
-  SkipListIterator begin_iter = SkipListIterator(nullptr);
-  SkipListIterator end_iter = SkipListIterator(nullptr);
-
-  // 从最高层开始查找
-  // 一开始 current == head, 所以  current_level - 1 处肯定有合法的指针
-  bool find1 = false;
   for (int i = current_level - 1; i >= 0; --i) {
-    while (!find1) {
-      auto forward_i = current->forward_[i];
-      if (forward_i == nullptr) {
-        break;
-      }
-      auto direction = predicate(forward_i->key_);
-      if (direction == 0) {
-        // current 已经满足谓词了
-        find1 = true;
-        current = forward_i;
-        break;
-      } else if (direction < 0) {
-        // 下一个位置不满足谓词, 且方向错误(位于目标区间右侧)
-        // 需要尝试更小的步长(层级)
-        break;
-      } else {
-        // 下一个位置不满足谓词, 但方向正确(位于目标区间左侧)
-        current = forward_i;
-      }
+    while (current->next(i) &&
+           predicate(std::string(current->next(i)->key())) > 0) {
+      current = current->next(i);
     }
   }
 
-  if (!find1) {
+  // 它的下一个节点就是第一个可能满足谓词的节点
+  auto first = current->next(0);
+  if (first == nullptr || predicate(std::string(first->key())) != 0) {
     // 无法找到第一个满足谓词的迭代器, 直接返回
     spdlog::trace("SkipList--iters_monotony_predicate(): no match found");
 
     return std::nullopt;
   }
 
-  // 记住当前 current 的位置
-  auto current2 = current;
-
-  // current 已经满足谓词, 但有可能中途跳过了节点, 需要前向检查
-  // 注意此时 不能直接从 current_level - 1 层开始,
-  // 因为当前节点的层数不一定等于最大层数
-  for (int i = current->backward_.size() - 1; i >= 0; --i) {
-    while (true) {
-      if (current->backward_[i].lock() == nullptr ||
-          current->backward_[i].lock() == head) {
-        // 当前层没有前向节点, 或前向节点指向头结点
-        break;
-      }
-      auto direction = predicate(current->backward_[i].lock()->key_);
-      if (direction == 0) {
-        // 前一个位置满足谓词, 继续判断
-        current = current->backward_[i].lock();
-        continue;
-      } else if (direction > 0) {
-        // 前一个位置不满足谓词
-        // 需要尝试更小的步长(层级)
-        break;
-      } else {
-        // 因为当前位置满足了谓词, 前一个位置不可能返回-1
-        // 这种情况属于跳表实现错误, 需要排查
-        spdlog::error("iters_predicate: invalid direction");
-
-        throw std::runtime_error("iters_predicate: invalid direction");
-      }
-    }
-  }
-
-  // 找到第一个满足谓词的节点
-  begin_iter = SkipListIterator(current);
-
-  // 找到最后一个满足谓词的节点
-  for (int i = current2->forward_.size() - 1; i >= 0; --i) {
-    while (true) {
-      if (current2->forward_[i] == nullptr) {
-        // 当前层没有后向节点
-        break;
-      }
-      auto direction = predicate(current2->forward_[i]->key_);
-      if (direction == 0) {
-        // 后一个位置满足谓词, 继续判断
-        current2 = current2->forward_[i];
-        continue;
-      } else if (direction < 0) {
-        // 后一个位置不满足谓词
-        // 需要尝试更小的步长(层级)
-        break;
-      } else {
-        // 因为当前位置满足了谓词, 后一个位置不可能返回1
-        // 这种情况属于跳表实现错误, 需要排查
-
-        spdlog::error("iters_predicate: invalid direction");
-
-        throw std::runtime_error("iters_predicate: invalid direction");
-      }
+  // 从第一个满足谓词的节点开始, 查找最后一个满足谓词的节点
+  // 注意 first 的层数不一定等于最大层数, 需要从头结点的最高层开始
+  current = head;
+  for (int i = current_level - 1; i >= 0; --i) {
+    while (current->next(i) &&
+           predicate(std::string(current->next(i)->key())) >= 0) {
+      current = current->next(i);
     }
   }
 
-  end_iter = SkipListIterator(current2);
-  // 转化为开区间
-  ++end_iter;
+  // current 是最后一个满足谓词的节点, 转化为开区间
+  auto begin_iter = SkipListIterator(first, arena);
+  auto end_iter = SkipListIterator(current->next(0), arena);
 
   spdlog::trace("SkipList--iters_monotony_predicate(): range found");
 
@@ -460,10 +402,10 @@ SkipList::iters_monotony_predicate(
 void SkipList::print_skiplist() {
   for (int level = 0; level < current_level; level++) {
     std::cout << "Level " << level << ": ";
-    auto current = head->forward_[level];
+    auto current = head->next(level);
     while (current) {
-      std::cout << current->key_;
-      current = current->forward_[level];
+      std::cout << current->key();
+      current = current->next(level);
       if (current) {
         std::cout << " -> ";
       }
@@ -472,4 +414,4 @@ void SkipList::print_skiplist() {
   }
   std::cout << std::endl;
 }
-} // namespace tiny_lsm
\ No newline at end of file
+} // namespace tiny_lsm
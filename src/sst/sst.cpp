@@ -2,6 +2,9 @@
 #include "../../include/config/config.h"
 #include "../../include/consts.h"
 #include "../../include/sst/sst_iterator.h"
+#include "../../include/utils/bloom_filter.h"
+#include "../../include/utils/xor_filter.h"
+#include "spdlog/spdlog.h"
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
@@ -39,32 +42,41 @@ std::shared_ptr<SST> SST::open(size_t sst_id, FileObj file,
   memcpy(&sst->min_tranc_id_, min_tranc_id.data(), sizeof(uint64_t));
 
   // 1. 读取元数据块的偏移量, 最后8字节: 2个 uint32_t,
-  // 分别是 meta 和 bloom 的 offset
+  // 分别是 meta 和 filter 的 offset
 
-  auto bloom_offset_bytes = sst->file.read_to_slice(
+  auto filter_offset_bytes = sst->file.read_to_slice(
       file_size - sizeof(uint64_t) * 2 - sizeof(uint32_t), sizeof(uint32_t));
-  memcpy(&sst->bloom_offset, bloom_offset_bytes.data(), sizeof(uint32_t));
+  memcpy(&sst->filter_offset, filter_offset_bytes.data(), sizeof(uint32_t));
 
   auto meta_offset_bytes = sst->file.read_to_slice(
       file_size - sizeof(uint64_t) * 2 - sizeof(uint32_t) * 2,
       sizeof(uint32_t));
   memcpy(&sst->meta_block_offset, meta_offset_bytes.data(), sizeof(uint32_t));
 
-  // 2. 读取 bloom filter
-  if (sst->bloom_offset + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) <
+  // 2. 读取过滤器
+  if (sst->filter_offset + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) <
       file_size) {
-    // 布隆过滤器偏移量 + 2*uint32_t 的大小小于文件大小
-    // 表示存在布隆过滤器
-    uint32_t bloom_size = file_size - sizeof(uint64_t) * 2 - sst->bloom_offset -
-                          sizeof(uint32_t) * 2;
-    auto bloom_bytes = sst->file.read_to_slice(sst->bloom_offset, bloom_size);
-
-    auto bloom = BloomFilter::decode(bloom_bytes);
-    sst->bloom_filter = std::make_shared<BloomFilter>(std::move(bloom));
+    // 过滤器偏移量 + 2*uint32_t 的大小小于文件大小
+    // 表示存在过滤器
+    uint32_t filter_size = file_size - sizeof(uint64_t) * 2 -
+                           sst->filter_offset - sizeof(uint32_t) * 2;
+    auto filter_bytes =
+        sst->file.read_to_slice(sst->filter_offset, filter_size);
+    try {
+      sst->decode_filters(filter_bytes);
+    } catch (const std::exception &e) {
+      // 过滤器只用于加速查询, 无法解析时当作没有过滤器
+      spdlog::warn("SST--open(): Ignoring filters of sst {}: {}", sst_id,
+                   e.what());
+      sst->filter = nullptr;
+      sst->prefix_filter = nullptr;
+      sst->prefix_extractor = nullptr;
+      sst->range_filter = nullptr;
+    }
   }
 
   // 3. 读取并解码元数据块
-  uint32_t meta_size = sst->bloom_offset - sst->meta_block_offset;
+  uint32_t meta_size = sst->filter_offset - sst->meta_block_offset;
   auto meta_bytes = sst->file.read_to_slice(sst->meta_block_offset, meta_size);
   sst->meta_entries = BlockMeta::decode_meta_from_slice(meta_bytes);
 
@@ -118,8 +130,8 @@ std::shared_ptr<Block> SST::read_block(int64_t block_idx) {
 }
 
 int64_t SST::find_block_idx(const std::string &key) {
-  // 先在布隆过滤器判断key是否存在
-  if (bloom_filter != nullptr && !bloom_filter->possibly_contains(key)) {
+  // 先在过滤器判断key是否存在
+  if (filter != nullptr && !filter->possibly_contains(key)) {
     return -1;
   }
 
@@ -147,13 +159,111 @@ int64_t SST::find_block_idx(const std::string &key) {
   return left;
 }
 
+bool SST::may_contain_preffix(const std::string &preffix) const {
+  // 先根据首尾 key 判断
+  if (last_key < preffix) {
+    return false;
+  }
+  if (first_key.compare(0, preffix.size(), preffix) > 0) {
+    return false;
+  }
+
+  if (prefix_filter != nullptr && prefix_extractor != nullptr) {
+    auto query = prefix_extractor->query_prefix(preffix);
+    if (query.has_value() && !prefix_filter->possibly_contains(query.value())) {
+      return false;
+    }
+  }
+
+  // 前缀查询等价于一次范围查询
+  if (range_filter != nullptr) {
+    return range_filter->may_contain_preffix(preffix);
+  }
+  return true;
+}
+
+bool SST::may_contain_range(const std::string &lo,
+                            const std::string &hi) const {
+  if (lo > hi || hi < first_key || lo > last_key) {
+    return false;
+  }
+  if (range_filter != nullptr) {
+    return range_filter->may_contain_range(lo, hi);
+  }
+  return true;
+}
+
+void SST::decode_filters(const std::vector<uint8_t> &data) {
+  size_t offset = 0;
+  auto read = [&](void *dst, size_t len) {
+    if (len > data.size() - offset) {
+      throw std::runtime_error("Invalid SST filter section");
+    }
+    memcpy(dst, data.data() + offset, len);
+    offset += len;
+  };
+
+  uint64_t magic = 0;
+  if (data.size() >= sizeof(uint64_t)) {
+    memcpy(&magic, data.data(), sizeof(uint64_t));
+  }
+  if (magic != SST_FILTER_MAGIC) {
+    // 旧版本的 sst 只有布隆过滤器
+    filter = std::make_shared<BloomFilter>(BloomFilter::decode(data));
+    return;
+  }
+  offset += sizeof(uint64_t);
+
+  uint8_t version;
+  read(&version, sizeof(uint8_t));
+  if (version > SST_FILTER_VERSION) {
+    throw std::runtime_error("Unsupported SST filter section version");
+  }
+
+  auto read_filter = [&]() -> std::shared_ptr<Filter> {
+    uint32_t len;
+    read(&len, sizeof(uint32_t));
+    if (len == 0) {
+      return nullptr;
+    }
+    if (len > data.size() - offset) {
+      throw std::runtime_error("Invalid SST filter section");
+    }
+    std::vector<uint8_t> filter_data(data.begin() + offset,
+                                     data.begin() + offset + len);
+    offset += len;
+    return Filter::decode_with_type(filter_data);
+  };
+
+  filter = read_filter();
+  prefix_filter = read_filter();
+
+  uint16_t name_len;
+  read(&name_len, sizeof(uint16_t));
+  std::string extractor_name(name_len, '\0');
+  read(extractor_name.data(), name_len);
+
+  // 只有前缀提取器与构建时一致才能使用前缀过滤器
+  auto extractor = PrefixExtractor::from_config();
+  if (extractor != nullptr && extractor->name() == extractor_name) {
+    prefix_extractor = extractor;
+  }
+
+  range_filter = std::dynamic_pointer_cast<RangeFilter>(read_filter());
+}
+
 SstIterator SST::get(const std::string &key, uint64_t tranc_id) {
   if (key < first_key || key > last_key) {
     return this->end();
   }
 
-  // 在布隆过滤器判断key是否存在
-  if (bloom_filter != nullptr && !bloom_filter->possibly_contains(key)) {
+  // 所有版本都晚于 tranc_id, 对读者不可见
+  if (tranc_id != 0 && min_tranc_id_ > tranc_id) {
+    return this->end();
+  }
+
+  // 在过滤器判断key是否存在
+  if (filter != nullptr && !filter->possibly_contains(key)) {
     return this->end();
   }
 
@@ -185,16 +295,40 @@ std::pair<uint64_t, uint64_t> SST::get_tranc_id_range() const {
   return std::make_pair(min_tranc_id_, max_tranc_id_);
 }
 
+bool SST::block_visible(size_t block_idx, uint64_t tranc_id) const {
+  return tranc_id == 0 || meta_entries[block_idx].min_tranc_id <= tranc_id;
+}
+
+bool SST::has_newer_version(const std::string &key, uint64_t tranc_id) {
+  // 整个 sst 中都没有更新的版本
+  if (max_tranc_id_ <= tranc_id || key < first_key || key > last_key) {
+    return false;
+  }
+  auto block_idx = find_block_idx(key);
+  if (block_idx < 0 || block_idx >= static_cast<int64_t>(num_blocks())) {
+    return false;
+  }
+  // 同一个 key 的所有版本都在同一个 block 中
+  if (meta_entries[block_idx].max_tranc_id <= tranc_id) {
+    return false;
+  }
+  // 版本按 tranc_id 降序排列, 第一个版本就是最新的
+  BlockIterator it(read_block(block_idx), key, 0);
+  return !it.is_end() && it.get_tranc_id() > tranc_id;
+}
+
 // **************************************************
 // SSTBuilder
 // **************************************************
 
-SSTBuilder::SSTBuilder(size_t block_size, bool has_bloom) : block(block_size) {
-  // 初始化第一个block
+SSTBuilder::SSTBuilder(size_t block_size, bool has_bloom, size_t level)
+    : block(block_size), has_bloom(has_bloom), level(level) {
+  // 过滤器在 build 时根据实际的 key 数量创建
   if (has_bloom) {
-    bloom_filter = std::make_shared<BloomFilter>(
-        TomlConfig::getInstance().getBloomFilterExpectedSize(),
-        TomlConfig::getInstance().getBloomFilterExpectedErrorRate());
+    prefix_extractor = PrefixExtractor::from_config();
+    if (TomlConfig::getInstance().getSstRangeFilter()) {
+      range_builder.emplace();
+    }
   }
   meta_entries.clear();
   data.clear();
@@ -209,9 +343,22 @@ void SSTBuilder::add(const std::string &key, const std::string &value,
     first_key = key;
   }
 
-  // 在 布隆过滤器 中添加key
-  if (bloom_filter != nullptr) {
-    bloom_filter->add(key);
+  // 暂存 key 的哈希值, 同一个 key 的多个版本只记录一次
+  if (has_bloom && (key_hashes.empty() || key != last_key)) {
+    key_hashes.push_back(BloomFilter::base_hashes(key));
+  }
+
+  // 有序的 key 中相同前缀是连续的, 每个前缀只记录一次
+  if (prefix_extractor != nullptr && prefix_extractor->in_domain(key)) {
+    auto prefix = prefix_extractor->transform(key);
+    if (prefix_hashes.empty() || prefix != last_prefix) {
+      prefix_hashes.push_back(BloomFilter::base_hashes(prefix));
+      last_prefix = std::move(prefix);
+    }
+  }
+
+  if (range_builder.has_value()) {
+    range_builder->add(key);
   }
 
   // 记录 事务id 范围
@@ -224,6 +371,8 @@ void SSTBuilder::add(const std::string &key, const std::string &value,
   if (block.add_entry(key, value, tranc_id, force_write)) {
     // block 满足容量限制, 插入成功
     last_key = key;
+    block_max_tranc_id_ = std::max(block_max_tranc_id_, tranc_id);
+    block_min_tranc_id_ = std::min(block_min_tranc_id_, tranc_id);
     return;
   }
 
@@ -232,9 +381,14 @@ void SSTBuilder::add(const std::string &key, const std::string &value,
   block.add_entry(key, value, tranc_id, false);
   first_key = key;
   last_key = key; // 更新最后一个key
+  block_max_tranc_id_ = tranc_id;
+  block_min_tranc_id_ = tranc_id;
 }
 
-size_t SSTBuilder::real_size() const { return data.size() + block.cur_size(); }
+size_t SSTBuilder::real_size() const {
+  // 空 block 的 cur_size 也包含了记录 entry 数量的 2 字节, 不能计入
+  return data.size() + (block.is_empty() ? 0 : block.cur_size());
+}
 
 size_t SSTBuilder::estimated_size() const { return data.size(); }
 
@@ -242,7 +396,10 @@ void SSTBuilder::finish_block() {
   auto old_block = std::move(this->block);
   auto encoded_block = old_block.encode();
 
-  meta_entries.emplace_back(data.size(), first_key, last_key);
+  meta_entries.emplace_back(data.size(), first_key, last_key,
+                            block_min_tranc_id_, block_max_tranc_id_);
+  block_min_tranc_id_ = UINT64_MAX;
+  block_max_tranc_id_ = 0;
 
   // 预分配空间并添加数据
   data.reserve(data.size() + encoded_block.size());
@@ -276,11 +433,12 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
   // 2. 添加元数据块
   file_content.insert(file_content.end(), meta_block.begin(), meta_block.end());
 
-  // 3. 编码布隆过滤器
-  uint32_t bloom_offset = file_content.size();
-  if (bloom_filter != nullptr) {
-    auto bf_data = bloom_filter->encode();
-    file_content.insert(file_content.end(), bf_data.begin(), bf_data.end());
+  // 3. 编码过滤器
+  uint32_t filter_offset = file_content.size();
+  if (has_bloom) {
+    auto filter_data = encode_filters();
+    file_content.insert(file_content.end(), filter_data.begin(),
+                        filter_data.end());
   }
 
   auto extra_len = sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2;
@@ -292,10 +450,10 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
   memcpy(file_content.data() + file_content.size() - extra_len, &meta_offset,
          sizeof(uint32_t));
 
-  // 5. 添加布隆过滤器偏移量
+  // 5. 添加过滤器偏移量
   memcpy(file_content.data() + file_content.size() - extra_len +
              sizeof(uint32_t),
-         &bloom_offset, sizeof(uint32_t));
+         &filter_offset, sizeof(uint32_t));
 
   // 6. 添加最大和最小的事务id
   memcpy(file_content.data() + file_content.size() - sizeof(uint64_t) * 2,
@@ -304,7 +462,11 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
          &max_tranc_id_, sizeof(uint64_t));
 
   // 创建文件
-  FileObj file = FileObj::create_and_write(path, file_content);
+  FileObj file = FileObj::create_and_write(
+      path, file_content,
+      sync_mode_from_string(TomlConfig::getInstance().getSstSyncMode()));
+  // SST 之后只读, 释放同步使用的文件描述符
+  file.set_sync_mode(SyncMode::OS);
 
   // 返回SST对象
   auto res = std::make_shared<SST>();
@@ -314,8 +476,13 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
   res->first_key = meta_entries.front().first_key;
   res->last_key = meta_entries.back().last_key;
   res->meta_block_offset = meta_offset;
-  res->bloom_filter = this->bloom_filter;
-  res->bloom_offset = bloom_offset;
+  res->filter = this->filter;
+  res->prefix_filter = this->prefix_filter;
+  res->range_filter = this->range_filter;
+  if (prefix_filter != nullptr) {
+    res->prefix_extractor = prefix_extractor;
+  }
+  res->filter_offset = filter_offset;
   res->meta_entries = std::move(meta_entries);
   res->block_cache = block_cache;
   res->max_tranc_id_ = max_tranc_id_;
@@ -323,4 +490,82 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
 
   return res;
 }
+
+std::shared_ptr<Filter>
+SSTBuilder::build_filter(std::vector<std::pair<size_t, size_t>> &hashes) {
+  auto &config = TomlConfig::getInstance();
+
+  if (config.getSstFilterType() == "xor") {
+    // 构建 xor 过滤器只需要 key 的一个哈希值
+    std::vector<uint64_t> xor_hashes;
+    xor_hashes.reserve(hashes.size());
+    for (auto &[h1, h2] : hashes) {
+      xor_hashes.push_back(h1);
+    }
+    hashes.clear();
+    return std::make_shared<XorFilter>(std::move(xor_hashes));
+  }
+
+  double bits_per_key = config.getBloomFilterBitsPerKey(level);
+  size_t num_keys = hashes.size();
+
+  std::shared_ptr<BloomFilter> bloom_filter;
+  if (bits_per_key > 0) {
+    bloom_filter = std::make_shared<BloomFilter>(
+        BloomFilter::with_bits_per_key(num_keys, bits_per_key));
+  } else {
+    bloom_filter = std::make_shared<BloomFilter>(
+        std::max<size_t>(num_keys, 1),
+        config.getBloomFilterExpectedErrorRate());
+  }
+
+  for (auto &[h1, h2] : hashes) {
+    bloom_filter->add_hashes(h1, h2);
+  }
+  hashes.clear();
+  return bloom_filter;
+}
+
+std::vector<uint8_t> SSTBuilder::encode_filters() {
+  filter = build_filter(key_hashes);
+  if (!prefix_hashes.empty()) {
+    prefix_filter = build_filter(prefix_hashes);
+  }
+
+  std::vector<uint8_t> data;
+  uint64_t magic = SST_FILTER_MAGIC;
+  data.insert(data.end(), reinterpret_cast<const uint8_t *>(&magic),
+              reinterpret_cast<const uint8_t *>(&magic) + sizeof(uint64_t));
+  data.push_back(SST_FILTER_VERSION);
+
+  auto write_filter = [&data](std::shared_ptr<Filter> f) {
+    std::vector<uint8_t> filter_data;
+    if (f != nullptr) {
+      filter_data = Filter::encode_with_type(*f);
+    }
+    uint32_t len = filter_data.size();
+    data.insert(data.end(), reinterpret_cast<const uint8_t *>(&len),
+                reinterpret_cast<const uint8_t *>(&len) + sizeof(uint32_t));
+    data.insert(data.end(), filter_data.begin(), filter_data.end());
+  };
+
+  write_filter(filter);
+  write_filter(prefix_filter);
+
+  std::string extractor_name;
+  if (prefix_filter != nullptr) {
+    extractor_name = prefix_extractor->name();
+  }
+  uint16_t name_len = extractor_name.size();
+  data.insert(data.end(), reinterpret_cast<const uint8_t *>(&name_len),
+              reinterpret_cast<const uint8_t *>(&name_len) + sizeof(uint16_t));
+  data.insert(data.end(), extractor_name.begin(), extractor_name.end());
+
+  if (range_builder.has_value()) {
+    range_filter = std::make_shared<RangeFilter>(range_builder->finish());
+    range_builder.reset();
+  }
+  write_filter(range_filter);
+  return data;
+}
 } // namespace tiny_lsm
\ No newline at end of file
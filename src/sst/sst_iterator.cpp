@@ -16,16 +16,18 @@ std::optional<std::pair<SstIterator, SstIterator>> sst_iters_monotony_predicate(
   std::optional<SstIterator> final_begin = std::nullopt;
   std::optional<SstIterator> final_end = std::nullopt;
   for (int block_idx = 0; block_idx < sst->meta_entries.size(); block_idx++) {
-    auto block = sst->read_block(block_idx);
-
+    // 先根据元数据判断, 避免读取不满足条件的 block
     BlockMeta &meta_i = sst->meta_entries[block_idx];
     if (predicate(meta_i.first_key) < 0) {
       break;
     }
-    if (predicate(meta_i.last_key) > 0) {
+    if (predicate(meta_i.last_key) > 0 ||
+        !sst->block_visible(block_idx, tranc_id)) {
       continue;
     }
 
+    auto block = sst->read_block(block_idx);
+
     auto result_i = block->get_monotony_predicate_iters(tranc_id, predicate);
     if (result_i.has_value()) {
       auto [i_begin, i_end] = result_i.value();
@@ -77,8 +79,23 @@ void SstIterator::seek_first() {
   }
 
   m_block_idx = 0;
-  auto block = m_sst->read_block(m_block_idx);
-  m_block_it = std::make_shared<BlockIterator>(block, 0, max_tranc_id_);
+  load_visible_block();
+}
+
+void SstIterator::load_visible_block() {
+  // 跳过没有可见版本的 block, 不需要读取和解码
+  while (m_block_idx < m_sst->num_blocks()) {
+    if (m_sst->block_visible(m_block_idx, max_tranc_id_)) {
+      auto block = m_sst->read_block(m_block_idx);
+      m_block_it = std::make_shared<BlockIterator>(block, 0, max_tranc_id_);
+      if (!m_block_it->is_end()) {
+        return;
+      }
+    }
+    m_block_idx++;
+  }
+  // 没有下一个block
+  m_block_it = nullptr;
 }
 
 void SstIterator::seek(const std::string &key) {
@@ -89,8 +106,9 @@ void SstIterator::seek(const std::string &key) {
 
   try {
     m_block_idx = m_sst->find_block_idx(key);
-    if (m_block_idx == -1 || m_block_idx >= m_sst->num_blocks()) {
-      // 置为 end
+    if (m_block_idx == -1 || m_block_idx >= m_sst->num_blocks() ||
+        !m_sst->block_visible(m_block_idx, max_tranc_id_)) {
+      // 置为 end, block 中没有可见版本时也不需要读取
       // TODO: 这个边界情况需要添加单元测试
       m_block_it = nullptr;
       m_block_idx = m_sst->num_blocks();
@@ -134,16 +152,9 @@ BaseIterator &SstIterator::operator++() {
   }
   ++(*m_block_it);
   if (m_block_it->is_end()) {
+    // 读取下一个有可见版本的block
     m_block_idx++;
-    if (m_block_idx < m_sst->num_blocks()) {
-      // 读取下一个block
-      auto next_block = m_sst->read_block(m_block_idx);
-      BlockIterator new_blk_it(next_block, 0, max_tranc_id_);
-      (*m_block_it) = new_blk_it;
-    } else {
-      // 没有下一个block
-      m_block_it = nullptr;
-    }
+    load_visible_block();
   }
   return *this;
 }
@@ -182,6 +193,12 @@ SstIterator::value_type SstIterator::operator*() const {
 IteratorType SstIterator::get_type() const { return IteratorType::SstIterator; }
 
 uint64_t SstIterator::get_tranc_id() const { return max_tranc_id_; }
+uint64_t SstIterator::get_entry_tranc_id() const {
+  if (!m_block_it) {
+    throw std::runtime_error("Iterator is invalid");
+  }
+  return m_block_it->get_tranc_id();
+}
 bool SstIterator::is_end() const { return !m_block_it; }
 
 bool SstIterator::is_valid() const {
@@ -0,0 +1,60 @@
+#include "../../include/utils/arena.h"
+#include <cstdint>
+
+namespace tiny_lsm {
+
+static constexpr size_t ARENA_ALIGN = sizeof(void *) > 8 ? sizeof(void *) : 8;
+static_assert((ARENA_ALIGN & (ARENA_ALIGN - 1)) == 0,
+              "arena alignment should be a power of 2");
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size), alloc_ptr_(nullptr), alloc_bytes_remaining_(0),
+      allocated_bytes_(0), memory_usage_(0) {}
+
+Arena::~Arena() = default;
+
+char *Arena::allocate(size_t bytes) {
+  // 对齐到 ARENA_ALIGN, 对齐的填充也计入已分配的字节数
+  bytes = (bytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  std::lock_guard<std::mutex> lock(mutex_);
+  allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  if (bytes <= alloc_bytes_remaining_) {
+    char *result = alloc_ptr_;
+    alloc_ptr_ += bytes;
+    alloc_bytes_remaining_ -= bytes;
+    return result;
+  }
+  return allocate_fallback(bytes);
+}
+
+char *Arena::allocate_fallback(size_t bytes) {
+  if (bytes > block_size_ / 4) {
+    // 较大的对象单独分配一个块, 避免浪费当前块的剩余空间
+    return allocate_new_block(bytes);
+  }
+
+  // 当前块的剩余空间直接丢弃
+  alloc_ptr_ = allocate_new_block(block_size_);
+  alloc_bytes_remaining_ = block_size_;
+
+  char *result = alloc_ptr_;
+  alloc_ptr_ += bytes;
+  alloc_bytes_remaining_ -= bytes;
+  return result;
+}
+
+char *Arena::allocate_new_block(size_t block_bytes) {
+  // new char[] 返回的地址满足 ARENA_ALIGN 的对齐要求
+  blocks_.emplace_back(new char[block_bytes]);
+  memory_usage_.fetch_add(block_bytes, std::memory_order_relaxed);
+  return blocks_.back().get();
+}
+
+size_t Arena::allocated_bytes() const {
+  return allocated_bytes_.load(std::memory_order_relaxed);
+}
+
+size_t Arena::memory_usage() const {
+  return memory_usage_.load(std::memory_order_relaxed);
+}
+} // namespace tiny_lsm
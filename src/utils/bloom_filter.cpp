@@ -1,9 +1,11 @@
 // include/utils/bloom_filter.cpp
 
 #include "../../include/utils/bloom_filter.h"
+#include <algorithm>
 #include <cstring>
 #include <functional>
 #include <cmath>
+#include <stdexcept>
 #include <string>
 
 namespace tiny_lsm {
@@ -36,6 +38,30 @@ BloomFilter::BloomFilter(size_t expected_elements, double false_positive_rate)
   bits_.resize(num_bits_, false);
 }
 
+BloomFilter::BloomFilter(size_t expected_elements, double false_positive_rate,
+                         size_t num_bits)
+    : expected_elements_(expected_elements),
+      false_positive_rate_(false_positive_rate),
+      num_bits_(std::max<size_t>(num_bits, 1)) {
+  // k = m / n * ln2 时假阳性率最低
+  double bits_per_key = static_cast<double>(num_bits_) /
+                        std::max<size_t>(expected_elements, 1);
+  num_hashes_ = static_cast<size_t>(std::round(bits_per_key * std::log(2)));
+  num_hashes_ = std::clamp<size_t>(num_hashes_, 1, 30);
+
+  bits_.resize(num_bits_, false);
+}
+
+BloomFilter BloomFilter::with_bits_per_key(size_t num_elements,
+                                           double bits_per_key) {
+  num_elements = std::max<size_t>(num_elements, 1);
+  auto num_bits = static_cast<size_t>(std::ceil(num_elements * bits_per_key));
+  // 理论假阳性率: (1 - e^(-k/b))^k, 取最优 k 时约为 e^(-b * ln2^2)
+  double false_positive_rate =
+      std::exp(-bits_per_key * std::pow(std::log(2), 2));
+  return BloomFilter(num_elements, false_positive_rate, num_bits);
+}
+
 void BloomFilter::add(const std::string &key) {
   // 对每个哈希函数计算哈希值，并将对应位置的位设置为true
   for (size_t i = 0; i < num_hashes_; ++i) {
@@ -43,6 +69,8 @@ void BloomFilter::add(const std::string &key) {
   }
 }
 
+FilterType BloomFilter::type() const { return FilterType::BLOOM; }
+
 //  如果key可能存在于布隆过滤器中，返回true；否则返回false
 bool BloomFilter::possibly_contains(const std::string &key) const {
   // 对每个哈希函数计算哈希值，检查对应位置的位是否都为true
@@ -55,9 +83,22 @@ bool BloomFilter::possibly_contains(const std::string &key) const {
   return true;
 }
 
+std::pair<size_t, size_t> BloomFilter::base_hashes(const std::string &key) {
+  std::hash<std::string> hasher;
+  return {hasher(key), hasher(key + "salt")};
+}
+
+void BloomFilter::add_hashes(size_t h1, size_t h2) {
+  for (size_t i = 0; i < num_hashes_; ++i) {
+    bits_[(h1 + i * h2) % num_bits_] = true;
+  }
+}
+
 // 清空布隆过滤器
 void BloomFilter::clear() { bits_.assign(bits_.size(), false); }
 
+size_t BloomFilter::num_bits() const { return num_bits_; }
+
 size_t BloomFilter::hash1(const std::string &key) const {
   std::hash<std::string> hasher;
   return hasher(key);
@@ -69,6 +110,7 @@ size_t BloomFilter::hash2(const std::string &key) const {
 }
 
 size_t BloomFilter::hash(const std::string &key, size_t idx) const {
+  // 需要与 base_hashes 保持一致
   auto h1 = hash1(key);
   auto h2 = hash2(key);
   return (h1 + idx * h2) % num_bits_;
@@ -118,6 +160,9 @@ std::vector<uint8_t> BloomFilter::encode() {
 // 从 std::vector<uint8_t> 解码布隆过滤器
 BloomFilter BloomFilter::decode(const std::vector<uint8_t> &data) {
   size_t index = 0;
+  if (data.size() < sizeof(size_t) * 3 + sizeof(double)) {
+    throw std::runtime_error("Invalid bloom filter data");
+  }
 
   // 解码 expected_elements_
   size_t expected_elements;
@@ -139,6 +184,11 @@ BloomFilter BloomFilter::decode(const std::vector<uint8_t> &data) {
   std::memcpy(&num_hashes, &data[index], sizeof(num_hashes));
   index += sizeof(num_hashes);
 
+  // 位数组的长度需要与剩余的数据一致
+  if (num_bits == 0 || (num_bits + 7) / 8 != data.size() - index) {
+    throw std::runtime_error("Invalid bloom filter data");
+  }
+
   // 解码 bits_
   std::vector<bool> bits(num_bits, false);
   size_t num_bytes = (num_bits + 7) / 8;
@@ -0,0 +1,111 @@
+#include "../../include/utils/crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define TINY_LSM_CRC32C_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define TINY_LSM_CRC32C_ARM
+#endif
+
+namespace tiny_lsm {
+
+// 反射形式的 Castagnoli 多项式
+static constexpr uint32_t CRC32C_POLY = 0x82F63B78;
+
+static constexpr std::array<uint32_t, 256> make_crc32c_table() {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+static constexpr auto CRC32C_TABLE = make_crc32c_table();
+
+// 以下实现的 crc 参数和返回值都是取反后的中间状态
+[[maybe_unused]] static uint32_t
+crc32c_portable(uint32_t crc, const uint8_t *data, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    crc = CRC32C_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(TINY_LSM_CRC32C_SSE42)
+// 只有这个函数使用 SSE4.2 指令编译, 调用前需要确认 CPU 支持
+__attribute__((target("sse4.2"))) static uint32_t
+crc32c_sse42(uint32_t crc, const uint8_t *data, size_t n) {
+#if defined(__x86_64__)
+  uint64_t crc64 = crc;
+  while (n >= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(uint64_t));
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += sizeof(uint64_t);
+    n -= sizeof(uint64_t);
+  }
+  crc = static_cast<uint32_t>(crc64);
+#endif
+  while (n >= sizeof(uint32_t)) {
+    uint32_t word;
+    std::memcpy(&word, data, sizeof(uint32_t));
+    crc = _mm_crc32_u32(crc, word);
+    data += sizeof(uint32_t);
+    n -= sizeof(uint32_t);
+  }
+  while (n > 0) {
+    crc = _mm_crc32_u8(crc, *data++);
+    n--;
+  }
+  return crc;
+}
+
+bool crc32c_hardware_accelerated() {
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+
+uint32_t crc32c_extend(uint32_t crc, const uint8_t *data, size_t n) {
+  if (crc32c_hardware_accelerated()) {
+    return ~crc32c_sse42(~crc, data, n);
+  }
+  return ~crc32c_portable(~crc, data, n);
+}
+
+#elif defined(TINY_LSM_CRC32C_ARM)
+static uint32_t crc32c_arm(uint32_t crc, const uint8_t *data, size_t n) {
+  while (n >= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(uint64_t));
+    crc = __crc32cd(crc, word);
+    data += sizeof(uint64_t);
+    n -= sizeof(uint64_t);
+  }
+  while (n > 0) {
+    crc = __crc32cb(crc, *data++);
+    n--;
+  }
+  return crc;
+}
+
+bool crc32c_hardware_accelerated() { return true; }
+
+uint32_t crc32c_extend(uint32_t crc, const uint8_t *data, size_t n) {
+  return ~crc32c_arm(~crc, data, n);
+}
+
+#else
+bool crc32c_hardware_accelerated() { return false; }
+
+uint32_t crc32c_extend(uint32_t crc, const uint8_t *data, size_t n) {
+  return ~crc32c_portable(~crc, data, n);
+}
+#endif
+} // namespace tiny_lsm
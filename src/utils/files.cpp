@@ -32,14 +32,20 @@ bool FileObj::truncate(size_t offset) {
 }
 
 FileObj FileObj::create_and_write(const std::string &path,
-                                  std::vector<uint8_t> buf) {
+                                  std::vector<uint8_t> buf, SyncMode mode) {
   FileObj file_obj;
-  if (!file_obj.m_file->create(path, buf)) {
+  if (!file_obj.m_file->create(path, buf, mode)) {
     throw std::runtime_error("Failed to create or write file: " + path);
   }
 
   // 同步到磁盘
-  file_obj.m_file->sync();
+  if (!file_obj.m_file->sync()) {
+    throw std::runtime_error("Failed to sync file: " + path);
+  }
+  // 新建的文件还需要同步目录项, 否则掉电后文件本身可能不存在
+  if (is_durable(mode) && !StdFile::sync_dir(path)) {
+    throw std::runtime_error("Failed to sync directory of file: " + path);
+  }
 
   return std::move(file_obj);
 }
@@ -186,8 +192,22 @@ bool FileObj::append_uint64(uint64_t value) {
                        sizeof(uint64_t));
 }
 
+bool FileObj::set_sync_mode(SyncMode mode) {
+  return m_file->set_sync_mode(mode);
+}
+
+bool FileObj::flush() { return m_file->flush(); }
+
 bool FileObj::sync() { return m_file->sync(); }
 
+bool FileObj::sync_data() { return m_file->sync_data(); }
+
+bool FileObj::sync_dir(const std::string &path) {
+  return StdFile::sync_dir(path);
+}
+
+bool FileObj::preallocate(size_t size) { return m_file->preallocate(size); }
+
 Cursor FileObj::get_cursor(FileObj &file_obj) {
   return Cursor(&file_obj, 0);
 }
@@ -0,0 +1,37 @@
+// src/utils/filter.cpp
+
+#include "../../include/utils/filter.h"
+#include "../../include/utils/bloom_filter.h"
+#include "../../include/utils/range_filter.h"
+#include "../../include/utils/xor_filter.h"
+#include <stdexcept>
+
+namespace tiny_lsm {
+
+std::vector<uint8_t> Filter::encode_with_type(Filter &filter) {
+  std::vector<uint8_t> data;
+  data.push_back(static_cast<uint8_t>(filter.type()));
+  auto filter_data = filter.encode();
+  data.insert(data.end(), filter_data.begin(), filter_data.end());
+  return data;
+}
+
+std::shared_ptr<Filter>
+Filter::decode_with_type(const std::vector<uint8_t> &data) {
+  if (data.empty()) {
+    throw std::runtime_error("Invalid filter data");
+  }
+
+  std::vector<uint8_t> filter_data(data.begin() + 1, data.end());
+  switch (static_cast<FilterType>(data[0])) {
+  case FilterType::BLOOM:
+    return std::make_shared<BloomFilter>(BloomFilter::decode(filter_data));
+  case FilterType::XOR:
+    return std::make_shared<XorFilter>(XorFilter::decode(filter_data));
+  case FilterType::RANGE:
+    return std::make_shared<RangeFilter>(RangeFilter::decode(filter_data));
+  default:
+    throw std::runtime_error("Unknown filter type");
+  }
+}
+} // namespace tiny_lsm
@@ -0,0 +1,110 @@
+// src/utils/prefix_extractor.cpp
+
+#include "../../include/utils/prefix_extractor.h"
+#include "../../include/config/config.h"
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace tiny_lsm {
+
+std::optional<std::string>
+PrefixExtractor::query_prefix(const std::string &preffix) const {
+  if (!in_domain(preffix)) {
+    return std::nullopt;
+  }
+  return transform(preffix);
+}
+
+std::shared_ptr<const PrefixExtractor> PrefixExtractor::from_config() {
+  static std::shared_ptr<const PrefixExtractor> extractor = [] {
+    auto &config = TomlConfig::getInstance();
+    const auto &type = config.getPrefixExtractor();
+
+    std::shared_ptr<const PrefixExtractor> res;
+    if (type == "fixed") {
+      res = std::make_shared<FixedPrefixExtractor>(
+          config.getPrefixExtractorFixedLen());
+    } else if (type == "redis") {
+      // 与 redis_wrapper 中 set, zset 和 hash field 的 key 格式保持一致
+      res = std::make_shared<HeaderPrefixExtractor>(
+          std::vector<std::string>{config.getRedisSetPrefix(),
+                                   config.getRedisSortedSetPrefix(),
+                                   config.getRedisFieldPrefix()},
+          '_');
+    } else if (type != "none") {
+      spdlog::warn("PrefixExtractor--Unknown prefix extractor '{}', prefix "
+                   "bloom filters are disabled",
+                   type);
+    }
+    return res;
+  }();
+  return extractor;
+}
+
+// **************************************************
+// FixedPrefixExtractor
+// **************************************************
+
+FixedPrefixExtractor::FixedPrefixExtractor(size_t len) : len_(len) {
+  if (len_ == 0) {
+    throw std::invalid_argument("Prefix length must be positive");
+  }
+}
+
+std::string FixedPrefixExtractor::name() const {
+  return "fixed:" + std::to_string(len_);
+}
+
+bool FixedPrefixExtractor::in_domain(const std::string &key) const {
+  return key.size() >= len_;
+}
+
+std::string FixedPrefixExtractor::transform(const std::string &key) const {
+  return key.substr(0, len_);
+}
+
+// **************************************************
+// HeaderPrefixExtractor
+// **************************************************
+
+HeaderPrefixExtractor::HeaderPrefixExtractor(std::vector<std::string> headers,
+                                             char delimiter)
+    : headers_(std::move(headers)), delimiter_(delimiter) {
+  for (size_t i = 0; i < headers_.size(); ++i) {
+    for (size_t j = 0; j < headers_.size(); ++j) {
+      if (i != j && headers_[j].compare(0, headers_[i].size(), headers_[i]) ==
+                        0) {
+        throw std::invalid_argument("Prefix headers must not be prefixes of "
+                                    "each other: " +
+                                    headers_[i] + ", " + headers_[j]);
+      }
+    }
+  }
+}
+
+std::string HeaderPrefixExtractor::name() const {
+  std::string res = "header:";
+  res += delimiter_;
+  for (const auto &header : headers_) {
+    res += ":" + header;
+  }
+  return res;
+}
+
+size_t HeaderPrefixExtractor::delimiter_pos(const std::string &key) const {
+  for (const auto &header : headers_) {
+    if (key.compare(0, header.size(), header) == 0) {
+      return key.find(delimiter_, header.size());
+    }
+  }
+  return std::string::npos;
+}
+
+bool HeaderPrefixExtractor::in_domain(const std::string &key) const {
+  return delimiter_pos(key) != std::string::npos;
+}
+
+std::string HeaderPrefixExtractor::transform(const std::string &key) const {
+  return key.substr(0, delimiter_pos(key) + 1);
+}
+} // namespace tiny_lsm
@@ -0,0 +1,163 @@
+// src/utils/range_filter.cpp
+
+#include "../../include/utils/range_filter.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace tiny_lsm {
+
+namespace {
+size_t common_prefix_len(const std::string &a, const std::string &b) {
+  size_t len = std::min(a.size(), b.size());
+  size_t i = 0;
+  while (i < len && a[i] == b[i]) {
+    ++i;
+  }
+  return i;
+}
+} // namespace
+
+// **************************************************
+// RangeFilter::Builder
+// **************************************************
+
+void RangeFilter::Builder::add(const std::string &key) {
+  if (!last_key_.has_value()) {
+    last_key_ = key;
+    last_lcp_ = 0;
+    return;
+  }
+  if (key == last_key_.value()) {
+    return;
+  }
+
+  // 上一个 key 的两个相邻 key 都已确定, 截断到能区分两者的长度
+  size_t lcp = common_prefix_len(last_key_.value(), key);
+  size_t len = std::max(last_lcp_, lcp) + 1;
+  entries_.push_back(last_key_.value().substr(0, len));
+
+  last_key_ = key;
+  last_lcp_ = lcp;
+}
+
+RangeFilter RangeFilter::Builder::finish() {
+  if (last_key_.has_value()) {
+    entries_.push_back(last_key_.value().substr(0, last_lcp_ + 1));
+    last_key_.reset();
+  }
+
+  RangeFilter filter;
+  filter.entries_ = std::move(entries_);
+  entries_.clear();
+  return filter;
+}
+
+// **************************************************
+// RangeFilter
+// **************************************************
+
+FilterType RangeFilter::type() const { return FilterType::RANGE; }
+
+bool RangeFilter::possibly_contains(const std::string &key) const {
+  return may_contain_range(key, key);
+}
+
+size_t RangeFilter::seek(const std::string &lo, bool &prefix_of_lo) const {
+  auto it = std::lower_bound(entries_.begin(), entries_.end(), lo);
+  prefix_of_lo = false;
+  if (it != entries_.begin()) {
+    // 被截断的 key 可能大于 lo, 但其前缀小于 lo
+    // 此时该前缀一定是 lo 的前缀, 且一定紧挨在 lower_bound 之前
+    const auto &prev = *(it - 1);
+    prefix_of_lo = lo.compare(0, prev.size(), prev) == 0;
+  }
+  return it - entries_.begin();
+}
+
+bool RangeFilter::may_contain_range(const std::string &lo,
+                                    const std::string &hi) const {
+  if (lo > hi) {
+    return false;
+  }
+  bool prefix_of_lo;
+  size_t idx = seek(lo, prefix_of_lo);
+  if (prefix_of_lo) {
+    return true;
+  }
+  // 截断后的前缀不大于原 key, 若其已经大于 hi 则范围内一定不存在 key
+  return idx < entries_.size() && entries_[idx] <= hi;
+}
+
+bool RangeFilter::may_contain_preffix(const std::string &preffix) const {
+  bool prefix_of_lo;
+  size_t idx = seek(preffix, prefix_of_lo);
+  if (prefix_of_lo) {
+    return true;
+  }
+  return idx < entries_.size() &&
+         entries_[idx].compare(0, preffix.size(), preffix) == 0;
+}
+
+// 编码格式: | num_entries(32) | entry | ... | entry |
+// 每个 entry 与前一个共享前缀: | shared_len(16) | suffix_len(16) | suffix |
+std::vector<uint8_t> RangeFilter::encode() {
+  std::vector<uint8_t> data;
+  auto append = [&data](const void *src, size_t len) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    data.insert(data.end(), p, p + len);
+  };
+
+  uint32_t num_entries = entries_.size();
+  append(&num_entries, sizeof(uint32_t));
+
+  const std::string *prev = nullptr;
+  for (const auto &entry : entries_) {
+    uint16_t shared_len =
+        prev == nullptr ? 0 : common_prefix_len(*prev, entry);
+    uint16_t suffix_len = entry.size() - shared_len;
+    append(&shared_len, sizeof(uint16_t));
+    append(&suffix_len, sizeof(uint16_t));
+    append(entry.data() + shared_len, suffix_len);
+    prev = &entry;
+  }
+  return data;
+}
+
+RangeFilter RangeFilter::decode(const std::vector<uint8_t> &data) {
+  size_t offset = 0;
+  auto read = [&data, &offset](void *dst, size_t len) {
+    if (offset + len > data.size()) {
+      throw std::runtime_error("Invalid range filter data");
+    }
+    memcpy(dst, data.data() + offset, len);
+    offset += len;
+  };
+
+  RangeFilter filter;
+  uint32_t num_entries;
+  read(&num_entries, sizeof(uint32_t));
+  filter.entries_.reserve(num_entries);
+
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    uint16_t shared_len, suffix_len;
+    read(&shared_len, sizeof(uint16_t));
+    read(&suffix_len, sizeof(uint16_t));
+
+    std::string entry;
+    if (shared_len > 0) {
+      if (filter.entries_.empty() ||
+          shared_len > filter.entries_.back().size()) {
+        throw std::runtime_error("Invalid range filter data");
+      }
+      entry = filter.entries_.back().substr(0, shared_len);
+    }
+    entry.resize(shared_len + suffix_len);
+    read(entry.data() + shared_len, suffix_len);
+    filter.entries_.push_back(std::move(entry));
+  }
+  return filter;
+}
+
+size_t RangeFilter::num_entries() const { return entries_.size(); }
+} // namespace tiny_lsm
@@ -1,8 +1,31 @@
 #include "../../include/utils/std_file.h"
+#include "spdlog/spdlog.h"
+#include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 
 namespace tiny_lsm {
 
+SyncMode sync_mode_from_string(const std::string &mode) {
+  if (mode == "none") {
+    return SyncMode::NONE;
+  }
+  if (mode == "os") {
+    return SyncMode::OS;
+  }
+  if (mode == "fdatasync") {
+    return SyncMode::FDATASYNC;
+  }
+  if (mode == "fsync") {
+    return SyncMode::FSYNC;
+  }
+  if (mode == "dsync") {
+    return SyncMode::DSYNC;
+  }
+  spdlog::warn("StdFile--Unknown sync mode '{}', using fdatasync", mode);
+  return SyncMode::FDATASYNC;
+}
+
 bool StdFile::open(const std::string &filename, bool create) {
   filename_ = filename;
 
@@ -16,10 +39,14 @@ bool StdFile::open(const std::string &filename, bool create) {
   return file_.is_open();
 }
 
-bool StdFile::create(const std::string &filename, std::vector<uint8_t> &buf) {
+bool StdFile::create(const std::string &filename, std::vector<uint8_t> &buf,
+                     SyncMode mode) {
   if (!this->open(filename, true)) {
     throw std::runtime_error("Failed to open file for writing");
   }
+  if (!set_sync_mode(mode)) {
+    throw std::runtime_error("Failed to open file for syncing");
+  }
   if (!buf.empty()) {
     write(0, buf.data(), buf.size());
   }
@@ -27,11 +54,33 @@ bool StdFile::create(const std::string &filename, std::vector<uint8_t> &buf) {
   return true;
 }
 
+bool StdFile::set_sync_mode(SyncMode mode) {
+  flush();
+  close_sync_fd();
+  sync_mode_ = mode;
+  if (mode == SyncMode::FDATASYNC || mode == SyncMode::FSYNC) {
+    sync_fd_ = ::open(filename_.c_str(), O_RDONLY);
+  } else if (mode == SyncMode::DSYNC) {
+    sync_fd_ = ::open(filename_.c_str(), O_WRONLY | O_DSYNC);
+  } else {
+    return true;
+  }
+  return sync_fd_ >= 0;
+}
+
+void StdFile::close_sync_fd() {
+  if (sync_fd_ >= 0) {
+    ::close(sync_fd_);
+    sync_fd_ = -1;
+  }
+}
+
 void StdFile::close() {
   if (file_.is_open()) {
     sync();
     file_.close();
   }
+  close_sync_fd();
 }
 
 size_t StdFile::size() {
@@ -49,20 +98,88 @@ std::vector<uint8_t> StdFile::read(size_t offset, size_t length) {
 }
 
 bool StdFile::write(size_t offset, const void *data, size_t size) {
+  if (sync_mode_ == SyncMode::DSYNC) {
+    // 绕过用户态缓冲区直接写入, 返回时数据已经落盘
+    file_.flush();
+    auto ptr = static_cast<const char *>(data);
+    while (size > 0) {
+      auto n = ::pwrite(sync_fd_, ptr, size, offset);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      ptr += n;
+      offset += n;
+      size -= n;
+    }
+    return true;
+  }
   file_.seekg(offset, std::ios::beg);
   file_.write(static_cast<const char *>(data), size);
   // this->sync();
   return true;
 }
 
-bool StdFile::sync() {
+bool StdFile::flush() {
   if (!file_.is_open()) {
     return false;
   }
-  file_.flush();
+  if (sync_mode_ != SyncMode::NONE) {
+    file_.flush();
+  }
   return file_.good();
 }
 
+bool StdFile::sync() {
+  if (!flush()) {
+    return false;
+  }
+  return sync_data();
+}
+
+bool StdFile::sync_data() {
+  switch (sync_mode_) {
+  case SyncMode::FDATASYNC:
+    return ::fdatasync(sync_fd_) == 0;
+  case SyncMode::FSYNC:
+    return ::fsync(sync_fd_) == 0;
+  default:
+    // DSYNC 模式下每次写入都已经落盘
+    return true;
+  }
+}
+
+bool StdFile::preallocate(size_t size) {
+#ifdef __linux__
+  int fd = ::open(filename_.c_str(), O_WRONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) == 0;
+  ::close(fd);
+  return ok;
+#else
+  // 其他平台没有不改变文件大小的预分配, 直接跳过
+  return false;
+#endif
+}
+
+bool StdFile::sync_dir(const std::string &path) {
+  auto dir = std::filesystem::path(path).parent_path();
+  if (dir.empty()) {
+    dir = ".";
+  }
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+}
+
 bool StdFile::remove() { return std::remove(filename_.c_str()) == 0; }
 
 bool StdFile::truncate(size_t size) {
@@ -0,0 +1,184 @@
+// src/utils/xor_filter.cpp
+
+#include "../../include/utils/xor_filter.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace tiny_lsm {
+
+namespace {
+// murmur3 的 64 位 finalizer
+uint64_t murmur64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+uint64_t rotl64(uint64_t n, unsigned int c) {
+  return (n << (c & 63)) | (n >> ((-c) & 63));
+}
+
+// 将 32 位哈希值映射到 [0, n)
+uint32_t reduce(uint32_t hash, uint32_t n) {
+  return static_cast<uint32_t>((static_cast<uint64_t>(hash) * n) >> 32);
+}
+
+// 构建失败时最多尝试的种子数量
+constexpr int MAX_BUILD_ATTEMPTS = 100;
+} // namespace
+
+XorFilter::XorFilter() : seed_(0), block_length_(0) {}
+
+XorFilter::XorFilter(std::vector<uint64_t> key_hashes) {
+  // 重复的哈希值会导致构建无法完成, 需要先去重
+  std::sort(key_hashes.begin(), key_hashes.end());
+  key_hashes.erase(std::unique(key_hashes.begin(), key_hashes.end()),
+                   key_hashes.end());
+
+  size_t size = key_hashes.size();
+  size_t capacity = 32 + static_cast<size_t>(1.23 * size);
+  block_length_ = static_cast<uint32_t>(capacity / 3);
+  capacity = static_cast<size_t>(block_length_) * 3;
+  fingerprints_.assign(capacity, 0);
+
+  // 每个位置被多少个 key 映射, 以及这些 key 的哈希值的异或
+  std::vector<uint32_t> counts(capacity);
+  std::vector<uint64_t> xor_hashes(capacity);
+  // 剥离顺序: (哈希值, 该 key 唯一占据的位置)
+  std::vector<std::pair<uint64_t, uint32_t>> stack;
+  std::vector<uint32_t> queue;
+  stack.reserve(size);
+
+  seed_ = 0x9e3779b97f4a7c15ULL;
+  for (int attempt = 0; attempt < MAX_BUILD_ATTEMPTS; ++attempt) {
+    seed_ = murmur64(seed_ + attempt);
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(xor_hashes.begin(), xor_hashes.end(), 0);
+    stack.clear();
+    queue.clear();
+
+    for (auto key_hash : key_hashes) {
+      uint64_t hash = mix(key_hash);
+      uint32_t pos[3];
+      positions(hash, pos);
+      for (auto p : pos) {
+        counts[p]++;
+        xor_hashes[p] ^= hash;
+      }
+    }
+
+    for (uint32_t i = 0; i < capacity; ++i) {
+      if (counts[i] == 1) {
+        queue.push_back(i);
+      }
+    }
+
+    // 不断剥离只被一个 key 映射的位置
+    while (!queue.empty()) {
+      uint32_t idx = queue.back();
+      queue.pop_back();
+      if (counts[idx] != 1) {
+        continue;
+      }
+      uint64_t hash = xor_hashes[idx];
+      stack.emplace_back(hash, idx);
+
+      uint32_t pos[3];
+      positions(hash, pos);
+      for (auto p : pos) {
+        counts[p]--;
+        xor_hashes[p] ^= hash;
+        if (counts[p] == 1) {
+          queue.push_back(p);
+        }
+      }
+    }
+
+    if (stack.size() == size) {
+      break;
+    }
+  }
+
+  if (stack.size() != size) {
+    throw std::runtime_error("Failed to build xor filter");
+  }
+
+  // 逆序赋值, 保证每个 key 的 3 个位置的指纹异或等于 key 的指纹
+  for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+    auto [hash, idx] = *it;
+    uint32_t pos[3];
+    positions(hash, pos);
+    fingerprints_[idx] = 0;
+    fingerprints_[idx] = fingerprint(hash) ^ fingerprints_[pos[0]] ^
+                         fingerprints_[pos[1]] ^ fingerprints_[pos[2]];
+  }
+}
+
+uint64_t XorFilter::key_hash(const std::string &key) {
+  return std::hash<std::string>{}(key);
+}
+
+FilterType XorFilter::type() const { return FilterType::XOR; }
+
+bool XorFilter::possibly_contains(const std::string &key) const {
+  if (block_length_ == 0) {
+    return false;
+  }
+  uint64_t hash = mix(key_hash(key));
+  uint32_t pos[3];
+  positions(hash, pos);
+  return fingerprint(hash) == (fingerprints_[pos[0]] ^ fingerprints_[pos[1]] ^
+                               fingerprints_[pos[2]]);
+}
+
+// 编码格式: | seed(64) | block_length(32) | fingerprints(8 * 3 * block_length) |
+std::vector<uint8_t> XorFilter::encode() {
+  std::vector<uint8_t> data(sizeof(seed_) + sizeof(block_length_));
+  memcpy(data.data(), &seed_, sizeof(seed_));
+  memcpy(data.data() + sizeof(seed_), &block_length_, sizeof(block_length_));
+  data.insert(data.end(), fingerprints_.begin(), fingerprints_.end());
+  return data;
+}
+
+XorFilter XorFilter::decode(const std::vector<uint8_t> &data) {
+  if (data.size() < sizeof(uint64_t) + sizeof(uint32_t)) {
+    throw std::runtime_error("Invalid xor filter data");
+  }
+
+  XorFilter xf;
+  memcpy(&xf.seed_, data.data(), sizeof(xf.seed_));
+  memcpy(&xf.block_length_, data.data() + sizeof(xf.seed_),
+         sizeof(xf.block_length_));
+
+  size_t offset = sizeof(xf.seed_) + sizeof(xf.block_length_);
+  size_t capacity = static_cast<size_t>(xf.block_length_) * 3;
+  if (data.size() - offset != capacity) {
+    throw std::runtime_error("Invalid xor filter data");
+  }
+  xf.fingerprints_.assign(data.begin() + offset, data.end());
+  return xf;
+}
+
+size_t XorFilter::num_fingerprints() const { return fingerprints_.size(); }
+
+uint64_t XorFilter::mix(uint64_t key_hash) const {
+  return murmur64(key_hash + seed_);
+}
+
+uint8_t XorFilter::fingerprint(uint64_t hash) const {
+  return static_cast<uint8_t>(hash ^ (hash >> 32));
+}
+
+void XorFilter::positions(uint64_t hash, uint32_t (&pos)[3]) const {
+  pos[0] = reduce(static_cast<uint32_t>(hash), block_length_);
+  pos[1] = reduce(static_cast<uint32_t>(rotl64(hash, 21)), block_length_) +
+           block_length_;
+  pos[2] = reduce(static_cast<uint32_t>(rotl64(hash, 42)), block_length_) +
+           2 * block_length_;
+}
+} // namespace tiny_lsm
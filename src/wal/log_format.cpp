@@ -0,0 +1,143 @@
+#include "../../include/wal/log_format.h"
+#include "../../include/utils/crc32c.h"
+#include <algorithm>
+#include <cstring>
+
+namespace tiny_lsm {
+
+// 分片头中各字段的偏移
+static constexpr size_t CRC_OFFSET = 0;
+static constexpr size_t LENGTH_OFFSET = CRC_OFFSET + sizeof(uint32_t);
+static constexpr size_t TYPE_OFFSET = LENGTH_OFFSET + sizeof(uint16_t);
+static constexpr size_t LOG_NUMBER_OFFSET = TYPE_OFFSET + sizeof(uint8_t);
+
+static_assert(LogFormat::BLOCK_SIZE - LogFormat::HEADER_SIZE <= UINT16_MAX,
+              "fragment length should fit in 16 bits");
+
+void LogFormat::encode(std::vector<uint8_t> &dst, size_t offset,
+                       const uint8_t *data, size_t size, uint32_t log_number) {
+  size_t block_offset = offset % BLOCK_SIZE;
+  // 预留足够的空间, 避免逐个分片扩容
+  dst.reserve(dst.size() + size +
+              (size / (BLOCK_SIZE - HEADER_SIZE) + 2) * HEADER_SIZE);
+
+  bool begin = true;
+  do {
+    size_t leftover = BLOCK_SIZE - block_offset;
+    if (leftover < HEADER_SIZE) {
+      // 剩余空间放不下分片头, 填充后切换到下一个块
+      dst.insert(dst.end(), leftover, 0);
+      block_offset = 0;
+      leftover = BLOCK_SIZE;
+    }
+
+    size_t fragment_len = std::min(size, leftover - HEADER_SIZE);
+    bool end = fragment_len == size;
+    LogFragmentType type;
+    if (begin && end) {
+      type = LogFragmentType::FULL;
+    } else if (begin) {
+      type = LogFragmentType::FIRST;
+    } else if (end) {
+      type = LogFragmentType::LAST;
+    } else {
+      type = LogFragmentType::MIDDLE;
+    }
+
+    size_t pos = dst.size();
+    dst.resize(pos + HEADER_SIZE);
+    dst.insert(dst.end(), data, data + fragment_len);
+
+    uint8_t *header = dst.data() + pos;
+    auto len16 = static_cast<uint16_t>(fragment_len);
+    std::memcpy(header + LENGTH_OFFSET, &len16, sizeof(uint16_t));
+    header[TYPE_OFFSET] = static_cast<uint8_t>(type);
+    std::memcpy(header + LOG_NUMBER_OFFSET, &log_number, sizeof(uint32_t));
+    uint32_t crc = crc32c_value(header + TYPE_OFFSET,
+                                HEADER_SIZE - TYPE_OFFSET + fragment_len);
+    std::memcpy(header + CRC_OFFSET, &crc, sizeof(uint32_t));
+
+    data += fragment_len;
+    size -= fragment_len;
+    block_offset += HEADER_SIZE + fragment_len;
+    begin = false;
+  } while (size > 0);
+}
+
+std::vector<std::vector<uint8_t>>
+LogFormat::decode(const std::vector<uint8_t> &data, uint32_t log_number) {
+  std::vector<std::vector<uint8_t>> records;
+  std::vector<uint8_t> scratch;
+  bool in_fragmented = false;
+  size_t pos = 0;
+
+  while (pos < data.size()) {
+    size_t leftover = BLOCK_SIZE - pos % BLOCK_SIZE;
+    if (leftover < HEADER_SIZE) {
+      // 块末尾的填充
+      pos += leftover;
+      continue;
+    }
+    if (pos + HEADER_SIZE > data.size()) {
+      break;
+    }
+
+    const uint8_t *header = data.data() + pos;
+    uint16_t fragment_len;
+    std::memcpy(&fragment_len, header + LENGTH_OFFSET, sizeof(uint16_t));
+    auto type = static_cast<LogFragmentType>(header[TYPE_OFFSET]);
+    uint32_t fragment_log_number;
+    std::memcpy(&fragment_log_number, header + LOG_NUMBER_OFFSET,
+                sizeof(uint32_t));
+    if (HEADER_SIZE + fragment_len > leftover ||
+        pos + HEADER_SIZE + fragment_len > data.size()) {
+      break;
+    }
+    uint32_t expected_crc;
+    std::memcpy(&expected_crc, header + CRC_OFFSET, sizeof(uint32_t));
+    uint32_t crc = crc32c_value(header + TYPE_OFFSET,
+                                HEADER_SIZE - TYPE_OFFSET + fragment_len);
+    if (crc != expected_crc || fragment_log_number != log_number) {
+      break;
+    }
+
+    const uint8_t *payload = header + HEADER_SIZE;
+    pos += HEADER_SIZE + fragment_len;
+
+    bool valid = true;
+    switch (type) {
+    case LogFragmentType::FULL:
+      valid = !in_fragmented;
+      if (valid) {
+        records.emplace_back(payload, payload + fragment_len);
+      }
+      break;
+    case LogFragmentType::FIRST:
+      valid = !in_fragmented;
+      scratch.assign(payload, payload + fragment_len);
+      in_fragmented = true;
+      break;
+    case LogFragmentType::MIDDLE:
+      valid = in_fragmented;
+      scratch.insert(scratch.end(), payload, payload + fragment_len);
+      break;
+    case LogFragmentType::LAST:
+      valid = in_fragmented;
+      if (valid) {
+        scratch.insert(scratch.end(), payload, payload + fragment_len);
+        records.push_back(std::move(scratch));
+        scratch.clear();
+        in_fragmented = false;
+      }
+      break;
+    default:
+      valid = false;
+      break;
+    }
+    if (!valid) {
+      break;
+    }
+  }
+  return records;
+}
+} // namespace tiny_lsm
@@ -10,21 +10,21 @@ Record Record::createRecord(uint64_t tranc_id) {
   Record record;
   record.operation_type_ = OperationType::CREATE;
   record.tranc_id_ = tranc_id;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+  record.record_len_ = HEADER_SIZE;
   return record;
 }
 Record Record::commitRecord(uint64_t tranc_id) {
   Record record;
   record.operation_type_ = OperationType::COMMIT;
   record.tranc_id_ = tranc_id;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+  record.record_len_ = HEADER_SIZE;
   return record;
 }
 Record Record::rollbackRecord(uint64_t tranc_id) {
   Record record;
   record.operation_type_ = OperationType::ROLLBACK;
   record.tranc_id_ = tranc_id;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+  record.record_len_ = HEADER_SIZE;
   return record;
 }
 Record Record::putRecord(uint64_t tranc_id, const std::string &key,
@@ -34,9 +34,8 @@ Record Record::putRecord(uint64_t tranc_id, const std::string &key,
   record.tranc_id_ = tranc_id;
   record.key_ = key;
   record.value_ = value;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) +
-                       sizeof(uint16_t) + key.size() + sizeof(uint16_t) +
-                       value.size();
+  record.record_len_ = HEADER_SIZE + sizeof(uint32_t) + key.size() +
+                       sizeof(uint32_t) + value.size();
   return record;
 }
 Record Record::deleteRecord(uint64_t tranc_id, const std::string &key) {
@@ -44,71 +43,69 @@ Record Record::deleteRecord(uint64_t tranc_id, const std::string &key) {
   record.operation_type_ = OperationType::DELETE;
   record.tranc_id_ = tranc_id;
   record.key_ = key;
-  record.record_len_ = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) +
-                       sizeof(uint16_t) + key.size();
+  record.record_len_ = HEADER_SIZE + sizeof(uint32_t) + key.size();
   return record;
 }
 
 std::vector<uint8_t> Record::encode() const {
   std::vector<uint8_t> record;
+  encode_to(record);
+  return record;
+}
 
-  size_t key_offset = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
-  // 记录长度本身(16) + 事务id(64) +
-  // 操作类型(8), 固有的编码部分
+void Record::encode_to(std::vector<uint8_t> &buf) const {
+  size_t begin = buf.size();
+  // 记录长度本身(32) + 事务id(64) + 操作类型(8), 固有的编码部分
+  size_t key_offset = begin + HEADER_SIZE;
 
-  record.resize(record_len_, 0);
+  buf.resize(begin + record_len_, 0);
 
   // 编码 record_len
-  std::memcpy(record.data(), &record_len_, sizeof(uint16_t));
+  std::memcpy(buf.data() + begin, &record_len_, sizeof(uint32_t));
 
   // 编码 tranc_id
-  std::memcpy(record.data() + sizeof(uint16_t), &tranc_id_, sizeof(uint64_t));
+  std::memcpy(buf.data() + begin + sizeof(uint32_t), &tranc_id_,
+              sizeof(uint64_t));
 
   // 编码 operation_type
   auto type_byte = static_cast<uint8_t>(operation_type_);
-  std::memcpy(record.data() + sizeof(uint16_t) + sizeof(uint64_t), &type_byte,
-              sizeof(uint8_t));
+  buf[key_offset - sizeof(uint8_t)] = type_byte;
 
   if (this->operation_type_ == OperationType::PUT) {
-    uint16_t key_len = key_.size();
-    std::memcpy(record.data() + key_offset, &key_len, sizeof(uint16_t));
-    std::memcpy(record.data() + key_offset + sizeof(uint16_t), key_.data(),
+    uint32_t key_len = key_.size();
+    std::memcpy(buf.data() + key_offset, &key_len, sizeof(uint32_t));
+    std::memcpy(buf.data() + key_offset + sizeof(uint32_t), key_.data(),
                 key_.size());
 
-    size_t value_offset = key_offset + sizeof(uint16_t) + key_.size();
+    size_t value_offset = key_offset + sizeof(uint32_t) + key_.size();
 
-    uint16_t value_len = value_.size();
-    std::memcpy(record.data() + value_offset, &value_len, sizeof(uint16_t));
-    std::memcpy(record.data() + value_offset + sizeof(uint16_t), value_.data(),
+    uint32_t value_len = value_.size();
+    std::memcpy(buf.data() + value_offset, &value_len, sizeof(uint32_t));
+    std::memcpy(buf.data() + value_offset + sizeof(uint32_t), value_.data(),
                 value_.size());
   } else if (this->operation_type_ == OperationType::DELETE) {
-    uint16_t key_len = key_.size();
-    std::memcpy(record.data() + key_offset, &key_len, sizeof(uint16_t));
-    std::memcpy(record.data() + key_offset + sizeof(uint16_t), key_.data(),
+    uint32_t key_len = key_.size();
+    std::memcpy(buf.data() + key_offset, &key_len, sizeof(uint32_t));
+    std::memcpy(buf.data() + key_offset + sizeof(uint32_t), key_.data(),
                 key_.size());
   }
-
-  return record;
 }
 
 std::vector<Record> Record::decode(const std::vector<uint8_t> &data) {
-  if (data.size() < sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t)) {
-    return {};
-  }
-
   std::vector<Record> records;
   size_t pos = 0;
 
-  while (pos < data.size()) {
+  while (pos + HEADER_SIZE <= data.size()) {
     // 读取 record_len
-    uint16_t record_len;
-    std::memcpy(&record_len, data.data() + pos, sizeof(uint16_t));
-    pos += sizeof(uint16_t);
+    uint32_t record_len;
+    std::memcpy(&record_len, data.data() + pos, sizeof(uint32_t));
 
-    // 检查数据长度是否足够
-    if (data.size() < record_len) {
-      throw std::runtime_error("Data length does not match record length");
+    // 检查记录是否完整
+    if (record_len < HEADER_SIZE || record_len > data.size() - pos) {
+      break;
     }
+    size_t end = pos + record_len;
+    pos += sizeof(uint32_t);
 
     // 读取 tranc_id
     uint64_t tranc_id;
@@ -124,39 +121,43 @@ std::vector<Record> Record::decode(const std::vector<uint8_t> &data) {
     record.operation_type_ = operation_type;
     record.record_len_ = record_len;
 
-    if (operation_type == OperationType::PUT) {
+    if (operation_type == OperationType::PUT ||
+        operation_type == OperationType::DELETE) {
       // 读取 key_len
-      uint16_t key_len;
-      std::memcpy(&key_len, data.data() + pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
+      uint32_t key_len;
+      if (pos + sizeof(uint32_t) > end) {
+        break;
+      }
+      std::memcpy(&key_len, data.data() + pos, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      if (key_len > end - pos) {
+        break;
+      }
 
       // 读取 key
       record.key_ = std::string(
           reinterpret_cast<const char *>(data.data() + pos), key_len);
       pos += key_len;
-
+    }
+    if (operation_type == OperationType::PUT) {
       // 读取 value_len
-      uint16_t value_len;
-      std::memcpy(&value_len, data.data() + pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
+      uint32_t value_len;
+      if (pos + sizeof(uint32_t) > end) {
+        break;
+      }
+      std::memcpy(&value_len, data.data() + pos, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      if (value_len > end - pos) {
+        break;
+      }
 
       // 读取 value
       record.value_ = std::string(
           reinterpret_cast<const char *>(data.data() + pos), value_len);
-      pos += value_len;
-    } else if (operation_type == OperationType::DELETE) {
-      // 读取 key_len
-      uint16_t key_len;
-      std::memcpy(&key_len, data.data() + pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
-
-      // 读取 key
-      record.key_ = std::string(
-          reinterpret_cast<const char *>(data.data() + pos), key_len);
-      pos += key_len;
     }
 
     records.push_back(record);
+    pos = end;
   }
   return records;
 }
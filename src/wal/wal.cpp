@@ -1,25 +1,49 @@
 // src/wal/wal.cpp
 
 #include "../../include/wal/wal.h"
+#include "../../include/utils/crc32c.h"
+#include "spdlog/spdlog.h"
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <tuple>
 #include <vector>
 
 namespace tiny_lsm {
 
+// 文件切换时写入末尾的摘要:
+// 最小 tranc_id(64) + 最大 tranc_id(64) + 日志编号(32) + 魔数(32) + crc32c(32)
+static constexpr uint32_t WAL_FOOTER_MAGIC = 0x57414C46;
+static constexpr size_t WAL_FOOTER_SIZE =
+    sizeof(uint64_t) * 2 + sizeof(uint32_t) * 3;
+static constexpr size_t WAL_FOOTER_CRC_OFFSET =
+    WAL_FOOTER_SIZE - sizeof(uint32_t);
+
 // 从零开始的初始化流程
 WAL::WAL(const std::string &log_dir, size_t buffer_size,
          uint64_t checkpoint_tranc_id, uint64_t clean_interval,
-         uint64_t file_size_limit)
-    : buffer_size_(buffer_size), checkpoint_tranc_id_(checkpoint_tranc_id),
+         uint64_t file_size_limit, SyncMode sync_mode,
+         uint64_t sync_interval_ms, uint64_t sync_bytes, bool preallocate,
+         size_t recycle_file_num)
+    : min_tranc_id_(UINT64_MAX), max_tranc_id_(0), preallocate_(preallocate),
+      recycle_file_num_(recycle_file_num), file_size_limit_(file_size_limit),
+      buffer_size_(buffer_size), checkpoint_tranc_id_(checkpoint_tranc_id),
       stop_cleaner_(false), clean_interval_(clean_interval),
-      file_size_limit_(file_size_limit) {
+      sync_mode_(sync_mode), sync_interval_ms_(sync_interval_ms),
+      sync_bytes_(sync_bytes) {
   active_log_path_ = log_dir + "/wal.0";
-  log_file_ = FileObj::open(active_log_path_, true);
+  log_file_ = FileObj::create_and_write(active_log_path_, {}, sync_mode_);
+  if (preallocate_) {
+    log_file_.preallocate(file_size_limit_);
+  }
 
   cleaner_thread_ = std::thread(&WAL::cleaner, this);
+  if (background_sync()) {
+    syncer_thread_ = std::thread(&WAL::syncer, this);
+  }
 }
 
 WAL::~WAL() {
@@ -28,25 +52,50 @@ WAL::~WAL() {
   {
     std::lock_guard<std::mutex> lock(mutex_);
     stop_cleaner_ = true;
+    stop_syncer_ = true;
   }
+  sync_cv_.notify_one();
+  cleaner_cv_.notify_one();
 
   if (cleaner_thread_.joinable()) {
     cleaner_thread_.join();
   }
+  if (syncer_thread_.joinable()) {
+    syncer_thread_.join();
+  }
   log_file_.sync();
 }
 
+bool WAL::background_sync() const {
+  return is_durable(sync_mode_) && (sync_interval_ms_ > 0 || sync_bytes_ > 0);
+}
+
 std::map<uint64_t, std::vector<Record>>
 WAL::recover(const std::string &log_dir, uint64_t checkpoint_tranc_id) {
   std::map<uint64_t, std::vector<Record>> tranc_records{};
+  recover(
+      log_dir, checkpoint_tranc_id,
+      [&](std::vector<Record> &records) {
+        for (auto &record : records) {
+          tranc_records[record.getTrancId()].push_back(std::move(record));
+        }
+      },
+      1);
+  return tranc_records;
+}
 
+void WAL::recover(const std::string &log_dir, uint64_t checkpoint_tranc_id,
+                  const std::function<void(std::vector<Record> &)> &visitor,
+                  size_t parallelism) {
   // 引擎启动时判断
   if (!std::filesystem::exists(log_dir)) {
-    return tranc_records;
+    return;
   }
 
   // 遍历log_dir下的所有文件
-  std::vector<std::string> wal_paths;
+  // (seq, 路径, 文件大小)
+  std::vector<std::tuple<uint64_t, std::string, size_t>> wal_paths;
+  size_t total_bytes = 0;
   for (const auto &entry : std::filesystem::directory_iterator(log_dir)) {
     if (entry.is_regular_file()) {
       // 获取/符号后的文件名
@@ -55,32 +104,108 @@ WAL::recover(const std::string &log_dir, uint64_t checkpoint_tranc_id) {
         continue;
       }
 
-      wal_paths.push_back(entry.path().string());
+      auto seq = std::stoull(filename.substr(filename.find_last_of(".") + 1));
+      wal_paths.emplace_back(seq, entry.path().string(), entry.file_size());
+      total_bytes += entry.file_size();
     }
   }
+  if (wal_paths.empty()) {
+    return;
+  }
 
   // 按照seq升序排序
-  std::sort(wal_paths.begin(), wal_paths.end(),
-            [](const std::string &a, const std::string &b) {
-              auto a_seq_str = a.substr(a.find_last_of(".") + 1);
-              auto b_seq_str = b.substr(b.find_last_of(".") + 1);
-              return std::stoi(a_seq_str) < std::stoi(b_seq_str);
-            });
-
-  // 读取所有的记录
-  for (const auto &wal_path : wal_paths) {
-    auto wal_file = FileObj::open(wal_path, false);
-    auto wal_records_slice = wal_file.read_to_slice(0, wal_file.size());
-    auto records = Record::decode(wal_records_slice);
-    for (const auto &record : records) {
-      if (record.getTrancId() > checkpoint_tranc_id) {
-        // 如果记录的 tranc_id 大于 checkpoint_tranc_id, 才需要尝试恢复
-        tranc_records[record.getTrancId()].push_back(record);
-      }
+  std::sort(wal_paths.begin(), wal_paths.end());
+
+  spdlog::info("WAL--recover(): Replaying {} WAL files ({} bytes)",
+               wal_paths.size(), total_bytes);
+
+  // 读取和解码在后台线程中进行, 记录按文件顺序交给 visitor
+  auto load = [checkpoint_tranc_id](uint64_t seq, std::string path) {
+    // 摘要表明文件中的记录都已经完成检查点时不需要解码
+    auto range = read_footer(path, seq);
+    if (range.has_value() && range->second <= checkpoint_tranc_id) {
+      return std::vector<Record>{};
+    }
+    auto records = read_records(path, seq);
+    // 只有 tranc_id 大于 checkpoint_tranc_id 的记录才需要尝试恢复
+    records.erase(std::remove_if(records.begin(), records.end(),
+                                 [&](const Record &record) {
+                                   return record.getTrancId() <=
+                                          checkpoint_tranc_id;
+                                 }),
+                  records.end());
+    return records;
+  };
+  parallelism = std::max<size_t>(parallelism, 1);
+  std::deque<std::future<std::vector<Record>>> pending;
+  size_t next = 0;
+  size_t done_bytes = 0;
+  int reported_percent = 0;
+  for (size_t i = 0; i < wal_paths.size(); i++) {
+    while (next < wal_paths.size() && pending.size() < parallelism) {
+      pending.push_back(std::async(std::launch::async, load,
+                                   std::get<0>(wal_paths[next]),
+                                   std::get<1>(wal_paths[next])));
+      next++;
+    }
+
+    auto records = pending.front().get();
+    pending.pop_front();
+    visitor(records);
+
+    // 每完成 10% 输出一次进度
+    done_bytes += std::get<2>(wal_paths[i]);
+    int percent = total_bytes == 0
+                      ? 100
+                      : static_cast<int>(done_bytes * 100 / total_bytes);
+    if (percent / 10 > reported_percent / 10 || i + 1 == wal_paths.size()) {
+      reported_percent = percent;
+      spdlog::info("WAL--recover(): Replayed {}/{} WAL files ({}%)", i + 1,
+                   wal_paths.size(), percent);
     }
   }
+}
 
-  return tranc_records;
+std::vector<Record> WAL::read_records(const std::string &path,
+                                      uint32_t log_number) {
+  auto wal_file = FileObj::open(path, false);
+  auto data = wal_file.read_to_slice(0, wal_file.size());
+  // 文件编号与分片中的日志编号不一致的部分是复用前残留的旧记录
+  std::vector<Record> records;
+  for (const auto &payload : LogFormat::decode(data, log_number)) {
+    auto batch = Record::decode(payload);
+    records.insert(records.end(), std::make_move_iterator(batch.begin()),
+                   std::make_move_iterator(batch.end()));
+  }
+  return records;
+}
+
+std::optional<std::pair<uint64_t, uint64_t>>
+WAL::read_footer(const std::string &path, uint32_t log_number) {
+  auto wal_file = FileObj::open(path, false);
+  auto file_size = wal_file.size();
+  if (file_size < WAL_FOOTER_SIZE) {
+    return std::nullopt;
+  }
+  auto footer = wal_file.read_to_slice(file_size - WAL_FOOTER_SIZE,
+                                       WAL_FOOTER_SIZE);
+
+  uint64_t min_tranc_id, max_tranc_id;
+  uint32_t footer_log_number, magic, crc;
+  size_t offset = 0;
+  std::memcpy(&min_tranc_id, footer.data() + offset, sizeof(uint64_t));
+  offset += sizeof(uint64_t);
+  std::memcpy(&max_tranc_id, footer.data() + offset, sizeof(uint64_t));
+  offset += sizeof(uint64_t);
+  std::memcpy(&footer_log_number, footer.data() + offset, sizeof(uint32_t));
+  offset += sizeof(uint32_t);
+  std::memcpy(&magic, footer.data() + offset, sizeof(uint32_t));
+  std::memcpy(&crc, footer.data() + WAL_FOOTER_CRC_OFFSET, sizeof(uint32_t));
+  if (magic != WAL_FOOTER_MAGIC || footer_log_number != log_number ||
+      crc != crc32c_value(footer.data(), WAL_FOOTER_CRC_OFFSET)) {
+    return std::nullopt;
+  }
+  return std::make_pair(min_tranc_id, max_tranc_id);
 }
 
 // commit 时 强制写入
@@ -94,109 +219,162 @@ void WAL::set_checkpoint_tranc_id(uint64_t checkpoint_tranc_id) {
 void WAL::log(const std::vector<Record> &records, bool force_flush) {
   std::unique_lock<std::mutex> lock(mutex_);
 
-  // 将 records 的所有记录添加到 log_buffer_
+  // 将 records 的所有记录编码到 log_buffer_
+  size_t encoded_size = 0;
   for (const auto &record : records) {
-    log_buffer_.push_back(record);
+    encoded_size += record.encoded_size();
   }
+  log_buffer_.reserve(log_buffer_.size() + encoded_size);
+  for (const auto &record : records) {
+    record.encode_to(log_buffer_);
+    // 缓冲区总是整体写入当前文件, 可以直接计入当前文件的范围
+    min_tranc_id_ = std::min(min_tranc_id_, record.getTrancId());
+    max_tranc_id_ = std::max(max_tranc_id_, record.getTrancId());
+  }
+  log_buffer_records_ += records.size();
 
-  if (log_buffer_.size() < buffer_size_ && !force_flush) {
-    // 如果 log_buffer_ 的大小小于 buffer_size_ 且 force_flush 为 false,
+  if (log_buffer_records_ < buffer_size_ && !force_flush) {
+    // 如果 log_buffer_ 中的记录数小于 buffer_size_ 且 force_flush 为 false,
     // 不进行写入
     return;
   }
 
-  // 否则写入 wal 文件
-  auto pre_buffer = std::move(log_buffer_);
-  for (const auto &record : pre_buffer) {
-    std::vector<uint8_t> encoded_record = record.encode();
-    log_file_.append(encoded_record);
+  // 否则将整个缓冲区作为一条逻辑记录写入 wal 文件
+  if (!log_buffer_.empty()) {
+    write_buffer_.clear();
+    LogFormat::encode(write_buffer_, write_offset_, log_buffer_.data(),
+                      log_buffer_.size(), log_number_);
+    log_buffer_.clear();
+    log_buffer_records_ = 0;
+    if (!log_file_.write(write_offset_, write_buffer_)) {
+      throw std::runtime_error("Failed to write WAL file");
+    }
+    write_offset_ += write_buffer_.size();
+    unsynced_bytes_ += write_buffer_.size();
   }
-  if (!log_file_.sync()) {
+
+  if (force_flush && !background_sync()) {
     // 确保日志立即写入磁盘
-    throw std::runtime_error("Failed to sync WAL file");
+    if (!log_file_.sync()) {
+      throw std::runtime_error("Failed to sync WAL file");
+    }
+    unsynced_bytes_ = 0;
+  } else {
+    // 缓冲区满或者开启了后台同步时只写入操作系统
+    if (!log_file_.flush()) {
+      throw std::runtime_error("Failed to flush WAL file");
+    }
+    if (sync_bytes_ > 0 && unsynced_bytes_ >= sync_bytes_) {
+      sync_cv_.notify_one();
+    }
   }
 
-  auto cur_file_size = log_file_.size();
-  if (cur_file_size > file_size_limit_) {
+  if (write_offset_ > file_size_limit_) {
     reset_file();
   }
 }
 
+void WAL::syncer() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_syncer_) {
+    auto need_sync = [this] {
+      return stop_syncer_ || (sync_bytes_ > 0 && unsynced_bytes_ >= sync_bytes_);
+    };
+    if (sync_interval_ms_ > 0) {
+      sync_cv_.wait_for(lock, std::chrono::milliseconds(sync_interval_ms_),
+                        need_sync);
+    } else {
+      sync_cv_.wait(lock, need_sync);
+    }
+    if (stop_syncer_ || unsynced_bytes_ == 0) {
+      continue;
+    }
+
+    // 数据已经在 log 中写入操作系统, 同步时不需要阻塞写入
+    unsynced_bytes_ = 0;
+    std::unique_lock<std::mutex> sync_lock(sync_mutex_);
+    lock.unlock();
+    if (!log_file_.sync_data()) {
+      spdlog::error("WAL--syncer(): Failed to sync WAL file");
+    }
+    // 先释放 sync_mutex_, 与 reset_file 的加锁顺序保持一致
+    sync_lock.unlock();
+    lock.lock();
+  }
+}
+
 void WAL::cleaner() {
   while (true) {
     {
-      // 睡眠 clean_interval_ s
-      std::this_thread::sleep_for(std::chrono::seconds(clean_interval_));
+      // 睡眠 clean_interval_ s, 关闭时提前唤醒
+      std::unique_lock<std::mutex> lock(mutex_);
+      cleaner_cv_.wait_for(lock, std::chrono::seconds(clean_interval_),
+                           [this]() { return stop_cleaner_.load(); });
       if (stop_cleaner_) {
         break;
       }
-      cleanWALFile();
     }
+    cleanWALFile();
   }
 }
 
 void WAL::cleanWALFile() {
-  // 遍历log_file_所在的文件夹
-  std::string dir_path;
-
-  std::unique_lock<std::mutex> lock(mutex_); // 只在获取当前文件路径时获取锁
-  if (active_log_path_.find("/") != std::string::npos) {
-    dir_path =
-        active_log_path_.substr(0, active_log_path_.find_last_of("/")) + "/";
-  } else {
-    dir_path = "./";
-  }
-  lock.unlock();
-
   // wal文件格式为:
   // wal.seq
-
-  std::vector<std::pair<size_t, std::string>> wal_paths;
-
-  for (const auto &entry : std::filesystem::directory_iterator(dir_path)) {
-    if (entry.is_regular_file() &&
-        entry.path().filename().string().substr(0, 4) == "wal.") {
-      std::string filename = entry.path().filename().string();
-      size_t dot_pos = filename.find_last_of(".");
-      std::string seq_str = filename.substr(dot_pos + 1);
-      uint64_t seq = std::stoull(seq_str);
-      wal_paths.push_back({seq, entry.path().string()});
+  std::vector<std::string> del_paths;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto path_prefix =
+        active_log_path_.substr(0, active_log_path_.find_last_of(".") + 1);
+    for (auto it = segment_ranges_.begin(); it != segment_ranges_.end();) {
+      // 文件中还有没有完成检查点的记录
+      if (it->second.second > checkpoint_tranc_id_) {
+        ++it;
+        continue;
+      }
+      auto path = path_prefix + std::to_string(it->first);
+      it = segment_ranges_.erase(it);
+      // 优先留作复用, 超过数量限制的直接删除
+      if (recycle_paths_.size() < recycle_file_num_) {
+        recycle_paths_.push_back(path);
+      } else {
+        del_paths.push_back(path);
+      }
     }
   }
 
-  // 按照seq升序排序
-  std::sort(wal_paths.begin(), wal_paths.end(),
-            [](const std::pair<size_t, std::string> &a,
-               const std::pair<size_t, std::string> &b) {
-              return a.first < b.first;
-            });
-
-  // 判断是否可以删除
-  std::vector<FileObj> del_paths;
-  for (int idx = 0; idx < wal_paths.size() - 1; idx++) {
-    auto cur_path = wal_paths[idx].second;
-    auto cur_file = FileObj::open(cur_path, false);
-    // 遍历文件记录, 读取所有的tranc_id,
-    // 判断是否都小于等于checkpoint_tranc_id_
-    size_t offset = 0;
-    bool has_unfinished = false;
-    while (offset + sizeof(uint16_t) < cur_file.size()) {
-      uint16_t record_size = cur_file.read_uint16(offset);
-      uint64_t tranc_id = cur_file.read_uint64(offset + sizeof(uint16_t));
-      if (tranc_id > checkpoint_tranc_id_) {
-        has_unfinished = true;
-        break;
-      }
-      offset += record_size;
-    }
-    if (!has_unfinished) {
-      del_paths.push_back(std::move(cur_file));
-    }
+  // 目录可能已经被删除 (如测试清理数据目录), 忽略删除失败
+  for (auto &del_path : del_paths) {
+    std::error_code ec;
+    std::filesystem::remove(del_path, ec);
   }
+}
 
-  for (auto &del_file : del_paths) {
-    del_file.del_file();
+void WAL::seal_file() {
+  std::vector<uint8_t> footer(WAL_FOOTER_SIZE);
+  size_t offset = 0;
+  std::memcpy(footer.data() + offset, &min_tranc_id_, sizeof(uint64_t));
+  offset += sizeof(uint64_t);
+  std::memcpy(footer.data() + offset, &max_tranc_id_, sizeof(uint64_t));
+  offset += sizeof(uint64_t);
+  std::memcpy(footer.data() + offset, &log_number_, sizeof(uint32_t));
+  offset += sizeof(uint32_t);
+  std::memcpy(footer.data() + offset, &WAL_FOOTER_MAGIC, sizeof(uint32_t));
+  uint32_t crc = crc32c_value(footer.data(), WAL_FOOTER_CRC_OFFSET);
+  std::memcpy(footer.data() + WAL_FOOTER_CRC_OFFSET, &crc, sizeof(uint32_t));
+
+  if (!log_file_.write(write_offset_, footer)) {
+    throw std::runtime_error("Failed to write WAL footer");
   }
+  // 复用的文件末尾残留着旧数据, 截断后摘要才位于文件末尾
+  size_t end = write_offset_ + WAL_FOOTER_SIZE;
+  if (log_file_.size() > end && !log_file_.truncate(end)) {
+    throw std::runtime_error("Failed to truncate WAL file");
+  }
+
+  segment_ranges_[log_number_] = {min_tranc_id_, max_tranc_id_};
+  min_tranc_id_ = UINT64_MAX;
+  max_tranc_id_ = 0;
 }
 
 void WAL::reset_file() {
@@ -206,15 +384,50 @@ void WAL::reset_file() {
 
   auto old_path = active_log_path_;
   // 字符串处理获取seq
-  auto seq = std::stoi(old_path.substr(old_path.find_last_of(".") + 1));
+  auto seq = std::stoul(old_path.substr(old_path.find_last_of(".") + 1));
   seq++;
 
   active_log_path_ = old_path.substr(0, old_path.find_last_of(".")) + "." +
                      std::to_string(seq);
 
+  // 切换前旧文件需要写入摘要并完整落盘, 之后后台线程只会同步新文件
+  seal_file();
+  if (!log_file_.sync()) {
+    throw std::runtime_error("Failed to sync WAL file");
+  }
+  unsynced_bytes_ = 0;
+
   // 创建新的文件
   // ? 如果不注释下面这行, debug 模式下 test_wal 能通过但 release 模式下报错
   // log_file_.~FileObj();
-  log_file_ = FileObj::create_and_write(active_log_path_, {});
+  std::lock_guard<std::mutex> sync_lock(sync_mutex_);
+  log_number_ = seq;
+  write_offset_ = 0;
+  while (!recycle_paths_.empty()) {
+    // 复用旧文件, 从头覆盖写入, 避免创建文件和分配磁盘块
+    auto recycle_path = recycle_paths_.front();
+    recycle_paths_.pop_front();
+    std::error_code ec;
+    std::filesystem::rename(recycle_path, active_log_path_, ec);
+    if (ec) {
+      spdlog::warn("WAL--reset_file(): Failed to recycle {}: {}", recycle_path,
+                   ec.message());
+      continue;
+    }
+    log_file_ = FileObj::open(active_log_path_, false);
+    if (!log_file_.set_sync_mode(sync_mode_)) {
+      throw std::runtime_error("Failed to open WAL file for syncing");
+    }
+    // 重命名也需要同步目录
+    if (is_durable(sync_mode_) && !FileObj::sync_dir(active_log_path_)) {
+      throw std::runtime_error("Failed to sync WAL directory");
+    }
+    return;
+  }
+
+  log_file_ = FileObj::create_and_write(active_log_path_, {}, sync_mode_);
+  if (preallocate_) {
+    log_file_.preallocate(file_size_limit_);
+  }
 }
 } // namespace tiny_lsm
\ No newline at end of file
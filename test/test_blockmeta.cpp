@@ -112,6 +112,31 @@ TEST_F(BlockMetaTest, ErrorHandlingTest) {
                std::runtime_error);
 }
 
+// 测试 block 的事务 id 范围
+TEST_F(BlockMetaTest, TrancIdRangeTest) {
+  auto metas = createTestMetas();
+  for (size_t i = 0; i < metas.size(); i++) {
+    metas[i].min_tranc_id = i * 10 + 1;
+    metas[i].max_tranc_id = i * 10 + 9;
+  }
+  std::vector<uint8_t> encoded_data;
+  BlockMeta::encode_meta_to_slice(metas, encoded_data);
+  auto decoded_metas = BlockMeta::decode_meta_from_slice(encoded_data);
+  ASSERT_EQ(decoded_metas.size(), metas.size());
+  for (size_t i = 0; i < metas.size(); i++) {
+    EXPECT_EQ(decoded_metas[i].min_tranc_id, metas[i].min_tranc_id);
+    EXPECT_EQ(decoded_metas[i].max_tranc_id, metas[i].max_tranc_id);
+  }
+
+  // 旧版本的元数据没有事务 id 范围, 使用不会跳过 block 的默认值
+  encoded_data.resize(encoded_data.size() - metas.size() * 16 - 4);
+  decoded_metas = BlockMeta::decode_meta_from_slice(encoded_data);
+  ASSERT_EQ(decoded_metas.size(), metas.size());
+  EXPECT_EQ(decoded_metas[0].first_key, metas[0].first_key);
+  EXPECT_EQ(decoded_metas[0].min_tranc_id, 0);
+  EXPECT_EQ(decoded_metas[0].max_tranc_id, UINT64_MAX);
+}
+
 // 修改大数据量测试，确保 key 有序
 TEST_F(BlockMetaTest, LargeDataTest) {
   std::vector<BlockMeta> large_metas;
@@ -1,3 +1,4 @@
+#include "../include/config/config.h"
 #include "../include/consts.h"
 #include "../include/logger/logger.h"
 #include "../include/lsm/engine.h"
@@ -5,6 +6,8 @@
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <tuple>
+#include <vector>
 
 using namespace ::tiny_lsm;
 
@@ -78,6 +81,53 @@ TEST_F(CompactTest, Persistence) {
   EXPECT_FALSE(lsm.get("nonexistent").has_value());
 }
 
+TEST_F(CompactTest, MergerKeepsVisibleVersions) {
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  auto build = [&](size_t sst_id,
+                   std::vector<std::tuple<std::string, std::string, uint64_t>>
+                       entries) {
+    SSTBuilder builder(64, true);
+    for (auto &[k, v, t] : entries) {
+      builder.add(k, v, t);
+    }
+    return builder.build(sst_id, test_dir + "/sst_" + std::to_string(sst_id),
+                         block_cache);
+  };
+  // sst 1 比 sst 0 更新
+  auto newer = build(1, {{"a", "a8", 8}, {"a", "a6", 6}, {"b", "", 7}});
+  auto older = build(0, {{"a", "a4", 4},
+                         {"a", "a2", 2},
+                         {"b", "b3", 3},
+                         {"c", "c1", 1},
+                         {"d", "", 2}});
+
+  auto collect = [&](uint64_t oldest_tranc_id, bool bottom_level) {
+    std::vector<std::shared_ptr<SST>> ssts = {newer, older};
+    CompactionMerger merger(ssts, oldest_tranc_id, bottom_level);
+    std::vector<std::tuple<std::string, std::string, uint64_t>> result;
+    std::string key, value;
+    uint64_t tranc_id;
+    while (merger.next(key, value, tranc_id)) {
+      result.emplace_back(key, value, tranc_id);
+    }
+    return result;
+  };
+
+  // 快照 5 之后的版本全部保留, 之前的版本只保留最新的一个
+  std::vector<std::tuple<std::string, std::string, uint64_t>> expected = {
+      {"a", "a8", 8}, {"a", "a6", 6}, {"a", "a4", 4}, {"b", "", 7},
+      {"b", "b3", 3}, {"c", "c1", 1}, {"d", "", 2}};
+  EXPECT_EQ(collect(5, false), expected);
+
+  // 没有更早的读者时每个 key 只保留最新版本, 最底层还会丢弃删除标记
+  expected = {{"a", "a8", 8}, {"b", "", 7}, {"c", "c1", 1}, {"d", "", 2}};
+  EXPECT_EQ(collect(10, false), expected);
+  expected = {{"a", "a8", 8}, {"c", "c1", 1}};
+  EXPECT_EQ(collect(10, true), expected);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
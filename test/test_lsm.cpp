@@ -1,11 +1,22 @@
 #include "../include/config/config.h"
 #include "../include/logger/logger.h"
+#include "../include/lsm/commit_table.h"
 #include "../include/lsm/engine.h"
 #include "../include/lsm/level_iterator.h"
+#include "../include/lsm/lock_manager.h"
+#include "../include/lsm/serializable_tracker.h"
+#include "../include/lsm/tranc_id_set.h"
+#include "../include/lsm/write_batch.h"
+#include "../include/lsm/write_queue.h"
+#include "../include/wal/wal.h"
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <map>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 using namespace ::tiny_lsm;
@@ -222,6 +233,85 @@ TEST_F(LSMTest, MonotonyPredicate) {
   EXPECT_EQ(actual_keys, expected_keys);
 }
 
+// 测试前缀查询, 不包含该前缀的 sst 会被前缀过滤器跳过
+TEST_F(LSMTest, RangeFilterPrune) {
+  auto engine = std::make_shared<LSMEngine>(test_dir);
+  for (int i = 10; i < 60; i++) {
+    engine->put("a" + std::to_string(i), "value", 1);
+    engine->put("c" + std::to_string(i), "value", 1);
+  }
+  engine->flush();
+
+  // 只有 sst 会调用 predicate, 被范围过滤器跳过的 sst 不会调用
+  int calls = 0;
+  auto predicate = [&calls](const std::string &key) {
+    calls++;
+    if (key < "b") {
+      return 1;
+    }
+    if (key > "bz") {
+      return -1;
+    }
+    return 0;
+  };
+  EXPECT_FALSE(engine->lsm_iters_monotony_predicate(0, predicate).has_value());
+  EXPECT_GT(calls, 0);
+
+  // [b, bz] 在 sst 的首尾 key 之间, 但其中没有 key
+  calls = 0;
+  EXPECT_FALSE(engine
+                   ->lsm_iters_monotony_predicate(0, predicate, "",
+                                                  std::make_pair("b", "bz"))
+                   .has_value());
+  EXPECT_EQ(calls, 0);
+
+  std::vector<std::string> keys;
+  auto result = engine->lsm_iters_range(0, "a50", "c11");
+  ASSERT_TRUE(result.has_value());
+  for (auto [it, end] = result.value(); it != end; ++it) {
+    keys.push_back(it->first);
+  }
+  EXPECT_EQ(keys.size(), 12);
+  EXPECT_EQ(keys.front(), "a50");
+  EXPECT_EQ(keys.back(), "c11");
+  EXPECT_FALSE(engine->lsm_iters_range(0, "b", "bz").has_value());
+}
+
+TEST_F(LSMTest, PreffixQuery) {
+  LSM lsm(test_dir);
+
+  // 每个集合的成员单独刷入一个 sst
+  for (int set_id = 0; set_id < 5; set_id++) {
+    for (int i = 0; i < 20; i++) {
+      lsm.put("REDIS_SET_s" + std::to_string(set_id) + "_m" +
+                  std::to_string(i),
+              "1");
+    }
+    lsm.flush();
+  }
+  // 部分数据留在 memtable 中
+  lsm.put("REDIS_SET_s5_m0", "1");
+
+  for (int set_id = 0; set_id < 6; set_id++) {
+    auto preffix = "REDIS_SET_s" + std::to_string(set_id) + "_";
+    auto result = lsm.lsm_iters_preffix(0, preffix);
+    ASSERT_TRUE(result.has_value());
+
+    auto [start, end] = result.value();
+    std::set<std::string> actual_keys;
+    for (auto it = start; it != end; ++it) {
+      EXPECT_EQ(it->first.compare(0, preffix.size(), preffix), 0);
+      actual_keys.insert(it->first);
+    }
+
+    size_t expected_num = set_id == 5 ? 1 : 20;
+    EXPECT_EQ(actual_keys.size(), expected_num);
+  }
+
+  auto result = lsm.lsm_iters_preffix(0, "REDIS_SET_s9_");
+  EXPECT_FALSE(result.has_value() && result->first.is_valid());
+}
+
 TEST_F(LSMTest, TrancIdTest) {
   // 注意是 LSMEngine 而不是 LSM
   // 因为 LSMEngine 才能手动控制事务id
@@ -270,6 +360,143 @@ TEST_F(LSMTest, TrancIdTest) {
   }
 }
 
+TEST(RowCacheTest, BasicOperations) {
+  // 单个分片, 容量只够存放 2 个缓存项
+  RowCache cache(2 * (64 + 8), 1);
+
+  cache.put("key1", "val1", 1, cache.version("key1"));
+  cache.put("key2", "val2", 2, cache.version("key2"));
+  EXPECT_EQ(cache.get("key1", 0)->first, "val1");
+  // 最新版本对更早的事务不可见
+  EXPECT_FALSE(cache.get("key2", 1).has_value());
+  EXPECT_EQ(cache.get("key2", 2)->first, "val2");
+
+  // key1 刚被访问过, 超出容量时淘汰 key2
+  cache.get("key1", 0);
+  cache.put("key3", "val3", 3, cache.version("key3"));
+  EXPECT_TRUE(cache.get("key1", 0).has_value());
+  EXPECT_FALSE(cache.get("key2", 0).has_value());
+  EXPECT_LE(cache.size_bytes(), 2 * (64 + 8));
+
+  // 查询期间发生了失效操作, 过期的结果不会被写入
+  auto version = cache.version("key1");
+  cache.invalidate("key1");
+  cache.put("key1", "val1", 1, version);
+  EXPECT_FALSE(cache.get("key1", 0).has_value());
+
+  EXPECT_GT(cache.hit_rate(), 0.0);
+  EXPECT_LT(cache.hit_rate(), 1.0);
+
+  // 容量为 0 时不启用
+  RowCache disabled(0);
+  disabled.put("key1", "val1", 1, disabled.version("key1"));
+  EXPECT_FALSE(disabled.get("key1", 0).has_value());
+}
+
+TEST_F(LSMTest, RowCache) {
+  auto &&config = const_cast<TomlConfig &>(TomlConfig::getInstance());
+  config.modify_lsm_row_cache_capacity_bytes(1024 * 1024);
+
+  {
+    LSMEngine lsm(test_dir);
+    lsm.put("key1", "tranc1", 1);
+    lsm.put("key2", "tranc1", 1);
+    lsm.flush();
+    lsm.put("key1", "tranc3", 3);
+
+    // 第一次查询写入缓存, 第二次查询命中缓存
+    EXPECT_EQ(lsm.get("key2", 2).value().first, "tranc1");
+    EXPECT_EQ(lsm.get("key2", 2).value().first, "tranc1");
+    EXPECT_GT(lsm.row_cache->hit_rate(), 0.0);
+
+    // 缓存的最新版本对事务 2 不可见, 需要读到更早的版本
+    EXPECT_EQ(lsm.get("key1", 0).value().first, "tranc3");
+    EXPECT_EQ(lsm.get("key1", 2).value().first, "tranc1");
+    EXPECT_EQ(lsm.get("key1", 3).value().first, "tranc3");
+
+    // 写入和删除会使缓存失效
+    lsm.put("key2", "tranc4", 4);
+    EXPECT_EQ(lsm.get("key2", 4).value().first, "tranc4");
+    lsm.remove("key2", 5);
+    EXPECT_FALSE(lsm.get("key2", 5).has_value());
+    EXPECT_FALSE(lsm.get("key2", 5).has_value());
+    EXPECT_EQ(lsm.get("key2", 4).value().first, "tranc4");
+
+    // 不存在的 key 也会被缓存
+    EXPECT_FALSE(lsm.get("key3", 5).has_value());
+    lsm.put("key3", "tranc6", 6);
+    EXPECT_EQ(lsm.get("key3", 6).value().first, "tranc6");
+  }
+
+  {
+    // 事务提交后缓存失效
+    LSM lsm(test_dir);
+    EXPECT_FALSE(lsm.get("key4").has_value());
+    auto tran_ctx = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+    tran_ctx->put("key4", "value4");
+    EXPECT_FALSE(lsm.get("key4").has_value());
+    EXPECT_TRUE(tran_ctx->commit());
+    EXPECT_EQ(lsm.get("key4").value(), "value4");
+  }
+
+  config.modify_lsm_row_cache_capacity_bytes(0);
+}
+
+TEST(WriteQueueTest, GroupCommit) {
+  const int num_threads = 8;
+  const int num_writes = 50;
+
+  for (bool parallel_apply : {true, false}) {
+    std::atomic<int> wal_calls{0};
+    std::atomic<int> wal_records{0};
+    std::atomic<int> applied{0};
+    WriteQueue queue(
+        [&](const std::vector<Record> &records, bool sync) {
+          EXPECT_TRUE(sync);
+          wal_calls++;
+          wal_records += records.size();
+          // 模拟同步 wal 文件的耗时, 期间到达的写入者会组成下一组
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        },
+        16, parallel_apply);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < num_writes; i++) {
+          WriteQueue::Writer writer;
+          writer.records.push_back(Record::putRecord(
+              t * num_writes + i + 1, "key" + std::to_string(i), "value"));
+          writer.sync = true;
+          writer.apply = [&]() { applied++; };
+          EXPECT_TRUE(queue.write(writer));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_EQ(applied.load(), num_threads * num_writes);
+    EXPECT_EQ(wal_records.load(), num_threads * num_writes);
+    // 并发的写入者共享同步
+    EXPECT_LT(wal_calls.load(), num_threads * num_writes);
+  }
+
+  // wal 写入失败时不会写入 memtable
+  WriteQueue failed_queue(
+      [](const std::vector<Record> &, bool) {
+        throw std::runtime_error("disk full");
+      },
+      16, true);
+  bool applied = false;
+  WriteQueue::Writer writer;
+  writer.records.push_back(Record::putRecord(1, "key", "value"));
+  writer.apply = [&]() { applied = true; };
+  EXPECT_FALSE(failed_queue.write(writer));
+  EXPECT_FALSE(applied);
+}
+
 TEST_F(LSMTest, TranContextTest) {
   LSM lsm(test_dir);
   auto tran_ctx = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
@@ -300,6 +527,666 @@ TEST_F(LSMTest, TranContextTest) {
   EXPECT_FALSE(commit_res);
 }
 
+TEST_F(LSMTest, ReadUncommittedRollback) {
+  LSM lsm(test_dir);
+  lsm.put("a", "a0");
+  lsm.put("b", "b0");
+  lsm.flush();
+  lsm.put("b", "b1");
+
+  auto tran_ctx = lsm.begin_tran(IsolationLevel::READ_UNCOMMITTED);
+  tran_ctx->put("a", "x");
+  tran_ctx->put("a", "y");
+  tran_ctx->remove("b");
+  tran_ctx->put("c", "z");
+  tran_ctx->put("d", "w");
+  // 未提交的写入对其他读者可见
+  EXPECT_EQ(lsm.get("a").value(), "y");
+  EXPECT_FALSE(lsm.get("b").has_value());
+  EXPECT_EQ(lsm.get("c").value(), "z");
+
+  // 之后的写入覆盖了 d, 回滚时保留
+  lsm.put("d", "later");
+  // 回滚前的版本已经刷盘时也能读到
+  lsm.flush();
+  EXPECT_TRUE(tran_ctx->abort());
+
+  EXPECT_EQ(lsm.get("a").value(), "a0");
+  EXPECT_EQ(lsm.get("b").value(), "b1");
+  EXPECT_FALSE(lsm.get("c").has_value());
+  EXPECT_EQ(lsm.get("d").value(), "later");
+}
+
+TEST_F(LSMTest, ConcurrentCommits) {
+  LSM lsm(test_dir);
+
+  // 写集合不相交的事务并行提交, 全部成功
+  const int thread_num = 8;
+  const int tranc_num = 50;
+  std::atomic<int> committed{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < tranc_num; i++) {
+        auto tran_ctx = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+        auto key = "t" + std::to_string(t) + "-k" + std::to_string(i);
+        tran_ctx->put(key, key);
+        tran_ctx->put(key + "-extra", key);
+        if (tran_ctx->commit()) {
+          committed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(committed.load(), thread_num * tranc_num);
+  for (int t = 0; t < thread_num; t++) {
+    for (int i = 0; i < tranc_num; i++) {
+      auto key = "t" + std::to_string(t) + "-k" + std::to_string(i);
+      EXPECT_EQ(lsm.get(key).value_or(""), key);
+    }
+  }
+
+  // 更晚开始的事务先提交了相同的 key, 较早的事务提交时冲突
+  auto older = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+  auto newer = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+  older->put("shared", "older");
+  newer->put("shared", "newer");
+  EXPECT_TRUE(newer->commit());
+  EXPECT_FALSE(older->commit());
+  EXPECT_EQ(lsm.get("shared").value(), "newer");
+}
+
+TEST_F(LSMTest, LeaderAppliesWrites) {
+  // 关闭并行写入, 组内的 memtable 写入都由 leader 执行
+  auto &&config = const_cast<TomlConfig &>(TomlConfig::getInstance());
+  config.modify_write_parallel_apply(false);
+
+  {
+    LSM lsm(test_dir);
+    lsm.put("counter", "0");
+
+    // 普通写入和事务提交交替写入相同的 key, 不会死锁
+    const int thread_num = 4;
+    const int op_num = 50;
+    std::atomic<int> increments{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; t++) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < op_num; i++) {
+          auto key = "shared" + std::to_string(i % 8);
+          lsm.put(key, "plain" + std::to_string(t));
+
+          // 悲观事务读-改-写计数器, 提交成功的更新不会丢失
+          while (true) {
+            auto tran_ctx = lsm.begin_tran(IsolationLevel::REPEATABLE_READ,
+                                           TrancMode::PESSIMISTIC);
+            auto value = tran_ctx->get_for_update("counter");
+            tran_ctx->put("counter",
+                          std::to_string(std::stoi(value.value()) + 1));
+            tran_ctx->put(key, "tranc" + std::to_string(t));
+            if (tran_ctx->commit()) {
+              increments++;
+              break;
+            }
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_EQ(increments.load(), thread_num * op_num);
+    EXPECT_EQ(lsm.get("counter").value(), std::to_string(thread_num * op_num));
+  }
+
+  config.modify_write_parallel_apply(true);
+}
+
+TEST(CommitTableTest, HistoryAndEviction) {
+  CommitTable table(1, 2);
+  auto locks = table.lock({"a", "b", "c"});
+  table.record_("a", 10);
+  table.record_("b", 20);
+  EXPECT_EQ(table.has_newer_commit("a", 5), std::optional<bool>(true));
+  EXPECT_EQ(table.has_newer_commit("a", 10), std::optional<bool>(false));
+  EXPECT_EQ(table.has_newer_commit("c", 1), std::optional<bool>(false));
+
+  // 超过容量后淘汰最早的 a, 早于它的事务无法再通过表判断
+  table.record_("c", 30);
+  EXPECT_EQ(table.has_newer_commit("a", 5), std::nullopt);
+  EXPECT_EQ(table.has_newer_commit("a", 15), std::optional<bool>(false));
+  EXPECT_EQ(table.has_newer_commit("b", 15), std::optional<bool>(true));
+}
+
+TEST(LockManagerTest, SharedExclusiveAndDeadlock) {
+  LockManager manager(4);
+  auto short_wait = std::chrono::milliseconds(50);
+  auto long_wait = std::chrono::milliseconds(2000);
+
+  // 共享锁相互兼容, 与排他锁互斥, 已持有的锁可以重入
+  EXPECT_EQ(manager.lock(1, "a", false, short_wait), LockStatus::OK);
+  EXPECT_EQ(manager.lock(2, "a", false, short_wait), LockStatus::OK);
+  EXPECT_EQ(manager.lock(3, "a", true, short_wait), LockStatus::TIMEOUT);
+  EXPECT_EQ(manager.lock(1, "a", false, short_wait), LockStatus::OK);
+
+  // 释放其他共享锁后可以升级为排他锁
+  manager.unlock(2, {"a"});
+  EXPECT_EQ(manager.lock(1, "a", true, short_wait), LockStatus::OK);
+  EXPECT_EQ(manager.lock(2, "a", false, short_wait), LockStatus::TIMEOUT);
+
+  // 持有者释放后等待者被唤醒
+  std::thread waiter([&]() {
+    EXPECT_EQ(manager.lock(2, "a", true, long_wait), LockStatus::OK);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  manager.unlock(1, {"a"});
+  waiter.join();
+  manager.unlock(2, {"a"});
+  EXPECT_EQ(manager.lock_count(), 0);
+
+  // 1 持有 x 等待 y, 2 持有 y 再请求 x 时形成环
+  EXPECT_EQ(manager.lock(1, "x", true, short_wait), LockStatus::OK);
+  EXPECT_EQ(manager.lock(2, "y", true, short_wait), LockStatus::OK);
+  std::thread first([&]() {
+    EXPECT_EQ(manager.lock(1, "y", true, long_wait), LockStatus::OK);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(manager.lock(2, "x", true, long_wait), LockStatus::DEADLOCK);
+  manager.unlock(2, {"y"});
+  first.join();
+  manager.unlock(1, {"x", "y"});
+  EXPECT_EQ(manager.lock_count(), 0);
+}
+
+TEST_F(LSMTest, PessimisticTransactions) {
+  LSM lsm(test_dir);
+  lsm.put("counter", "0");
+
+  // 热点 key 上的读改写依次获得排他锁, 全部提交且没有丢失更新
+  const int thread_num = 8;
+  const int tranc_num = 25;
+  std::atomic<int> committed{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; t++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < tranc_num; i++) {
+        auto tran_ctx = lsm.begin_tran(IsolationLevel::REPEATABLE_READ,
+                                       TrancMode::PESSIMISTIC);
+        auto value = std::stoi(tran_ctx->get_for_update("counter").value());
+        tran_ctx->put("counter", std::to_string(value + 1));
+        if (tran_ctx->commit()) {
+          committed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(committed.load(), thread_num * tranc_num);
+  EXPECT_EQ(lsm.get("counter").value(),
+            std::to_string(thread_num * tranc_num));
+
+  // REPEATABLE_READ 的共享锁阻止其他事务修改已读取的 key
+  auto reader = lsm.begin_tran(IsolationLevel::REPEATABLE_READ,
+                               TrancMode::PESSIMISTIC);
+  EXPECT_EQ(reader->get("counter").value(),
+            std::to_string(thread_num * tranc_num));
+  auto writer = lsm.begin_tran(IsolationLevel::READ_COMMITTED,
+                               TrancMode::PESSIMISTIC);
+  std::thread blocked([&]() {
+    writer->put("counter", "reset");
+    EXPECT_TRUE(writer->commit());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(reader->get("counter").value(),
+            std::to_string(thread_num * tranc_num));
+  EXPECT_TRUE(reader->commit());
+  blocked.join();
+  EXPECT_EQ(lsm.get("counter").value(), "reset");
+
+  // 死锁时请求者被终止, 另一个事务可以继续提交
+  auto first = lsm.begin_tran(IsolationLevel::READ_COMMITTED,
+                              TrancMode::PESSIMISTIC);
+  auto second = lsm.begin_tran(IsolationLevel::READ_COMMITTED,
+                               TrancMode::PESSIMISTIC);
+  first->put("x", "first");
+  second->put("y", "second");
+  std::thread first_thread([&]() {
+    first->put("y", "first");
+    EXPECT_TRUE(first->commit());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_THROW(second->put("x", "second"), std::runtime_error);
+  EXPECT_TRUE(second->isAborted);
+  first_thread.join();
+  EXPECT_EQ(lsm.get("x").value(), "first");
+  EXPECT_EQ(lsm.get("y").value(), "first");
+
+  // 乐观事务提交时等待悲观事务释放排他锁, 之后校验出冲突, 不会丢失更新
+  auto pessimistic = lsm.begin_tran(IsolationLevel::REPEATABLE_READ,
+                                    TrancMode::PESSIMISTIC);
+  auto optimistic = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+  EXPECT_EQ(pessimistic->get_for_update("x").value(), "first");
+  optimistic->put("x", "optimistic");
+  std::atomic<bool> optimistic_done{false};
+  std::thread optimistic_thread([&]() {
+    EXPECT_FALSE(optimistic->commit());
+    optimistic_done = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(optimistic_done.load());
+  EXPECT_EQ(lsm.get("x").value(), "first");
+  pessimistic->put("x", "first+pessimistic");
+  EXPECT_TRUE(pessimistic->commit());
+  optimistic_thread.join();
+  EXPECT_TRUE(optimistic->isAborted);
+  EXPECT_EQ(lsm.get("x").value(), "first+pessimistic");
+
+  // 乐观事务先提交时, 之后加锁的悲观事务读到它的写入
+  auto optimistic2 = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+  optimistic2->put("x", "optimistic");
+  EXPECT_TRUE(optimistic2->commit());
+  auto pessimistic2 = lsm.begin_tran(IsolationLevel::REPEATABLE_READ,
+                                     TrancMode::PESSIMISTIC);
+  EXPECT_EQ(pessimistic2->get_for_update("x").value(), "optimistic");
+  EXPECT_TRUE(pessimistic2->commit());
+
+  // 悲观事务不支持 READ_UNCOMMITTED 和 SERIALIZABLE
+  EXPECT_THROW(
+      lsm.begin_tran(IsolationLevel::SERIALIZABLE, TrancMode::PESSIMISTIC),
+      std::invalid_argument);
+}
+
+
+// 非事务写入等待悲观事务持有的行锁, 不会覆盖事务读取的版本
+TEST_F(LSMTest, PlainWriteWaitsForRowLock) {
+  LSM lsm(test_dir);
+  lsm.put("x", "0");
+
+  auto tran_ctx =
+      lsm.begin_tran(IsolationLevel::REPEATABLE_READ, TrancMode::PESSIMISTIC);
+  EXPECT_EQ(tran_ctx->get_for_update("x").value(), "0");
+  std::atomic<bool> plain_done{false};
+  std::thread plain([&]() {
+    lsm.put("x", "plain");
+    plain_done = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(plain_done.load());
+  EXPECT_EQ(lsm.get("x").value(), "0");
+  tran_ctx->put("x", "0+1");
+  EXPECT_TRUE(tran_ctx->commit());
+  plain.join();
+  EXPECT_EQ(lsm.get("x").value(), "plain");
+
+  // REPEATABLE_READ 的共享锁同样阻止非事务写入, 事务内的读取保持一致
+  auto reader =
+      lsm.begin_tran(IsolationLevel::REPEATABLE_READ, TrancMode::PESSIMISTIC);
+  EXPECT_EQ(reader->get("x").value(), "plain");
+  std::thread batch([&]() { lsm.put_batch({{"y", "1"}, {"x", "plain2"}}); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(reader->get("x").value(), "plain");
+  EXPECT_FALSE(lsm.get("y").has_value());
+  EXPECT_TRUE(reader->commit());
+  batch.join();
+  EXPECT_EQ(lsm.get("x").value(), "plain2");
+  EXPECT_EQ(lsm.get("y").value(), "1");
+
+  // 等待超时时写入失败, 不会生效
+  auto holder =
+      lsm.begin_tran(IsolationLevel::READ_COMMITTED, TrancMode::PESSIMISTIC);
+  EXPECT_EQ(holder->get_for_update("x").value(), "plain2");
+  EXPECT_THROW(lsm.remove("x"), std::runtime_error);
+  EXPECT_EQ(lsm.get("x").value(), "plain2");
+  EXPECT_TRUE(holder->commit());
+  lsm.remove("x");
+  EXPECT_FALSE(lsm.get("x").has_value());
+}
+TEST_F(LSMTest, SerializableTransactions) {
+  LSM lsm(test_dir);
+  lsm.put("x", "1");
+  lsm.put("y", "1");
+
+  // 写偏斜: 两个事务读取相同的数据, 各自修改不同的 key
+  auto write_skew = [&](IsolationLevel level) {
+    auto t1 = lsm.begin_tran(level);
+    auto t2 = lsm.begin_tran(level);
+    EXPECT_EQ(t1->get("x").value(), "1");
+    EXPECT_EQ(t1->get("y").value(), "1");
+    EXPECT_EQ(t2->get("x").value(), "1");
+    EXPECT_EQ(t2->get("y").value(), "1");
+    t1->put("x", "0");
+    t2->put("y", "0");
+    bool res1 = t1->commit();
+    bool res2 = t2->commit();
+    lsm.put("x", "1");
+    lsm.put("y", "1");
+    return std::make_pair(res1, res2);
+  };
+  // REPEATABLE_READ 不检测读写依赖, 两个事务都能提交
+  EXPECT_EQ(write_skew(IsolationLevel::REPEATABLE_READ),
+            std::make_pair(true, true));
+  EXPECT_EQ(write_skew(IsolationLevel::SERIALIZABLE),
+            std::make_pair(true, false));
+
+  // 只读取不相交数据的事务不受影响
+  auto a = lsm.begin_tran(IsolationLevel::SERIALIZABLE);
+  auto b = lsm.begin_tran(IsolationLevel::SERIALIZABLE);
+  EXPECT_EQ(a->get("x").value(), "1");
+  EXPECT_EQ(b->get("y").value(), "1");
+  a->put("x", "2");
+  b->put("y", "2");
+  EXPECT_TRUE(a->commit());
+  EXPECT_TRUE(b->commit());
+
+  // 幻读: 两个事务检查同一个前缀范围后各自插入
+  auto p1 = lsm.begin_tran(IsolationLevel::SERIALIZABLE);
+  auto p2 = lsm.begin_tran(IsolationLevel::SERIALIZABLE);
+  EXPECT_TRUE(p1->scan_preffix("oncall_").empty());
+  EXPECT_TRUE(p2->scan_preffix("oncall_").empty());
+  p1->put("oncall_alice", "1");
+  p2->put("oncall_bob", "1");
+  // 事务内的范围查询能看到自身的写入
+  EXPECT_EQ(p1->scan_preffix("oncall_").size(), 1);
+  EXPECT_TRUE(p1->commit());
+  EXPECT_FALSE(p2->commit());
+  EXPECT_FALSE(lsm.get("oncall_bob").has_value());
+
+  // 快照: 开始后提交的事务即使 tranc_id 更小也不可见
+  auto writer = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+  auto reader = lsm.begin_tran(IsolationLevel::SERIALIZABLE);
+  writer->put("x", "3");
+  writer->remove("oncall_alice");
+  EXPECT_TRUE(writer->commit());
+  EXPECT_EQ(reader->get("x").value(), "2");
+  auto scan = reader->scan_preffix("oncall_");
+  ASSERT_EQ(scan.size(), 1);
+  EXPECT_EQ(scan[0].first, "oncall_alice");
+  // 并发事务已经提交了 x, 先提交者胜出
+  reader->put("x", "4");
+  EXPECT_FALSE(reader->commit());
+  EXPECT_EQ(lsm.get("x").value(), "3");
+}
+
+TEST_F(LSMTest, SnapshotWatermark) {
+  {
+    auto engine = std::make_shared<LSMEngine>(test_dir);
+    auto tran_manager = std::make_shared<TranManager>(test_dir);
+    tran_manager->set_engine(engine);
+    engine->set_tran_manager(tran_manager);
+
+    // 没有快照和活跃事务时, 所有分配过的 tranc_id 都可见
+    EXPECT_EQ(tran_manager->oldest_visible_tranc_id(), 0);
+    auto s1 = tran_manager->get_snapshot();
+    auto tranc = tran_manager->new_tranc(IsolationLevel::REPEATABLE_READ);
+    auto s2 = tran_manager->get_snapshot();
+    EXPECT_EQ(tran_manager->oldest_visible_tranc_id(), s1->get_tranc_id());
+    tran_manager->release_snapshot(s1);
+    EXPECT_EQ(tran_manager->oldest_visible_tranc_id(), tranc->tranc_id_);
+
+    // 结束的事务不再限制历史版本的清理
+    tranc->put("key", "value");
+    EXPECT_TRUE(tranc->commit());
+    EXPECT_EQ(tran_manager->oldest_visible_tranc_id(), s2->get_tranc_id());
+    tran_manager->release_snapshot(s2);
+    EXPECT_EQ(tran_manager->oldest_visible_tranc_id(), s2->get_tranc_id());
+  }
+  std::filesystem::remove_all(test_dir);
+  std::filesystem::create_directory(test_dir);
+
+  LSM lsm(test_dir);
+  lsm.put("key", "v0");
+  lsm.put("deleted", "v0");
+  auto snapshot = lsm.get_snapshot();
+  // 多次刷盘触发 compact, 快照仍能读到获取时的版本
+  for (int i = 1; i <= 12; i++) {
+    lsm.put("key", "v" + std::to_string(i));
+    lsm.remove("deleted");
+    lsm.flush();
+  }
+  EXPECT_EQ(lsm.get("key").value(), "v12");
+  EXPECT_FALSE(lsm.get("deleted").has_value());
+  EXPECT_EQ(lsm.get("key", *snapshot).value(), "v0");
+  EXPECT_EQ(lsm.get("deleted", *snapshot).value(), "v0");
+  lsm.release_snapshot(snapshot);
+
+  for (int i = 13; i <= 24; i++) {
+    lsm.put("key", "v" + std::to_string(i));
+    lsm.flush();
+  }
+  EXPECT_EQ(lsm.get("key").value(), "v24");
+  EXPECT_FALSE(lsm.get("deleted").has_value());
+}
+
+TEST_F(LSMTest, SnapshotCheckpoint) {
+  // 获取快照不会在已刷盘集合中留下空洞, 刷盘后检查点仍然可以推进
+  LSM lsm(test_dir);
+  auto first = lsm.get_snapshot();
+  lsm.put("key", "v0");
+  auto snapshot = lsm.get_snapshot();
+  lsm.put("key", "v1");
+  // 快照使用已经分配的最大 tranc_id, 即 v1 的 tranc_id
+  auto last = lsm.get_snapshot();
+  lsm.flush();
+
+  EXPECT_EQ(lsm.get("key", *snapshot).value(), "v0");
+  EXPECT_EQ(lsm.get("key", *last).value(), "v1");
+  EXPECT_FALSE(lsm.get("key", *first).has_value());
+
+  std::string copy_dir = test_dir + "_copy";
+  std::filesystem::remove_all(copy_dir);
+  std::filesystem::create_directory(copy_dir);
+  std::filesystem::copy_file(test_dir + "/tranc_id", copy_dir + "/tranc_id");
+  {
+    TranManager tran_manager(copy_dir);
+    EXPECT_EQ(tran_manager.get_checkpoint_tranc_id(), last->get_tranc_id());
+    EXPECT_EQ(tran_manager.get_flushed_tranc_ids().exception_count(), 0);
+  }
+  std::filesystem::remove_all(copy_dir);
+
+  lsm.release_snapshot(first);
+  lsm.release_snapshot(snapshot);
+  lsm.release_snapshot(last);
+}
+
+TEST_F(LSMTest, TransactionIterator) {
+  TrancWriteBatch batch;
+  batch.put("c", "1");
+  batch.put("a", "1");
+  batch.put("c", "2");
+  batch.remove("b");
+  EXPECT_EQ(batch.get("c").value(), "2");
+  EXPECT_EQ(batch.get("b").value(), "");
+  EXPECT_FALSE(batch.get("d").has_value());
+  // 按 key 的顺序输出
+  std::vector<std::pair<std::string, std::string>> expected = {
+      {"a", "1"}, {"b", ""}, {"c", "2"}};
+  EXPECT_EQ(batch.kvs(), expected);
+
+  LSM lsm(test_dir);
+  lsm.put("k1", "v1");
+  lsm.put("k2", "v2");
+  lsm.put("k4", "v4");
+  lsm.flush();
+  lsm.put("k3", "v3");
+
+  auto tranc = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
+  tranc->put("k0", "t0");
+  tranc->put("k2", "t2");
+  tranc->remove("k3");
+  tranc->put("k5", "t5");
+
+  // 事务的迭代器能看到自身的写入, 看不到自身删除的 key
+  std::vector<std::pair<std::string, std::string>> all;
+  for (auto it = tranc->begin(); it != tranc->end(); ++it) {
+    all.push_back(*it);
+  }
+  expected = {{"k0", "t0"}, {"k1", "v1"}, {"k2", "t2"},
+              {"k4", "v4"}, {"k5", "t5"}};
+  EXPECT_EQ(all, expected);
+  EXPECT_EQ(tranc->scan_preffix("k"), expected);
+
+  // 其他事务的提交对可重复读事务不可见
+  lsm.put("k6", "v6");
+  EXPECT_EQ(tranc->scan_preffix("k").size(), 5);
+  EXPECT_TRUE(tranc->commit());
+  EXPECT_EQ(lsm.get("k2").value(), "t2");
+  EXPECT_FALSE(lsm.get("k3").has_value());
+
+  auto reader = lsm.begin_tran(IsolationLevel::SERIALIZABLE);
+  reader->remove("k1");
+  all.clear();
+  for (auto it = reader->begin(); it != reader->end(); ++it) {
+    all.push_back(*it);
+  }
+  expected = {{"k0", "t0"}, {"k2", "t2"}, {"k4", "v4"},
+              {"k5", "t5"}, {"k6", "v6"}};
+  EXPECT_EQ(all, expected);
+  EXPECT_TRUE(reader->commit());
+}
+
+TEST(SerializableTrackerTest, VisibilityAndPrune) {
+  SerializableTracker tracker;
+  auto t1 = tracker.begin(1);
+  tracker.commit(2, {"a"});
+  // 应用前开始的事务也看不到 2 的写入
+  auto t3 = tracker.begin(3);
+  tracker.applied(2);
+  auto t4 = tracker.begin(4);
+  EXPECT_FALSE(tracker.visible(*t1, 2));
+  EXPECT_FALSE(tracker.visible(*t3, 2));
+  EXPECT_TRUE(tracker.visible(*t4, 2));
+  EXPECT_EQ(tracker.invisible_writes(*t1, "").size(), 1);
+  EXPECT_TRUE(tracker.invisible_writes(*t4, "").empty());
+
+  // 写写冲突
+  EXPECT_FALSE(tracker.validate_and_commit(t1, {"a"}));
+  tracker.record_read(*t3, "b");
+  EXPECT_TRUE(tracker.validate_and_commit(t3, {"c"}));
+  tracker.applied(3);
+  tracker.abort(t4);
+  // 没有活跃事务后, 已提交的事务不再需要保留
+  EXPECT_EQ(tracker.tracked_count(), 0);
+}
+
+TEST(WriteBatchTest, EncodeAndReuse) {
+  WriteBatch batch;
+  EXPECT_TRUE(batch.empty());
+  batch.put("b", "1");
+  batch.remove("a");
+  batch.put("a", "2");
+  batch.remove("b");
+  EXPECT_EQ(batch.count(), 4);
+
+  // 同一个 key 以最后一次操作为准, 结果按 key 排序
+  std::vector<std::pair<std::string, std::string>> expected = {{"a", "2"},
+                                                               {"b", ""}};
+  EXPECT_EQ(batch.kvs(), expected);
+
+  // 序列化后可以恢复, 格式错误时抛出异常
+  WriteBatch restored(batch.data());
+  EXPECT_EQ(restored.count(), 4);
+  EXPECT_EQ(restored.kvs(), expected);
+  auto broken = batch.data();
+  broken.pop_back();
+  EXPECT_THROW(WriteBatch{broken}, std::runtime_error);
+
+  batch.clear();
+  EXPECT_TRUE(batch.empty());
+  batch.put("c", "3");
+  EXPECT_EQ(batch.kvs().size(), 1);
+}
+
+TEST_F(LSMTest, WriteBatch) {
+  {
+    LSM lsm(test_dir);
+    lsm.put("old", "value");
+    lsm.put("keep", "value");
+
+    // put 和 remove 混合在一个批量写入中
+    WriteBatch batch;
+    batch.put("new", "value");
+    batch.remove("old");
+    batch.put("keep", "updated");
+    lsm.write(batch);
+    EXPECT_EQ(lsm.get("new").value(), "value");
+    EXPECT_FALSE(lsm.get("old").has_value());
+    EXPECT_EQ(lsm.get("keep").value(), "updated");
+
+    batch.clear();
+    batch.remove("new");
+    lsm.write(batch);
+  }
+  {
+    // 重启后从 wal 中恢复
+    LSM lsm(test_dir);
+    EXPECT_FALSE(lsm.get("new").has_value());
+    EXPECT_FALSE(lsm.get("old").has_value());
+    EXPECT_EQ(lsm.get("keep").value(), "updated");
+  }
+}
+
+TEST(TrancIdSetTest, WatermarkAndEncoding) {
+  TrancIdSet set(10);
+  EXPECT_TRUE(set.contains(3));
+  EXPECT_FALSE(set.insert(10));
+
+  // 不连续的 tranc_id 记录在位图中, 补齐空洞后低水位推进
+  EXPECT_TRUE(set.insert(12));
+  EXPECT_TRUE(set.insert(200));
+  EXPECT_EQ(set.low_watermark(), 10);
+  EXPECT_EQ(set.max(), 200);
+  EXPECT_FALSE(set.contains(11));
+  EXPECT_TRUE(set.insert(11));
+  EXPECT_EQ(set.low_watermark(), 12);
+  EXPECT_EQ(set.exceptions(), std::vector<uint64_t>{200});
+  for (uint64_t i = 13; i < 200; i++) {
+    set.insert(i);
+  }
+  EXPECT_EQ(set.low_watermark(), 200);
+  EXPECT_EQ(set.exception_count(), 0);
+
+  set.insert(300);
+  std::vector<uint8_t> buf;
+  set.encode(buf);
+  TrancIdSet decoded;
+  EXPECT_EQ(decoded.decode(buf.data(), buf.size()), buf.size());
+  EXPECT_EQ(decoded.low_watermark(), 200);
+  EXPECT_EQ(decoded.max(), 300);
+  EXPECT_TRUE(decoded.contains(300));
+  EXPECT_FALSE(decoded.contains(299));
+  EXPECT_EQ(decoded.decode(buf.data(), buf.size() - 1), 0);
+}
+
+TEST_F(LSMTest, TrancIdFileDelta) {
+  LSM lsm(test_dir);
+  uint64_t last_tranc_id = 0;
+  for (int i = 0; i < 10; i++) {
+    auto tran_ctx = lsm.begin_tran(IsolationLevel::READ_COMMITTED);
+    tran_ctx->put("key" + std::to_string(i), "value");
+    EXPECT_TRUE(tran_ctx->commit());
+    last_tranc_id = tran_ctx->tranc_id_;
+    lsm.flush();
+  }
+
+  // 刷盘时追加的 delta 在没有正常关闭时也能读到
+  std::string copy_dir = test_dir + "_copy";
+  std::filesystem::remove_all(copy_dir);
+  std::filesystem::create_directory(copy_dir);
+  std::filesystem::copy_file(test_dir + "/tranc_id", copy_dir + "/tranc_id");
+  {
+    TranManager tran_manager(copy_dir);
+    EXPECT_GE(tran_manager.get_checkpoint_tranc_id(), last_tranc_id);
+    EXPECT_GT(tran_manager.getNextTransactionId(), last_tranc_id);
+  }
+  std::filesystem::remove_all(copy_dir);
+}
+
 TEST_F(LSMTest, Recover) {
   {
     LSM lsm(test_dir);
@@ -337,6 +1224,42 @@ TEST_F(LSMTest, Recover) {
   }
 }
 
+TEST_F(LSMTest, PlainWritesLogged) {
+  LSM lsm(test_dir);
+  WriteOptions sync_options;
+  sync_options.sync = true;
+  WriteOptions no_wal_options;
+  no_wal_options.disable_wal = true;
+
+  lsm.put("key1", "value1", sync_options);
+  lsm.put_batch({{"key2", "value2"}, {"key3", "value3"}}, sync_options);
+  lsm.remove("key3", sync_options);
+  lsm.put("key4", "value4", no_wal_options);
+
+  // sync 写入返回时记录已经落盘, 崩溃后可以从 wal 恢复
+  auto tranc_records = WAL::recover(test_dir, 0);
+  std::map<std::string, std::string> recovered;
+  for (auto &[tranc_id, records] : tranc_records) {
+    ASSERT_EQ(records.back().getOperationType(), OperationType::COMMIT);
+    for (auto &record : records) {
+      if (record.getOperationType() == OperationType::PUT) {
+        recovered[record.getKey()] = record.getValue();
+      } else if (record.getOperationType() == OperationType::DELETE) {
+        recovered[record.getKey()] = "";
+      }
+    }
+  }
+  EXPECT_EQ(recovered["key1"], "value1");
+  EXPECT_EQ(recovered["key2"], "value2");
+  EXPECT_EQ(recovered["key3"], "");
+  // 没有写 wal 的数据
+  EXPECT_EQ(recovered.count("key4"), 0);
+
+  EXPECT_EQ(lsm.get("key1").value(), "value1");
+  EXPECT_FALSE(lsm.get("key3").has_value());
+  EXPECT_EQ(lsm.get("key4").value(), "value4");
+}
+
 TEST_F(LSMTest, BigPersistence) {
   std::unordered_map<std::string, std::string> kvs;
   int num = 2000000;
@@ -1,9 +1,14 @@
+#include "../include/config/config.h"
 #include "../include/consts.h"
 #include "../include/iterator/iterator.h"
 #include "../include/logger/logger.h"
 #include "../include/memtable/memtable.h"
+#include "../include/memtable/memtable_rep.h"
+#include <algorithm>
+#include <atomic>
 #include <gtest/gtest.h>
 #include <iomanip>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <utility>
@@ -510,6 +515,219 @@ TEST(MemTableTest, ItersPredicate_Large) {
   EXPECT_TRUE(range_begin_iter.is_end());
 }
 
+// 测试不同的 memtable 存储结构
+TEST(MemTableRepTest, AllReps) {
+  std::vector<std::shared_ptr<MemTableRep>> reps = {
+      std::make_shared<SkipListRep>(), std::make_shared<HashSkipListRep>(16),
+      std::make_shared<VectorRep>()};
+
+  for (auto &rep : reps) {
+    for (int i = 99; i >= 0; i--) {
+      std::ostringstream oss;
+      oss << "key" << std::setw(3) << std::setfill('0') << i;
+      rep->put(oss.str(), "v1_" + std::to_string(i), 1);
+      rep->put(oss.str(), "v2_" + std::to_string(i), 2);
+    }
+    // 相同的 (key, tranc_id) 覆盖写入
+    rep->put("key050", "v2_new", 2);
+    rep->put("key051", "", 3);
+    EXPECT_GT(rep->get_size(), 0);
+
+    EXPECT_EQ(rep->get("key050", 0).get_value(), "v2_new");
+    EXPECT_EQ(rep->get("key050", 1).get_value(), "v1_50");
+    EXPECT_EQ(rep->get("key051", 0).get_tranc_id(), 3);
+    EXPECT_TRUE(rep->get("key051", 0).get_value().empty());
+    EXPECT_FALSE(rep->get("key100", 0).is_valid());
+
+    // 谓词查询, 同一个 key 的版本按 tranc_id 降序连续访问
+    std::vector<std::pair<std::string, uint64_t>> scanned;
+    rep->scan(
+        [](const std::string &key) {
+          if (key < "key010") {
+            return 1;
+          }
+          return key < "key020" ? 0 : -1;
+        },
+        [&](const SkipListIterator &iter) {
+          scanned.emplace_back(iter.get_key(), iter.get_tranc_id());
+        });
+    EXPECT_EQ(scanned.size(), 20);
+    for (size_t i = 0; i + 1 < scanned.size(); i += 2) {
+      EXPECT_EQ(scanned[i].first, scanned[i + 1].first);
+      EXPECT_EQ(scanned[i].second, 2);
+      EXPECT_EQ(scanned[i + 1].second, 1);
+    }
+
+    rep->freeze();
+    auto data = rep->flush();
+    ASSERT_EQ(data.size(), 201);
+    EXPECT_TRUE(std::is_sorted(data.begin(), data.end(),
+                               [](const auto &a, const auto &b) {
+                                 if (std::get<0>(a) != std::get<0>(b)) {
+                                   return std::get<0>(a) < std::get<0>(b);
+                                 }
+                                 return std::get<2>(a) > std::get<2>(b);
+                               }));
+    EXPECT_EQ(std::get<0>(data[0]), "key000");
+    EXPECT_EQ(std::get<2>(data[0]), 2);
+
+    rep->clear();
+    EXPECT_EQ(rep->get_size(), 0);
+    EXPECT_FALSE(rep->get("key050", 0).is_valid());
+  }
+}
+
+// 测试 VectorRep 在有序前缀和无序尾部之间交替读写
+TEST(MemTableRepTest, VectorRepUnsortedTail) {
+  VectorRep rep;
+  // 按序写入, 全部落在有序前缀中
+  for (int i = 0; i < 10; i++) {
+    rep.put("key" + std::to_string(i), "v1", 1);
+  }
+  // 乱序写入, 落在尾部, 包括覆盖前缀中相同的 (key, tranc_id)
+  rep.put("key5", "v2", 2);
+  rep.put("key3", "v1_new", 1);
+  rep.put("key3", "v1_newer", 1);
+  rep.put("key0", "v3", 3);
+  rep.put("key95", "v1", 1);
+
+  EXPECT_EQ(rep.get("key5", 0).get_value(), "v2");
+  EXPECT_EQ(rep.get("key5", 1).get_value(), "v1");
+  EXPECT_EQ(rep.get("key3", 0).get_value(), "v1_newer");
+  EXPECT_EQ(rep.get("key0", 2).get_value(), "v1");
+  EXPECT_EQ(rep.get("key0", 0).get_tranc_id(), 3);
+  EXPECT_EQ(rep.get("key95", 0).get_value(), "v1");
+  EXPECT_FALSE(rep.get("key10", 0).is_valid());
+
+  // 读取不会改变尾部, 之后的写入仍然可见
+  rep.put("key3", "v4", 4);
+  EXPECT_EQ(rep.get("key3", 0).get_value(), "v4");
+  EXPECT_EQ(rep.get("key3", 3).get_value(), "v1_newer");
+
+  std::vector<std::tuple<std::string, std::string, uint64_t>> scanned;
+  rep.scan(
+      [](const std::string &key) {
+        if (key < "key3") {
+          return 1;
+        }
+        return key < "key6" ? 0 : -1;
+      },
+      [&](const SkipListIterator &iter) {
+        scanned.emplace_back(iter.get_key(), iter.get_value(),
+                             iter.get_tranc_id());
+      });
+  std::vector<std::tuple<std::string, std::string, uint64_t>> expected = {
+      {"key3", "v4", 4}, {"key3", "v1_newer", 1}, {"key4", "v1", 1},
+      {"key5", "v2", 2}, {"key5", "v1", 1}};
+  EXPECT_EQ(scanned, expected);
+
+  rep.freeze();
+  auto data = rep.flush();
+  ASSERT_EQ(data.size(), 14);
+  EXPECT_EQ(data[0], std::make_tuple(std::string("key0"), std::string("v3"),
+                                     uint64_t(3)));
+  EXPECT_EQ(rep.get("key3", 0).get_value(), "v4");
+}
+
+// 测试通过配置切换 memtable 的存储结构
+TEST(MemTableTest, ConfiguredRep) {
+  auto &config = const_cast<TomlConfig &>(TomlConfig::getInstance());
+  for (std::string rep : {"hash_skiplist", "vector"}) {
+    config.modify_memtable_rep(rep);
+    MemTable memtable;
+    for (int i = 0; i < 100; i++) {
+      memtable.put("key" + std::to_string(i), "value" + std::to_string(i), 0);
+    }
+    memtable.frozen_cur_table();
+    memtable.remove("key1", 0);
+    memtable.put("key2", "new_value", 0);
+
+    EXPECT_EQ(memtable.get("key3", 0).get_value(), "value3");
+    EXPECT_EQ(memtable.get("key2", 0).get_value(), "new_value");
+    EXPECT_TRUE(memtable.get("key1", 0).get_value().empty());
+
+    std::vector<std::string> keys;
+    for (auto it = memtable.iters_preffix("key1", 0); !it.is_end(); ++it) {
+      keys.push_back(it->first);
+    }
+    // key1 已被删除, 剩余 key10 ~ key19
+    EXPECT_EQ(keys.size(), 10);
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+  }
+  config.modify_memtable_rep("skiplist");
+}
+
+// 批量写入对读者原子地生效
+TEST(MemTableTest, AtomicBatch) {
+  MemTable memtable;
+  const int batch_num = 2000;
+  std::atomic<bool> reading{false};
+  std::atomic<bool> done{false};
+
+  std::thread writer([&]() {
+    // 批次写入不会阻塞读者, 等读者开始后再写入, 保证两者重叠
+    while (!reading.load()) {
+      std::this_thread::yield();
+    }
+    for (int i = 1; i <= batch_num; i++) {
+      auto value = std::to_string(i);
+      memtable.put_batch({{"a", value}, {"b", value}, {"c", value}}, i);
+    }
+    done = true;
+  });
+
+  int checked = 0;
+  while (!done.load()) {
+    reading = true;
+    auto res = memtable.get_batch({"a", "b", "c"}, 0);
+    if (res[0].second.has_value()) {
+      EXPECT_TRUE(res[1].second.has_value());
+      EXPECT_TRUE(res[2].second.has_value());
+      EXPECT_EQ(res[0].second->first, res[1].second->first);
+      EXPECT_EQ(res[0].second->first, res[2].second->first);
+    }
+
+    std::vector<std::string> values;
+    for (auto it = memtable.begin(0); !it.is_end(); ++it) {
+      values.push_back(it->second);
+    }
+    if (!values.empty()) {
+      EXPECT_EQ(values.size(), 3);
+      EXPECT_EQ(std::count(values.begin(), values.end(), values[0]), 3);
+    }
+    checked++;
+  }
+  writer.join();
+  EXPECT_GT(checked, 0);
+}
+
+// 测试批次的发布序号和读者快照
+TEST(MemTableTest, BatchVisibility) {
+  BatchVisibility visibility;
+  visibility.begin(5);
+  {
+    // 未发布的批次对所有读者不可见
+    BatchVisibility::Reader reader(visibility, false);
+    EXPECT_FALSE(reader.visible(5));
+    EXPECT_TRUE(reader.visible(4));
+  }
+
+  BatchVisibility::Reader old_reader(visibility, true);
+  EXPECT_FALSE(old_reader.visible(5));
+  visibility.publish(5);
+  // 快照之后发布的批次对旧的读者仍然不可见
+  EXPECT_FALSE(old_reader.visible(5));
+  visibility.begin(6);
+  visibility.publish(6);
+  EXPECT_FALSE(old_reader.visible(6));
+
+  BatchVisibility::Reader new_reader(visibility, true);
+  EXPECT_TRUE(new_reader.visible(5));
+  EXPECT_TRUE(new_reader.visible(6));
+  BatchVisibility::Reader single_reader(visibility, false);
+  EXPECT_TRUE(single_reader.visible(5));
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
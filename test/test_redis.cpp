@@ -243,6 +243,58 @@ TEST_F(RedisCommandsTest, ListOperations) {
   std::string expected_lrange2 = "*1\r\n$6\r\nvalue1\r\n";
   EXPECT_EQ(lsm.lrange(lrange_args2), expected_lrange2);
 }
+TEST_F(RedisCommandsTest, ListElementEncoding) {
+  RedisWrapper lsm(test_dir);
+
+  // 元素中可以包含旧版本的分隔符
+  std::vector<std::string> rpush_args = {"RPUSH", "mylist", "a#b"};
+  EXPECT_EQ(lsm.rpush(rpush_args), ":1\r\n");
+  for (int i = 0; i < 100; i++) {
+    std::vector<std::string> args = {"RPUSH", "mylist", std::to_string(i)};
+    EXPECT_EQ(lsm.rpush(args), ":" + std::to_string(i + 2) + "\r\n");
+  }
+  std::vector<std::string> lpush_args = {"LPUSH", "mylist", "head"};
+  EXPECT_EQ(lsm.lpush(lpush_args), ":102\r\n");
+
+  std::vector<std::string> lrange_args = {"LRANGE", "mylist", "0", "2"};
+  EXPECT_EQ(lsm.lrange(lrange_args),
+            "*3\r\n$4\r\nhead\r\n$3\r\na#b\r\n$1\r\n0\r\n");
+  std::vector<std::string> lrange_tail = {"LRANGE", "mylist", "-2", "-1"};
+  EXPECT_EQ(lsm.lrange(lrange_tail), "*2\r\n$2\r\n98\r\n$2\r\n99\r\n");
+
+  // 名称以 mylist_ 开头的链表不会出现在范围查询中
+  std::vector<std::string> other_args = {"RPUSH", "mylist_8", "other"};
+  EXPECT_EQ(lsm.rpush(other_args), ":1\r\n");
+  std::vector<std::string> lrange_all = {"LRANGE", "mylist", "0", "-1"};
+  EXPECT_EQ(lsm.lrange(lrange_all).substr(0, 6), "*102\r\n");
+
+  std::vector<std::string> lpop_args = {"LPOP", "mylist"};
+  EXPECT_EQ(lsm.lpop(lpop_args), "$4\r\nhead\r\n");
+  std::vector<std::string> rpop_args = {"RPOP", "mylist"};
+  EXPECT_EQ(lsm.rpop(rpop_args), "$2\r\n99\r\n");
+  std::vector<std::string> llen_args = {"LLEN", "mylist"};
+  EXPECT_EQ(lsm.llen(llen_args), ":100\r\n");
+
+  // 删除链表时同时删除所有元素
+  std::vector<std::string> del_args = {"DEL", "mylist"};
+  EXPECT_EQ(lsm.del(del_args), ":1\r\n");
+  EXPECT_EQ(lsm.llen(llen_args), ":0\r\n");
+  EXPECT_EQ(lsm.lrange(lrange_all), "*0\r\n");
+  EXPECT_EQ(lsm.rpush(rpush_args), ":1\r\n");
+  EXPECT_EQ(lsm.lrange(lrange_all), "*1\r\n$3\r\na#b\r\n");
+
+  // 旧版本用分隔符拼接的链表可以读取, 写入时转换为按元素存储
+  std::vector<std::string> set_args = {"SET", "legacy", "x#y#z"};
+  lsm.set(set_args);
+  std::vector<std::string> legacy_llen = {"LLEN", "legacy"};
+  EXPECT_EQ(lsm.llen(legacy_llen), ":3\r\n");
+  std::vector<std::string> legacy_lpush = {"LPUSH", "legacy", "w"};
+  EXPECT_EQ(lsm.lpush(legacy_lpush), ":4\r\n");
+  std::vector<std::string> legacy_lrange = {"LRANGE", "legacy", "0", "-1"};
+  EXPECT_EQ(lsm.lrange(legacy_lrange),
+            "*4\r\n$1\r\nw\r\n$1\r\nx\r\n$1\r\ny\r\n$1\r\nz\r\n");
+}
+
 TEST_F(RedisCommandsTest, ZSetOperations) {
   RedisWrapper lsm(test_dir);
 
@@ -286,6 +338,43 @@ TEST_F(RedisCommandsTest, ZSetOperations) {
   EXPECT_EQ(res, ":2\r\n");
 }
 
+TEST_F(RedisCommandsTest, ZAddUpdateScore) {
+  RedisWrapper lsm(test_dir);
+
+  std::vector<std::string> zadd_args1 = {"ZADD", "myzset", "1", "one",
+                                         "2",    "two"};
+  EXPECT_EQ(lsm.zadd(zadd_args1), ":2\r\n");
+
+  // 更新已有成员的 score, 旧 score 的记录被删除
+  std::vector<std::string> zadd_args2 = {"ZADD", "myzset", "3", "one"};
+  EXPECT_EQ(lsm.zadd(zadd_args2), ":1\r\n");
+
+  std::vector<std::string> zrange_args = {"ZRANGE", "myzset", "0", "-1"};
+  EXPECT_EQ(lsm.zrange(zrange_args), "*2\r\n$3\r\ntwo\r\n$3\r\none\r\n");
+  std::vector<std::string> zcard_args = {"ZCARD", "myzset"};
+  EXPECT_EQ(lsm.zcard(zcard_args), ":2\r\n");
+}
+
+// 同一条命令中重复的 key 或元素只处理一次
+TEST_F(RedisCommandsTest, DuplicateArguments) {
+  RedisWrapper lsm(test_dir);
+
+  std::vector<std::string> set_args = {"SET", "a", "1"};
+  lsm.set(set_args);
+  std::vector<std::string> del_args = {"DEL", "a", "a", "missing", "a"};
+  EXPECT_EQ(lsm.del(del_args), ":1\r\n");
+  std::vector<std::string> get_args = {"GET", "a"};
+  EXPECT_EQ(lsm.get(get_args), "$-1\r\n");
+
+  std::vector<std::string> zadd_args = {"ZADD", "myzset", "1", "one",
+                                        "2",    "two"};
+  EXPECT_EQ(lsm.zadd(zadd_args), ":2\r\n");
+  std::vector<std::string> zrem_args = {"ZREM", "myzset", "two", "two"};
+  EXPECT_EQ(lsm.zrem(zrem_args), ":1\r\n");
+  std::vector<std::string> zcard_args = {"ZCARD", "myzset"};
+  EXPECT_EQ(lsm.zcard(zcard_args), ":1\r\n");
+}
+
 TEST_F(RedisCommandsTest, SetOperations) {
   RedisWrapper lsm(test_dir);
 
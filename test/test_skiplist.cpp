@@ -161,21 +161,25 @@ TEST(SkipListTest, RandomInsertAndRemove) {
 // 测试内存大小跟踪
 TEST(SkipListTest, MemorySizeTracking) {
   SkipList skipList;
+  EXPECT_EQ(skipList.get_size(), 0);
 
   // 插入数据
   skipList.put("key1", "value1", 0);
   skipList.put("key2", "value2", 0);
 
-  // 验证内存大小
-  size_t expected_size = sizeof("key1") - 1 + sizeof("value1") - 1 +
-                         sizeof(uint64_t) + sizeof("key2") - 1 +
-                         sizeof("value2") - 1 + sizeof(uint64_t);
-  EXPECT_EQ(skipList.get_size(), expected_size);
+  // 验证内存大小, 每个节点至少包含节点头部, key 和带长度的 value
+  size_t min_size = 2 * (sizeof(SkipListNode) + sizeof("key1") - 1 +
+                         sizeof(uint32_t) + sizeof("value1") - 1);
+  EXPECT_GE(skipList.get_size(), min_size);
 
-  // 删除数据
+  // 删除数据, 被删除节点的内存在跳表释放前不会回收
+  auto size = skipList.get_size();
   skipList.remove("key1");
-  expected_size -= sizeof("key1") - 1 + sizeof("value1") - 1 + sizeof(uint64_t);
-  EXPECT_EQ(skipList.get_size(), expected_size);
+  EXPECT_EQ(skipList.get_size(), size);
+
+  // 覆盖相同事务 id 的 value 需要重新分配 value
+  skipList.put("key2", "value22", 0);
+  EXPECT_EQ(skipList.get_size(), size + 16);
 
   skipList.clear();
   EXPECT_EQ(skipList.get_size(), 0);
@@ -343,8 +347,79 @@ TEST(SkipListTest, TransactionId) {
   EXPECT_EQ((skipList.get("key1", 2).get_value()), "value2");
 }
 
-// ! 现在的实现, 并发的锁由 SkipList 的上层 MemTable 实现, 因此不需要测试
-// SkipList 的并发性
+// 测试多线程并发插入, 同时有读线程查询和遍历
+TEST(SkipListTest, ConcurrentPut) {
+  SkipList skipList;
+  const int num_writers = 4;
+  const int num_operations = 5000; // 每个线程的操作数
+
+  std::atomic<bool> start{false};
+  std::atomic<bool> writers_done{false};
+
+  auto writer_func = [&](int thread_id) {
+    while (!start) {
+      std::this_thread::yield();
+    }
+    for (int i = 0; i < num_operations; ++i) {
+      std::string key = "key_" + std::to_string(i) + "_" +
+                        std::to_string(thread_id);
+      skipList.put(key, "value_" + std::to_string(i), i + 1);
+      // 相同的 key 由不同事务写入新的版本
+      if (i % 10 == 0) {
+        skipList.put(key, "new_value_" + std::to_string(i), i + 2);
+      }
+    }
+  };
+
+  auto reader_func = [&]() {
+    while (!start) {
+      std::this_thread::yield();
+    }
+    while (!writers_done) {
+      // 遍历过程中 key 始终有序
+      std::string last_key;
+      for (auto it = skipList.begin(); it != skipList.end(); ++it) {
+        auto key = it.get_key();
+        ASSERT_LE(last_key, key);
+        last_key = key;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_writers; ++i) {
+    threads.emplace_back(writer_func, i);
+  }
+  std::thread reader(reader_func);
+
+  start = true;
+  for (auto &t : threads) {
+    t.join();
+  }
+  writers_done = true;
+  reader.join();
+
+  // 验证所有写入都可见
+  for (int thread_id = 0; thread_id < num_writers; ++thread_id) {
+    for (int i = 0; i < num_operations; ++i) {
+      std::string key = "key_" + std::to_string(i) + "_" +
+                        std::to_string(thread_id);
+      std::string value = "value_" + std::to_string(i);
+      if (i % 10 == 0) {
+        EXPECT_EQ(skipList.get(key, 0).get_value(), "new_" + value);
+      }
+      EXPECT_EQ(skipList.get(key, i + 1).get_value(), value);
+    }
+  }
+
+  size_t count = 0;
+  for (auto it = skipList.begin(); it != skipList.end(); ++it) {
+    count++;
+  }
+  EXPECT_EQ(count, num_writers * (num_operations + num_operations / 10));
+}
+
+// ! remove 不支持与其他操作并发调用, 下面包含 remove 的并发测试不再适用
 // // 测试跳表的并发性能
 // TEST(SkipListTest, ConcurrentOperations) {
 //   SkipList skipList;
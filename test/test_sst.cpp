@@ -3,6 +3,8 @@
 #include "../include/logger/logger.h"
 #include "../include/sst/sst.h"
 #include "../include/sst/sst_iterator.h"
+#include "../include/utils/bloom_filter.h"
+#include <cstring>
 #include <filesystem>
 #include <gtest/gtest.h>
 
@@ -151,6 +153,167 @@ TEST_F(SSTTest, ReopenSST) {
   EXPECT_EQ(sst->num_blocks(), reopened_sst->num_blocks());
 }
 
+// 测试每个 block 的事务 id 范围
+TEST_F(SSTTest, BlockTrancIdRange) {
+  SSTBuilder builder(64, true);
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  for (int i = 0; i < 20; i++) {
+    char key[8];
+    snprintf(key, sizeof(key), "k%02d", i);
+    builder.add(key, "value", i + 1);
+  }
+  builder.build(1, "test_data/tranc.sst", block_cache);
+
+  FileObj file = FileObj::open("test_data/tranc.sst", false);
+  auto sst = SST::open(1, std::move(file), block_cache);
+  ASSERT_GT(sst->num_blocks(), 2);
+  EXPECT_TRUE(sst->block_visible(0, 1));
+  EXPECT_FALSE(sst->block_visible(sst->num_blocks() - 1, 5));
+  EXPECT_TRUE(sst->block_visible(sst->num_blocks() - 1, 0));
+
+  // 快照只能看到前 5 个 key, 之后的 block 不会被读取
+  std::vector<std::string> keys;
+  for (auto it = sst->begin(5); it.is_valid() && !it.is_end(); ++it) {
+    keys.push_back(it.key());
+  }
+  EXPECT_EQ(keys, std::vector<std::string>({"k00", "k01", "k02", "k03", "k04"}));
+  EXPECT_FALSE(sst->get("k15", 5).is_valid());
+  EXPECT_TRUE(sst->get("k15", 16).is_valid());
+
+  EXPECT_TRUE(sst->has_newer_version("k15", 15));
+  EXPECT_FALSE(sst->has_newer_version("k15", 16));
+  EXPECT_FALSE(sst->has_newer_version("k03", 10));
+  EXPECT_FALSE(sst->has_newer_version("k99", 0));
+}
+
+// 测试布隆过滤器按照 sst 实际的 key 数量分配空间
+TEST_F(SSTTest, BloomFilterSizedByKeys) {
+  auto sst = create_test_sst(256, 100);
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+
+  // 100 个 key 的布隆过滤器只需要很小的空间
+  FileObj file = FileObj::open("test_data/test.sst", false);
+  EXPECT_LT(file.size(), 8 * 1024);
+  auto reopened_sst = SST::open(1, std::move(file), block_cache);
+
+  // 存在的 key 不能被过滤
+  for (int i = 0; i < 100; i++) {
+    EXPECT_NE(reopened_sst->find_block_idx("key" + std::to_string(i)), -1);
+  }
+
+  // 范围内不存在的 key 大部分应被过滤
+  int false_positives = 0;
+  for (int i = 0; i < 1000; i++) {
+    if (reopened_sst->find_block_idx("key5_" + std::to_string(i)) != -1) {
+      false_positives++;
+    }
+  }
+  EXPECT_LT(false_positives, 50);
+}
+
+// 测试前缀过滤器和范围过滤器
+TEST_F(SSTTest, PreffixFilter) {
+  // 集合 id 均为两位数, 保证 key 有序
+  SSTBuilder builder(256, true);
+  for (int set_id = 10; set_id < 100; set_id += 2) {
+    for (int i = 0; i < 5; i++) {
+      builder.add("REDIS_SET_s" + std::to_string(set_id) + "_m" +
+                      std::to_string(i),
+                  "1", 0);
+    }
+  }
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  builder.build(1, "test_data/preffix.sst", block_cache);
+
+  FileObj file = FileObj::open("test_data/preffix.sst", false);
+  auto sst = SST::open(1, std::move(file), block_cache);
+
+  // 存在的前缀不能被过滤
+  for (int set_id = 10; set_id < 100; set_id += 2) {
+    EXPECT_TRUE(
+        sst->may_contain_preffix("REDIS_SET_s" + std::to_string(set_id) + "_"));
+    // 比过滤前缀更长的查询同样适用
+    EXPECT_TRUE(sst->may_contain_preffix("REDIS_SET_s" +
+                                         std::to_string(set_id) + "_m1"));
+  }
+
+  // 不存在的前缀应被过滤
+  for (int set_id = 11; set_id < 100; set_id += 2) {
+    EXPECT_FALSE(
+        sst->may_contain_preffix("REDIS_SET_s" + std::to_string(set_id) + "_"));
+  }
+
+  // 不在提取器定义域内的前缀无法使用前缀过滤器, 由范围过滤器判断
+  EXPECT_TRUE(sst->may_contain_preffix("REDIS_SET_s"));
+  EXPECT_TRUE(sst->may_contain_preffix("REDIS_SET_s5"));
+  EXPECT_FALSE(sst->may_contain_preffix("REDIS_SET_s0"));
+  EXPECT_FALSE(sst->may_contain_preffix("REDIS_ZZZ"));
+
+  // 范围查询
+  EXPECT_TRUE(sst->may_contain_range("REDIS_SET_s4", "REDIS_SET_s40_m0"));
+  EXPECT_FALSE(sst->may_contain_range("REDIS_SET_s11", "REDIS_SET_s11_z"));
+  EXPECT_FALSE(sst->may_contain_range("REDIS_SET_s99", "REDIS_SET_t"));
+}
+
+// 测试旧版本和损坏的 Filter Section
+TEST_F(SSTTest, LegacyFilterSection) {
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  SSTBuilder builder(256, false);
+  BloomFilter bloom(100, 0.01);
+  for (int i = 0; i < 100; i++) {
+    builder.add("key" + std::to_string(i), "value", 0);
+    bloom.add("key" + std::to_string(i));
+  }
+  builder.build(1, "test_data/plain.sst", block_cache);
+
+  // 没有过滤器时 Filter Section 为空, 在 filter offset 处插入过滤器数据
+  auto plain = FileObj::open("test_data/plain.sst", false);
+  auto bytes = plain.read_to_slice(0, plain.size());
+  size_t extra_size = sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2;
+  auto make_sst = [&](const std::string &path,
+                      const std::vector<uint8_t> &filter_data) {
+    std::vector<uint8_t> content(bytes.begin(), bytes.end() - extra_size);
+    content.insert(content.end(), filter_data.begin(), filter_data.end());
+    content.insert(content.end(), bytes.end() - extra_size, bytes.end());
+    FileObj::create_and_write(path, content);
+    return SST::open(1, FileObj::open(path, false), block_cache);
+  };
+
+  // 旧版本的 Filter Section 只有布隆过滤器的编码数据
+  auto legacy = make_sst("test_data/legacy.sst", bloom.encode());
+  for (int i = 0; i < 100; i++) {
+    EXPECT_NE(legacy->find_block_idx("key" + std::to_string(i)), -1);
+  }
+  int filtered = 0;
+  for (int i = 0; i < 100; i++) {
+    if (legacy->find_block_idx("key5_" + std::to_string(i)) == -1) {
+      filtered++;
+    }
+  }
+  EXPECT_GT(filtered, 90);
+
+  // 无法解析的 Filter Section 视为没有过滤器
+  std::vector<uint8_t> corrupted(sizeof(uint64_t) + 1 + sizeof(uint32_t),
+                                 0xff);
+  memcpy(corrupted.data(), &SST_FILTER_MAGIC, sizeof(uint64_t));
+  corrupted[sizeof(uint64_t)] = SST_FILTER_VERSION;
+  for (auto &filter_data :
+       {corrupted, std::vector<uint8_t>(7, 0xff), std::vector<uint8_t>(64, 0)}) {
+    std::shared_ptr<SST> sst;
+    EXPECT_NO_THROW(sst = make_sst("test_data/corrupted.sst", filter_data));
+    EXPECT_NE(sst->find_block_idx("key5_0"), -1);
+    EXPECT_TRUE(sst->get("key42", 0).is_valid());
+  }
+}
+
 // 测试大文件
 TEST_F(SSTTest, LargeSST) {
   SSTBuilder builder(4096, true); // 4KB blocks
@@ -1,7 +1,13 @@
 #include "../include/logger/logger.h"
+#include "../include/utils/arena.h"
 #include "../include/utils/bloom_filter.h"
+#include "../include/utils/crc32c.h"
 #include "../include/utils/cursor.h"
 #include "../include/utils/files.h"
+#include "../include/utils/prefix_extractor.h"
+#include "../include/utils/range_filter.h"
+#include "../include/utils/xor_filter.h"
+#include <cstring>
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <random>
@@ -135,6 +141,36 @@ TEST_F(FileTest, MoveSemantics) {
   EXPECT_EQ(read_data, data);
 }
 
+TEST_F(FileTest, SyncModes) {
+  EXPECT_EQ(sync_mode_from_string("none"), SyncMode::NONE);
+  EXPECT_EQ(sync_mode_from_string("os"), SyncMode::OS);
+  EXPECT_EQ(sync_mode_from_string("fsync"), SyncMode::FSYNC);
+  EXPECT_EQ(sync_mode_from_string("dsync"), SyncMode::DSYNC);
+  EXPECT_EQ(sync_mode_from_string("unknown"), SyncMode::FDATASYNC);
+
+  for (auto mode : {SyncMode::NONE, SyncMode::OS, SyncMode::FDATASYNC,
+                    SyncMode::FSYNC, SyncMode::DSYNC}) {
+    const std::string path =
+        "test_data/sync" + std::to_string(static_cast<int>(mode)) + ".dat";
+    std::vector<uint8_t> data = {1, 2, 3, 4};
+    auto file = FileObj::create_and_write(path, data, mode);
+
+    // 追加写入后同步, 读取时能看到所有数据
+    std::vector<uint8_t> more = {5, 6};
+    EXPECT_TRUE(file.append(more));
+    EXPECT_TRUE(file.append_uint32(7));
+    EXPECT_TRUE(file.sync());
+    EXPECT_TRUE(file.sync_data());
+    EXPECT_EQ(file.size(), 10);
+    EXPECT_EQ(file.read_uint8(4), 5);
+    EXPECT_EQ(file.read_uint32(6), 7);
+
+    auto opened_file = FileObj::open(path, false);
+    EXPECT_EQ(opened_file.size(), 10);
+    EXPECT_EQ(opened_file.read_to_slice(0, 4), data);
+  }
+}
+
 TEST_F(FileTest, TruncateFile) {
   const std::string path = "test_data/truncate.dat";
   std::vector<uint8_t> data = {10, 20, 30, 40, 50, 60, 70, 80};
@@ -272,6 +308,182 @@ TEST(BloomFilterTest, ComprehensiveTest) {
 
 }
 
+// 测试按每个 key 的位数创建布隆过滤器
+TEST(BloomFilterTest, BitsPerKey) {
+  // 每个 key 10 位, 理论假阳性率约为 0.8%
+  auto bf = BloomFilter::with_bits_per_key(5000, 10);
+  EXPECT_EQ(bf.num_bits(), 50000);
+
+  // add 与 add_hashes 的结果应一致
+  for (int i = 0; i < 5000; ++i) {
+    auto key = "key" + std::to_string(i);
+    if (i % 2 == 0) {
+      bf.add(key);
+    } else {
+      auto [h1, h2] = BloomFilter::base_hashes(key);
+      bf.add_hashes(h1, h2);
+    }
+  }
+
+  // 编码后再解码, 不能出现假阴性
+  auto decoded = BloomFilter::decode(bf.encode());
+  for (int i = 0; i < 5000; ++i) {
+    EXPECT_TRUE(decoded.possibly_contains("key" + std::to_string(i)));
+  }
+
+  int false_positives = 0;
+  for (int i = 5000; i < 15000; ++i) {
+    if (decoded.possibly_contains("key" + std::to_string(i))) {
+      ++false_positives;
+    }
+  }
+  EXPECT_LE(static_cast<double>(false_positives) / 10000, 0.02);
+}
+
+// 测试 xor 过滤器以及按类型编解码
+TEST(XorFilterTest, BuildAndQuery) {
+  std::vector<uint64_t> hashes;
+  for (int i = 0; i < 10000; ++i) {
+    hashes.push_back(XorFilter::key_hash("key" + std::to_string(i)));
+  }
+  // 重复的 key 不影响构建
+  hashes.push_back(XorFilter::key_hash("key0"));
+  XorFilter xf(hashes);
+
+  // 每个 key 约 1.23 个 8 位指纹
+  EXPECT_LE(xf.num_fingerprints(), 10000 * 1.23 + 32);
+
+  auto decoded = Filter::decode_with_type(Filter::encode_with_type(xf));
+  EXPECT_EQ(decoded->type(), FilterType::XOR);
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_TRUE(decoded->possibly_contains("key" + std::to_string(i)));
+  }
+
+  // 理论假阳性率约为 1/256
+  int false_positives = 0;
+  for (int i = 10000; i < 30000; ++i) {
+    if (decoded->possibly_contains("key" + std::to_string(i))) {
+      ++false_positives;
+    }
+  }
+  EXPECT_LE(static_cast<double>(false_positives) / 20000, 0.01);
+
+  // 空的过滤器
+  XorFilter empty_xf(std::vector<uint64_t>{});
+  EXPECT_FALSE(empty_xf.possibly_contains("key0"));
+}
+
+// 测试前缀提取器
+TEST(PrefixExtractorTest, Extract) {
+  FixedPrefixExtractor fixed(4);
+  EXPECT_FALSE(fixed.in_domain("abc"));
+  EXPECT_EQ(fixed.transform("abcdef"), "abcd");
+  EXPECT_FALSE(fixed.query_prefix("ab").has_value());
+  EXPECT_EQ(fixed.query_prefix("abcde").value(), "abcd");
+
+  HeaderPrefixExtractor header({"SET_", "ZSET_"}, '_');
+  EXPECT_FALSE(header.in_domain("HASH_a_b"));
+  EXPECT_FALSE(header.in_domain("SET_a"));
+  EXPECT_EQ(header.transform("SET_a_b"), "SET_a_");
+  EXPECT_EQ(header.transform("ZSET_a_SCORE_1"), "ZSET_a_");
+  // 查询前缀与以其开头的 key 提取的前缀相同
+  EXPECT_EQ(header.query_prefix("ZSET_a_SCORE_").value(),
+            header.transform("ZSET_a_SCORE_0001_x"));
+  EXPECT_NE(fixed.name(), header.name());
+
+  // header 之间不能互为前缀
+  EXPECT_THROW(HeaderPrefixExtractor({"SET_", "SET_A_"}, '_'),
+               std::invalid_argument);
+}
+
+// 测试范围过滤器
+TEST(RangeFilterTest, RangeAndPreffix) {
+  std::vector<std::string> keys = {"apple", "apple", "applesauce", "banana",
+                                   "band",  "cat",   "dog1",       "dog2"};
+  RangeFilter::Builder builder;
+  for (const auto &key : keys) {
+    builder.add(key);
+  }
+  auto rf = builder.finish();
+  // 重复的 key 只记录一次
+  EXPECT_EQ(rf.num_entries(), 7);
+
+  auto decoded = Filter::decode_with_type(Filter::encode_with_type(rf));
+  auto range_filter = std::dynamic_pointer_cast<RangeFilter>(decoded);
+  ASSERT_NE(range_filter, nullptr);
+
+  // 包含 key 的范围不能被过滤
+  for (const auto &key : keys) {
+    EXPECT_TRUE(range_filter->possibly_contains(key));
+    EXPECT_TRUE(range_filter->may_contain_range(key, key + "z"));
+    EXPECT_TRUE(range_filter->may_contain_preffix(key.substr(0, 2)));
+  }
+  EXPECT_TRUE(range_filter->may_contain_range("b", "bana"));
+  EXPECT_TRUE(range_filter->may_contain_preffix("band"));
+  EXPECT_TRUE(range_filter->may_contain_preffix("dog"));
+
+  // 不包含 key 的范围
+  EXPECT_FALSE(range_filter->may_contain_range("a", "ap"));
+  EXPECT_FALSE(range_filter->may_contain_range("bb", "bz"));
+  EXPECT_FALSE(range_filter->may_contain_range("dz", "zz"));
+  EXPECT_FALSE(range_filter->may_contain_preffix("bo"));
+  EXPECT_FALSE(range_filter->may_contain_preffix("e"));
+}
+
+TEST(Crc32cTest, KnownValues) {
+  std::string digits = "123456789";
+  EXPECT_EQ(crc32c_value(reinterpret_cast<const uint8_t *>(digits.data()),
+                         digits.size()),
+            0xE3069283);
+
+  std::vector<uint8_t> zeros(32, 0);
+  EXPECT_EQ(crc32c_value(zeros.data(), zeros.size()), 0x8A9136AA);
+
+  std::vector<uint8_t> ones(32, 0xFF);
+  EXPECT_EQ(crc32c_value(ones.data(), ones.size()), 0x62A8AB43);
+
+  // 分段计算与整体计算结果一致, 包括不对齐的起始位置和长度
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<uint8_t>(i * 7 + 3);
+  }
+  uint32_t whole = crc32c_value(data.data(), data.size());
+  uint32_t crc = crc32c_value(data.data(), 3);
+  crc = crc32c_extend(crc, data.data() + 3, 500);
+  crc = crc32c_extend(crc, data.data() + 503, data.size() - 503);
+  EXPECT_EQ(crc, whole);
+}
+
+TEST(ArenaTest, Allocate) {
+  Arena arena(1024);
+  EXPECT_EQ(arena.allocated_bytes(), 0);
+  EXPECT_EQ(arena.memory_usage(), 0);
+
+  std::vector<std::pair<char *, size_t>> allocs;
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<size_t> dis(1, 600);
+  size_t bytes = 0;
+  for (int i = 0; i < 1000; i++) {
+    size_t size = dis(gen);
+    char *mem = arena.allocate(size);
+    // 按指针大小对齐
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(mem) % sizeof(void *), 0);
+    std::memset(mem, i % 256, size);
+    allocs.emplace_back(mem, size);
+    bytes += (size + 7) / 8 * 8;
+  }
+  EXPECT_EQ(arena.allocated_bytes(), bytes);
+  EXPECT_GE(arena.memory_usage(), arena.allocated_bytes());
+
+  // 之前分配的内存不会被覆盖
+  for (size_t i = 0; i < allocs.size(); i++) {
+    auto [mem, size] = allocs[i];
+    for (size_t j = 0; j < size; j++) {
+      ASSERT_EQ(static_cast<unsigned char>(mem[j]), i % 256);
+    }
+  }
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
@@ -1,10 +1,13 @@
 #include "../include/logger/logger.h"
+#include "../include/wal/log_format.h"
 #include "../include/wal/record.h"
 #include "../include/lsm/engine.h"
 #include "../include/wal/wal.h"
+#include <chrono>
 #include <filesystem>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <thread>
 
 using namespace testing;
 using namespace ::tiny_lsm;
@@ -21,7 +24,7 @@ public:
 
   FileObj *get_log_file() { return &log_file_; }
 
-  std::vector<Record> &get_log_buffer() { return log_buffer_; }
+  size_t get_log_buffer_size() { return log_buffer_records_; }
 
   size_t get_file_size_limit() { return file_size_limit_; }
 
@@ -100,13 +103,13 @@ TEST_F(WALTest, LogAndFlush) {
   }
 
   wal.log(records1, false);
-  EXPECT_EQ(wal.get_log_buffer().size(), 8);
+  EXPECT_EQ(wal.get_log_buffer_size(), 8);
 
   wal.log(records2, false);
-  EXPECT_EQ(wal.get_log_buffer().size(), 0);
+  EXPECT_EQ(wal.get_log_buffer_size(), 0);
 
   wal.flush();
-  EXPECT_EQ(wal.get_log_buffer().size(), 0);
+  EXPECT_EQ(wal.get_log_buffer_size(), 0);
 }
 
 TEST_F(WALTest, RecoverTest) {
@@ -158,6 +161,200 @@ TEST_F(WALTest, RecoverTest) {
   }
 }
 
+TEST_F(WALTest, BackgroundSync) {
+  {
+    // 每 5ms 或者积累 256 字节后由后台线程同步
+    WAL wal(test_dir, 1, 0, 1, 1 << 20, SyncMode::FDATASYNC, 5, 256);
+    for (uint64_t tranc_id = 1; tranc_id <= 100; tranc_id++) {
+      wal.log({Record::putRecord(tranc_id, "key", "value"),
+               Record::commitRecord(tranc_id)},
+              true);
+    }
+    // 写入返回时数据已经交给操作系统, 其他进程可以读到
+    auto tranc_records = WAL::recover(test_dir, 0);
+    EXPECT_EQ(tranc_records.size(), 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  auto tranc_records = WAL::recover(test_dir, 0);
+  ASSERT_EQ(tranc_records.size(), 100);
+  for (auto &[tranc_id, records] : tranc_records) {
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].getValue(), "value");
+  }
+}
+
+class RecycleWAL : public WAL {
+public:
+  RecycleWAL(const std::string &log_dir)
+      : WAL(log_dir, 1, 0, 1, 256, SyncMode::OS, 0, 0, true, 2) {}
+
+  void clean() { cleanWALFile(); }
+};
+
+static size_t count_wal_files(const std::string &dir) {
+  size_t count = 0;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.path().filename().string().find("wal.") == 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+TEST_F(WALTest, RecycleFiles) {
+  {
+    RecycleWAL wal(test_dir);
+    std::string old_value(200, 'o');
+    for (uint64_t tranc_id = 1; tranc_id <= 20; tranc_id++) {
+      wal.log({Record::putRecord(tranc_id, "key", old_value),
+               Record::commitRecord(tranc_id)},
+              true);
+    }
+    auto file_num = count_wal_files(test_dir);
+    ASSERT_GT(file_num, 3);
+
+    // 旧文件全部完成检查点, 保留 2 个用于复用, 其余删除
+    wal.set_checkpoint_tranc_id(20);
+    wal.clean();
+    EXPECT_EQ(count_wal_files(test_dir), 3);
+
+    // 复用的文件从头覆盖写入, 新的记录较短, 末尾残留着旧记录
+    for (uint64_t tranc_id = 21; tranc_id <= 40; tranc_id++) {
+      wal.log({Record::putRecord(tranc_id, "key", "new"),
+               Record::commitRecord(tranc_id)},
+              true);
+    }
+    EXPECT_EQ(count_wal_files(test_dir), 4);
+  }
+
+  // 旧文件每写入 2 次切换, 写入 20 后切换到空的新文件
+  // 复用文件中残留的旧记录无法通过校验, 不会被恢复
+  auto tranc_records = WAL::recover(test_dir, 0);
+  ASSERT_EQ(tranc_records.size(), 20);
+  for (auto &[tranc_id, records] : tranc_records) {
+    EXPECT_GE(tranc_id, 21);
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].getValue(), "new");
+  }
+}
+
+TEST(LogFormatTest, FragmentAndVerify) {
+  // 大于一个块的记录被切分为 FIRST / MIDDLE / LAST 分片
+  std::vector<std::vector<uint8_t>> payloads = {
+      std::vector<uint8_t>(100, 'a'),
+      std::vector<uint8_t>(LogFormat::BLOCK_SIZE * 2 + 17, 'b'),
+      // 前两条记录在第三个块中占用 161 字节, 写入这条记录后块内只剩 5 字节,
+      // 放不下分片头, 需要填充
+      std::vector<uint8_t>(LogFormat::BLOCK_SIZE - 177, 'c'),
+      std::vector<uint8_t>(1, 'd')};
+  std::vector<uint8_t> data;
+  for (auto &payload : payloads) {
+    LogFormat::encode(data, data.size(), payload.data(), payload.size(), 7);
+  }
+  EXPECT_EQ(LogFormat::decode(data, 7), payloads);
+
+  // 日志编号不一致的分片视为旧文件残留的记录
+  EXPECT_TRUE(LogFormat::decode(data, 8).empty());
+
+  // 损坏的分片及之后的记录不会被解码
+  auto corrupted = data;
+  corrupted[LogFormat::BLOCK_SIZE + 5] ^= 0x1;
+  auto decoded = LogFormat::decode(corrupted, 7);
+  ASSERT_EQ(decoded.size(), 1);
+  EXPECT_EQ(decoded[0], payloads[0]);
+
+  // 写了一半的记录被丢弃
+  auto torn = data;
+  torn.resize(data.size() - 1);
+  EXPECT_EQ(LogFormat::decode(torn, 7).size(), 3);
+}
+
+TEST_F(WALTest, SegmentIndexClean) {
+  class IndexWAL : public WAL {
+  public:
+    IndexWAL(const std::string &log_dir) : WAL(log_dir, 1, 0, 1, 256) {}
+    void clean() { cleanWALFile(); }
+  };
+
+  IndexWAL wal(test_dir);
+  for (uint64_t tranc_id = 1; tranc_id <= 30; tranc_id++) {
+    wal.log({Record::putRecord(tranc_id, "key", "value"),
+             Record::commitRecord(tranc_id)},
+            true);
+  }
+  auto file_num = count_wal_files(test_dir);
+
+  // 只删除所有记录都已完成检查点的文件
+  wal.set_checkpoint_tranc_id(15);
+  wal.clean();
+  EXPECT_LT(count_wal_files(test_dir), file_num);
+
+  auto tranc_records = WAL::recover(test_dir, 0);
+  for (uint64_t tranc_id = 16; tranc_id <= 30; tranc_id++) {
+    EXPECT_EQ(tranc_records.count(tranc_id), 1);
+  }
+  // 第一个文件中的记录都已完成检查点, 文件被删除
+  EXPECT_EQ(tranc_records.count(1), 0);
+}
+
+TEST_F(WALTest, LargeRecordAndTornWrite) {
+  std::string large_value(200 * 1024, 'v');
+  {
+    WAL wal(test_dir, 1, 0, 1, 4096);
+    for (uint64_t tranc_id = 1; tranc_id <= 3; tranc_id++) {
+      wal.log({Record::putRecord(tranc_id, "key", large_value),
+               Record::commitRecord(tranc_id)},
+              true);
+    }
+  }
+
+  // 超过 64KB 的记录完整恢复
+  auto tranc_records = WAL::recover(test_dir, 0);
+  ASSERT_EQ(tranc_records.size(), 3);
+  for (auto &[tranc_id, records] : tranc_records) {
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].getValue(), large_value);
+  }
+
+  // 模拟最后一个文件写到一半时崩溃
+  std::string last_path = test_dir + "/wal.2";
+  ASSERT_TRUE(std::filesystem::exists(last_path));
+  std::filesystem::resize_file(last_path,
+                               std::filesystem::file_size(last_path) / 2);
+  tranc_records = WAL::recover(test_dir, 0);
+  ASSERT_EQ(tranc_records.size(), 2);
+  EXPECT_EQ(tranc_records.count(3), 0);
+}
+
+TEST_F(WALTest, ParallelRecoverKeepsOrder) {
+  {
+    WAL wal(test_dir, 1, 0, 1, 512);
+    for (uint64_t tranc_id = 1; tranc_id <= 200; tranc_id++) {
+      wal.log({Record::putRecord(tranc_id, "key" + std::to_string(tranc_id),
+                                 "value"),
+               Record::commitRecord(tranc_id)},
+              true);
+    }
+  }
+
+  // 多个文件并行解码, 回调仍按照写入顺序进行, 检查点之前的记录被跳过
+  size_t file_count = 0;
+  uint64_t last_tranc_id = 50;
+  WAL::recover(
+      test_dir, 50,
+      [&](std::vector<Record> &records) {
+        file_count++;
+        for (auto &record : records) {
+          EXPECT_GE(record.getTrancId(), last_tranc_id);
+          last_tranc_id = record.getTrancId();
+        }
+      },
+      4);
+  EXPECT_GT(file_count, 4);
+  EXPECT_EQ(last_tranc_id, 200);
+}
+
 TEST_F(WALTest, PartialFlushRecoveryTest) {
   {
     LSM lsm(test_dir);
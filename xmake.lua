@@ -37,6 +37,7 @@ target("config")
 
 target("utils")
     set_kind("static")  -- 生成静态库
+    add_deps("config")
     add_files("src/utils/*.cpp")
     add_packages("toml11", "spdlog")
     add_includedirs("include", {public = true})
@@ -49,6 +50,7 @@ target("iterator")
 
 target("skiplist")
     set_kind("static")  -- 生成静态库
+    add_deps("utils")
     add_files("src/skiplist/*.cpp")
     add_packages("toml11", "spdlog")
     add_includedirs("include", {public = true})